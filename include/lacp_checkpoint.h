@@ -0,0 +1,54 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_CHECKPOINT_H__
+#define __LACP_CHECKPOINT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct ds;
+struct lacp_per_port_variables;
+
+/* Maps the checkpoint file and loads the ports the previous lacpd left
+ * in Collecting_Distributing.  Must be called before the OVSDB thread
+ * starts.  A missing, torn or foreign file just means a cold start. */
+extern void lacp_checkpoint_init(const char *path);
+
+/* True, once per interface, if the previous lacpd had name in
+ * Collecting_Distributing.  The OVSDB thread then leaves the
+ * interface's hw_bond_config as it is, instead of clearing it, until
+ * the protocol thread has either restored the port or detached it. */
+extern bool lacp_checkpoint_hold(const char *name);
+
+/* Called by LACP_initialize_port() once the port's admin variables are
+ * set.  If the checkpoint holds the port and its configuration and
+ * link still match, runs the state machines straight to
+ * Collecting_Distributing without sending a LACPDU on the way, and
+ * returns true.  Otherwise returns false and the port starts cold;
+ * if the previous lacpd had it enabled in hardware it is detached.
+ * Protocol thread only. */
+extern bool lacp_checkpoint_restore(struct lacp_per_port_variables *plpinfo);
+
+/* Writes the state of every LACP port of the calling protocol worker
+ * to the checkpoint, at most once per LACPD_CHECKPOINT_INTERVAL_MS.
+ * Ports with hardware programming in flight are left out.
+ * Protocol threads only, called after each event. */
+extern void lacp_checkpoint_run(void);
+
+extern void lacp_checkpoint_dump(struct ds *ds);
+
+#endif /* __LACP_CHECKPOINT_H__ */
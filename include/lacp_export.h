@@ -0,0 +1,156 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_EXPORT_H__
+#define __LACP_EXPORT_H__
+
+/*
+ * State export.
+ *
+ * lacpd publishes the state machines and PDU counters of every LACP
+ * port in a memory-mapped file (LACPD_EXPORT_FILE), so that show
+ * commands and monitoring can poll them without going through the
+ * protocol threads or OVSDB.  A reader maps the file read-only, checks
+ * the header's magic, version, n_ports and port_size, and copies ports
+ * with lacp_export_read_port().
+ *
+ * Each port slot is a seqlock: its sequence number is odd while lacpd
+ * writes the slot, and changes with every write.  lacpd creates a new
+ * file each time it starts, so a reader that sees updated_msec stop
+ * moving should map the file again.  Only this header is needed to read
+ * the file; values are in host byte order.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LACP_EXPORT_MAGIC       0x4c414353U     /* "LACS" */
+#define LACP_EXPORT_VERSION     2
+
+/* lacp_export_port actor_state and partner_state bits, as in the
+ * LACPDU. */
+#define LACP_EXPORT_STATE_ACTIVITY          0x01
+#define LACP_EXPORT_STATE_TIMEOUT           0x02
+#define LACP_EXPORT_STATE_AGGREGATION       0x04
+#define LACP_EXPORT_STATE_SYNCHRONIZATION   0x08
+#define LACP_EXPORT_STATE_COLLECTING        0x10
+#define LACP_EXPORT_STATE_DISTRIBUTING      0x20
+#define LACP_EXPORT_STATE_DEFAULTED         0x40
+#define LACP_EXPORT_STATE_EXPIRED           0x80
+
+/* One side of a port's aggregation: its oper variables. */
+struct lacp_export_side {
+    uint8_t             system_mac[6];
+    uint16_t            system_priority;
+    uint16_t            port_priority;
+    uint16_t            port_number;
+    uint16_t            key;
+    uint8_t             state;          /* LACP_EXPORT_STATE_* */
+    uint8_t             pad;
+};
+
+/* One port, as its protocol thread last published it. */
+struct lacp_export_port {
+    char                name[32];       /* "" if the slot is unused */
+    uint64_t            updated_msec;   /* CLOCK_MONOTONIC */
+    uint64_t            sport_handle;   /* aggregator, 0 if none */
+    uint16_t            lag_id;         /* configured LAG_ID */
+    uint8_t             lacp_up;
+    uint8_t             port_enabled;   /* link up */
+    uint8_t             selected;       /* UNSELECTED, SELECTED, STANDBY */
+    uint8_t             recv_fsm_state; /* RECV_FSM_*_STATE */
+    uint8_t             mux_fsm_state;  /* MUX_FSM_*_STATE */
+    uint8_t             periodic_tx_fsm_state;
+    struct lacp_export_side actor;
+    struct lacp_export_side partner;
+
+    /* lacp_port_stats_t */
+    uint64_t            lacp_pdus_sent;
+    uint64_t            marker_response_pdus_sent;
+    uint64_t            lacp_pdus_received;
+    uint64_t            marker_pdus_received;
+    uint64_t            lacp_pdus_fast_path;
+    uint64_t            pdus_dropped;
+    uint64_t            pdus_malformed;
+    uint64_t            pdus_queue_overflow;
+    uint64_t            pdus_tx_failed;
+};
+
+struct lacp_export_slot {
+    uint32_t            seq;            /* odd while being written */
+    uint32_t            pad;
+    struct lacp_export_port port;
+};
+
+struct lacp_export_header {
+    uint32_t            magic;
+    uint16_t            version;
+    uint16_t            n_ports;
+    uint32_t            port_size;      /* sizeof(struct lacp_export_slot) */
+    uint32_t            pid;            /* of the lacpd writing the file */
+    uint32_t            interval_ms;    /* LACPD_EXPORT_INTERVAL_MS */
+    uint32_t            pad;
+    uint64_t            updated_msec;   /* CLOCK_MONOTONIC, last publish */
+    uint64_t            n_publishes;
+};
+
+/* The file: the header, then n_ports slots indexed by interface
+ * index. */
+struct lacp_export_file {
+    struct lacp_export_header header;
+    struct lacp_export_slot ports[];
+};
+
+/* Copies slot into port.  Returns false if lacpd kept writing the slot
+ * for the whole of max_tries attempts. */
+static inline bool
+lacp_export_read_port(const struct lacp_export_slot *slot,
+                      struct lacp_export_port *port, int max_tries)
+{
+    uint32_t seq;
+
+    while (max_tries-- > 0) {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+
+        memcpy(port, &slot->port, sizeof *port);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+struct ds;
+
+/* Creates the export file.  Called once, before the protocol threads
+ * start.  An empty path disables the export. */
+extern void lacp_export_init(const char *path);
+
+/* Publishes the ports of the calling protocol worker, at most once per
+ * LACPD_EXPORT_INTERVAL_MS.  Protocol threads only, called after each
+ * event. */
+extern void lacp_export_run(void);
+
+extern void lacp_export_dump(struct ds *ds);
+
+#endif /* __LACP_EXPORT_H__ */
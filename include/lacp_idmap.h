@@ -0,0 +1,54 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_IDMAP_H__
+#define __LACP_IDMAP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct ds;
+
+/* Allocator for a dense range of integer IDs, kept as a bitmap of
+ * 64-bit words.  Allocation returns the lowest free ID; freeing is
+ * O(1).  An ID map is not thread safe: it belongs to the thread that
+ * initialized it, which is also the only one that may dump it. */
+struct lacp_idmap {
+    const char          *name;
+    int                 first;          /* lowest ID in the range */
+    unsigned int        size;           /* number of IDs */
+    unsigned int        n_words;
+    uint64_t            *words;         /* set bit = ID in use */
+    unsigned int        hint;           /* no free ID in words below it */
+    struct lacp_idmap   *next;          /* in the list of all ID maps */
+
+    /* Usage counters. */
+    unsigned int        n_in_use;
+    unsigned int        n_high_water;
+    unsigned long       n_allocs;
+    unsigned long       n_frees;
+    unsigned long       n_failures;     /* allocations with no free ID */
+};
+
+extern void lacp_idmap_init(struct lacp_idmap *map, const char *name,
+                            int first, unsigned int size);
+/* Returns the lowest free ID, or -1 if every ID is in use. */
+extern int lacp_idmap_alloc(struct lacp_idmap *map);
+/* Returns false if the ID is out of range or not in use. */
+extern bool lacp_idmap_free(struct lacp_idmap *map, int id);
+extern void lacp_idmap_dump(struct ds *ds);
+
+#endif /* __LACP_IDMAP_H__ */
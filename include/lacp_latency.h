@@ -0,0 +1,93 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_LATENCY_H__
+#define __LACP_LATENCY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct ds;
+struct lacp_per_port_variables;
+
+/* Stages of a port's way to Collecting_Distributing, in order.  A trace
+ * starts when the mux machine enters WAITING.  The first five stages
+ * are timed by the protocol thread, the rest by the OVSDB thread. */
+enum lacp_latency_stage {
+    LACP_LAT_RX_QUEUE,      /* RX thread read the LACPDU -> protocol thread */
+    LACP_LAT_SELECT,        /* protocol thread -> mux WAITING */
+    LACP_LAT_WAIT_WHILE,    /* WAITING -> ATTACHED */
+    LACP_LAT_ATTACHED,      /* ATTACHED -> COLLECTING (partner in sync) */
+    LACP_LAT_COLLECTING,    /* COLLECTING -> COLLECTING_DISTRIBUTING */
+    LACP_LAT_DB_QUEUE,      /* hw_bond_config rx queued -> in a transaction */
+    LACP_LAT_DB_COMMIT,     /* transaction built -> committed */
+    LACP_LAT_TOTAL,         /* trace start -> committed */
+    LACP_LAT_N_STAGES
+};
+
+#define LACP_LAT_N_FSM_STAGES   (LACP_LAT_COLLECTING + 1)
+
+/* Bucket 0 counts samples under 1 usec, bucket n samples from 2^(n-1)
+ * up to 2^n usec.  The last bucket also takes everything longer
+ * (2^26 usec is about 67 sec). */
+#define LACP_LAT_BUCKETS        28
+
+/* Per-port trace, kept in lacp_port_cold_t.  Times are
+ * lacp_latency_now() values, 0 if the stage was not reached. */
+typedef struct lacp_latency_trace {
+    unsigned long long t_rx;
+    unsigned long long t_fsm;
+    unsigned long long t_waiting;
+    unsigned long long t_attached;
+    unsigned long long t_collecting;
+    bool active;
+
+    /* Stage times of the last trace that reached Collecting_
+     * Distributing, in usec.  Written by the protocol thread with
+     * atomic stores, so lacpd/getlacplatency can read them. */
+    unsigned int last_usec[LACP_LAT_N_FSM_STAGES];
+} lacp_latency_trace_t;
+
+/* Microseconds on CLOCK_MONOTONIC. */
+extern unsigned long long lacp_latency_now(void);
+
+/* Adds a sample to a stage's histogram.  Each stage must only be
+ * recorded from one thread. */
+extern void lacp_latency_record(enum lacp_latency_stage stage,
+                                unsigned long long usec);
+
+/* Brackets the handling of a batch of LACPDUs the RX thread read at
+ * rx_usec (0 if unknown), so a trace started by one of them begins
+ * there.  Protocol thread only. */
+extern void lacp_latency_rx_begin(unsigned long long rx_usec);
+extern void lacp_latency_rx_end(void);
+
+/* Called by the mux machine when it enters a state.  Protocol thread
+ * only. */
+extern void lacp_latency_mux_state(struct lacp_per_port_variables *plpinfo,
+                                   int mux_state);
+
+/* Start of the port's trace, or 0 if no trace is running.  Protocol
+ * thread only. */
+extern unsigned long long
+lacp_latency_trace_start(const lacp_latency_trace_t *trace);
+
+extern const char *lacp_latency_stage_name(enum lacp_latency_stage stage);
+extern void lacp_latency_dump(struct ds *ds);
+extern void lacp_latency_trace_dump(struct ds *ds,
+                                    const lacp_latency_trace_t *trace);
+
+#endif /* __LACP_LATENCY_H__ */
@@ -72,7 +72,7 @@
  *      exit
  *      list-commands
  *      version
- *      lacpd/dump [{interface [interface name]} | {port [port name]}]
+ *      lacpd/dump [{interface [interface name]} | {port [port name]} | queue | pool | tx | checkpoint | export | filter | workers | hw | link]
  *      vlog/disable-rate-limit [module]...
  *      vlog/enable-rate-limit  [module]...
  *      vlog/list
@@ -103,6 +103,7 @@
  *
  *      /var/run/openvswitch/lacpd.pid: Process ID for the lacpd daemon
  *      /var/run/openvswitch/lacpd.<pid>.ctl: Control file for ovs-appctl
+ *      /var/run/openvswitch/lacpd.ckpt: Protocol state kept for warm restarts
  *
  ***************************************************************************/
 
@@ -119,11 +120,28 @@
 #include "mvlan_lacp.h"
 #include "lacp.h"
 
+/* One side's lacp_status values as last set, and the raw values they
+ * were formatted from.  A string is only formatted again when its raw
+ * value changes. */
 struct lacp_status_values {
-    char *system_id;
-    char *port_id;
-    char *key;
-    char *state;
+    bool                valid;              /*!< false=nothing set yet */
+    system_variables_t  system;
+    u_short             port_priority;
+    u_short             port_number;
+    u_short             key_value;
+    state_parameters_t  state_value;
+    char                system_id[24];      /*!< "prio,xx:xx:xx:xx:xx:xx" */
+    char                port_id[12];        /*!< "prio,number" */
+    char                key[8];
+    char                state[128];         /*!< Eight "name:0|1" flags */
+};
+
+/* Member interface bond_status, as last written by lacpd. */
+enum lacpd_bond_state {
+    BOND_STATE_NONE,
+    BOND_STATE_UP,
+    BOND_STATE_BLOCKED,
+    BOND_STATE_DOWN
 };
 
 /*************************************************************************//**
@@ -131,13 +149,15 @@ struct lacp_status_values {
  * @brief lacpd's internal data strucuture to store per interface data.
  ****************************************************************************/
 struct iface_data {
-    char                *name;              /*!< Name of the interface */
+    const char          *name;              /*!< Name of the interface, the all_interfaces key */
     enum ovsrec_interface_type_e intf_type; /*!< Interface type */
     struct port_data    *port_datap;        /*!< Pointer to associated port's port_data */
     unsigned int        link_speed;         /*!< Operarational link speed of the interface */
     bool                lag_eligible;       /*!< indicates whether this interface is eligible
                                               to become member of configured LAG */
+    bool                ckpt_hold;          /*!< hw_bond_config kept from the previous lacpd */
     enum ovsrec_interface_link_state_e link_state; /*!< operational link state */
+    unsigned int        link_seqno;         /*!< link_state changes seen in OVSDB */
     enum ovsrec_interface_duplex_e duplex;  /*!< operational link duplex */
 
     /* These members are valid only within lacpd_reconfigure(). */
@@ -161,6 +181,7 @@ struct iface_data {
 
     /* LACPDU send/receive related. */
     int                 pdu_sockfd;         /*!< Socket FD for LACPDU rx/tx */
+    int                 ifindex;            /*!< Kernel interface index */
     bool                pdu_registered;     /*!< Indicates if port is registered to receive LACPDU */
 
     /* LACP status values formatted */
@@ -168,7 +189,21 @@ struct iface_data {
     struct lacp_status_values partner;      /*!< Currently set lacp status values - partner */
     bool                      lacp_current; /*!< Currently set lacp_current value */
     bool                      lacp_current_set; /*!< false=lacp_current is not set, true=lacp_current is set */
+    bool                      status_in_txn; /*!< lacp_status written into wb_txn */
     struct state_parameters   local_state;
+
+    /* bond_status bookkeeping. */
+    enum lacpd_bond_state bond_state;       /*!< Currently set bond_status value */
+    bool                bond_status_synced; /*!< false=bond_status must be rewritten */
+    struct port_data    *bond_port;         /*!< LAG whose bond counters include bond_state */
+
+    /* Convergence latency of the last RX enable, lacp_latency_now()
+     * values.  OVSDB thread only. */
+    unsigned long long  lat_start;          /*!< Trace start on the protocol thread */
+    unsigned long long  lat_queued;         /*!< hw_bond_config RX enable queued */
+    unsigned long long  lat_applied;        /*!< Written into a transaction */
+    bool                lat_in_txn;         /*!< Waiting for wb_txn to commit */
+    unsigned int        lat_last_usec[LACP_LAT_N_STAGES]; /*!< Last DB stage times */
 };
 
 /**
@@ -176,7 +211,8 @@ struct iface_data {
  * OVSDB interface functions for lacpd.
  * @{
  */
-// H/W Configuration function
+// H/W Configuration function.  These only queue the hw_bond_config
+// change; they never wait for it (see lacpd_hw_ops_in_flight()).
 extern void ops_trunk_port_egr_enable(uint16_t lag_id, int port);
 extern void ops_attach_port_in_hw(uint16_t lag_id, int port);
 extern void ops_detach_port_in_hw(uint16_t lag_id, int port);
@@ -190,9 +226,54 @@ extern void db_delete_lag_port(uint16_t lag_id, int port, lacp_per_port_variable
 
 extern void db_update_interface(lacp_per_port_variables_t *plpinfo);
 
+// Bracket the handling of one event by a protocol thread.  The LAG
+// and hw_bond_config changes it makes are queued together at the end,
+// so they go out in the same OVSDB transaction.
+extern void db_writeback_pass_begin(void);
+extern void db_writeback_pass_end(void);
+
 // Utility functions
 extern struct iface_data *find_iface_data_by_index(int index);
 
+/*************************************************************************//**
+ * @ingroup lacpd_ovsdb_if
+ * @brief Copy of the interface configuration the LACP protocol thread
+ *        needs, published by the OVSDB thread.
+ ****************************************************************************/
+struct lacpd_iface_cfg {
+    char                name[32];           /*!< Name of the interface */
+    uint16_t            cfg_lag_id;         /*!< Configured LAG_ID */
+    bool                lacp_enabled;       /*!< LACP is enabled */
+    bool                valid;              /*!< Interface index is in use */
+    int                 link_state;         /*!< INTERFACE_LINK_STATE_UP or _DOWN */
+    unsigned int        link_seqno;         /*!< Bumped on each link_state change */
+    unsigned int        link_speed;         /*!< Operational link speed */
+};
+
+/**************************************************************************//**
+ * Copies the published configuration of an interface without taking
+ * OVSDB_LOCK.  Safe to call from any thread.
+ *
+ * @param index interface index.
+ * @param cfg filled in with the interface configuration.
+ *
+ * @return true if the index refers to a known interface.
+ *****************************************************************************/
+extern bool lacpd_iface_cfg_get(int index, struct lacpd_iface_cfg *cfg);
+
+/**************************************************************************//**
+ * Number of hardware programming requests (ops_attach_port_in_hw(),
+ * ops_detach_port_in_hw(), ops_trunk_port_egr_enable()) queued for an
+ * interface whose write-back transaction has not committed yet.
+ * Safe to call from any thread.
+ *
+ * @param index interface index.
+ *
+ * @return the number of requests in flight, 0 once hw_bond_config is
+ *         up to date.
+ *****************************************************************************/
+extern unsigned int lacpd_hw_ops_in_flight(int index);
+
 /**************************************************************************//**
  * Initializes OVSDB interface.
  * Called by lacpd's initialization code to create a connection to OVSDB
@@ -272,6 +353,20 @@ extern void lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[]
  *****************************************************************************/
 extern void lacpd_state_dump(struct ds *ds, int argc, const char *argv[]);
 
+/**************************************************************************//**
+ * Debug function to dump the convergence latency histograms, and the
+ * stage times of the last convergence of every interface of all the
+ * LAG ports in the daemon or of an individual specified port.
+ * Called by lacpd's appctl interface.
+ *
+ * @param[in,out] ds pointer to struct ds that holds the debug output.
+ * @param[in] argc number of arguments passed to this function.
+ * @param[in] argv variable argument list.
+ *
+ *****************************************************************************/
+extern void lacpd_latency_dump(struct ds *ds, int argc, const char *argv[]);
+extern void lacpd_memstats_dump(struct ds *ds);
+
 /**************************************************************************//**
  * lacpd daemon's main OVS interface function.
  *
@@ -0,0 +1,58 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_POOL_H__
+#define __LACP_POOL_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+struct ds;
+
+/* Fixed-size object pool.  Objects are carved out of slabs that are
+ * never returned to the heap, and freed objects are kept on a free list
+ * for reuse.  Pools are defined statically with LACP_POOL_INITIALIZER
+ * and are not thread safe: a pool belongs to the LACP protocol thread.
+ * Only the counters may be read from another thread. */
+struct lacp_pool {
+    const char          *name;
+    size_t              obj_size;
+    unsigned int        objs_per_slab;
+    void                *free_list;
+    struct lacp_pool    *next;          /* in the list of all pools */
+    bool                registered;
+
+    /* Usage counters. */
+    unsigned long       n_slabs;
+    unsigned long       n_in_use;
+    unsigned long       n_high_water;
+    unsigned long       n_allocs;
+};
+
+#define LACP_POOL_INITIALIZER(NAME, TYPE, OBJS_PER_SLAB) \
+    { NAME, sizeof(TYPE), OBJS_PER_SLAB, NULL, NULL, false, 0, 0, 0, 0 }
+
+/* Returns a zeroed object, or NULL if out of memory. */
+extern void *lacp_pool_alloc(struct lacp_pool *pool);
+extern void lacp_pool_free(struct lacp_pool *pool, void *obj);
+
+/* Bytes held by the slabs of the pool named name, 0 if it has not
+ * allocated yet.  Sets *n_in_use to its objects in use.  Safe from any
+ * thread. */
+extern size_t lacp_pool_memory(const char *name, unsigned long *n_in_use);
+extern void lacp_pool_dump(struct ds *ds);
+
+#endif /* __LACP_POOL_H__ */
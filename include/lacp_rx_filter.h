@@ -0,0 +1,52 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_RX_FILTER_H__
+#define __LACP_RX_FILTER_H__
+
+#include <stdbool.h>
+
+struct ds;
+struct lacp_per_port_variables;
+
+/* Loads the in-kernel LACPDU filter.  Called once, before any RX socket
+ * is opened.  Without LACPD_RX_EBPF, or if the kernel refuses the
+ * program, lacpd uses the classic slow-protocol filter only. */
+extern void lacp_rx_filter_init(void);
+
+/* The eBPF program to attach to RX sockets with SO_ATTACH_BPF, or -1
+ * to attach the classic filter. */
+extern int lacp_rx_filter_prog(void);
+
+/* Tells the filter which ifindex an interface index receives on; 0
+ * when the interface is deregistered.  Protocol thread of the port. */
+extern void lacp_rx_filter_port(int port, int ifindex);
+
+/* Called after each state machine run.  Lets the kernel drop the
+ * port's LACPDUs that are identical to the last one while the receive
+ * machine's fast path applies, and takes them back as soon as it does
+ * not. */
+extern void lacp_rx_filter_update(struct lacp_per_port_variables *plpinfo);
+
+/* Called when the port's current_while timer expires.  If the kernel
+ * dropped an identical LACPDU less than a timeout ago, restarts the
+ * timer from that LACPDU and returns true; the partner is still
+ * current. */
+extern bool lacp_rx_filter_refresh(struct lacp_per_port_variables *plpinfo);
+
+extern void lacp_rx_filter_dump(struct ds *ds);
+
+#endif /* __LACP_RX_FILTER_H__ */
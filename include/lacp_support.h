@@ -35,6 +35,9 @@
 
 #define MAX_ASYNC_TX                    3
 
+/* Size of the port table; PM_HANDLE2PORT() is 8 bits wide. */
+#define LACP_MAX_PORTS                  256
+
 /*****************************************************************************
  *      DEFAULT VALUES
  *****************************************************************************/
@@ -70,6 +73,8 @@ extern void LACP_receive_fsm(int, int, lacpdu_payload_t *,
 extern void LACP_transmit_lacpdu(lacp_per_port_variables_t *);
 extern void LACP_process_lacpdu(struct lacp_per_port_variables *,
                                 void *);
+extern int LACP_rx_fast_path_ready(lacp_per_port_variables_t *);
+extern void LACP_process_unchanged_lacpdu(lacp_per_port_variables_t *);
 extern void LACP_initialize_port(port_handle_t lport_handle,
                                  unsigned short port_id,
                                  unsigned long flags,
@@ -88,6 +93,8 @@ extern void LACP_update_port_params(port_handle_t lport_handle,
                                     short data, int hw_collecting);
 extern int port_number_2_link_group_index(int);
 extern void LAG_selection(lacp_per_port_variables_t *);
+extern void LAG_remove_member(LAG_t *, lacp_per_port_variables_t *);
+extern void LAG_destroy(LAG_t *);
 extern void LAG_id_string(char *const, LAG_Id_t *const);
 extern int loop_back_check(lacp_per_port_variables_t *);
 extern void print_lacp_fsm_state(port_handle_t);
@@ -112,12 +119,19 @@ extern void set_lport_overrides(port_handle_t, int, unsigned char *);
 
 extern void lacp_support_diag_dump(int port);
 
+extern lacp_per_port_variables_t *LACP_port_by_index(int);
+extern lacp_per_port_variables_t *LACP_port_find(port_handle_t);
+extern lacp_per_port_variables_t *LACP_port_first(void);
+extern lacp_per_port_variables_t *LACP_port_next(lacp_per_port_variables_t *);
+extern size_t LACP_ports_memory(int *n_in_use);
+extern void LACP_port_stats_snapshot(const lacp_per_port_variables_t *,
+                                     lacp_port_stats_t *);
+
 /*****************************************************************************
  *       Extern declarations for global variables
  *****************************************************************************/
 extern unsigned char my_mac_addr[];
 extern uint actor_system_priority;
-extern lacp_avl_tree_t lacp_per_port_vars_tree;
 extern const unsigned char lacp_mcast_addr[];
 extern const unsigned char default_partner_system_mac[];
 extern int lacp_tables_last_changed_time;
@@ -0,0 +1,49 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_TIMER_H__
+#define __LACP_TIMER_H__
+
+#include <stdbool.h>
+
+#define LACP_TIMER_MSEC_PER_SEC     1000
+
+/* One-shot timer kept on the LACP timer wheel.  Embedded in the object
+ * it times; the handler recovers the owner from the timer address.
+ * A zeroed timer is valid and stopped.  All timer functions must be
+ * called from the LACP protocol thread that owns the timer's port;
+ * they use that worker's wheel. */
+typedef struct lacp_timer {
+    struct lacp_timer   *t_next;
+    struct lacp_timer   **t_pprev;      /* NULL when not running */
+    unsigned long long  t_expires;      /* wheel tick */
+    void                (*t_handler)(struct lacp_timer *);
+} lacp_timer_t;
+
+extern int lacp_timer_init(void);
+/* timerfd of a protocol worker's wheel, readable when it is due. */
+extern int lacp_timer_fd(int worker);
+extern void lacp_timer_setup(lacp_timer_t *timer,
+                             void (*handler)(lacp_timer_t *));
+extern void lacp_timer_start(lacp_timer_t *timer, unsigned int msec);
+extern void lacp_timer_start_phase(lacp_timer_t *timer, unsigned int period,
+                                   unsigned int phase);
+extern void lacp_timer_stop(lacp_timer_t *timer);
+extern bool lacp_timer_running(const lacp_timer_t *timer);
+extern unsigned int lacp_timer_remaining(const lacp_timer_t *timer);
+extern void lacp_timer_run(void);
+
+#endif /* __LACP_TIMER_H__ */
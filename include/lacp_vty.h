@@ -35,10 +35,15 @@
 #define OVSDB_LB_L3_HASH    (LAG_LB_ALG_L3 OVSDB_LB_HASH_SUFFIX)
 #define OVSDB_LB_L4_HASH    (LAG_LB_ALG_L4 OVSDB_LB_HASH_SUFFIX)
 
+struct ovsdb_idl;
+struct ovsrec_port;
+
 void cli_pre_init(void);
 void cli_post_init(void);
 bool lacp_exceeded_maximum_lag(void);
 int vtysh_init_intf_lag_context_clients();
 char * lacp_remove_lb_hash_suffix(const char * lb_hash);
+const struct ovsrec_port *lacp_find_intf_lag(struct ovsdb_idl *lag_idl,
+                                             const char *if_name);
 
 #endif /* _LACP_VTY_H */
@@ -0,0 +1,68 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACP_WORKER_H__
+#define __LACP_WORKER_H__
+
+#include <stdbool.h>
+
+#include "lacp.h"
+
+struct ds;
+
+/* lacp_worker_route() result for messages every worker must see. */
+#define LACP_WORKER_ALL         (-1)
+
+#if LACPD_PROTOCOL_WORKERS > 1
+/* Index of the protocol thread running on this thread.  The RX, OVSDB
+ * and tool threads count as worker 0. */
+extern __thread int lacp_worker_id;
+#define lacp_worker_self()      (lacp_worker_id)
+
+/* Worker a port runs on.  Changes only through a migration (see
+ * lacp_worker_redirect()); safe to call from any thread. */
+extern int lacp_worker_owner(int port);
+
+/* True if the calling protocol thread runs the port's state machines. */
+#define lacp_worker_owns(port)  (lacp_worker_owner(port) == lacp_worker_id)
+#else
+#define lacp_worker_self()      (0)
+#define lacp_worker_owner(port) (0)
+#define lacp_worker_owns(port)  (true)
+#endif
+
+/* Called by each protocol thread before it takes its first event. */
+extern void lacp_worker_start(int worker);
+
+/* Worker a message from the OVSDB thread goes to: a port's current
+ * owner for port messages, LACP_WORKER_ALL for system wide settings,
+ * worker 0 for aggregator messages.  body is the message body. */
+extern int lacp_worker_route(int peer, int msgnum, const void *body);
+
+/* Called by a protocol thread for each configuration message before
+ * applying it.  Returns true if the message was handed on to another
+ * worker instead: either the port is not ours (any more), or its
+ * aggregation key now belongs to another worker, in which case LACP
+ * is disabled on the port here first and the port moves along with
+ * the message. */
+extern bool lacp_worker_redirect(const ML_event *pevent);
+
+/* Counts a LACPDU that reached a worker the port had already left. */
+extern void lacp_worker_count_misrouted(void);
+
+extern void lacp_worker_dump(struct ds *ds);
+
+#endif /* __LACP_WORKER_H__ */
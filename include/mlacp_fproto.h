@@ -19,6 +19,9 @@
 
 #include "mvlan_lacp.h"
 
+struct ds;
+struct MLt_drivers_mlacp__rxPdu;
+
 //***************************************************************
 // Variables in lacpd.c
 //***************************************************************
@@ -30,13 +33,21 @@ extern bool exiting;
 extern void *mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)));
 extern void register_mcast_addr(port_handle_t lport_handle);
 extern void deregister_mcast_addr(port_handle_t lport_handle);
+extern void mlacp_tx_pdu_header(unsigned char *data);
 extern int mlacp_tx_pdu(unsigned char* data, int length, port_handle_t lport_handle);
-extern void *lacpd_protocol_thread(void *arg  __attribute__ ((unused)));
+extern void mlacp_tx_flush(void);
+extern void mlacp_tx_dump(struct ds *ds);
+extern void mlacp_link_dump(struct ds *ds);
+extern void *lacpd_protocol_thread(void *arg);
 extern int mlacp_init(u_long);
+extern void mlacp_event_queue_dump(struct ds *ds);
+extern void mlacp_event_cost_dump(struct ds *ds);
 
 //***************************************************************
 // Functions in mlacp_send.c
 //***************************************************************
+// Despite their names, none of these wait: hardware programming is
+// queued to the OVSDB thread and completes in the background.
 extern  int mlacp_blocking_send_select_aggregator(LAG_t *const lag,
                                                   lacp_per_port_variables_t *lacp_port);
 extern  int mlacp_blocking_send_attach_aggregator(lacp_per_port_variables_t *lacp_port);
@@ -57,10 +68,10 @@ extern void mlacp_process_rxPdu(port_handle_t sport_handle, unsigned char *data)
 //***************************************************************
 // Functions in lacp_task.c
 //***************************************************************
-extern void LACP_periodic_tx(void);
-extern void LACP_current_while_expiry(void);
-extern int lacp_lag_port_match(void *v1, void *v2);
+extern void LACP_init_port_timers(lacp_per_port_variables_t *plpinfo);
+extern void LACP_stop_port_timers(lacp_per_port_variables_t *plpinfo);
 extern void LACP_process_input_pkt(port_handle_t lport_handle, unsigned char * data, int len);
+extern void LACP_process_input_batch(struct MLt_drivers_mlacp__rxPdu *pdus, int count);
 
 //***************************************************************
 // Functions in mlacp_recv.c
@@ -70,6 +81,7 @@ extern void mlacp_process_vlan_msg(struct ML_event *);
 extern void mlacp_process_api_msg(struct ML_event *);
 extern void mlacp_process_timer(void);
 extern void mlacpVapiLportEvent(struct ML_event *pevent);
+extern void mlacp_process_config_batch(struct ML_event *pevent);
 
 //***************************************************************
 // Functions in lacp_support.c
@@ -80,5 +92,15 @@ extern void LACP_disable_lacp(port_handle_t lport_handle);
 extern void mlacpVapiSportParamsChange(int msg,
                                        struct MLt_vpm_api__lacp_sport_params *pin_lacp_params);
 
+// Between these two calls, mlacpVapiSportParamsChange() only records
+// the aggregator; its ports are unselected by the release.
+extern void mlacpVapiSportParamsHold(void);
+extern void mlacpVapiSportParamsRelease(void);
+
+// Sweep for an aggregator change made by another protocol worker.
+extern void mlacpVapiSportParamsNotify(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params);
+// Has every other protocol worker make that sweep.
+extern void mlacpVapiSportParamsNotifyOthers(port_handle_t sport_handle, int flags);
+
 
 #endif //_MLACP_FPROTO_H
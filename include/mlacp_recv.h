@@ -19,7 +19,8 @@
 
 
 enum MLm_drivers_mlacp {
-    MLm_drivers_mlacp__rxPdu = 0,   //% MLt_drivers_mlacp__rxPdu
+    MLm_drivers_mlacp__rxPdu = 0,       //% MLt_drivers_mlacp__rxPdu
+    MLm_drivers_mlacp__rxPduBatch = 1,  //% MLt_drivers_mlacp__rxPduBatch
 };
 
 struct MLt_drivers_mlacp__rxPdu {
@@ -28,4 +29,12 @@ struct MLt_drivers_mlacp__rxPdu {
     char data[LACP_PKT_SIZE];
 };
 
+// Up to LACPD_RX_BATCH_SIZE PDUs read in one RX thread wakeup, at
+// rx_usec (lacp_latency_now()).
+struct MLt_drivers_mlacp__rxPduBatch {
+    int  count;
+    unsigned long long rx_usec;
+    struct MLt_drivers_mlacp__rxPdu pdus[];
+};
+
 #endif  /* __MLACP_RECV_H__ */
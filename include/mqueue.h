@@ -17,25 +17,121 @@
 #ifndef __MQUEUE_H__
 #define __MQUEUE_H__
 
+#include <stddef.h>
 #include <pthread.h>
 #include <search.h>
 #include <semaphore.h>
 
-typedef struct qelem {
-    struct qelem   *q_forw;
-    struct qelem   *q_back;
+#define MQUEUE_CACHE_LINE   64
+#define MQUEUE_MAX_LANES    4
+
+/* Tagged mqueue_qelem so that it does not clash with the <search.h>
+ * struct qelem that glibc exposes under _GNU_SOURCE. */
+typedef struct mqueue_qelem {
+    struct mqueue_qelem *q_forw;
+    struct mqueue_qelem *q_back;
     void           *q_data;
+    unsigned long long q_stamp;     /* Send time, nsec */
 } qelem_t;
 
+/* Bounded ring cell.  c_seq tells producers and consumers whose turn
+ * it is to use the cell (see mqueue.c). */
+typedef struct mqueue_cell {
+    unsigned long   c_seq;
+    void           *c_data;
+    unsigned long long c_stamp;     /* Send time, nsec */
+} mqueue_cell_t;
+
+/* Fixed-capacity, lock-free ring of pointers.  Producer and consumer
+ * positions live on separate cache lines. */
+typedef struct mqueue_ring {
+    unsigned long   r_head __attribute__ ((aligned (MQUEUE_CACHE_LINE)));
+    unsigned long   r_tail __attribute__ ((aligned (MQUEUE_CACHE_LINE)));
+    unsigned long   r_mask;
+    mqueue_cell_t  *r_cells;
+} mqueue_ring_t;
+
+/* Priority lane.  Lane 0 has the highest priority.  The statistics
+ * are updated with relaxed atomics (see mqueue_get_stats). */
+typedef struct mqueue_lane {
+    mqueue_ring_t   l_ring;         /* Ring mode only */
+    unsigned long   l_sent;
+    unsigned long   l_received;
+    unsigned long   l_overflow;     /* Sends rejected, ring full */
+    unsigned long   l_promoted;     /* Received ahead of a busier lane */
+    unsigned int    l_depth_max;    /* Deepest the lane has been */
+    unsigned long long l_dwell_total_ns;
+    unsigned long long l_dwell_max_ns;
+    unsigned int    l_skipped;      /* Receiver only */
+} mqueue_lane_t;
+
 typedef struct mqueue {
     qelem_t         q_head;
     qelem_t         q_tail;
     pthread_mutex_t q_mutex;
-    sem_t           q_avail;
+    sem_t           q_avail;        /* Messages in all lanes */
+
+    /* Ring mode only (see mqueue_init_ring). */
+    mqueue_ring_t   q_free;         /* Free message slots */
+    char           *q_slots;        /* Preallocated slot storage */
+    size_t          q_slot_size;    /* Size of each slot */
+    unsigned int    q_capacity;     /* 0 in list mode */
+    unsigned int    q_starve_limit; /* Skips before a lane is promoted */
+    unsigned long   q_slot_misses;  /* Slot requests with no free slot */
+
+    /* List mode has a single lane. */
+    unsigned int    q_n_lanes;
+    mqueue_lane_t   q_lanes[MQUEUE_MAX_LANES];
 } mqueue_t;
 
+/* Snapshot of a lane's statistics.  Dwell time runs from a message
+ * being sent to it being received. */
+typedef struct mqueue_lane_stats {
+    unsigned long   sent;
+    unsigned long   received;
+    unsigned long   overflow;
+    unsigned long   promoted;
+    unsigned int    depth;
+    unsigned int    depth_max;
+    unsigned long long dwell_total_ns;
+    unsigned long long dwell_max_ns;
+} mqueue_lane_stats_t;
+
+/* A queue's statistics: the sum of its lanes (depth_max and
+ * dwell_max are the largest), then each lane. */
+typedef struct mqueue_stats {
+    mqueue_lane_stats_t total;
+    unsigned long   slot_misses;
+    unsigned int    n_lanes;
+    mqueue_lane_stats_t lanes[MQUEUE_MAX_LANES];
+} mqueue_stats_t;
+
 extern int mqueue_init(mqueue_t *queue);
+extern int mqueue_init_ring(mqueue_t *queue, unsigned int capacity,
+                            size_t slot_size);
+/* Ring mode with n_lanes priority lanes of the given capacity each,
+ * sharing the slots.  mqueue_wait() takes the next message from the
+ * highest priority lane that has one, unless a lower lane has been
+ * passed over starve_limit times in a row while it had messages. */
+extern int mqueue_init_lanes(mqueue_t *queue, unsigned int n_lanes,
+                             unsigned int capacity, size_t slot_size,
+                             unsigned int starve_limit);
 extern int mqueue_send(mqueue_t *queue, void *data);
+/* Sends on a lane.  Lanes past the last one use the last.  Returns
+ * EINVAL if queue or data is NULL, and ENOBUFS or ENOMEM if data could
+ * not be queued.  Any other error is from waking up the receiver, after
+ * data was queued. */
+extern int mqueue_send_lane(mqueue_t *queue, void *data, unsigned int lane);
 extern int mqueue_wait(mqueue_t *queue, void **data);
+extern void *mqueue_slot_alloc(mqueue_t *queue, size_t size);
+extern int mqueue_slot_free(mqueue_t *queue, void *slot);
+/* Number of messages sent and not yet received. */
+extern unsigned int mqueue_depth(mqueue_t *queue);
+/* Bytes held by the queue itself, not counting the messages of a list
+ * mode queue.  Safe to call from any thread. */
+extern size_t mqueue_memory(mqueue_t *queue);
+/* Safe to call from any thread.  The fields are read one by one, so
+ * they need not be consistent with each other. */
+extern void mqueue_get_stats(mqueue_t *queue, mqueue_stats_t *stats);
 
 #endif  /*  __MQUEUE_H__  */
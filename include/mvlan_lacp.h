@@ -17,6 +17,7 @@
 #ifndef _MVLAN_LACP_H_
 #define _MVLAN_LACP_H_
 
+#include <hmap.h>
 #include <pm_cmn.h>
 
 /******************************************************************************************/
@@ -55,6 +56,7 @@ struct MLt_lacp_api__set_lport_overrides {
 #define MLm_vpm_api__unset_lacp_sport_params          17
 #define MLm_vpm_api__set_lacp_lport_params_event      18
 #define MLm_vpm_api__set_lport_fallback_status        19
+#define MLm_vpm_api__config_batch                     20
 
 struct MLt_vpm_api__create_sport {
     short type;                       //  The type of super port
@@ -125,6 +127,29 @@ struct MLt_vpm_api__lport_fallback_status {
     int status;                        // Fallback new status
 };
 
+// One configuration message of a batch: the sender peer and message
+// number it would have been sent with, and its body.
+struct MLt_vpm_api__config_item {
+    int peer;                          // ml_lport_index or ml_cfgMgr_index
+    int msgnum;
+    union {
+        struct MLt_lacp_api__actorSysPriority      sys_priority;
+        struct MLt_lacp_api__actorSysMac           sys_mac;
+        struct MLt_lacp_api__set_lport_overrides   lport_overrides;
+        struct MLt_vpm_api__create_sport           create_sport;
+        struct MLt_vpm_api__delete_sport           delete_sport;
+        struct MLt_vpm_api__lacp_sport_params      sport_params;
+        struct MLt_vpm_api__lport_lacp_change      lport_change;
+        struct MLt_vpm_api__lport_fallback_status  fallback_status;
+    } u;
+};
+
+// Configuration messages applied in order by one event.
+struct MLt_vpm_api__config_batch {
+    int count;
+    struct MLt_vpm_api__config_item items[];
+};
+
 // The message give by the LACP module to match the
 // given logical port to a corresponding aggregator.
 struct MLt_vpm_api__lacp_match_params {
@@ -184,6 +209,9 @@ typedef struct lacp_sport_params_s {
 typedef struct lacp_int_sport_params_s {
     lacp_sport_params_t  lacp_params;   /* Should be the first field in this struct */
     void                *psport;        /* Pointer to the super port */
+    struct hmap_node     exact_node;    /* In the exact match index */
+    struct hmap_node     key_node;      /* In the actor key index */
+    unsigned int         seq;           /* Creation order, newest is preferred */
 } lacp_int_sport_params_t;
 
 
@@ -202,9 +230,18 @@ extern int mvlan_api_select_aggregator(struct MLt_vpm_api__lacp_match_params *pl
 extern int mvlan_api_attach_lport_to_aggregator(struct MLt_vpm_api__lacp_attach *placp_attach_params);
 extern int mvlan_api_detach_lport_from_aggregator(struct MLt_vpm_api__lacp_attach *placp_detach_params);
 
+extern int ml_init_event_rcvr(void);
+extern ML_event* ml_event_alloc(int size);
+extern ML_event* ml_event_copy(const ML_event *event, const void *body);
 extern int ml_send_event(ML_event* event);
+extern int ml_send_event_to(int worker, ML_event *event);
 extern ML_event* ml_wait_for_next_event(void);
 extern void ml_event_free(ML_event* event);
+extern unsigned int ml_event_queue_depth(void);
+extern size_t ml_event_queue_memory(void);
+extern unsigned long long ml_event_clock_ns(void);
+extern void ml_event_account(const ML_event *event,
+                             unsigned long long start_ns);
 
 // LACPDU send function
 extern int mlacp_send(unsigned char* data, int length, port_handle_t portHandle);
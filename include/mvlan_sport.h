@@ -90,5 +90,9 @@ extern int mvlan_sport_create(struct MLt_vpm_api__create_sport  *psport_create,
 extern int mvlan_sport_delete(super_port_t  *psport);
 extern int mvlan_destroy_sport(super_port_t *psport);
 extern int mvlan_get_sport(port_handle_t handle, super_port_t **ppsport, int type);
+extern size_t mvlan_sport_memory(unsigned int *psports);
+
+// In mvlan_lacp.c: frees a super port's LACP parameters.
+extern void mvlan_release_sport_params(void *placp_params);
 
 #endif /* _MVLAN_SPORT_H */
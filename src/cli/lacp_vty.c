@@ -40,6 +40,7 @@
 #include "vswitch-idl.h"
 #include "ovsdb-idl.h"
 #include "smap.h"
+#include "shash.h"
 #include "openvswitch/vlog.h"
 #include "openswitch-idl.h"
 #include "vtysh/vtysh_ovsdb_if.h"
@@ -100,6 +101,39 @@ lacp_exceeded_maximum_lag()
   return lags_found >= MAX_LAG_INTERFACES;
 }
 
+/* Interface name to LAG port row, built in one pass over the Port
+ * table.  It is rebuilt only when the IDL seqno moves, so the per
+ * interface lookups made by one command or one running-config dump
+ * share it instead of rescanning every LAG. */
+static struct shash lag_by_intf = SHASH_INITIALIZER(&lag_by_intf);
+static unsigned int lag_by_intf_seqno;
+static bool lag_by_intf_valid = false;
+
+const struct ovsrec_port *
+lacp_find_intf_lag(struct ovsdb_idl *lag_idl, const char *if_name)
+{
+  const struct ovsrec_port *port_row = NULL;
+  int k = 0;
+
+  if (!lag_by_intf_valid ||
+      lag_by_intf_seqno != ovsdb_idl_get_seqno(lag_idl)) {
+      shash_clear(&lag_by_intf);
+      OVSREC_PORT_FOR_EACH(port_row, lag_idl) {
+          if (strncmp(port_row->name, LAG_PORT_NAME_PREFIX,
+                      LAG_PORT_NAME_PREFIX_LENGTH) == 0) {
+              for (k = 0; k < port_row->n_interfaces; k++) {
+                  shash_add_once(&lag_by_intf,
+                                 port_row->interfaces[k]->name, port_row);
+              }
+          }
+      }
+      lag_by_intf_seqno = ovsdb_idl_get_seqno(lag_idl);
+      lag_by_intf_valid = true;
+  }
+
+  return shash_find_data(&lag_by_intf, if_name);
+}
+
 char *
 lacp_remove_lb_hash_suffix(const char * lb_hash) {
     char * temp_hash_suffix = NULL;
@@ -1860,10 +1894,9 @@ lacp_show_interfaces(const char *if_name)
    vty_out(vty, "X - State m/c expired              E - Default neighbor state");
    vty_out(vty,"%s%s", VTY_NEWLINE, VTY_NEWLINE);
 
-   OVSREC_PORT_FOR_EACH(port_row, idl)
+   port_row = lacp_find_intf_lag(idl, if_name);
+   if (port_row)
    {
-     if (strncmp(port_row->name, LAG_PORT_NAME_PREFIX, LAG_PORT_NAME_PREFIX_LENGTH) == 0)
-     {
         for (k = 0; k < port_row->n_interfaces; k++)
         {
            if_row = port_row->interfaces[k];
@@ -1902,12 +1935,11 @@ lacp_show_interfaces(const char *if_name)
                parse_id_from_db(p_system_priority_id_ovsdb, &p_system_priority, &p_system_id);
              }
              port_row_round = true;
-             goto Exit;
+             break;
            }
         }
-     }
    }
-Exit:
+
    vty_out(vty,"%s",VTY_NEWLINE);
    vty_out(vty, "Aggregate-name : %s%s", port_row_round?port_row->name:" ", VTY_NEWLINE);
    vty_out(vty, "-------------------------------------------------");
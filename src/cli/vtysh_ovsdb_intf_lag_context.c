@@ -281,28 +281,16 @@ vtysh_ret_val
 vtysh_intf_context_lag_clientcallback(void *p_private)
 {
   const struct ovsrec_port *port_row = NULL;
-  const struct ovsrec_interface *if_row = NULL;
   vtysh_ovsdb_cbmsg_ptr p_msg = (vtysh_ovsdb_cbmsg *)p_private;
   const struct ovsrec_interface *ifrow = NULL;
-  int k=0;
 
   ifrow = (struct ovsrec_interface *)p_msg->feature_row;
-  OVSREC_PORT_FOR_EACH(port_row, p_msg->idl)
+  port_row = lacp_find_intf_lag(p_msg->idl, ifrow->name);
+  if (port_row)
   {
-    if (strncmp(port_row->name, LAG_PORT_NAME_PREFIX,
-                LAG_PORT_NAME_PREFIX_LENGTH) == 0)
-    {
-      for (k = 0; k < port_row->n_interfaces; k++)
-      {
-        if_row = port_row->interfaces[k];
-        if(strcmp(ifrow->name, if_row->name) == 0)
-        {
-          PRINT_INTERFACE_NAME(p_msg->disp_header_cfg, p_msg, ifrow->name)
-          vtysh_ovsdb_cli_print(p_msg, "%4s%s %d", " ", "lag",
-                                atoi(&port_row->name[LAG_PORT_NAME_PREFIX_LENGTH]));
-        }
-      }
-    }
+    PRINT_INTERFACE_NAME(p_msg->disp_header_cfg, p_msg, ifrow->name)
+    vtysh_ovsdb_cli_print(p_msg, "%4s%s %d", " ", "lag",
+                          atoi(&port_row->name[LAG_PORT_NAME_PREFIX_LENGTH]));
   }
 
   return e_vtysh_ok;
@@ -30,15 +30,18 @@
 #include <unistd.h>
 
 #include <nlib.h>
+#include "lacp_pool.h"
 
 typedef struct NList NList;
 
+static struct lacp_pool n_list_pool = LACP_POOL_INITIALIZER("NList", NList, 128);
+
 NList *
 n_list_alloc(void)
 {
     NList *pval;
 
-    pval = (NList *)malloc(sizeof(NList));
+    pval = lacp_pool_alloc(&n_list_pool);
     if (pval == NULL) {
         fprintf(stderr, "LACPd dlist - n_list_alloc failed!\n");
     }
@@ -50,7 +53,7 @@ n_list_alloc(void)
 void
 n_list_free(NList *element)
 {
-    free(element);
+    lacp_pool_free(&n_list_pool, element);
 
 } // n_list_free
 
@@ -0,0 +1,603 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_checkpoint.c
+ *
+ *   Warm restart.
+ *
+ *   The protocol thread keeps a copy of every LACP port's admin
+ *   variables, partner oper variables, mux state and aggregator in a
+ *   memory-mapped file (LACPD_CHECKPOINT_FILE), rewritten at most once
+ *   per LACPD_CHECKPOINT_INTERVAL_MS.  The file lives on the run
+ *   directory's tmpfs: it survives lacpd, not a reboot.  The header's
+ *   sequence number is odd while the ports are written, so a lacpd
+ *   that died halfway through leaves a checkpoint the next one
+ *   ignores.
+ *
+ *   At startup the ports that were in Collecting_Distributing are
+ *   loaded.  The OVSDB thread does not clear their hw_bond_config, and
+ *   when OVSDB configures LACP on one of them again the protocol thread
+ *   compares its configuration and link with the checkpoint.  If they
+ *   match, and the checkpoint is younger than the port's LACP timeout
+ *   (so the partner still has us as current), the machines are run to
+ *   Collecting_Distributing with the periodic machine held in
+ *   NO_PERIODIC; the first LACPDU sent already has the synchronization,
+ *   collecting and distributing bits set and the partner never sees the
+ *   port go down.  Otherwise the port starts cold and is detached in
+ *   hardware.  Nothing is saved until every loaded port has been
+ *   restored, started cold, or become too old, so a lacpd that dies
+ *   during startup does not lose the checkpoint.
+ *
+ *   With several protocol workers, each writes the slots of the ports
+ *   it owns, on its own schedule, under lacp_lock(); the header then
+ *   carries the time of the oldest of their last saves.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include <lacp_cmn.h>
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "lacp_ops_if.h"
+#include "lacp_checkpoint.h"
+#include "lacp_worker.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_checkpoint);
+
+#define LACP_CKPT_MAGIC         0x4c41434bU     /* "LACK" */
+#define LACP_CKPT_VERSION       1
+
+/* One port, as the protocol thread last saw it.  Values are kept in
+ * the byte order of lacp_per_port_variables_t. */
+struct lacp_ckpt_port {
+    char                name[32];       /* "" if the slot is unused */
+    uint64_t            sport_handle;
+    uint16_t            lag_id;         /* configured LAG_ID */
+    uint16_t            port_type;
+    uint32_t            mux_state;
+
+    /* Actor admin variables, checked against the new configuration. */
+    u_short             actor_port_number;
+    u_short             actor_port_priority;
+    u_short             actor_key;
+    state_parameters_t  actor_state;
+    system_variables_t  actor_system;
+
+    /* Partner oper variables, restored. */
+    u_short             partner_port_number;
+    u_short             partner_port_priority;
+    u_short             partner_key;
+    state_parameters_t  partner_state;
+    system_variables_t  partner_system;
+};
+
+struct lacp_ckpt_header {
+    uint32_t            magic;
+    uint16_t            version;
+    uint16_t            n_ports;
+    uint32_t            port_size;
+    uint32_t            seq;            /* odd while being written */
+    uint64_t            saved_msec;     /* CLOCK_MONOTONIC */
+};
+
+/* The file, indexed by port table slot. */
+struct lacp_ckpt_file {
+    struct lacp_ckpt_header header;
+    struct lacp_ckpt_port ports[LACP_MAX_PORTS];
+};
+
+/* Why a loaded port was or was not restored. */
+enum lacp_ckpt_outcome {
+    LACP_CKPT_RESTORED,
+    LACP_CKPT_STALE,
+    LACP_CKPT_CONFIG_CHANGED,
+    LACP_CKPT_LINK_DOWN,
+    LACP_CKPT_AGGREGATOR_CHANGED,
+    LACP_CKPT_N_OUTCOMES
+};
+
+static const char *const ckpt_outcome_names[LACP_CKPT_N_OUTCOMES] = {
+    [LACP_CKPT_RESTORED]           = "restored",
+    [LACP_CKPT_STALE]              = "cold, too old",
+    [LACP_CKPT_CONFIG_CHANGED]     = "cold, config changed",
+    [LACP_CKPT_LINK_DOWN]          = "cold, link down",
+    [LACP_CKPT_AGGREGATOR_CHANGED] = "cold, aggregator changed",
+};
+
+/* A port loaded from the previous lacpd's checkpoint.  held belongs
+ * to the OVSDB thread, claimed to the protocol threads. */
+struct lacp_ckpt_restore {
+    struct lacp_ckpt_port port;
+    bool                held;
+    bool                claimed;
+};
+
+static struct lacp_ckpt_file *ckpt_map;
+static char *ckpt_path;
+
+/* Set by lacp_checkpoint_init() before the other threads start. */
+static struct lacp_ckpt_restore ckpt_restore[LACP_MAX_PORTS];
+static int ckpt_n_restore;
+static unsigned long long ckpt_loaded_msec;     /* saved_msec of the load */
+static unsigned long long ckpt_restore_until;   /* last port goes stale */
+
+/* Protocol threads, under lacp_lock(); read by lacp_checkpoint_dump(). */
+static int ckpt_n_pending;                      /* loaded, not claimed */
+static unsigned long long ckpt_next_save[LACPD_PROTOCOL_WORKERS];
+static unsigned long long ckpt_saved[LACPD_PROTOCOL_WORKERS];
+static unsigned long long ckpt_last_save;
+static unsigned long ckpt_n_saves;
+static unsigned long ckpt_outcomes[LACP_CKPT_N_OUTCOMES];
+
+static unsigned long long
+ckpt_now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+} // ckpt_now_msec
+
+/* How long the partner keeps the port current without hearing from
+ * us, and we the partner. */
+static unsigned long long
+ckpt_max_age_msec(const struct lacp_ckpt_port *port)
+{
+    if (port->actor_state.lacp_timeout == SHORT_TIMEOUT ||
+        port->partner_state.lacp_timeout == SHORT_TIMEOUT) {
+        return SHORT_TIMEOUT_COUNT * LACP_TIMER_MSEC_PER_SEC;
+    }
+
+    return LONG_TIMEOUT_COUNT * LACP_TIMER_MSEC_PER_SEC;
+} // ckpt_max_age_msec
+
+static void
+ckpt_load(const struct lacp_ckpt_file *map)
+{
+    const struct lacp_ckpt_header *h = &map->header;
+    unsigned long long now = ckpt_now_msec();
+    unsigned long long until = 0;
+    unsigned long long age;
+    int ii;
+
+    if (h->magic != LACP_CKPT_MAGIC) {
+        return;
+    }
+
+    if (h->version != LACP_CKPT_VERSION || h->n_ports != LACP_MAX_PORTS ||
+        h->port_size != sizeof(struct lacp_ckpt_port)) {
+        VLOG_INFO("Ignoring checkpoint of version %u", h->version);
+        return;
+    }
+
+    if (h->seq & 1) {
+        VLOG_WARN("Ignoring checkpoint that was being written");
+        return;
+    }
+
+    if (h->saved_msec > now) {
+        /* CLOCK_MONOTONIC restarted: saved before a reboot. */
+        VLOG_INFO("Ignoring checkpoint from before the last boot");
+        return;
+    }
+    age = now - h->saved_msec;
+
+    for (ii = 0; ii < LACP_MAX_PORTS; ii++) {
+        const struct lacp_ckpt_port *port = &map->ports[ii];
+
+        if (port->name[0] == '\0' ||
+            port->mux_state != MUX_FSM_COLLECTING_DISTRIBUTING_STATE ||
+            age >= ckpt_max_age_msec(port)) {
+            continue;
+        }
+
+        memcpy(&ckpt_restore[ckpt_n_restore].port, port, sizeof *port);
+        ckpt_restore[ckpt_n_restore].port.name[sizeof port->name - 1] = '\0';
+        ckpt_n_restore++;
+
+        if (h->saved_msec + ckpt_max_age_msec(port) > until) {
+            until = h->saved_msec + ckpt_max_age_msec(port);
+        }
+    }
+
+    ckpt_loaded_msec = h->saved_msec;
+    ckpt_restore_until = until;
+    ckpt_n_pending = ckpt_n_restore;
+
+    VLOG_INFO("Loaded %d ports from a checkpoint saved %llu msec ago",
+              ckpt_n_restore, age);
+} // ckpt_load
+
+//*****************************************************************
+// Function : lacp_checkpoint_init
+//*****************************************************************
+void
+lacp_checkpoint_init(const char *path)
+{
+    struct lacp_ckpt_file *map;
+    int fd;
+
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        VLOG_WARN("Failed to open checkpoint file %s, rc=%s; "
+                  "warm restart is disabled", path, strerror(errno));
+        return;
+    }
+
+    if (ftruncate(fd, sizeof *map) < 0) {
+        VLOG_WARN("Failed to size checkpoint file %s, rc=%s; "
+                  "warm restart is disabled", path, strerror(errno));
+        close(fd);
+        return;
+    }
+
+    map = mmap(NULL, sizeof *map, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        VLOG_WARN("Failed to map checkpoint file %s, rc=%s; "
+                  "warm restart is disabled", path, strerror(errno));
+        return;
+    }
+
+    ckpt_load(map);
+
+    ckpt_map = map;
+    ckpt_path = xstrdup(path);
+} // lacp_checkpoint_init
+
+//*****************************************************************
+// Function : lacp_checkpoint_hold
+//*****************************************************************
+bool
+lacp_checkpoint_hold(const char *name)
+{
+    int ii;
+
+    for (ii = 0; ii < ckpt_n_restore; ii++) {
+        struct lacp_ckpt_restore *r = &ckpt_restore[ii];
+
+        if (!r->held && !strcmp(r->port.name, name)) {
+            r->held = true;
+            return true;
+        }
+    }
+
+    return false;
+} // lacp_checkpoint_hold
+
+static struct lacp_ckpt_restore *
+ckpt_claim(const char *name)
+{
+    int ii;
+
+    for (ii = 0; ii < ckpt_n_restore; ii++) {
+        struct lacp_ckpt_restore *r = &ckpt_restore[ii];
+
+        if (!r->claimed && !strcmp(r->port.name, name)) {
+            r->claimed = true;
+            __atomic_store_n(&ckpt_n_pending, ckpt_n_pending - 1,
+                             __ATOMIC_RELAXED);
+            return r;
+        }
+    }
+
+    return NULL;
+} // ckpt_claim
+
+/* Compares the checkpoint with the port as initialize_per_port_variables()
+ * has just set it up from the new configuration. */
+static enum lacp_ckpt_outcome
+ckpt_check(const struct lacp_ckpt_port *port,
+           const lacp_per_port_variables_t *plpinfo,
+           const struct lacpd_iface_cfg *cfg)
+{
+    const state_parameters_t *state = &plpinfo->actor_admin_port_state;
+
+    if (ckpt_now_msec() - ckpt_loaded_msec >= ckpt_max_age_msec(port)) {
+        return LACP_CKPT_STALE;
+    }
+
+    if (plpinfo->lacp_control.port_enabled == FALSE) {
+        return LACP_CKPT_LINK_DOWN;
+    }
+
+    if (port->lag_id != cfg->cfg_lag_id ||
+        port->port_type != plpinfo->port_type ||
+        port->actor_port_number != plpinfo->actor_admin_port_number ||
+        port->actor_port_priority != plpinfo->actor_admin_port_priority ||
+        port->actor_key != plpinfo->actor_admin_port_key ||
+        port->actor_state.lacp_activity != state->lacp_activity ||
+        port->actor_state.lacp_timeout != state->lacp_timeout ||
+        port->actor_state.aggregation != state->aggregation ||
+        port->actor_system.system_priority !=
+            plpinfo->actor_admin_system_variables.system_priority ||
+        memcmp(port->actor_system.system_mac_addr,
+               plpinfo->actor_admin_system_variables.system_mac_addr,
+               MAC_ADDR_LENGTH)) {
+        return LACP_CKPT_CONFIG_CHANGED;
+    }
+
+    return LACP_CKPT_RESTORED;
+} // ckpt_check
+
+/* Runs the port's machines to the state the previous lacpd left them
+ * in.  The mux machine goes through every state as usual, so the LAG,
+ * the aggregator and hw_bond_config are set up the same way as after a
+ * LACPDU; only the wait while timer is skipped, the port having been
+ * attached before. */
+static enum lacp_ckpt_outcome
+ckpt_restore_port(lacp_per_port_variables_t *plpinfo,
+                  const struct lacp_ckpt_port *port)
+{
+    // Nothing goes out on the wire until the machines are through.
+    plpinfo->periodic_tx_fsm_state = PERIODIC_TX_FSM_NO_PERIODIC_STATE;
+
+    // The partner as recordPDU() last recorded it.
+    plpinfo->partner_oper_port_number = port->partner_port_number;
+    plpinfo->partner_oper_port_priority = port->partner_port_priority;
+    plpinfo->partner_oper_key = port->partner_key;
+    plpinfo->partner_oper_port_state = port->partner_state;
+    plpinfo->partner_oper_system_variables = port->partner_system;
+    plpinfo->actor_oper_port_state.defaulted = FALSE;
+    plpinfo->actor_oper_port_state.expired = FALSE;
+
+    plpinfo->recv_fsm_state = RECV_FSM_CURRENT_STATE;
+    lacp_timer_start(&plpinfo->current_while_timer,
+                     (plpinfo->actor_oper_port_state.lacp_timeout ==
+                      SHORT_TIMEOUT ? SHORT_TIMEOUT_COUNT :
+                                      LONG_TIMEOUT_COUNT) *
+                     LACP_TIMER_MSEC_PER_SEC);
+
+    plpinfo->lacp_control.begin = FALSE;
+    plpinfo->selecting_lag = FALSE;
+    plpinfo->lacp_up = TRUE;
+
+    LACP_mux_fsm(E7, plpinfo->mux_fsm_state, plpinfo);
+    LAG_selection(plpinfo);
+
+    if (plpinfo->mux_fsm_state != MUX_FSM_WAITING_STATE ||
+        plpinfo->sport_handle != port->sport_handle) {
+        return LACP_CKPT_AGGREGATOR_CHANGED;
+    }
+
+    lacp_timer_stop(&plpinfo->wait_while_timer);
+    plpinfo->lacp_control.ready_n = TRUE;
+    LACP_mux_fsm(E3, plpinfo->mux_fsm_state, plpinfo);
+
+    if (plpinfo->mux_fsm_state != MUX_FSM_COLLECTING_DISTRIBUTING_STATE) {
+        return LACP_CKPT_AGGREGATOR_CHANGED;
+    }
+
+    // Start the periodic machine, and tell the partner right away;
+    // the mux machine used up the async Tx window on the way.
+    LACP_periodic_tx_fsm(E1, plpinfo->periodic_tx_fsm_state, plpinfo);
+    plpinfo->async_tx_count = 0;
+    lacp_timer_stop(&plpinfo->async_tx_timer);
+    plpinfo->lacp_control.ntt = TRUE;
+    LACP_async_transmit_lacpdu(plpinfo);
+
+    return LACP_CKPT_RESTORED;
+} // ckpt_restore_port
+
+//*****************************************************************
+// Function : lacp_checkpoint_restore
+//*****************************************************************
+bool
+lacp_checkpoint_restore(lacp_per_port_variables_t *plpinfo)
+{
+    int index = PM_HANDLE2PORT(plpinfo->lport_handle);
+    struct lacpd_iface_cfg cfg;
+    struct lacp_ckpt_restore *r;
+    enum lacp_ckpt_outcome outcome;
+    int lock;
+
+    if (__atomic_load_n(&ckpt_n_pending, __ATOMIC_RELAXED) == 0 ||
+        !lacpd_iface_cfg_get(index, &cfg)) {
+        return false;
+    }
+
+    lock = lacp_lock();
+    r = ckpt_claim(cfg.name);
+    if (r == NULL) {
+        lacp_unlock(lock);
+        return false;
+    }
+
+    outcome = ckpt_check(&r->port, plpinfo, &cfg);
+    if (outcome == LACP_CKPT_RESTORED) {
+        outcome = ckpt_restore_port(plpinfo, &r->port);
+    }
+
+    __atomic_store_n(&ckpt_outcomes[outcome], ckpt_outcomes[outcome] + 1,
+                     __ATOMIC_RELAXED);
+    lacp_unlock(lock);
+
+    if (outcome == LACP_CKPT_RESTORED) {
+        VLOG_INFO("Interface %s: restored from the checkpoint", cfg.name);
+        return true;
+    }
+
+    VLOG_INFO("Interface %s: starting cold (%s)", cfg.name,
+              ckpt_outcome_names[outcome]);
+
+    // The caller starts the machines from scratch.  The OVSDB thread
+    // left hw_bond_config as the previous lacpd had it; if the mux
+    // machine did not get as far as attaching the port, its detach
+    // will not clear it.
+    plpinfo->lacp_up = FALSE;
+    if (plpinfo->hw_attached_to_mux == FALSE) {
+        ops_detach_port_in_hw(PM_HANDLE2LAG(r->port.sport_handle), index);
+    }
+
+    return false;
+} // lacp_checkpoint_restore
+
+//*****************************************************************
+// Function : lacp_checkpoint_run
+//*****************************************************************
+void
+lacp_checkpoint_run(void)
+{
+    struct lacp_ckpt_file *map = ckpt_map;
+    lacp_per_port_variables_t *plpinfo;
+    struct lacpd_iface_cfg cfg;
+    unsigned long long now;
+    unsigned long long saved;
+    int worker = lacp_worker_self();
+    int lock;
+    int ii;
+
+    if (map == NULL) {
+        return;
+    }
+
+    now = ckpt_now_msec();
+    if (now < ckpt_next_save[worker]) {
+        return;
+    }
+
+    if (__atomic_load_n(&ckpt_n_pending, __ATOMIC_RELAXED) > 0 &&
+        now < ckpt_restore_until) {
+        // Keep the previous lacpd's checkpoint for the ports that
+        // OVSDB has not configured yet.
+        return;
+    }
+
+    ckpt_next_save[worker] = now + LACPD_CHECKPOINT_INTERVAL_MS;
+
+    lock = lacp_lock();
+
+    __atomic_store_n(&map->header.seq, map->header.seq | 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // Only our own slots; the other workers write theirs.
+    for (ii = 0; ii < LACP_MAX_PORTS; ii++) {
+        if (lacp_worker_owns(ii)) {
+            memset(&map->ports[ii], 0, sizeof map->ports[ii]);
+        }
+    }
+
+    for (plpinfo = LACP_port_first(); plpinfo;
+         plpinfo = LACP_port_next(plpinfo)) {
+        int index = PM_HANDLE2PORT(plpinfo->lport_handle);
+        struct lacp_ckpt_port *port = &map->ports[index];
+
+        if (plpinfo->lacp_up == FALSE || !lacpd_iface_cfg_get(index, &cfg)) {
+            continue;
+        }
+
+        // Not until hw_bond_config has caught up with the mux machine;
+        // a restart in between would restore a port that was never
+        // enabled in hardware.
+        if (lacpd_hw_ops_in_flight(index)) {
+            continue;
+        }
+
+        snprintf(port->name, sizeof port->name, "%s", cfg.name);
+        port->sport_handle = plpinfo->sport_handle;
+        port->lag_id = cfg.cfg_lag_id;
+        port->port_type = plpinfo->port_type;
+        port->mux_state = plpinfo->mux_fsm_state;
+
+        port->actor_port_number = plpinfo->actor_admin_port_number;
+        port->actor_port_priority = plpinfo->actor_admin_port_priority;
+        port->actor_key = plpinfo->actor_admin_port_key;
+        port->actor_state = plpinfo->actor_admin_port_state;
+        port->actor_system = plpinfo->actor_admin_system_variables;
+
+        port->partner_port_number = plpinfo->partner_oper_port_number;
+        port->partner_port_priority = plpinfo->partner_oper_port_priority;
+        port->partner_key = plpinfo->partner_oper_key;
+        port->partner_state = plpinfo->partner_oper_port_state;
+        port->partner_system = plpinfo->partner_oper_system_variables;
+    }
+
+    map->header.magic = LACP_CKPT_MAGIC;
+    map->header.version = LACP_CKPT_VERSION;
+    map->header.n_ports = LACP_MAX_PORTS;
+    map->header.port_size = sizeof(struct lacp_ckpt_port);
+
+    // The oldest slot decides how old the checkpoint is.
+    ckpt_saved[worker] = now;
+    saved = now;
+    for (ii = 0; ii < LACPD_PROTOCOL_WORKERS; ii++) {
+        if (ckpt_saved[ii] != 0 && ckpt_saved[ii] < saved) {
+            saved = ckpt_saved[ii];
+        }
+    }
+    map->header.saved_msec = saved;
+
+    __atomic_store_n(&map->header.seq, map->header.seq + 1, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&ckpt_last_save, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&ckpt_n_saves, ckpt_n_saves + 1, __ATOMIC_RELAXED);
+
+    lacp_unlock(lock);
+} // lacp_checkpoint_run
+
+//*****************************************************************
+// Function : lacp_checkpoint_dump
+//*****************************************************************
+void
+lacp_checkpoint_dump(struct ds *ds)
+{
+    unsigned long long last_save;
+    int ii;
+
+    ds_put_format(ds, "Checkpoint:\n");
+    if (ckpt_path == NULL) {
+        ds_put_format(ds, "    file          : none (warm restart is "
+                      "disabled)\n");
+        return;
+    }
+
+    last_save = __atomic_load_n(&ckpt_last_save, __ATOMIC_RELAXED);
+
+    ds_put_format(ds, "    file          : %s\n", ckpt_path);
+    ds_put_format(ds, "    interval      : %d msec\n",
+                  LACPD_CHECKPOINT_INTERVAL_MS);
+    ds_put_format(ds, "    saves         : %lu\n",
+                  __atomic_load_n(&ckpt_n_saves, __ATOMIC_RELAXED));
+    if (last_save) {
+        ds_put_format(ds, "    last save     : %llu msec ago\n",
+                      ckpt_now_msec() - last_save);
+    }
+    ds_put_format(ds, "    loaded ports  : %d\n", ckpt_n_restore);
+    ds_put_format(ds, "    pending       : %d\n",
+                  __atomic_load_n(&ckpt_n_pending, __ATOMIC_RELAXED));
+
+    for (ii = 0; ii < LACP_CKPT_N_OUTCOMES; ii++) {
+        ds_put_format(ds, "    %-25s : %lu\n", ckpt_outcome_names[ii],
+                      __atomic_load_n(&ckpt_outcomes[ii], __ATOMIC_RELAXED));
+    }
+} // lacp_checkpoint_dump
@@ -0,0 +1,326 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_export.c
+ *
+ *   State export for show commands and monitoring (see lacp_export.h
+ *   for the file layout).
+ *
+ *   Each protocol worker publishes the ports it owns, at most once per
+ *   LACPD_EXPORT_INTERVAL_MS, from the end of its event loop: the
+ *   slots are only written by the thread running the port's state
+ *   machines, and never under lacp_lock().  Readers retry a slot whose
+ *   sequence number changed while they copied it; lacpd never waits
+ *   for them.
+ *
+ *   The file is created under a temporary name and renamed into place,
+ *   so a reader still mapping the previous lacpd's file is never left
+ *   with a truncated mapping.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include <lacp_cmn.h>
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "lacp_ops_if.h"
+#include "lacp_export.h"
+#include "lacp_worker.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_export);
+
+#define EXPORT_FILE_SIZE \
+    (sizeof(struct lacp_export_header) + \
+     LACP_MAX_PORTS * sizeof(struct lacp_export_slot))
+
+static struct lacp_export_file *export_map;
+static char *export_path;
+
+/* Each protocol worker only touches its own. */
+static unsigned long long export_next[LACPD_PROTOCOL_WORKERS];
+
+static unsigned long long
+export_now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+} // export_now_msec
+
+static uint8_t
+export_state(state_parameters_t state)
+{
+    return ((state.lacp_activity ? LACP_EXPORT_STATE_ACTIVITY : 0) |
+            (state.lacp_timeout ? LACP_EXPORT_STATE_TIMEOUT : 0) |
+            (state.aggregation ? LACP_EXPORT_STATE_AGGREGATION : 0) |
+            (state.synchronization ? LACP_EXPORT_STATE_SYNCHRONIZATION : 0) |
+            (state.collecting ? LACP_EXPORT_STATE_COLLECTING : 0) |
+            (state.distributing ? LACP_EXPORT_STATE_DISTRIBUTING : 0) |
+            (state.defaulted ? LACP_EXPORT_STATE_DEFAULTED : 0) |
+            (state.expired ? LACP_EXPORT_STATE_EXPIRED : 0));
+} // export_state
+
+/* The oper variables are kept in network byte order, as in the
+ * LACPDU. */
+static void
+export_side(struct lacp_export_side *side, const system_variables_t *system,
+            u_short port_priority, u_short port_number, u_short key,
+            state_parameters_t state)
+{
+    u_short mac;
+    int ii;
+
+    for (ii = 0; ii < 3; ii++) {
+        mac = htons(system->system_mac_addr[ii]);
+        side->system_mac[2 * ii] = mac >> 8;
+        side->system_mac[2 * ii + 1] = mac & 0xff;
+    }
+    side->system_priority = ntohs(system->system_priority);
+    side->port_priority = ntohs(port_priority);
+    side->port_number = ntohs(port_number);
+    side->key = ntohs(key);
+    side->state = export_state(state);
+} // export_side
+
+static void
+export_fill(struct lacp_export_port *port,
+            const lacp_per_port_variables_t *plpinfo, int index,
+            unsigned long long now)
+{
+    struct lacpd_iface_cfg cfg;
+    lacp_port_stats_t stats;
+
+    if (lacpd_iface_cfg_get(index, &cfg)) {
+        snprintf(port->name, sizeof port->name, "%s", cfg.name);
+        port->lag_id = cfg.cfg_lag_id;
+    }
+
+    port->updated_msec = now;
+    port->sport_handle = plpinfo->sport_handle;
+    port->lacp_up = plpinfo->lacp_up ? 1 : 0;
+    port->port_enabled = plpinfo->lacp_control.port_enabled ? 1 : 0;
+    port->selected = plpinfo->lacp_control.selected;
+    port->recv_fsm_state = plpinfo->recv_fsm_state;
+    port->mux_fsm_state = plpinfo->mux_fsm_state;
+    port->periodic_tx_fsm_state = plpinfo->periodic_tx_fsm_state;
+
+    export_side(&port->actor, &plpinfo->actor_oper_system_variables,
+                plpinfo->actor_oper_port_priority,
+                plpinfo->actor_oper_port_number,
+                plpinfo->actor_oper_port_key,
+                plpinfo->actor_oper_port_state);
+    export_side(&port->partner, &plpinfo->partner_oper_system_variables,
+                plpinfo->partner_oper_port_priority,
+                plpinfo->partner_oper_port_number,
+                plpinfo->partner_oper_key,
+                plpinfo->partner_oper_port_state);
+
+    LACP_port_stats_snapshot(plpinfo, &stats);
+    port->lacp_pdus_sent = stats.lacp_pdus_sent;
+    port->marker_response_pdus_sent = stats.marker_response_pdus_sent;
+    port->lacp_pdus_received = stats.lacp_pdus_received;
+    port->marker_pdus_received = stats.marker_pdus_received;
+    port->lacp_pdus_fast_path = stats.lacp_pdus_fast_path;
+    port->pdus_dropped = stats.pdus_dropped;
+    port->pdus_malformed = stats.pdus_malformed;
+    port->pdus_queue_overflow = stats.pdus_queue_overflow;
+    port->pdus_tx_failed = stats.pdus_tx_failed;
+} // export_fill
+
+static void
+export_write(struct lacp_export_slot *slot, const struct lacp_export_port *port)
+{
+    uint32_t seq = slot->seq;
+
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memcpy(&slot->port, port, sizeof *port);
+
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+} // export_write
+
+//*****************************************************************
+// Function : lacp_export_init
+//*****************************************************************
+void
+lacp_export_init(const char *path)
+{
+    struct lacp_export_file *map;
+    char *tmp;
+    int fd;
+
+    if (path == NULL || path[0] == '\0') {
+        return;
+    }
+
+    tmp = xasprintf("%s.tmp", path);
+
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        VLOG_WARN("Failed to open state export file %s, rc=%s; "
+                  "the export is disabled", tmp, strerror(errno));
+        goto out;
+    }
+
+    if (ftruncate(fd, EXPORT_FILE_SIZE) < 0) {
+        VLOG_WARN("Failed to size state export file %s, rc=%s; "
+                  "the export is disabled", tmp, strerror(errno));
+        close(fd);
+        unlink(tmp);
+        goto out;
+    }
+
+    map = mmap(NULL, EXPORT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+               fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        VLOG_WARN("Failed to map state export file %s, rc=%s; "
+                  "the export is disabled", tmp, strerror(errno));
+        unlink(tmp);
+        goto out;
+    }
+
+    map->header.version = LACP_EXPORT_VERSION;
+    map->header.n_ports = LACP_MAX_PORTS;
+    map->header.port_size = sizeof(struct lacp_export_slot);
+    map->header.pid = getpid();
+    map->header.interval_ms = LACPD_EXPORT_INTERVAL_MS;
+    map->header.updated_msec = export_now_msec();
+    __atomic_store_n(&map->header.magic, LACP_EXPORT_MAGIC,
+                     __ATOMIC_RELEASE);
+
+    if (rename(tmp, path) < 0) {
+        VLOG_WARN("Failed to rename state export file %s to %s, rc=%s; "
+                  "the export is disabled", tmp, path, strerror(errno));
+        munmap(map, EXPORT_FILE_SIZE);
+        unlink(tmp);
+        goto out;
+    }
+
+    export_map = map;
+    export_path = xstrdup(path);
+
+out:
+    free(tmp);
+} // lacp_export_init
+
+//*****************************************************************
+// Function : lacp_export_run
+//*****************************************************************
+void
+lacp_export_run(void)
+{
+    struct lacp_export_file *map = export_map;
+    lacp_per_port_variables_t *plpinfo;
+    struct lacp_export_port port;
+    unsigned long long now;
+    int worker = lacp_worker_self();
+    int ii;
+
+    if (map == NULL) {
+        return;
+    }
+
+    now = export_now_msec();
+    if (now < export_next[worker]) {
+        return;
+    }
+    export_next[worker] = now + LACPD_EXPORT_INTERVAL_MS;
+
+    for (ii = 0; ii < LACP_MAX_PORTS; ii++) {
+        struct lacp_export_slot *slot = &map->ports[ii];
+
+        if (!lacp_worker_owns(ii)) {
+            continue;
+        }
+
+        memset(&port, 0, sizeof port);
+
+        plpinfo = LACP_port_by_index(ii);
+        if (plpinfo != NULL) {
+            export_fill(&port, plpinfo, ii, now);
+        } else if (slot->port.name[0] == '\0') {
+            // Still unused; nothing to tell the readers.
+            continue;
+        }
+
+        export_write(slot, &port);
+    }
+
+    __atomic_store_n(&map->header.updated_msec, now, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&map->header.n_publishes, 1, __ATOMIC_RELAXED);
+} // lacp_export_run
+
+//*****************************************************************
+// Function : lacp_export_dump
+//*****************************************************************
+void
+lacp_export_dump(struct ds *ds)
+{
+    struct lacp_export_file *map = export_map;
+    struct lacp_export_port port;
+    int n_ports = 0;
+    int n_busy = 0;
+    int ii;
+
+    ds_put_format(ds, "State export:\n");
+    if (map == NULL) {
+        ds_put_format(ds, "    file          : none (the export is "
+                      "disabled)\n");
+        return;
+    }
+
+    for (ii = 0; ii < LACP_MAX_PORTS; ii++) {
+        if (!lacp_export_read_port(&map->ports[ii], &port, 4)) {
+            n_busy++;
+        } else if (port.name[0] != '\0') {
+            n_ports++;
+        }
+    }
+
+    ds_put_format(ds, "    file          : %s\n", export_path);
+    ds_put_format(ds, "    size          : %zu bytes\n", EXPORT_FILE_SIZE);
+    ds_put_format(ds, "    interval      : %d msec\n",
+                  LACPD_EXPORT_INTERVAL_MS);
+    ds_put_format(ds, "    publishes     : %llu\n",
+                  (unsigned long long)
+                  __atomic_load_n(&map->header.n_publishes,
+                                  __ATOMIC_RELAXED));
+    ds_put_format(ds, "    last publish  : %llu msec ago\n",
+                  export_now_msec() -
+                  __atomic_load_n(&map->header.updated_msec,
+                                  __ATOMIC_RELAXED));
+    ds_put_format(ds, "    ports         : %d\n", n_ports);
+    ds_put_format(ds, "    being written : %d\n", n_busy);
+} // lacp_export_dump
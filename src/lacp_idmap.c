@@ -0,0 +1,160 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_idmap.c
+ *
+ *   Bitmap allocators for the small integer IDs handed out by the
+ *   OVSDB interface (LAG IDs and interface indexes).
+ *
+ *   Each word holds 64 IDs.  Finding a free ID skips full words and
+ *   takes the lowest clear bit of the first one that is not full with
+ *   __builtin_ctzll().  The hint is the lowest word that may still
+ *   hold a free ID, so a run of allocations does not rescan the words
+ *   it has already filled; freeing an ID only moves the hint down.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include "lacp_idmap.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_idmap);
+
+#define LACP_IDMAP_WORD_BITS    64
+
+static struct lacp_idmap *all_idmaps;
+
+//*****************************************************************
+// Function : lacp_idmap_init
+//*****************************************************************
+void
+lacp_idmap_init(struct lacp_idmap *map, const char *name,
+                int first, unsigned int size)
+{
+    unsigned int tail;
+
+    memset(map, 0, sizeof(*map));
+    map->name = name;
+    map->first = first;
+    map->size = size;
+    map->n_words = (size + LACP_IDMAP_WORD_BITS - 1) / LACP_IDMAP_WORD_BITS;
+    map->words = xcalloc(map->n_words, sizeof(uint64_t));
+
+    /* Mark the bits past the end of the range as in use, so the last
+     * word needs no bounds check. */
+    tail = size % LACP_IDMAP_WORD_BITS;
+    if (tail) {
+        map->words[map->n_words - 1] = ~0ULL << tail;
+    }
+
+    map->next = all_idmaps;
+    all_idmaps = map;
+
+    VLOG_DBG("%s: %u IDs starting at %d", name, size, first);
+} // lacp_idmap_init
+
+//*****************************************************************
+// Function : lacp_idmap_alloc
+//*****************************************************************
+int
+lacp_idmap_alloc(struct lacp_idmap *map)
+{
+    unsigned int ww;
+
+    for (ww = map->hint; ww < map->n_words; ww++) {
+        uint64_t word = map->words[ww];
+        unsigned int bit;
+
+        if (word == ~0ULL) {
+            continue;
+        }
+
+        bit = __builtin_ctzll(~word);
+        map->words[ww] = word | (1ULL << bit);
+        map->hint = ww;
+
+        map->n_allocs++;
+        if (++map->n_in_use > map->n_high_water) {
+            map->n_high_water = map->n_in_use;
+        }
+
+        return map->first + (int)(ww * LACP_IDMAP_WORD_BITS + bit);
+    }
+
+    map->hint = map->n_words;
+    map->n_failures++;
+
+    return -1;
+} // lacp_idmap_alloc
+
+//*****************************************************************
+// Function : lacp_idmap_free
+//*****************************************************************
+bool
+lacp_idmap_free(struct lacp_idmap *map, int id)
+{
+    unsigned int idx;
+    unsigned int ww;
+    uint64_t mask;
+
+    if (id < map->first || (unsigned int)(id - map->first) >= map->size) {
+        return false;
+    }
+
+    idx = id - map->first;
+    ww = idx / LACP_IDMAP_WORD_BITS;
+    mask = 1ULL << (idx % LACP_IDMAP_WORD_BITS);
+
+    if ((map->words[ww] & mask) == 0) {
+        return false;
+    }
+
+    map->words[ww] &= ~mask;
+    if (ww < map->hint) {
+        map->hint = ww;
+    }
+
+    map->n_frees++;
+    map->n_in_use--;
+
+    return true;
+} // lacp_idmap_free
+
+//*****************************************************************
+// Function : lacp_idmap_dump
+//*****************************************************************
+void
+lacp_idmap_dump(struct ds *ds)
+{
+    struct lacp_idmap *map;
+
+    ds_put_format(ds, "ID maps:\n");
+    ds_put_format(ds, "    %-16s %8s %8s %8s %12s %12s %8s\n",
+                  "name", "size", "in use", "peak", "allocs", "frees",
+                  "failed");
+
+    for (map = all_idmaps; map; map = map->next) {
+        ds_put_format(ds, "    %-16s %8u %8u %8u %12lu %12lu %8lu\n",
+                      map->name, map->size, map->n_in_use,
+                      map->n_high_water, map->n_allocs, map->n_frees,
+                      map->n_failures);
+    }
+} // lacp_idmap_dump
@@ -0,0 +1,340 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_latency.c
+ *
+ *   Convergence latency tracing.
+ *
+ *   A trace follows one port from the LACPDU that made it select an
+ *   aggregator to the OVSDB commit that enabled RX in hw_bond_config.
+ *   The protocol thread stamps the mux transitions in the port's
+ *   lacp_latency_trace_t and the OVSDB thread times the write-back, and
+ *   each stage goes into a log2 histogram.  Every protocol worker has
+ *   its own set, which the dump adds up, so every histogram has one
+ *   writer; the counters are updated with relaxed atomics so that
+ *   lacpd/getlacplatency can read them from the OVSDB thread at any
+ *   time, at worst seeing a sample half recorded.
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+
+#include <lacp_cmn.h>
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_latency.h"
+#include "lacp_worker.h"
+
+/* The sample count is the sum of the buckets. */
+struct lacp_latency_hist {
+    unsigned long long total_usec;
+    unsigned long long max_usec;
+    unsigned long long buckets[LACP_LAT_BUCKETS];
+};
+
+static struct lacp_latency_hist lat_hists[LACPD_PROTOCOL_WORKERS]
+                                        [LACP_LAT_N_STAGES];
+
+static const char *const lat_stage_names[LACP_LAT_N_STAGES] = {
+    [LACP_LAT_RX_QUEUE]   = "rx_queue",
+    [LACP_LAT_SELECT]     = "select",
+    [LACP_LAT_WAIT_WHILE] = "wait_while",
+    [LACP_LAT_ATTACHED]   = "attached",
+    [LACP_LAT_COLLECTING] = "collecting",
+    [LACP_LAT_DB_QUEUE]   = "db_queue",
+    [LACP_LAT_DB_COMMIT]  = "db_commit",
+    [LACP_LAT_TOTAL]      = "total",
+};
+
+/* The LACPDU batch being handled by this protocol thread, if any. */
+static __thread unsigned long long lat_batch_rx_usec;
+static __thread unsigned long long lat_batch_fsm_usec;
+
+//*****************************************************************
+// Function : lacp_latency_now
+//*****************************************************************
+unsigned long long
+lacp_latency_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+} // lacp_latency_now
+
+static int
+lat_bucket(unsigned long long usec)
+{
+    int bucket;
+
+    if (usec == 0) {
+        return 0;
+    }
+
+    bucket = 64 - __builtin_clzll(usec);
+    return MIN(bucket, LACP_LAT_BUCKETS - 1);
+} // lat_bucket
+
+//*****************************************************************
+// Function : lacp_latency_record
+//*****************************************************************
+void
+lacp_latency_record(enum lacp_latency_stage stage, unsigned long long usec)
+{
+    struct lacp_latency_hist *h = &lat_hists[lacp_worker_self()][stage];
+    int bucket = lat_bucket(usec);
+
+    __atomic_store_n(&h->total_usec, h->total_usec + usec, __ATOMIC_RELAXED);
+    if (usec > h->max_usec) {
+        __atomic_store_n(&h->max_usec, usec, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&h->buckets[bucket], h->buckets[bucket] + 1,
+                     __ATOMIC_RELAXED);
+} // lacp_latency_record
+
+//*****************************************************************
+// Function : lacp_latency_rx_begin
+//            lacp_latency_rx_end
+//*****************************************************************
+void
+lacp_latency_rx_begin(unsigned long long rx_usec)
+{
+    lat_batch_rx_usec = rx_usec;
+    lat_batch_fsm_usec = lacp_latency_now();
+} // lacp_latency_rx_begin
+
+void
+lacp_latency_rx_end(void)
+{
+    lat_batch_rx_usec = 0;
+    lat_batch_fsm_usec = 0;
+} // lacp_latency_rx_end
+
+static void
+lat_store_last(lacp_latency_trace_t *trace, enum lacp_latency_stage stage,
+               unsigned long long usec)
+{
+    lacp_latency_record(stage, usec);
+    __atomic_store_n(&trace->last_usec[stage],
+                     (unsigned int)MIN(usec, UINT_MAX), __ATOMIC_RELAXED);
+} // lat_store_last
+
+//*****************************************************************
+// Function : lacp_latency_mux_state
+//*****************************************************************
+void
+lacp_latency_mux_state(struct lacp_per_port_variables *plpinfo,
+                       int mux_state)
+{
+    lacp_latency_trace_t *trace = &LACP_PORT_COLD(plpinfo)->latency;
+    unsigned long long now;
+
+    switch (mux_state) {
+    case MUX_FSM_DETACHED_STATE:
+        trace->active = false;
+        break;
+
+    case MUX_FSM_WAITING_STATE:
+        /* Timer driven selection has no LACPDU to start from. */
+        now = lacp_latency_now();
+        trace->t_rx = lat_batch_rx_usec;
+        trace->t_fsm = lat_batch_fsm_usec ? lat_batch_fsm_usec : now;
+        trace->t_waiting = now;
+        trace->t_attached = 0;
+        trace->t_collecting = 0;
+        trace->active = true;
+        break;
+
+    case MUX_FSM_ATTACHED_STATE:
+        if (trace->active && !trace->t_attached) {
+            trace->t_attached = lacp_latency_now();
+        }
+        break;
+
+    case MUX_FSM_COLLECTING_STATE:
+        if (trace->active && !trace->t_collecting) {
+            trace->t_collecting = lacp_latency_now();
+        }
+        break;
+
+    case MUX_FSM_COLLECTING_DISTRIBUTING_STATE:
+        if (!trace->active || !trace->t_attached || !trace->t_collecting) {
+            trace->active = false;
+            break;
+        }
+
+        now = lacp_latency_now();
+        if (trace->t_rx && trace->t_fsm >= trace->t_rx) {
+            lat_store_last(trace, LACP_LAT_RX_QUEUE,
+                           trace->t_fsm - trace->t_rx);
+        } else {
+            __atomic_store_n(&trace->last_usec[LACP_LAT_RX_QUEUE], 0,
+                             __ATOMIC_RELAXED);
+        }
+        lat_store_last(trace, LACP_LAT_SELECT,
+                       trace->t_waiting - trace->t_fsm);
+        lat_store_last(trace, LACP_LAT_WAIT_WHILE,
+                       trace->t_attached - trace->t_waiting);
+        lat_store_last(trace, LACP_LAT_ATTACHED,
+                       trace->t_collecting - trace->t_attached);
+        lat_store_last(trace, LACP_LAT_COLLECTING,
+                       now - trace->t_collecting);
+        trace->active = false;
+        break;
+
+    default:
+        break;
+    }
+} // lacp_latency_mux_state
+
+//*****************************************************************
+// Function : lacp_latency_trace_start
+//*****************************************************************
+unsigned long long
+lacp_latency_trace_start(const lacp_latency_trace_t *trace)
+{
+    if (!trace->active) {
+        return 0;
+    }
+
+    return trace->t_rx ? trace->t_rx : trace->t_fsm;
+} // lacp_latency_trace_start
+
+const char *
+lacp_latency_stage_name(enum lacp_latency_stage stage)
+{
+    return lat_stage_names[stage];
+} // lacp_latency_stage_name
+
+/* Upper bound of the bucket that holds the pct'th percentile. */
+static unsigned long long
+lat_percentile(const unsigned long long *buckets, unsigned long long count,
+               int pct)
+{
+    unsigned long long want = (count * pct + 99) / 100;
+    unsigned long long seen = 0;
+    int ii;
+
+    for (ii = 0; ii < LACP_LAT_BUCKETS; ii++) {
+        seen += buckets[ii];
+        if (seen >= want) {
+            break;
+        }
+    }
+
+    return 1ULL << MIN(ii, LACP_LAT_BUCKETS - 1);
+} // lat_percentile
+
+/* Adds up the workers' histograms of a stage. */
+static void
+lat_hist_sum(enum lacp_latency_stage stage, struct lacp_latency_hist *sum)
+{
+    int worker;
+    int ii;
+
+    memset(sum, 0, sizeof(*sum));
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        const struct lacp_latency_hist *h = &lat_hists[worker][stage];
+
+        sum->total_usec += __atomic_load_n(&h->total_usec, __ATOMIC_RELAXED);
+        sum->max_usec = MAX(sum->max_usec,
+                            __atomic_load_n(&h->max_usec, __ATOMIC_RELAXED));
+        for (ii = 0; ii < LACP_LAT_BUCKETS; ii++) {
+            sum->buckets[ii] += __atomic_load_n(&h->buckets[ii],
+                                                __ATOMIC_RELAXED);
+        }
+    }
+} // lat_hist_sum
+
+//*****************************************************************
+// Function : lacp_latency_dump
+//*****************************************************************
+void
+lacp_latency_dump(struct ds *ds)
+{
+    struct lacp_latency_hist h;
+    unsigned long long count;
+    int stage;
+    int ii;
+
+    ds_put_format(ds, "Convergence latency (usec):\n");
+    ds_put_format(ds, "  %-11s %10s %10s %10s %10s %10s\n",
+                  "stage", "count", "avg", "p50<=", "p99<=", "max");
+
+    for (stage = 0; stage < LACP_LAT_N_STAGES; stage++) {
+        lat_hist_sum(stage, &h);
+
+        count = 0;
+        for (ii = 0; ii < LACP_LAT_BUCKETS; ii++) {
+            count += h.buckets[ii];
+        }
+
+        if (count == 0) {
+            ds_put_format(ds, "  %-11s %10d\n", lat_stage_names[stage], 0);
+            continue;
+        }
+
+        ds_put_format(ds, "  %-11s %10llu %10llu %10llu %10llu %10llu\n",
+                      lat_stage_names[stage], count, h.total_usec / count,
+                      lat_percentile(h.buckets, count, 50),
+                      lat_percentile(h.buckets, count, 99), h.max_usec);
+    }
+
+    ds_put_format(ds, "Histogram (samples per bucket, <= usec):\n");
+    for (stage = 0; stage < LACP_LAT_N_STAGES; stage++) {
+        bool any = false;
+
+        lat_hist_sum(stage, &h);
+
+        for (ii = 0; ii < LACP_LAT_BUCKETS; ii++) {
+            count = h.buckets[ii];
+            if (count == 0) {
+                continue;
+            }
+            if (!any) {
+                ds_put_format(ds, "  %-11s", lat_stage_names[stage]);
+                any = true;
+            }
+            ds_put_format(ds, " %llu:%llu", 1ULL << ii, count);
+        }
+        if (any) {
+            ds_put_char(ds, '\n');
+        }
+    }
+} // lacp_latency_dump
+
+//*****************************************************************
+// Function : lacp_latency_trace_dump
+//*****************************************************************
+void
+lacp_latency_trace_dump(struct ds *ds, const lacp_latency_trace_t *trace)
+{
+    int stage;
+
+    for (stage = 0; stage < LACP_LAT_N_FSM_STAGES; stage++) {
+        ds_put_format(ds, " %s=%u", lat_stage_names[stage],
+                      __atomic_load_n(&trace->last_usec[stage],
+                                      __ATOMIC_RELAXED));
+    }
+} // lacp_latency_trace_dump
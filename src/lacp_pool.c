@@ -0,0 +1,182 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_pool.c
+ *
+ *   Object pools for the LACP data structures that are created and
+ *   destroyed as ports flap (LAGs, LAG IDs, aggregator parameters and
+ *   list nodes).  Keeping them in per-type slabs stops a long running
+ *   daemon from fragmenting the heap.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include "lacp_pool.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_pool);
+
+/* Keeps every object suitably aligned for any of the pooled types. */
+#define LACP_POOL_ALIGN     (2 * sizeof(void *))
+
+/* Written by the protocol thread only; lacpd/dump walks it from the
+ * OVSDB thread.  Pools are never removed. */
+static struct lacp_pool *all_pools;
+
+static size_t
+pool_obj_size(const struct lacp_pool *pool)
+{
+    size_t size = pool->obj_size;
+
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+
+    return (size + LACP_POOL_ALIGN - 1) & ~(LACP_POOL_ALIGN - 1);
+} // pool_obj_size
+
+static void
+pool_register(struct lacp_pool *pool)
+{
+    pool->next = all_pools;
+    __atomic_store_n(&all_pools, pool, __ATOMIC_RELEASE);
+    pool->registered = true;
+} // pool_register
+
+static bool
+pool_grow(struct lacp_pool *pool)
+{
+    size_t size = pool_obj_size(pool);
+    char *slab;
+    unsigned int ii;
+
+    slab = malloc(size * pool->objs_per_slab);
+    if (slab == NULL) {
+        VLOG_ERR("Out of memory growing %s pool", pool->name);
+        return false;
+    }
+
+    for (ii = 0; ii < pool->objs_per_slab; ii++) {
+        void **obj = (void **)(slab + ii * size);
+
+        *obj = pool->free_list;
+        pool->free_list = obj;
+    }
+
+    __atomic_store_n(&pool->n_slabs, pool->n_slabs + 1, __ATOMIC_RELAXED);
+
+    return true;
+} // pool_grow
+
+//*****************************************************************
+// Function : lacp_pool_alloc
+//*****************************************************************
+void *
+lacp_pool_alloc(struct lacp_pool *pool)
+{
+    void **obj;
+
+    if (!pool->registered) {
+        pool_register(pool);
+    }
+
+    if (pool->free_list == NULL && !pool_grow(pool)) {
+        return NULL;
+    }
+
+    obj = pool->free_list;
+    pool->free_list = *obj;
+
+    __atomic_store_n(&pool->n_in_use, pool->n_in_use + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->n_allocs, pool->n_allocs + 1, __ATOMIC_RELAXED);
+    if (pool->n_in_use > pool->n_high_water) {
+        __atomic_store_n(&pool->n_high_water, pool->n_in_use,
+                         __ATOMIC_RELAXED);
+    }
+
+    memset(obj, 0, pool->obj_size);
+
+    return obj;
+} // lacp_pool_alloc
+
+//*****************************************************************
+// Function : lacp_pool_free
+//*****************************************************************
+void
+lacp_pool_free(struct lacp_pool *pool, void *obj)
+{
+    void **link = obj;
+
+    if (obj == NULL) {
+        return;
+    }
+
+    *link = pool->free_list;
+    pool->free_list = link;
+
+    __atomic_store_n(&pool->n_in_use, pool->n_in_use - 1, __ATOMIC_RELAXED);
+} // lacp_pool_free
+
+//*****************************************************************
+// Function : lacp_pool_memory
+//*****************************************************************
+size_t
+lacp_pool_memory(const char *name, unsigned long *n_in_use)
+{
+    struct lacp_pool *pool;
+
+    *n_in_use = 0;
+
+    for (pool = __atomic_load_n(&all_pools, __ATOMIC_ACQUIRE);
+         pool;
+         pool = pool->next) {
+        if (!strcmp(pool->name, name)) {
+            *n_in_use = __atomic_load_n(&pool->n_in_use, __ATOMIC_RELAXED);
+            return (__atomic_load_n(&pool->n_slabs, __ATOMIC_RELAXED) *
+                    pool->objs_per_slab * pool_obj_size(pool));
+        }
+    }
+
+    return 0;
+} // lacp_pool_memory
+
+//*****************************************************************
+// Function : lacp_pool_dump
+//*****************************************************************
+void
+lacp_pool_dump(struct ds *ds)
+{
+    struct lacp_pool *pool;
+
+    ds_put_format(ds, "Object pools:\n");
+    ds_put_format(ds, "    %-16s %8s %8s %8s %8s %12s\n",
+                  "name", "size", "slabs", "in use", "peak", "allocs");
+
+    for (pool = __atomic_load_n(&all_pools, __ATOMIC_ACQUIRE);
+         pool;
+         pool = pool->next) {
+        ds_put_format(ds, "    %-16s %8zu %8lu %8lu %8lu %12lu\n",
+                      pool->name, pool->obj_size,
+                      __atomic_load_n(&pool->n_slabs, __ATOMIC_RELAXED),
+                      __atomic_load_n(&pool->n_in_use, __ATOMIC_RELAXED),
+                      __atomic_load_n(&pool->n_high_water, __ATOMIC_RELAXED),
+                      __atomic_load_n(&pool->n_allocs, __ATOMIC_RELAXED));
+    }
+} // lacp_pool_dump
@@ -0,0 +1,578 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_rx_filter.c
+ *
+ *   In-kernel filtering of steady-state LACPDUs (LACPD_RX_EBPF).
+ *
+ *   Once a port is selected and its partner keeps sending the same
+ *   LACPDU, the receive machine's fast path does nothing but restart
+ *   current_while.  With this option the RX sockets run an eBPF socket
+ *   filter instead of the classic one, with a hash map keyed by
+ *   ifindex.  While the fast path applies to a port, the protocol
+ *   thread stores the actor and partner TLVs of its last LACPDU in the
+ *   port's entry; the filter then drops every LACPDU with the same
+ *   TLVs, counting it and stamping the time it arrived.  Neither the
+ *   RX thread nor the protocol thread wakes up for it.
+ *
+ *   When current_while expires, the protocol thread looks at the
+ *   port's entry first: if the kernel dropped an identical LACPDU less
+ *   than a timeout ago, the partner is still current and the timer is
+ *   restarted from that LACPDU.  As soon as a state machine changes the
+ *   state the fast path depends on, the entry is cleared and LACPDUs
+ *   reach lacpd again.  The filtered LACPDUs are added to the port's
+ *   received and fast path counts at these two points.
+ *
+ *   The program is built here instruction by instruction, so no eBPF
+ *   toolchain is needed.  Without LACPD_RX_EBPF all of this compiles
+ *   away.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include <lacp_cmn.h>
+#include <pm_cmn.h>
+#include <mlacp_debug.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "lacp_rx_filter.h"
+
+#ifdef LACPD_RX_EBPF
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <linux/bpf.h>
+#endif
+
+VLOG_DEFINE_THIS_MODULE(lacp_rx_filter);
+
+#ifdef LACPD_RX_EBPF
+/* Frame offsets: the actor and partner TLVs the fast path compares,
+ * as in lacp_per_port_variables_t rx_info. */
+#define RX_FILTER_INFO_OFFSET   offsetof(lacpdu_payload_t, tlv_type_actor)
+#define RX_FILTER_WORDS         (2 * LACP_TLV_INFO_LENGTH / 4)
+
+/* A map entry, shared with the program.  info holds the TLVs as the
+ * program loads them: 32-bit words in host order. */
+struct rx_filter_value {
+    uint32_t            info[RX_FILTER_WORDS];
+    uint32_t            armed;
+    uint32_t            pad;
+    uint64_t            last_seen_ns;   /* CLOCK_MONOTONIC, 0 if none */
+    uint64_t            n_filtered;
+};
+
+#define RX_FILTER_ARMED_OFFSET  offsetof(struct rx_filter_value, armed)
+#define RX_FILTER_SEEN_OFFSET   offsetof(struct rx_filter_value, last_seen_ns)
+#define RX_FILTER_COUNT_OFFSET  offsetof(struct rx_filter_value, n_filtered)
+
+/* What the protocol thread last told the kernel about a port. */
+struct rx_filter_port {
+    int                 ifindex;        /* 0 if not registered */
+    bool                armed;
+    uint32_t            info[RX_FILTER_WORDS];
+    uint64_t            n_collected;    /* of the entry's n_filtered */
+};
+
+/* Indexed by PM_HANDLE2PORT(); each slot is only touched by the port's
+ * protocol thread. */
+static struct rx_filter_port rx_filter_ports[LACP_MAX_PORTS];
+
+static int rx_filter_map_fd = -1;
+static int rx_filter_prog_fd = -1;
+
+/* Bumped by every protocol worker. */
+static unsigned long rx_filter_arms;
+static unsigned long rx_filter_disarms;
+static unsigned long rx_filter_refreshes;
+static unsigned long rx_filter_expiries;
+static unsigned long rx_filter_pdus;
+static unsigned long rx_filter_errors;
+
+/* Instructions, the way the kernel's own filter.h spells them. */
+#define INSN(CODE, DST, SRC, OFF, IMM) \
+    ((struct bpf_insn) { .code = (CODE), .dst_reg = (DST), \
+                         .src_reg = (SRC), .off = (OFF), .imm = (IMM) })
+#define MOV64_REG(DST, SRC)     INSN(BPF_ALU64 | BPF_MOV | BPF_X, DST, SRC, 0, 0)
+#define MOV64_IMM(DST, IMM)     INSN(BPF_ALU64 | BPF_MOV | BPF_K, DST, 0, 0, IMM)
+#define MOV32_IMM(DST, IMM)     INSN(BPF_ALU | BPF_MOV | BPF_K, DST, 0, 0, IMM)
+#define ADD64_IMM(DST, IMM)     INSN(BPF_ALU64 | BPF_ADD | BPF_K, DST, 0, 0, IMM)
+#define LD_ABS(SIZE, OFF)       INSN(BPF_LD | BPF_ABS | (SIZE), 0, 0, 0, OFF)
+#define LDX_MEM(SIZE, DST, SRC, OFF) \
+    INSN(BPF_LDX | BPF_MEM | (SIZE), DST, SRC, OFF, 0)
+#define STX_MEM(SIZE, DST, SRC, OFF) \
+    INSN(BPF_STX | BPF_MEM | (SIZE), DST, SRC, OFF, 0)
+#define STX_XADD(SIZE, DST, SRC, OFF) \
+    INSN(BPF_STX | BPF_XADD | (SIZE), DST, SRC, OFF, 0)
+#define LD_MAP_FD(DST, FD) \
+    INSN(BPF_LD | BPF_DW | BPF_IMM, DST, BPF_PSEUDO_MAP_FD, 0, FD)
+#define LD_IMM64_HI(IMM)        INSN(0, 0, 0, 0, IMM)
+#define CALL(FUNC)              INSN(BPF_JMP | BPF_CALL, 0, 0, 0, FUNC)
+#define EXIT()                  INSN(BPF_JMP | BPF_EXIT, 0, 0, 0, 0)
+
+/* Jumps to the end of the program, resolved by rx_filter_resolve(). */
+#define RX_FILTER_PASS          (-1)    /* up to lacpd */
+#define RX_FILTER_DROP          (-2)    /* not a slow-protocol frame */
+#define JNE_REG(DST, SRC, TO)   INSN(BPF_JMP | BPF_JNE | BPF_X, DST, SRC, TO, 0)
+#define JEQ_IMM(DST, IMM, TO)   INSN(BPF_JMP | BPF_JEQ | BPF_K, DST, 0, TO, IMM)
+#define JLT_IMM(DST, IMM, TO)   INSN(BPF_JMP | BPF_JLT | BPF_K, DST, 0, TO, IMM)
+
+static long
+rx_filter_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof *attr);
+} // rx_filter_bpf
+
+/* Points the RX_FILTER_PASS and RX_FILTER_DROP jumps at the two exits
+ * at the end of the program. */
+static void
+rx_filter_resolve(struct bpf_insn *insns, int n_insns, int pass, int drop)
+{
+    int ii;
+
+    for (ii = 0; ii < n_insns; ii++) {
+        if (BPF_CLASS(insns[ii].code) != BPF_JMP ||
+            BPF_OP(insns[ii].code) == BPF_CALL ||
+            BPF_OP(insns[ii].code) == BPF_EXIT) {
+            continue;
+        }
+
+        if (insns[ii].off == RX_FILTER_PASS) {
+            insns[ii].off = pass - (ii + 1);
+        } else if (insns[ii].off == RX_FILTER_DROP) {
+            insns[ii].off = drop - (ii + 1);
+        }
+    }
+} // rx_filter_resolve
+
+/* The classic filter's destination MAC check, then: a LACPDU of full
+ * length whose TLVs match its ifindex's armed entry is counted and
+ * dropped, anything else goes up to lacpd as before. */
+static int
+rx_filter_load(int map_fd)
+{
+    struct bpf_insn insns[128];
+    union bpf_attr attr;
+    int n = 0;
+    int pass, drop;
+    int ii;
+
+    // r6 = skb, as LD_ABS wants it.
+    insns[n++] = MOV64_REG(BPF_REG_6, BPF_REG_1);
+
+    // ether dst 01:80:c2:00:00:02
+    insns[n++] = LD_ABS(BPF_W, 2);
+    insns[n++] = MOV32_IMM(BPF_REG_1, 0xc2000002);
+    insns[n++] = JNE_REG(BPF_REG_0, BPF_REG_1, RX_FILTER_DROP);
+    insns[n++] = LD_ABS(BPF_H, 0);
+    insns[n++] = MOV32_IMM(BPF_REG_1, 0x0180);
+    insns[n++] = JNE_REG(BPF_REG_0, BPF_REG_1, RX_FILTER_DROP);
+
+    // Short frames and Marker PDUs are lacpd's business.
+    insns[n++] = LDX_MEM(BPF_W, BPF_REG_0, BPF_REG_6,
+                         offsetof(struct __sk_buff, len));
+    insns[n++] = JLT_IMM(BPF_REG_0, LACP_PKT_SIZE, RX_FILTER_PASS);
+    insns[n++] = LD_ABS(BPF_B, LACP_HEADROOM_SIZE);
+    insns[n++] = MOV32_IMM(BPF_REG_1, LACP_SUBTYPE);
+    insns[n++] = JNE_REG(BPF_REG_0, BPF_REG_1, RX_FILTER_PASS);
+
+    // r7 = the entry of skb->ifindex, if armed.
+    insns[n++] = LDX_MEM(BPF_W, BPF_REG_1, BPF_REG_6,
+                         offsetof(struct __sk_buff, ifindex));
+    insns[n++] = STX_MEM(BPF_W, BPF_REG_10, BPF_REG_1, -4);
+    insns[n++] = MOV64_REG(BPF_REG_2, BPF_REG_10);
+    insns[n++] = ADD64_IMM(BPF_REG_2, -4);
+    insns[n++] = LD_MAP_FD(BPF_REG_1, map_fd);
+    insns[n++] = LD_IMM64_HI(0);
+    insns[n++] = CALL(BPF_FUNC_map_lookup_elem);
+    insns[n++] = JEQ_IMM(BPF_REG_0, 0, RX_FILTER_PASS);
+    insns[n++] = MOV64_REG(BPF_REG_7, BPF_REG_0);
+    insns[n++] = LDX_MEM(BPF_W, BPF_REG_0, BPF_REG_7, RX_FILTER_ARMED_OFFSET);
+    insns[n++] = JEQ_IMM(BPF_REG_0, 0, RX_FILTER_PASS);
+
+    // The TLVs, a word at a time.
+    for (ii = 0; ii < RX_FILTER_WORDS; ii++) {
+        insns[n++] = LD_ABS(BPF_W, RX_FILTER_INFO_OFFSET + 4 * ii);
+        insns[n++] = LDX_MEM(BPF_W, BPF_REG_1, BPF_REG_7, 4 * ii);
+        insns[n++] = JNE_REG(BPF_REG_0, BPF_REG_1, RX_FILTER_PASS);
+    }
+
+    // Same LACPDU: stamp, count and drop it.
+    insns[n++] = CALL(BPF_FUNC_ktime_get_ns);
+    insns[n++] = STX_MEM(BPF_DW, BPF_REG_7, BPF_REG_0, RX_FILTER_SEEN_OFFSET);
+    insns[n++] = MOV64_IMM(BPF_REG_1, 1);
+    insns[n++] = STX_XADD(BPF_DW, BPF_REG_7, BPF_REG_1, RX_FILTER_COUNT_OFFSET);
+    insns[n++] = MOV64_IMM(BPF_REG_0, 0);
+    insns[n++] = EXIT();
+
+    pass = n;
+    insns[n++] = MOV64_IMM(BPF_REG_0, 0xffff);
+    insns[n++] = EXIT();
+
+    drop = n;
+    insns[n++] = MOV64_IMM(BPF_REG_0, 0);
+    insns[n++] = EXIT();
+
+    ovs_assert(n <= ARRAY_SIZE(insns));
+    rx_filter_resolve(insns, n, pass, drop);
+
+    memset(&attr, 0, sizeof attr);
+    attr.prog_type = BPF_PROG_TYPE_SOCKET_FILTER;
+    attr.insns = (uintptr_t)insns;
+    attr.insn_cnt = n;
+    attr.license = (uintptr_t)"Apache-2.0";
+
+    return rx_filter_bpf(BPF_PROG_LOAD, &attr);
+} // rx_filter_load
+
+static uint64_t
+rx_filter_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+} // rx_filter_now_ns
+
+static void
+rx_filter_count(unsigned long *counter, unsigned long n)
+{
+    __atomic_add_fetch(counter, n, __ATOMIC_RELAXED);
+} // rx_filter_count
+
+static bool
+rx_filter_write(const struct rx_filter_port *fp,
+                const struct rx_filter_value *value)
+{
+    union bpf_attr attr;
+    uint32_t key = fp->ifindex;
+
+    memset(&attr, 0, sizeof attr);
+    attr.map_fd = rx_filter_map_fd;
+    attr.key = (uintptr_t)&key;
+    attr.value = (uintptr_t)value;
+    attr.flags = BPF_ANY;
+
+    if (rx_filter_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&rl, "Failed to update LACPDU filter for ifindex %d, "
+                     "rc=%s", fp->ifindex, strerror(errno));
+        rx_filter_count(&rx_filter_errors, 1);
+        return false;
+    }
+
+    return true;
+} // rx_filter_write
+
+/* Reads the port's entry, and adds the LACPDUs the kernel dropped since
+ * the last time to the port's counters. */
+static bool
+rx_filter_collect(lacp_per_port_variables_t *plpinfo,
+                  struct rx_filter_port *fp, struct rx_filter_value *value)
+{
+    union bpf_attr attr;
+    uint32_t key = fp->ifindex;
+    uint64_t n;
+
+    memset(&attr, 0, sizeof attr);
+    attr.map_fd = rx_filter_map_fd;
+    attr.key = (uintptr_t)&key;
+    attr.value = (uintptr_t)value;
+
+    if (rx_filter_bpf(BPF_MAP_LOOKUP_ELEM, &attr) < 0) {
+        rx_filter_count(&rx_filter_errors, 1);
+        return false;
+    }
+
+    n = value->n_filtered - fp->n_collected;
+    if (n != 0) {
+        fp->n_collected = value->n_filtered;
+        LACP_STATS_WRITE_BEGIN(plpinfo);
+        __atomic_store_n(&plpinfo->stats.lacp_pdus_received,
+                         plpinfo->stats.lacp_pdus_received + n,
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&plpinfo->stats.lacp_pdus_fast_path,
+                         plpinfo->stats.lacp_pdus_fast_path + n,
+                         __ATOMIC_RELAXED);
+        LACP_STATS_WRITE_END(plpinfo);
+        rx_filter_count(&rx_filter_pdus, n);
+    }
+
+    return true;
+} // rx_filter_collect
+
+static void
+rx_filter_disarm(lacp_per_port_variables_t *plpinfo,
+                 struct rx_filter_port *fp)
+{
+    struct rx_filter_value value;
+
+    if (plpinfo != NULL) {
+        rx_filter_collect(plpinfo, fp, &value);
+    }
+
+    memset(&value, 0, sizeof value);
+    if (rx_filter_write(fp, &value)) {
+        fp->armed = false;
+        rx_filter_count(&rx_filter_disarms, 1);
+    }
+} // rx_filter_disarm
+
+/* Whether the kernel may drop the port's repeated LACPDUs: the
+ * receive machine's fast path applies, and LACPDU debug, which wants
+ * to see them all, is off. */
+static bool
+rx_filter_ready(lacp_per_port_variables_t *plpinfo)
+{
+    return (LACP_rx_fast_path_ready(plpinfo) &&
+            !(plpinfo->debug_level & DBG_LACPDU));
+} // rx_filter_ready
+#endif /* LACPD_RX_EBPF */
+
+//*****************************************************************
+// Function : lacp_rx_filter_init
+//*****************************************************************
+void
+lacp_rx_filter_init(void)
+{
+#ifdef LACPD_RX_EBPF
+    union bpf_attr attr;
+    int fd;
+
+    memset(&attr, 0, sizeof attr);
+    attr.map_type = BPF_MAP_TYPE_HASH;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(struct rx_filter_value);
+    attr.max_entries = LACP_MAX_PORTS;
+
+    fd = rx_filter_bpf(BPF_MAP_CREATE, &attr);
+    if (fd < 0) {
+        VLOG_WARN("Failed to create LACPDU filter map, rc=%s; "
+                  "using the classic filter", strerror(errno));
+        return;
+    }
+
+    rx_filter_prog_fd = rx_filter_load(fd);
+    if (rx_filter_prog_fd < 0) {
+        VLOG_WARN("Failed to load LACPDU filter program, rc=%s; "
+                  "using the classic filter", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    rx_filter_map_fd = fd;
+    VLOG_INFO("In-kernel LACPDU filter loaded");
+#endif
+} // lacp_rx_filter_init
+
+//*****************************************************************
+// Function : lacp_rx_filter_prog
+//*****************************************************************
+int
+lacp_rx_filter_prog(void)
+{
+#ifdef LACPD_RX_EBPF
+    return rx_filter_prog_fd;
+#else
+    return -1;
+#endif
+} // lacp_rx_filter_prog
+
+//*****************************************************************
+// Function : lacp_rx_filter_port
+//*****************************************************************
+void
+lacp_rx_filter_port(int port, int ifindex)
+{
+#ifdef LACPD_RX_EBPF
+    struct rx_filter_port *fp;
+    union bpf_attr attr;
+    uint32_t key;
+
+    if (rx_filter_map_fd < 0 || port < 0 || port >= LACP_MAX_PORTS) {
+        return;
+    }
+
+    fp = &rx_filter_ports[port];
+    if (fp->ifindex != 0) {
+        key = fp->ifindex;
+        memset(&attr, 0, sizeof attr);
+        attr.map_fd = rx_filter_map_fd;
+        attr.key = (uintptr_t)&key;
+        rx_filter_bpf(BPF_MAP_DELETE_ELEM, &attr);
+    }
+
+    memset(fp, 0, sizeof *fp);
+    fp->ifindex = ifindex;
+#endif
+} // lacp_rx_filter_port
+
+//*****************************************************************
+// Function : lacp_rx_filter_update
+//*****************************************************************
+void
+lacp_rx_filter_update(lacp_per_port_variables_t *plpinfo)
+{
+#ifdef LACPD_RX_EBPF
+    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+    struct rx_filter_port *fp;
+    struct rx_filter_value value;
+    int ii;
+
+    if (rx_filter_map_fd < 0 || port < 0 || port >= LACP_MAX_PORTS) {
+        return;
+    }
+
+    fp = &rx_filter_ports[port];
+    if (fp->ifindex == 0) {
+        return;
+    }
+
+    if (!rx_filter_ready(plpinfo)) {
+        if (fp->armed) {
+            rx_filter_disarm(plpinfo, fp);
+        }
+        return;
+    }
+
+    memset(&value, 0, sizeof value);
+    for (ii = 0; ii < RX_FILTER_WORDS; ii++) {
+        uint32_t word;
+
+        memcpy(&word, &plpinfo->rx_info[4 * ii], sizeof word);
+        value.info[ii] = ntohl(word);
+    }
+
+    if (fp->armed && !memcmp(fp->info, value.info, sizeof value.info)) {
+        return;
+    }
+
+    // New TLVs: collect what the old ones filtered before replacing
+    // them.
+    if (fp->armed) {
+        struct rx_filter_value old;
+
+        rx_filter_collect(plpinfo, fp, &old);
+    }
+
+    value.armed = 1;
+    if (rx_filter_write(fp, &value)) {
+        fp->armed = true;
+        fp->n_collected = 0;
+        memcpy(fp->info, value.info, sizeof fp->info);
+        rx_filter_count(&rx_filter_arms, 1);
+    }
+#endif
+} // lacp_rx_filter_update
+
+//*****************************************************************
+// Function : lacp_rx_filter_refresh
+//*****************************************************************
+bool
+lacp_rx_filter_refresh(lacp_per_port_variables_t *plpinfo)
+{
+#ifdef LACPD_RX_EBPF
+    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
+    struct rx_filter_port *fp;
+    struct rx_filter_value value;
+    uint64_t timeout_ns;
+    uint64_t age_ns;
+
+    if (rx_filter_map_fd < 0 || port < 0 || port >= LACP_MAX_PORTS) {
+        return false;
+    }
+
+    fp = &rx_filter_ports[port];
+    if (!fp->armed) {
+        return false;
+    }
+
+    // The TLVs the kernel matches against are only current while the
+    // fast path applies; some state changes come without a state
+    // machine run, and so without lacp_rx_filter_update().
+    if (!rx_filter_ready(plpinfo)) {
+        rx_filter_disarm(plpinfo, fp);
+        return false;
+    }
+
+    if (!rx_filter_collect(plpinfo, fp, &value)) {
+        return false;
+    }
+
+    timeout_ns = (uint64_t)(plpinfo->actor_oper_port_state.lacp_timeout ==
+                            SHORT_TIMEOUT ? SHORT_TIMEOUT_COUNT :
+                                            LONG_TIMEOUT_COUNT) *
+                 1000000000;
+    age_ns = rx_filter_now_ns() - value.last_seen_ns;
+
+    if (value.last_seen_ns == 0 || age_ns >= timeout_ns) {
+        rx_filter_count(&rx_filter_expiries, 1);
+        return false;
+    }
+
+    lacp_timer_start(&plpinfo->current_while_timer,
+                     (timeout_ns - age_ns) / 1000000 + 1);
+    rx_filter_count(&rx_filter_refreshes, 1);
+
+    return true;
+#else
+    return false;
+#endif
+} // lacp_rx_filter_refresh
+
+//*****************************************************************
+// Function : lacp_rx_filter_dump
+//*****************************************************************
+void
+lacp_rx_filter_dump(struct ds *ds)
+{
+#ifdef LACPD_RX_EBPF
+    ds_put_format(ds, "In-kernel LACPDU filter:\n");
+    if (rx_filter_prog_fd < 0) {
+        ds_put_format(ds, "    program       : not loaded (classic "
+                      "filter)\n");
+        return;
+    }
+
+    ds_put_format(ds, "    program       : loaded\n");
+    ds_put_format(ds, "    armed         : %lu\n",
+                  __atomic_load_n(&rx_filter_arms, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    disarmed      : %lu\n",
+                  __atomic_load_n(&rx_filter_disarms, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    filtered PDUs : %lu\n",
+                  __atomic_load_n(&rx_filter_pdus, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    refreshes     : %lu\n",
+                  __atomic_load_n(&rx_filter_refreshes, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    expiries      : %lu\n",
+                  __atomic_load_n(&rx_filter_expiries, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    map errors    : %lu\n",
+                  __atomic_load_n(&rx_filter_errors, __ATOMIC_RELAXED));
+#else
+    ds_put_format(ds, "In-kernel LACPDU filter: not built "
+                  "(LACPD_RX_EBPF)\n");
+#endif
+} // lacp_rx_filter_dump
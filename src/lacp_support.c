@@ -14,11 +14,13 @@
  * under the License.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <assert.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 
@@ -37,6 +39,9 @@
 #include "mlacp_fproto.h"
 #include "mvlan_sport.h"
 #include "lacp_ops_if.h"
+#include "lacp_checkpoint.h"
+#include "lacp_rx_filter.h"
+#include "lacp_worker.h"
 #include <vswitch-idl.h>
 
 VLOG_DEFINE_THIS_MODULE(lacpd_support);
@@ -47,10 +52,18 @@ VLOG_DEFINE_THIS_MODULE(lacpd_support);
 unsigned char my_mac_addr[MAC_ADDR_LENGTH] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 uint actor_system_priority = DEFAULT_SYSTEM_PRIORITY;
 
-/* Global per port variables table */
-lacp_avl_tree_t lacp_per_port_vars_tree;
+/* Global per port variables table, indexed by PM_HANDLE2PORT().  Slots
+ * are never freed, so a port keeps its address for as long as it runs
+ * LACP, and sweeps over all ports walk one contiguous array in port
+ * order.  A slot keeps its port's full lport_handle: a handle that
+ * differs from it in any bit, the lport type included, is not found. */
+lacp_per_port_variables_t lacp_ports[LACP_MAX_PORTS];
+lacp_port_cold_t lacp_ports_cold[LACP_MAX_PORTS];
+
+/* One past the highest slot ever used; bounds the sweeps.  Only raised,
+ * under lacp_lock(). */
+static int lacp_ports_end;
 
-extern struct NList *mlacp_lag_tuple_list;
 
 /*****************************************************************************
  *          Prototypes for static functions
@@ -114,28 +127,30 @@ LACP_initialize_port(port_handle_t lport_handle,
     lacp_int_sport_params_t     *placp_sport_params;
     int                         status = R_SUCCESS;
     int                         max_port_priority = MAX_PORT_PRIORITY;
+    int                         lock;
 
     RENTRY();
 
     /* RDEBUG exists in the caller ... */
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
 
     /* Should not happen, but if LACP is already running
      * on this port, just kill it and restart with the latest
      * config info. */
     if (plpinfo != NULL) {
+        lock = lacp_lock();
         status = mvlan_get_sport(plpinfo->sport_handle , &psport,
                                  MLm_vpm_api__get_sport);
         if (R_SUCCESS == status) {
-            plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+            plpinfo_priority = LACP_port_first();
             while (plpinfo_priority) {
                 if (plpinfo_priority->lport_handle != plpinfo->lport_handle &&
                     plpinfo_priority->sport_handle == psport->handle &&
                     max_port_priority > plpinfo_priority->actor_admin_port_priority) {
                     max_port_priority = plpinfo_priority->actor_admin_port_priority;
                 }
-                plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
+                plpinfo_priority = LACP_port_next(plpinfo_priority);
             }
             placp_sport_params = psport->placp_params;
             placp_sport_params->lacp_params.actor_max_port_priority = max_port_priority;
@@ -145,25 +160,37 @@ LACP_initialize_port(port_handle_t lport_handle,
                  "initialized?  port_id=%d  lport=0x%llx",
                  port_id, lport_handle);
         LACP_disable_lacp(lport_handle);
+        lacp_unlock(lock);
         plpinfo = NULL;
     }
 
+    /* The slot may hold a port whose handle differs only in the lport
+     * type.  Don't take over its state. */
+    plpinfo = &lacp_ports[PM_HANDLE2PORT(lport_handle)];
+    if (plpinfo->in_use) {
+        VLOG_ERR("LACP port slot %d is held by lport 0x%llx, "
+                 "not initializing lport 0x%llx",
+                 PM_HANDLE2PORT(lport_handle), plpinfo->lport_handle,
+                 lport_handle);
+        REXIT();
+        return;
+    }
+
     /* First time adding the lport. */
     RDEBUG(DL_INFO, "alloc data structure for lport 0x%llx\n", lport_handle);
 
-    plpinfo = calloc(1, sizeof(lacp_per_port_variables_t));
-    if (plpinfo == NULL) {
-        VLOG_FATAL("out of memory");
-        exit(-1);
-    }
+    memset(plpinfo, 0, sizeof(*plpinfo));
+    memset(LACP_PORT_COLD(plpinfo), 0, sizeof(lacp_port_cold_t));
 
     plpinfo->lport_handle = lport_handle;
-    LACP_AVL_INIT_NODE(plpinfo->avlnode, plpinfo, &(plpinfo->lport_handle));
+    LACP_init_port_timers(plpinfo);
 
-    if (LACP_AVL_INSERT(lacp_per_port_vars_tree, plpinfo->avlnode) == FALSE) {
-        VLOG_FATAL("avl_insert failed for handle 0x%llx", lport_handle);
-        exit(-1);
+    plpinfo->in_use = TRUE;
+    lock = lacp_lock();
+    if (PM_HANDLE2PORT(lport_handle) >= lacp_ports_end) {
+        lacp_ports_end = PM_HANDLE2PORT(lport_handle) + 1;
     }
+    lacp_unlock(lock);
 
     /* Start lacpd with "-l" option to set this dynamically */
     /* OPS_TODO: convert to use VLOG. */
@@ -220,6 +247,12 @@ LACP_initialize_port(port_handle_t lport_handle,
      ***************************************************************************/
     register_mcast_addr(lport_handle);
 
+    /* Warm restart: pick up where the previous lacpd left the port. */
+    if (lacp_checkpoint_restore(plpinfo)) {
+        REXIT();
+        return;
+    }
+
     /***************************************************************************
      *    Generate appropriate initial events for the state machines.
      ***************************************************************************/
@@ -287,7 +320,7 @@ LACP_update_port_params(port_handle_t lport_handle,
 
     RENTRY();
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
 
     if (plpinfo != NULL) {
 
@@ -320,6 +353,7 @@ LACP_update_port_params(port_handle_t lport_handle,
 
         // Inform the transmit state machine about the change.
         plpinfo->lacp_control.ntt = TRUE;
+        lacp_rx_filter_update(plpinfo);
 
     } else {
         VLOG_ERR("Update LACP param: lport_handle 0x%llx not found",
@@ -488,13 +522,12 @@ LACP_disable_lacp(port_handle_t lport_handle)
 {
 
     LAG_t *lag;
-    struct NList *pdummy;
-    lacp_lag_ppstruct_t *plag_port_struct = NULL;
     lacp_per_port_variables_t *plpinfo;
+    int lock;
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("Disable LACP: lport_handle 0x%llx not found",
                  lport_handle);
@@ -505,9 +538,8 @@ LACP_disable_lacp(port_handle_t lport_handle)
            plpinfo->lport_handle,
            plpinfo->sport_handle);
 
-    /*
-     * Use locks here once we make it multithreaded
-     */
+    lock = lacp_lock();
+
     if(plpinfo->sport_handle != 0) {
         mlacp_blocking_send_disable_collect_dist(plpinfo);
         mlacp_blocking_send_detach_aggregator(plpinfo);
@@ -516,21 +548,9 @@ LACP_disable_lacp(port_handle_t lport_handle)
     lag = plpinfo->lag;
 
     if (lag != NULL) {
-        /*
-         * Can be optimized by putting a pointer
-         * to plag_port_struct in the perport variables
-         */
-        pdummy = n_list_find_data(lag->pplist,
-                                  &lacp_lag_port_match,
-                                  &plpinfo->lport_handle);
-        if (pdummy != NULL) {
-            plag_port_struct = pdummy->data;
-            if(plag_port_struct != NULL) {
-                lag->pplist =  n_list_remove_data(lag->pplist, plag_port_struct);
-            }
-        }
+        LAG_remove_member(lag, plpinfo);
 
-        if (lag->pplist == NULL) {
+        if (lag->members == NULL) {
             /*
              * It was the last port in the LAG, remove the whole LAG.
              */
@@ -541,28 +561,158 @@ LACP_disable_lacp(port_handle_t lport_handle)
             }
 
             plpinfo->lag = NULL;
-            free(lag->LAG_Id);
-
-            //*********************************************************
-            // Remove the LAG from the tuple_list before we free it.
-            //*********************************************************
-            mlacp_lag_tuple_list = n_list_remove_data(
-                                               mlacp_lag_tuple_list,
-                                               lag);
-            free(lag);
+            LAG_destroy(lag);
         }
     }
-    LACP_AVL_DELETE(lacp_per_port_vars_tree,plpinfo->avlnode);
+
+    lacp_unlock(lock);
+
+    plpinfo->in_use = FALSE;
 
     //****************************************************************
     // As LACP is per-port, go ahead & de-register for this port.
     //****************************************************************
     deregister_mcast_addr(plpinfo->lport_handle);
 
-    free(plpinfo);
+    LACP_stop_port_timers(plpinfo);
 
 } /* LACP_disable_lacp */
 
+/* Sweeps only see the ports of the calling protocol worker. */
+static lacp_per_port_variables_t *
+lacp_ports_scan(int index)
+{
+    for (; index < lacp_ports_end; index++) {
+        if (lacp_ports[index].in_use && lacp_worker_owns(index)) {
+            return &lacp_ports[index];
+        }
+    }
+
+    return NULL;
+
+} /* lacp_ports_scan */
+
+//***************************************************************
+// Function : LACP_port_by_index
+// Returns the port in slot index of the port table, or NULL.
+//***************************************************************
+lacp_per_port_variables_t *
+LACP_port_by_index(int index)
+{
+    if (index < 0 || index >= lacp_ports_end || !lacp_ports[index].in_use) {
+        return NULL;
+    }
+
+    return &lacp_ports[index];
+
+} /* LACP_port_by_index */
+
+//***************************************************************
+// Function : LACP_port_find
+//***************************************************************
+lacp_per_port_variables_t *
+LACP_port_find(port_handle_t lport_handle)
+{
+    lacp_per_port_variables_t *plpinfo;
+
+    plpinfo = LACP_port_by_index(PM_HANDLE2PORT(lport_handle));
+    if (plpinfo == NULL || plpinfo->lport_handle != lport_handle) {
+        return NULL;
+    }
+
+    return plpinfo;
+
+} /* LACP_port_find */
+
+//***************************************************************
+// Function : LACP_port_first
+//***************************************************************
+lacp_per_port_variables_t *
+LACP_port_first(void)
+{
+    return lacp_ports_scan(0);
+
+} /* LACP_port_first */
+
+//***************************************************************
+// Function : LACP_port_next
+// Returns the next port after plpinfo in port order, or NULL.
+//***************************************************************
+lacp_per_port_variables_t *
+LACP_port_next(lacp_per_port_variables_t *plpinfo)
+{
+    return lacp_ports_scan(plpinfo - lacp_ports + 1);
+
+} /* LACP_port_next */
+
+//***************************************************************
+// Function : LACP_port_stats_snapshot
+// Copies the port's PDU statistics.  Safe from any thread.  The
+// counters the protocol thread alone writes are copied as of one
+// point in time, retrying while it updates them; the counters the RX
+// thread also bumps are read one by one.
+//***************************************************************
+void
+LACP_port_stats_snapshot(const lacp_per_port_variables_t *plpinfo,
+                         lacp_port_stats_t *stats)
+{
+    const lacp_port_stats_t *src = &plpinfo->stats;
+    uint32_t seq;
+
+    do {
+        seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+
+        stats->lacp_pdus_sent =
+            __atomic_load_n(&src->lacp_pdus_sent, __ATOMIC_RELAXED);
+        stats->lacp_pdus_received =
+            __atomic_load_n(&src->lacp_pdus_received, __ATOMIC_RELAXED);
+        stats->lacp_pdus_fast_path =
+            __atomic_load_n(&src->lacp_pdus_fast_path, __ATOMIC_RELAXED);
+        stats->pdus_dropped =
+            __atomic_load_n(&src->pdus_dropped, __ATOMIC_RELAXED);
+        stats->pdus_malformed =
+            __atomic_load_n(&src->pdus_malformed, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) ||
+             (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) != seq));
+    stats->seq = seq;
+
+    stats->marker_response_pdus_sent =
+        __atomic_load_n(&src->marker_response_pdus_sent, __ATOMIC_RELAXED);
+    stats->marker_pdus_received =
+        __atomic_load_n(&src->marker_pdus_received, __ATOMIC_RELAXED);
+    stats->pdus_queue_overflow =
+        __atomic_load_n(&src->pdus_queue_overflow, __ATOMIC_RELAXED);
+    stats->pdus_tx_failed =
+        __atomic_load_n(&src->pdus_tx_failed, __ATOMIC_RELAXED);
+
+} /* LACP_port_stats_snapshot */
+
+//***************************************************************
+// Function : LACP_ports_memory
+// Bytes of per-port state: every slot of lacp_ports[] and
+// lacp_ports_cold[] is allocated, in use or not.  Sets *n_in_use to
+// the slots holding a port.  Safe from any thread.
+//***************************************************************
+size_t
+LACP_ports_memory(int *n_in_use)
+{
+    int index;
+
+    *n_in_use = 0;
+    for (index = 0; index < LACP_MAX_PORTS; index++) {
+        if (lacp_ports[index].in_use) {
+            (*n_in_use)++;
+        }
+    }
+
+    return sizeof(lacp_ports) + sizeof(lacp_ports_cold);
+
+} /* LACP_ports_memory */
+
 
 /*----------------------------------------------------------------------
  * Function: set_actor_admin_parms_2_oper(int port_number)
@@ -741,7 +891,7 @@ print_lacp_fsm_state(port_handle_t lport_handle)
     char state_string[STATE_STRING_SIZE];
     lacp_per_port_variables_t *lacp_port;
 
-    lacp_port = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    lacp_port = LACP_port_find(lport_handle);
     if (lacp_port == NULL) {
         VLOG_ERR(" fsm print - can't find lport 0x%llx", lport_handle);
         return;
@@ -787,10 +937,10 @@ print_lacp_fsm_state(port_handle_t lport_handle)
                                          "TRUE" : "FALSE");
     RDBG("      PartnerCollect:      %s\n", lacp_port->partner_oper_port_state.collecting ?
                                          "TRUE" : "FALSE");
-    RDBG("   Timer counters\n");
-    RDBG("      periodic tx timer:   %d\n", lacp_port->periodic_tx_timer_expiry_counter);
-    RDBG("      current while timer:   %d\n", lacp_port->current_while_timer_expiry_counter);
-    RDBG("      wait while timer:   %d\n", lacp_port->wait_while_timer_expiry_counter);
+    RDBG("   Timers (msec left)\n");
+    RDBG("      periodic tx timer:   %u\n", lacp_timer_remaining(&lacp_port->periodic_tx_timer));
+    RDBG("      current while timer:   %u\n", lacp_timer_remaining(&lacp_port->current_while_timer));
+    RDBG("      wait while timer:   %u\n", lacp_timer_remaining(&lacp_port->wait_while_timer));
 
     lacp_unlock(lock);
 
@@ -948,7 +1098,27 @@ LAG_id_string(char *const str, LAG_Id_t *const lag_id)
 
 /********************************************************************
  *  Semaphore routines
+ *
+ *  With more than one protocol worker, serializes access to what the
+ *  workers share: the aggregators, the LAGs and the object pools.
+ *  Recursive, as selection calls into the aggregator functions.
  ********************************************************************/
+#if LACPD_PROTOCOL_WORKERS > 1
+static pthread_mutex_t lacp_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+int
+lacp_lock(void)
+{
+    pthread_mutex_lock(&lacp_mutex);
+    return(0);
+}
+
+void
+lacp_unlock(int lock __attribute__ ((unused)))
+{
+    pthread_mutex_unlock(&lacp_mutex);
+}
+#else
 inline int
 lacp_lock(void)
 {
@@ -959,6 +1129,7 @@ inline void
 lacp_unlock(int lock __attribute__ ((unused)))
 {
 }
+#endif
 
 //********************************************************************
 // Function : display_lacpdu
@@ -1024,7 +1195,7 @@ mlacpVapiLinkUp(port_handle_t lport_handle, int speed)
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("link up but can't find lport 0x%llx", lport_handle);
         return;
@@ -1090,12 +1261,18 @@ mlacpVapiLinkDown(port_handle_t lport_handle)
 
     RDEBUG(DL_INFO, "%s: lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
     if (plpinfo == NULL) {
         VLOG_ERR("link down, but can't find lport 0x%llx", lport_handle);
         return;
     }
 
+    if (plpinfo->lacp_control.port_enabled == FALSE) {
+        // Already down.  With LACPD_NETLINK_LINK the kernel reports a
+        // link down first, and OVSDB reports it again later.
+        return;
+    }
+
     plpinfo->lacp_control.port_enabled = FALSE;
 
     assert(plpinfo->lacp_up == TRUE);
@@ -1128,7 +1305,7 @@ set_all_port_system_mac_addr(void)
 {
     lacp_per_port_variables_t *plpinfo;
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+    plpinfo = LACP_port_first();
 
     while (plpinfo) {
         if (plpinfo->actor_sys_id_override == FALSE) {
@@ -1136,8 +1313,9 @@ set_all_port_system_mac_addr(void)
                    MAC_ADDR_LENGTH);
             memcpy(plpinfo->actor_oper_system_variables.system_mac_addr, my_mac_addr,
                    MAC_ADDR_LENGTH);
+            lacp_rx_filter_update(plpinfo);
         }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+        plpinfo = LACP_port_next(plpinfo);
     }
 
 } /* set_all_port_system_mac_addr */
@@ -1150,7 +1328,7 @@ set_all_port_system_priority(void)
 {
     lacp_per_port_variables_t *plpinfo;
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+    plpinfo = LACP_port_first();
 
     while (plpinfo) {
         if (plpinfo->actor_prio_override == FALSE) {
@@ -1159,10 +1337,11 @@ set_all_port_system_priority(void)
             plpinfo->actor_oper_system_variables.system_priority =
                 plpinfo->actor_admin_system_variables.system_priority;
             /* Update interface status when a system setting changes */
+            lacp_rx_filter_update(plpinfo);
             db_update_interface(plpinfo);
         }
 
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+        plpinfo = LACP_port_next(plpinfo);
     }
 
 } /* set_all_port_system_priority */
@@ -1178,7 +1357,7 @@ set_lport_fallback_status(port_handle_t lport_handle, int status)
 {
     lacp_per_port_variables_t *plpinfo = NULL;
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
 
     if (plpinfo != NULL) {
         plpinfo->fallback_enabled = status;
@@ -1206,7 +1385,7 @@ set_lport_overrides(port_handle_t lport_handle, int prio, unsigned char *mac)
 {
     lacp_per_port_variables_t *plpinfo;
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
 
     if (plpinfo != NULL) {
         /* process priority */
@@ -1244,12 +1423,82 @@ set_lport_overrides(port_handle_t lport_handle, int prio, unsigned char *mac)
                    mac,
                    MAC_ADDR_LENGTH);
         }
+
+        /* Outside a state machine run; the filter must not keep
+         * matching the old actor system. */
+        lacp_rx_filter_update(plpinfo);
     } else {
         VLOG_ERR("Set port overrides: lport_handle 0x%llx not found",
                  lport_handle);
     }
 } /* set_lport_overrides */
 
+/* Aggregators whose partner parameters changed while a configuration
+ * batch was applied; their ports are unselected in one sweep when the
+ * batch is done (see mlacpVapiSportParamsRelease()).  Each protocol
+ * worker holds its own. */
+static __thread port_handle_t sport_changes[LACP_MAX_PORTS];
+static __thread int n_sport_changes;
+static __thread bool sport_changes_held;
+
+static void
+unselect_sport_ports(const port_handle_t *sports, int n_sports)
+{
+    lacp_per_port_variables_t *plpinfo;
+    int ii;
+
+    for (plpinfo = LACP_port_first(); plpinfo;
+         plpinfo = LACP_port_next(plpinfo)) {
+        for (ii = 0; ii < n_sports; ii++) {
+            if (plpinfo->sport_handle == sports[ii]) {
+                break;
+            }
+        }
+
+        if (ii < n_sports) {
+            /*
+             * Make selected UNSELECTED, and cause approp. event in
+             * the mux machine.
+             */
+            plpinfo->lacp_control.selected = UNSELECTED;
+            LACP_mux_fsm(E2, plpinfo->mux_fsm_state, plpinfo);
+            plpinfo->lacp_control.ready_n = FALSE;
+        }
+    }
+} /* unselect_sport_ports */
+
+//*****************************************************************
+// Function : mlacpVapiSportParamsNotifyOthers
+// A sweep of the ports on an aggregator only covers the ports of
+// this protocol worker.  The others get the change as an lport
+// message, and sweep theirs with mlacpVapiSportParamsNotify().
+//*****************************************************************
+void
+mlacpVapiSportParamsNotifyOthers(port_handle_t sport_handle, int flags)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    struct MLt_vpm_api__lacp_sport_params *pmsg;
+    ML_event *event;
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        if (worker == lacp_worker_self()) {
+            continue;
+        }
+
+        event = ml_event_alloc(sizeof(ML_event) + sizeof(*pmsg));
+        event->sender.peer = ml_lport_index;
+        event->msgnum = MLm_vpm_api__set_lacp_sport_params;
+
+        pmsg = (struct MLt_vpm_api__lacp_sport_params *)(event + 1);
+        pmsg->sport_handle = sport_handle;
+        pmsg->flags = flags;
+
+        ml_send_event_to(worker, event);
+    }
+#endif
+} /* mlacpVapiSportParamsNotifyOthers */
+
 //*****************************************************************
 // Function : mlacpVapiSportParamsChange
 // Aggregator parameters changed, detach all the lports
@@ -1258,30 +1507,80 @@ void
 mlacpVapiSportParamsChange(int msg __attribute__ ((unused)),
                            struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
 {
-    lacp_per_port_variables_t *plpinfo, *lacp_port;
+    port_handle_t sport_handle = pin_lacp_params->sport_handle;
+    int ii;
 
     RDEBUG(DL_INFO, "%s: sport_handle 0x%llx\n", __FUNCTION__,
            pin_lacp_params->sport_handle);
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+    if (!(pin_lacp_params->flags &
+          (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
+           LACP_LAG_PARTNER_SYSID_FIELD_PRESENT))) {
+        return;
+    }
 
-    while (plpinfo) {
-        if (plpinfo->sport_handle == pin_lacp_params->sport_handle) {
-            lacp_port = plpinfo;
-
-            if (pin_lacp_params->flags &
-                (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
-                 LACP_LAG_PARTNER_SYSID_FIELD_PRESENT)) {
-                /*
-                 * Make selected UNSELECTED, and cause approp. event in
-                 * the mux machine.
-                 */
-                lacp_port->lacp_control.selected = UNSELECTED;
-                LACP_mux_fsm(E2, lacp_port->mux_fsm_state, lacp_port);
-                lacp_port->lacp_control.ready_n = FALSE;
+    if (sport_changes_held) {
+        for (ii = 0; ii < n_sport_changes; ii++) {
+            if (sport_changes[ii] == sport_handle) {
+                return;
             }
         }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+
+        if (n_sport_changes < LACP_MAX_PORTS) {
+            sport_changes[n_sport_changes++] = sport_handle;
+            return;
+        }
     }
 
+    unselect_sport_ports(&sport_handle, 1);
+    mlacpVapiSportParamsNotifyOthers(sport_handle, pin_lacp_params->flags);
+
 } /* mlacpVapiSportParamsChange */
+
+//*****************************************************************
+// Function : mlacpVapiSportParamsNotify
+// Another protocol worker changed the aggregator; unselect our
+// ports on it.
+//*****************************************************************
+void
+mlacpVapiSportParamsNotify(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
+{
+    RDEBUG(DL_INFO, "%s: sport_handle 0x%llx\n", __FUNCTION__,
+           pin_lacp_params->sport_handle);
+
+    unselect_sport_ports(&pin_lacp_params->sport_handle, 1);
+
+} /* mlacpVapiSportParamsNotify */
+
+//*****************************************************************
+// Function : mlacpVapiSportParamsHold
+//*****************************************************************
+void
+mlacpVapiSportParamsHold(void)
+{
+    sport_changes_held = true;
+
+} /* mlacpVapiSportParamsHold */
+
+//*****************************************************************
+// Function : mlacpVapiSportParamsRelease
+//*****************************************************************
+void
+mlacpVapiSportParamsRelease(void)
+{
+    int ii;
+
+    sport_changes_held = false;
+
+    if (n_sport_changes) {
+        unselect_sport_ports(sport_changes, n_sport_changes);
+        for (ii = 0; ii < n_sport_changes; ii++) {
+            mlacpVapiSportParamsNotifyOthers(
+                sport_changes[ii],
+                LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
+                LACP_LAG_PARTNER_SYSID_FIELD_PRESENT);
+        }
+        n_sport_changes = 0;
+    }
+
+} /* mlacpVapiSportParamsRelease */
@@ -16,6 +16,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <sys/time.h>
 #include <string.h>
 #include <strings.h>
@@ -35,6 +36,9 @@
 #include "mvlan_lacp.h"
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
+#include "lacp_rx_filter.h"
+#include "lacp_worker.h"
+#include "mlacp_recv.h"
 
 VLOG_DEFINE_THIS_MODULE(lacp_task);
 
@@ -51,195 +55,205 @@ const unsigned char default_partner_system_mac[MAC_ADDR_LENGTH] =
 /****************************************************************************
  *   Prototypes for static functions
  ****************************************************************************/
-static void periodic_tx_timer_expiry(lacp_per_port_variables_t *);
-static void current_while_timer_expiry(lacp_per_port_variables_t *);
-static void mux_wait_while_timer_expiry(lacp_per_port_variables_t *);
+static void periodic_tx_timer_expiry(lacp_timer_t *);
+static void async_tx_timer_expiry(lacp_timer_t *);
+static void current_while_timer_expiry(lacp_timer_t *);
+static void mux_wait_while_timer_expiry(lacp_timer_t *);
 static int LACP_marker_responder(lacp_per_port_variables_t *, void *);
-static marker_pdu_payload_t *LACP_build_marker_response_payload(
-                                           port_handle_t, marker_pdu_payload_t *);
+static void LACP_build_marker_response_payload(port_handle_t,
+                                               marker_pdu_payload_t *,
+                                               marker_pdu_payload_t *);
 static void LACP_transmit_marker_response(port_handle_t, void *);
 static int is_pkt_from_same_system(lacp_per_port_variables_t *, lacpdu_payload_t *);
-int lacp_lag_port_match(void *, void *);
+static void classify_rx_batch(struct MLt_drivers_mlacp__rxPdu *, int,
+                              lacp_per_port_variables_t **,
+                              uint64_t *, uint64_t *);
 
 
-/**************************************************************
- *       Periodic Tx Timer handler routines
- *************************************************************/
+/* Recovers the port that embeds the given timer. */
+#define PLPINFO_FROM_TIMER(timer, field) \
+    ((lacp_per_port_variables_t *) \
+     ((char *)(timer) - offsetof(lacp_per_port_variables_t, field)))
 
 /*----------------------------------------------------------------------
- * Function: LACP_periodic_tx()
- * Synopsis: Goes thro' all the ports in all LACP link groups and does
- *           periodic Tx on each one of them depending upon their states.
- * Input  :
+ * Function: LACP_init_port_timers()
+ * Synopsis: Attaches the expiry handlers to a new port's timers.
+ *           Must be called before any of its state machines run.
+ * Input  :  lacp_per_port_variables_t * - the port
  * Returns:  void
  *----------------------------------------------------------------------*/
 void
-LACP_periodic_tx(void)
+LACP_init_port_timers(lacp_per_port_variables_t *plpinfo)
 {
-    lacp_per_port_variables_t *plpinfo;
+    lacp_timer_setup(&plpinfo->periodic_tx_timer, periodic_tx_timer_expiry);
+    plpinfo->periodic_tx_phase = PM_HANDLE2PORT(plpinfo->lport_handle);
+    lacp_timer_setup(&plpinfo->current_while_timer, current_while_timer_expiry);
+    lacp_timer_setup(&plpinfo->wait_while_timer, mux_wait_while_timer_expiry);
+    lacp_timer_setup(&plpinfo->async_tx_timer, async_tx_timer_expiry);
 
-    RENTRY();
+} /* LACP_init_port_timers */
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-
-    while (plpinfo) {
-        if (plpinfo->debug_level & DBG_TX_FSM) {
-            print_lacp_fsm_state(plpinfo->lport_handle);
-        }
-
-        if (plpinfo->lacp_up == TRUE) { /* LACP port is initialized */
-            periodic_tx_timer_expiry(plpinfo);
-            mux_wait_while_timer_expiry(plpinfo);
-        }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
-    }
+/*----------------------------------------------------------------------
+ * Function: LACP_stop_port_timers()
+ * Synopsis: Takes all of a port's timers off the timer wheel.
+ *           Must be called before the port is freed.
+ * Input  :  lacp_per_port_variables_t * - the port
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+void
+LACP_stop_port_timers(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_timer_stop(&plpinfo->periodic_tx_timer);
+    lacp_timer_stop(&plpinfo->current_while_timer);
+    lacp_timer_stop(&plpinfo->wait_while_timer);
+    lacp_timer_stop(&plpinfo->async_tx_timer);
 
-    REXIT();
+} /* LACP_stop_port_timers */
 
-} /* LACP_periodic_tx */
+/**************************************************************
+ *       Periodic Tx Timer handler routines
+ *************************************************************/
 
 /*----------------------------------------------------------------------
- * Function: periodic_tx_timer_expiry(int)
+ * Function: periodic_tx_timer_expiry(timer)
  * Synopsis: For the given port does periodic Tx if periodic Tx state
  *           of the port is in Fast Periodic or Slow Periodic states.
- * Input  :  int - port number
+ * Input  :  lacp_timer_t * - the port's periodic Tx timer
  * Returns:  void
  *----------------------------------------------------------------------*/
 static void
-periodic_tx_timer_expiry(lacp_per_port_variables_t *plpinfo)
+periodic_tx_timer_expiry(lacp_timer_t *timer)
 {
+    lacp_per_port_variables_t *plpinfo;
+
     RENTRY();
 
+    plpinfo = PLPINFO_FROM_TIMER(timer, periodic_tx_timer);
+
+    if (plpinfo->debug_level & DBG_TX_FSM) {
+        print_lacp_fsm_state(plpinfo->lport_handle);
+    }
+
     /********************************************************************
      * If the state is no periodic do nothing.
      ********************************************************************/
-    if (plpinfo->periodic_tx_fsm_state == PERIODIC_TX_FSM_NO_PERIODIC_STATE) {
+    if (plpinfo->lacp_up == FALSE ||
+        plpinfo->periodic_tx_fsm_state == PERIODIC_TX_FSM_NO_PERIODIC_STATE) {
         if (plpinfo->debug_level & DBG_TX_FSM) {
             RDBG("%s : do nothing (lport 0x%llx)\n",
                  __FUNCTION__, plpinfo->lport_handle);
         }
     } else {
-        RDEBUG(DL_TIMERS, "decrement the expiry counter (lport 0x%llx)\n",
-               plpinfo->lport_handle);
-
         /*********************************************************************
-         * Decrement the expiry counter if greater than 0.
+         * The periodic Tx also starts a new async Tx window.
          *********************************************************************/
-        if (plpinfo->periodic_tx_timer_expiry_counter > 0) {
-
-            plpinfo->periodic_tx_timer_expiry_counter--;
-
-            /*********************************************************************
-             * Since the lowest expiry time is 1 second, we clear the async Tx
-             * counter every 1 second.
-             *********************************************************************/
-            plpinfo->async_tx_count = 0;
-
-            /*********************************************************************
-             * If expiry counter is 0, generate the appropriate event.
-             *********************************************************************/
-            if (plpinfo->periodic_tx_timer_expiry_counter == 0) {
-
-                /* Generate periodic Tx timer expired event (E3) */
-                LACP_periodic_tx_fsm(E3,
-                                     plpinfo->periodic_tx_fsm_state,
-                                     plpinfo);
-
-            } else if (TRUE == plpinfo->lacp_control.ntt) {
-                // OpenSwitch FIX: if "async_tx_count" reached the max while
-                // NTT was true, then LACPDUs would not have been
-                // transmitted.  We need to transmit it now if NTT is
-                // still true and periodic_tx_timer didn't expire in this
-                // round (i.e. long timeout).
-                LACP_async_transmit_lacpdu(plpinfo);
-            }
+        plpinfo->async_tx_count = 0;
+        lacp_timer_stop(&plpinfo->async_tx_timer);
 
-        } // if (plpinfo->periodic_tx_timer_expiry_counter > 0)
-    } // else - (FSM state != PERIODIC_TX_FSM_NO_PERIODIC_STATE)
+        /* Generate periodic Tx timer expired event (E3) */
+        LACP_periodic_tx_fsm(E3,
+                             plpinfo->periodic_tx_fsm_state,
+                             plpinfo);
+    }
 
     REXIT();
 
 } /* periodic_tx_timer_expiry */
 
 /*----------------------------------------------------------------------
- * Function: mux_wait_while_timer_expiry(int)
- * Synopsis: Decrements the counter, if it reaches 0, causes
- *           an approp. event in the Mux machine.
- * Input  :  physical port number
+ * Function: async_tx_timer_expiry(timer)
+ * Synopsis: Ends the async Tx window opened by the first async
+ *           LACPDU, so that up to MAX_ASYNC_TX LACPDUs a second can
+ *           be sent outside of the periodic Tx.
+ * Input  :  lacp_timer_t * - the port's async Tx timer
  * Returns:  void
  *----------------------------------------------------------------------*/
 static void
-mux_wait_while_timer_expiry(lacp_per_port_variables_t *lacp_port)
+async_tx_timer_expiry(lacp_timer_t *timer)
 {
-    LAG_t *lag;
-    lacp_per_port_variables_t *plp;
+    lacp_per_port_variables_t *plpinfo;
 
     RENTRY();
 
-    RDEBUG(DL_TIMERS, "%s: lport 0x%llx\n", __FUNCTION__, lacp_port->lport_handle);
+    plpinfo = PLPINFO_FROM_TIMER(timer, async_tx_timer);
 
-    lag = lacp_port->lag;
-    if (!lag) {
-        return;
-    }
+    plpinfo->async_tx_count = 0;
 
-    if (lag->pplist == NULL) {
-        return;
+    // OpenSwitch FIX: if "async_tx_count" reached the max while
+    // NTT was true, then LACPDUs would not have been
+    // transmitted.  We need to transmit it now if NTT is
+    // still true and periodic_tx_timer didn't expire in this
+    // round (i.e. long timeout).
+    if (plpinfo->lacp_up == TRUE &&
+        plpinfo->periodic_tx_fsm_state != PERIODIC_TX_FSM_NO_PERIODIC_STATE &&
+        TRUE == plpinfo->lacp_control.ntt) {
+        LACP_async_transmit_lacpdu(plpinfo);
     }
 
-    if (n_list_find_data(lag->pplist,
-                         &lacp_lag_port_match,
-                         &lacp_port->lport_handle) == NULL) {
-        VLOG_ERR("lport (ox%llx) not set ??", lacp_port->lport_handle);
-        return;
-    }
+    REXIT();
 
-    if (lacp_port->wait_while_timer_expiry_counter > 0) {
+} /* async_tx_timer_expiry */
 
-        RDEBUG(DL_TIMERS, "decrement wait_while_timer (lport 0x%llx)\n",
-               lacp_port->lport_handle);
+/*----------------------------------------------------------------------
+ * Function: mux_wait_while_timer_expiry(timer)
+ * Synopsis: When the wait while timer expires, causes an approp.
+ *           event in the Mux machine.
+ * Input  :  lacp_timer_t * - the port's wait while timer
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+mux_wait_while_timer_expiry(lacp_timer_t *timer)
+{
+    LAG_t *lag;
+    lacp_per_port_variables_t *lacp_port;
+    lacp_per_port_variables_t *plp;
 
-        lacp_port->wait_while_timer_expiry_counter--;
+    RENTRY();
 
-        /*
-         * If expiry counter is 0, check for ready and selected variables.
-         * If selected is SELECTED for the port and ready is TRUE for the
-         * link group, then generate event E3 for the port's mux fsm.
-         */
-        if (lacp_port->wait_while_timer_expiry_counter <= 0) {
+    lacp_port = PLPINFO_FROM_TIMER(timer, wait_while_timer);
 
-            lacp_port->lacp_control.ready_n = TRUE;
-            lag->ready = TRUE;      /* assume */
+    RDEBUG(DL_TIMERS, "%s: lport 0x%llx\n", __FUNCTION__, lacp_port->lport_handle);
 
-            for (plp = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-                 plp;
-                 plp = LACP_AVL_NEXT(plp->avlnode)) {
+    lag = lacp_port->lag;
 
-                if (n_list_find_data(lag->pplist,
-                                     &lacp_lag_port_match,
-                                     &plp->lport_handle) == NULL) {
-                    continue;
-                }
+    if (lacp_port->lacp_up == FALSE || !lag || lag->members == NULL) {
+        /* Not attached to its LAG yet, check again in a second. */
+        lacp_timer_start(timer, LACP_TIMER_MSEC_PER_SEC);
+        return;
+    }
 
-                if (plp->lacp_control.ready_n == FALSE) {
-                    lag->ready = FALSE;
-                    break;
-                }
-            }
+    if (!LAG_IS_MEMBER(lag, lacp_port)) {
+        VLOG_ERR("lport (ox%llx) not set ??", lacp_port->lport_handle);
+        lacp_timer_start(timer, LACP_TIMER_MSEC_PER_SEC);
+        return;
+    }
 
-            if (lag->ready == TRUE &&
-                lacp_port->lacp_control.selected ==  SELECTED) {
-                LACP_mux_fsm(E3,
-                             lacp_port->mux_fsm_state,
-                             lacp_port);
-            } else {
-                start_wait_while_timer(lacp_port);
-            }
+    /*
+     * Check for ready and selected variables.
+     * If selected is SELECTED for the port and ready is TRUE for the
+     * link group, then generate event E3 for the port's mux fsm.
+     */
+    lacp_port->lacp_control.ready_n = TRUE;
+    lag->ready = TRUE;      /* assume */
 
+    LAG_FOR_EACH_MEMBER(plp, lag) {
+        if (plp->lacp_control.ready_n == FALSE) {
             lag->ready = FALSE;
+            break;
         }
     }
 
+    if (lag->ready == TRUE &&
+        lacp_port->lacp_control.selected ==  SELECTED) {
+        LACP_mux_fsm(E3,
+                     lacp_port->mux_fsm_state,
+                     lacp_port);
+    } else {
+        start_wait_while_timer(lacp_port);
+    }
+
+    lag->ready = FALSE;
+
     REXIT();
 
 } /* mux_wait_while_timer_expiry */
@@ -250,78 +264,36 @@ mux_wait_while_timer_expiry(lacp_per_port_variables_t *lacp_port)
  *********************************************************************/
 
 /*----------------------------------------------------------------------
- * Function: LACP_current_while_expiry()
- * Synopsis: Goes thro' all the ports in all LACP link groups and does
- *           current while expiry action on each one of them depending
- *           upon their states.
- * Input  :
- * Returns:  void
- *----------------------------------------------------------------------*/
-void
-LACP_current_while_expiry(void)
-{
-    lacp_per_port_variables_t *lacp_port;
-
-    RENTRY();
-
-    lacp_port = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-    while (lacp_port) {
-        if (lacp_port->lacp_up == TRUE) { /* LACP port is initialized */
-
-            RDEBUG(DL_TIMERS, "invoke current_while_timer_expiry.  lport=0x%llx\n",
-                   lacp_port->lport_handle);
-
-            current_while_timer_expiry(lacp_port);
-        }
-
-        lacp_port = LACP_AVL_NEXT(lacp_port->avlnode);
-    }
-
-    REXIT();
-
-} /* LACP_current_while_expiry */
-
-/*----------------------------------------------------------------------
- * Function: current_while_timer_expiry(int port_number)
- * Synopsis: Decrements the expiry counter, if greater than 0.
- *           If counter reaches 0, generates a current_while timer
- *           expired event (E2).
+ * Function: current_while_timer_expiry(timer)
+ * Synopsis: Generates a current_while timer expired event (E2).
  *
- * Input  :
+ * Input  :  lacp_timer_t * - the port's current while timer
  * Returns:  void
  *----------------------------------------------------------------------*/
 static void
-current_while_timer_expiry(lacp_per_port_variables_t *plpinfo)
+current_while_timer_expiry(lacp_timer_t *timer)
 {
-    RENTRY();
-
-    RDEBUG(DL_TIMERS, "%s: lport 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
-
-    if (plpinfo->current_while_timer_expiry_counter > 0) {
+    lacp_per_port_variables_t *plpinfo;
 
-        RDEBUG(DL_TIMERS, "current_while_timer %d lport 0x%llx\n",
-               plpinfo->current_while_timer_expiry_counter,
-               plpinfo->lport_handle);
+    RENTRY();
 
-        /********************************************************************
-         * Decrement the expiry counter and if it has reached 0, generate
-         * Event E2.
-         ********************************************************************/
-        plpinfo->current_while_timer_expiry_counter--;
+    plpinfo = PLPINFO_FROM_TIMER(timer, current_while_timer);
 
-        if (plpinfo->current_while_timer_expiry_counter == 0) {
-            /*********************************************************************
-             *  Generate current while timer expired event (E2).
-             *********************************************************************/
-            if (plpinfo->debug_level & DBG_RX_FSM) {
-                RDBG("%s : Generate E2 (lport 0x%llx)\n", __FUNCTION__, plpinfo->lport_handle);
-            }
+    RDEBUG(DL_TIMERS, "%s: lport 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
 
-            LACP_receive_fsm(E2,
-                             plpinfo->recv_fsm_state,
-                             NULL,
-                             plpinfo);
+    if (plpinfo->lacp_up == TRUE &&  /* LACP port is initialized */
+        !lacp_rx_filter_refresh(plpinfo)) { /* and the kernel heard nothing */
+        /*********************************************************************
+         *  Generate current while timer expired event (E2).
+         *********************************************************************/
+        if (plpinfo->debug_level & DBG_RX_FSM) {
+            RDBG("%s : Generate E2 (lport 0x%llx)\n", __FUNCTION__, plpinfo->lport_handle);
         }
+
+        LACP_receive_fsm(E2,
+                         plpinfo->recv_fsm_state,
+                         NULL,
+                         plpinfo);
     }
 
     REXIT();
@@ -339,10 +311,13 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
 
     RENTRY();
 
-    plpinfo = LACP_AVL_FIND(lacp_per_port_vars_tree, &lport_handle);
+    plpinfo = LACP_port_find(lport_handle);
     if (plpinfo == NULL || plpinfo->lacp_up == FALSE) {
         VLOG_WARN("Got LACPDU, but LACP not enabled (port 0x%llx)",
                   lport_handle);
+        if (plpinfo != NULL) {
+            LACP_STAT_INC(plpinfo, pdus_dropped);
+        }
         return;
     }
 
@@ -387,6 +362,7 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
      ********************************************************************/
     lacpdu_payload = (lacpdu_payload_t *)data;
     if (lacpdu_payload->subtype != LACP_SUBTYPE) {
+        LACP_STAT_INC(plpinfo, pdus_malformed);
         return;
     }
 
@@ -398,6 +374,7 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
             RDEBUG(DL_LACPDU, "Rx LACPDU on port 0x%llx discarded - "
                    "ls it's in loop back.\n", lport_handle);
         }
+        LACP_STAT_INC(plpinfo, pdus_dropped);
         return;
     }
 
@@ -415,6 +392,7 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
         RDEBUG(DL_LACPDU, "Rx LACPDU on port 0x%llx discarded - "
                "port (%d) is 0.\n",
                lport_handle, lacpdu_payload->actor_port);
+        LACP_STAT_INC(plpinfo, pdus_malformed);
         return;
     }
 
@@ -439,6 +417,167 @@ LACP_process_input_pkt(port_handle_t lport_handle, unsigned char *data, int len)
 
 } /* LACP_process_input_pkt */
 
+/* RX batches are classified this many PDUs at a time: one bit per PDU
+ * in each mask. */
+#define RX_CLASSIFY_CHUNK   64
+
+/*----------------------------------------------------------------------
+ * Function: rx_info_equal(plpinfo, recvd_lacpdu)
+ * Synopsis: Compares the actor and partner TLVs of a LACPDU with the
+ *           port's cached rx_info a word at a time, without a branch per
+ *           field or byte: rx_info is 2 * LACP_TLV_INFO_LENGTH (40) bytes,
+ *           five 64-bit words.
+ * Returns:  TRUE if they are the same.
+ *----------------------------------------------------------------------*/
+static inline int
+rx_info_equal(const lacp_per_port_variables_t *plpinfo,
+              const lacpdu_payload_t *recvd_lacpdu)
+{
+    const u_char *tlvs = (const u_char *)&recvd_lacpdu->tlv_type_actor;
+    uint64_t diff = 0;
+    uint64_t a, b;
+    size_t ii;
+
+    for (ii = 0; ii + sizeof a <= sizeof(plpinfo->rx_info); ii += sizeof a) {
+        memcpy(&a, &plpinfo->rx_info[ii], sizeof a);
+        memcpy(&b, &tlvs[ii], sizeof b);
+        diff |= a ^ b;
+    }
+    for (; ii < sizeof(plpinfo->rx_info); ii++) {
+        diff |= plpinfo->rx_info[ii] ^ tlvs[ii];
+    }
+
+    return diff == 0;
+} /* rx_info_equal */
+
+/********************************************************************
+ * Function which is called with each batch of PDUs from the RX thread
+ ********************************************************************/
+void
+LACP_process_input_batch(struct MLt_drivers_mlacp__rxPdu *pdus, int count)
+{
+    lacp_per_port_variables_t *ports[RX_CLASSIFY_CHUNK];
+    uint64_t unchanged;
+    uint64_t invalid;
+    int n, ii;
+    int dirty;
+
+    for (; count > 0; pdus += n, count -= n) {
+        n = (count < RX_CLASSIFY_CHUNK) ? count : RX_CLASSIFY_CHUNK;
+
+        classify_rx_batch(pdus, n, ports, &unchanged, &invalid);
+
+        // Only the PDUs that the receive machine has to look at are
+        // handed to it, in order.  Once one has been, any port of the
+        // chunk may have changed (LAG selection covers the whole LAG):
+        // PDUs classified unchanged before it are checked again.
+        dirty = FALSE;
+        for (ii = 0; ii < n; ii++) {
+            uint64_t bit = 1ULL << ii;
+            lacpdu_payload_t *lacpdu = (lacpdu_payload_t *)pdus[ii].data;
+
+            if (invalid & bit) {
+                if (!lacp_worker_owns(PM_HANDLE2PORT(pdus[ii].lport_handle))) {
+                    // The port moved while the batch was queued.
+                    lacp_worker_count_misrouted();
+                    continue;
+                }
+                // Counted as dropped or malformed, state is not touched.
+                LACP_process_input_pkt(pdus[ii].lport_handle,
+                                       (unsigned char *)pdus[ii].data,
+                                       pdus[ii].pktLen);
+                continue;
+            }
+
+            if ((unchanged & bit) &&
+                (dirty == FALSE ||
+                 (LACP_rx_fast_path_ready(ports[ii]) &&
+                  rx_info_equal(ports[ii], lacpdu)))) {
+                LACP_process_unchanged_lacpdu(ports[ii]);
+                continue;
+            }
+
+            LACP_process_input_pkt(pdus[ii].lport_handle,
+                                   (unsigned char *)pdus[ii].data,
+                                   pdus[ii].pktLen);
+            dirty = TRUE;
+        }
+    }
+} /* LACP_process_input_batch */
+
+/*----------------------------------------------------------------------
+ * Function: classify_rx_batch(pdus, count, ports, unchanged, invalid)
+ *
+ * Synopsis: Classifies up to RX_CLASSIFY_CHUNK received PDUs in one pass,
+ *           before any of them is processed:
+ *             invalid   - dropped without looking at the port's state:
+ *                         misrouted, LACP not up on the port, or neither
+ *                         a LACPDU nor a Marker PDU;
+ *             unchanged - a LACPDU identical to the last one received on
+ *                         the port, which the receive machine's current
+ *                         state fast path would take;
+ *             changed   - everything else, including all PDUs of ports
+ *                         with PDU debug on.
+ * Input  :
+ *           pdus, count - the PDUs
+ *           ports - filled in with the port of each PDU, or NULL
+ *           unchanged, invalid - filled in with one bit per PDU
+ *
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+classify_rx_batch(struct MLt_drivers_mlacp__rxPdu *pdus, int count,
+                  lacp_per_port_variables_t **ports,
+                  uint64_t *unchanged, uint64_t *invalid)
+{
+    lacp_per_port_variables_t *plpinfo;
+    lacpdu_payload_t *lacpdu;
+    uint64_t bit;
+    int ii;
+
+    *unchanged = 0;
+    *invalid = 0;
+
+    for (ii = 0; ii < count; ii++) {
+        bit = 1ULL << ii;
+        lacpdu = (lacpdu_payload_t *)pdus[ii].data;
+
+        ports[ii] = NULL;
+        if (!lacp_worker_owns(PM_HANDLE2PORT(pdus[ii].lport_handle))) {
+            *invalid |= bit;
+            continue;
+        }
+
+        plpinfo = LACP_port_find(pdus[ii].lport_handle);
+        ports[ii] = plpinfo;
+        if (plpinfo == NULL || plpinfo->lacp_up == FALSE) {
+            *invalid |= bit;
+            continue;
+        }
+
+        // Debug output is produced by the full path only.
+        if ((plpinfo->debug_level & (DBG_LACPDU | DBG_RX_FSM)) ||
+            plpinfo->rx_lacpdu_display == TRUE) {
+            continue;
+        }
+
+        if (lacpdu->subtype != LACP_SUBTYPE) {
+            if (lacpdu->subtype != MARKER_SUBTYPE) {
+                *invalid |= bit;
+            }
+            continue;
+        }
+
+        // No need to look for loop backs or a zero actor port: the
+        // cached TLVs came from a LACPDU that passed both checks, and
+        // the fast path snapshot covers our system ID.
+        if (rx_info_equal(plpinfo, lacpdu) &&
+            LACP_rx_fast_path_ready(plpinfo)) {
+            *unchanged |= bit;
+        }
+    }
+} /* classify_rx_batch */
+
 /*----------------------------------------------------------------------
  * Function: LACP_marker_responder(int port_number, void *data)
  * Synopsis: Checks if the recvd PDU is a marker PDU, if so
@@ -453,7 +592,7 @@ LACP_marker_responder(lacp_per_port_variables_t *plpinfo, void *data)
 {
     int status = FALSE;
     marker_pdu_payload_t *marker_payload;
-    marker_pdu_payload_t *marker_response_payload;
+    marker_pdu_payload_t marker_response_payload;
 
     RENTRY();
 
@@ -467,19 +606,18 @@ LACP_marker_responder(lacp_per_port_variables_t *plpinfo, void *data)
         goto exit;
     }
 
-    plpinfo->marker_pdus_received++;
+    // Atomic add: the RX thread answers most Marker PDUs itself and
+    // counts them in the same fields (see mlacp_rx_marker_respond()).
+    __atomic_add_fetch(&plpinfo->stats.marker_pdus_received, 1,
+                       __ATOMIC_RELAXED);
     status = TRUE;
 
-    if (!(marker_response_payload =
-          LACP_build_marker_response_payload(plpinfo->lport_handle, data))) {
-        /* Report error and exit with status as TRUE */
-        VLOG_ERR("CANT TX MARKER RESPONSE");
-        goto exit;
-    }
+    LACP_build_marker_response_payload(plpinfo->lport_handle, data,
+                                       &marker_response_payload);
 
+    // Counts marker_response_pdus_sent once the frame is out.
     LACP_transmit_marker_response(plpinfo->lport_handle,
-                                  (void *)marker_response_payload);
-    free((void *)marker_response_payload);
+                                  (void *)&marker_response_payload);
 
 exit:
     REXIT();
@@ -489,38 +627,31 @@ exit:
 } /* LACP_marker_responder */
 
 /*----------------------------------------------------------------------
- * Function: LACP_build_lacpdu(int port_number)
- * Synopsis: Function to construct the lacpdu.
+ * Function: LACP_build_marker_response_payload(lport_handle, marker_pdu,
+ *                                              marker_response_payload)
+ * Synopsis: Function to construct the marker response, framed and ready
+ *           to transmit, in the caller's buffer.
  * Input  :
- *           port_number = port number on which to act upon.
- * Returns:  pointer to the constructed lacpdu payload or NULL in case
- *           of error.
+ *           lport_handle = port on which to act upon.
+ *           marker_pdu = received marker PDU.
+ *           marker_response_payload = buffer for the response.
+ * Returns:  void
  *----------------------------------------------------------------------*/
-static marker_pdu_payload_t *
+static void
 LACP_build_marker_response_payload(port_handle_t lport_handle,
-                                   marker_pdu_payload_t *marker_pdu)
+                                   marker_pdu_payload_t *marker_pdu,
+                                   marker_pdu_payload_t *marker_response_payload)
 {
-    marker_pdu_payload_t *marker_response_payload;
-
     RENTRY();
 
     // DL4 (not per-port debug) as this is not common.
     RDEBUG(DL_LACPDU, "%s: lport 0x%llx\n", __FUNCTION__, lport_handle);
 
     /***************************************************************************
-     * Allocate memory for the lacpdu.
-     ***************************************************************************/
-    marker_response_payload = (marker_pdu_payload_t *)malloc(sizeof(marker_pdu_payload_t));
-    if (marker_response_payload == NULL) {
-        /* Report error */
-        VLOG_ERR("%s : LACP_E_NOMEMMARKERRESPONSE", __FUNCTION__);
-        goto exit;
-    }
-
-    /***************************************************************************
-     * Zero out the memory.
+     * Zero out the memory and write the Ethernet header.
      ***************************************************************************/
     memset(marker_response_payload, 0, sizeof(marker_pdu_payload_t));
+    mlacp_tx_pdu_header(marker_response_payload->headroom);
 
     /***************************************************************************
      * Fill in the general parameters in the marker_response_payload.
@@ -543,11 +674,8 @@ LACP_build_marker_response_payload(port_handle_t lport_handle,
     marker_response_payload->tlv_type_terminator = TERMINATOR_TLV_TYPE;
     marker_response_payload->terminator_length =   TERMINATOR_LENGTH;
 
-exit:
     REXIT();
 
-    return (marker_response_payload);
-
 } /* LACP_build_marker_response_payload */
 
 /*----------------------------------------------------------------------
@@ -621,17 +749,3 @@ is_pkt_from_same_system(lacp_per_port_variables_t *plpinfo,
     return status;
 
 } /* is_pkt_from_same_system */
-
-int
-lacp_lag_port_match(void *v1, void *v2)
-{
-    lacp_lag_ppstruct_t *ppstruct = v1;
-    port_handle_t lport_handle = *(port_handle_t *)v2;
-
-    if (ppstruct->lport_handle == lport_handle) {
-        return 1;
-    } else {
-        return 0;
-    }
-
-} /* lacp_lag_port_match */
@@ -0,0 +1,338 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_timer.c
+ *
+ *   Timer wheel for the per-port LACP timers.
+ *
+ *   Time is counted in ticks of LACPD_TIMER_TICK_MS.  A running timer
+ *   sits in wheel slot (expires % LACP_TIMER_WHEEL_SLOTS), so only
+ *   the slots between the last processed tick and now are visited when
+ *   the wheel runs.  Timers further out than one revolution stay in
+ *   their slot and are skipped until they are due.
+ *
+ *   A one-shot timerfd is armed for the next occupied slot.  It is
+ *   watched by the RX thread's epoll loop, which turns each expiry into
+ *   a timer event for the protocol thread; no wakeups happen while no
+ *   timer is running.
+ *
+ *   Each protocol worker has a wheel and a timerfd of its own, and the
+ *   timer functions work on the caller's.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <openvswitch/vlog.h>
+#include <pm_cmn.h>
+
+#include "lacp.h"
+#include "lacp_timer.h"
+#include "lacp_worker.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_timer);
+
+/* 1024 slots of 100 msec cover the longest LACP timer (90 sec long
+ * timeout) in a single revolution. */
+#define LACP_TIMER_WHEEL_SLOTS  1024
+#define LACP_TIMER_WHEEL_MASK   (LACP_TIMER_WHEEL_SLOTS - 1)
+
+struct lacp_timer_wheel {
+    lacp_timer_t *slots[LACP_TIMER_WHEEL_SLOTS];
+    unsigned long long tick;        /* last processed tick */
+    unsigned long long armed_tick;  /* 0 when timerfd disarmed */
+    int fd;
+};
+
+static struct lacp_timer_wheel wheels[LACPD_PROTOCOL_WORKERS];
+
+/* The calling protocol worker's wheel. */
+#define this_wheel()    (&wheels[lacp_worker_self()])
+
+static unsigned long long
+now_tick(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((unsigned long long)ts.tv_sec * LACP_TIMER_MSEC_PER_SEC +
+            ts.tv_nsec / 1000000) / LACPD_TIMER_TICK_MS;
+} // now_tick
+
+static void
+wheel_arm(struct lacp_timer_wheel *w, unsigned long long tick)
+{
+    struct itimerspec its;
+    unsigned long long msec = tick * LACPD_TIMER_TICK_MS;
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = msec / LACP_TIMER_MSEC_PER_SEC;
+    its.it_value.tv_nsec = (msec % LACP_TIMER_MSEC_PER_SEC) * 1000000;
+
+    if (timerfd_settime(w->fd, TFD_TIMER_ABSTIME, &its, NULL) != 0) {
+        VLOG_ERR("Failed to arm LACP timer, rc=%s", strerror(errno));
+        return;
+    }
+
+    w->armed_tick = tick;
+} // wheel_arm
+
+static void
+wheel_insert(struct lacp_timer_wheel *w, lacp_timer_t *timer)
+{
+    lacp_timer_t **head = &w->slots[timer->t_expires & LACP_TIMER_WHEEL_MASK];
+
+    timer->t_next = *head;
+    if (*head) {
+        (*head)->t_pprev = &timer->t_next;
+    }
+    *head = timer;
+    timer->t_pprev = head;
+} // wheel_insert
+
+static void
+wheel_unlink(lacp_timer_t *timer)
+{
+    *timer->t_pprev = timer->t_next;
+    if (timer->t_next) {
+        timer->t_next->t_pprev = timer->t_pprev;
+    }
+    timer->t_next = NULL;
+    timer->t_pprev = NULL;
+} // wheel_unlink
+
+//*****************************************************************
+// Function : lacp_timer_init
+//*****************************************************************
+int
+lacp_timer_init(void)
+{
+    struct lacp_timer_wheel *w;
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        w = &wheels[worker];
+
+        w->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (w->fd < 0) {
+            VLOG_ERR("Failed to create LACP timerfd, rc=%s", strerror(errno));
+            return -1;
+        }
+
+        w->tick = now_tick();
+        w->armed_tick = 0;
+    }
+
+    return 0;
+} // lacp_timer_init
+
+//*****************************************************************
+// Function : lacp_timer_fd
+//*****************************************************************
+int
+lacp_timer_fd(int worker)
+{
+    return wheels[worker].fd;
+} // lacp_timer_fd
+
+//*****************************************************************
+// Function : lacp_timer_setup
+//*****************************************************************
+void
+lacp_timer_setup(lacp_timer_t *timer, void (*handler)(lacp_timer_t *))
+{
+    memset(timer, 0, sizeof(*timer));
+    timer->t_handler = handler;
+} // lacp_timer_setup
+
+//*****************************************************************
+// Function : lacp_timer_start
+// (Re)starts the timer to expire msec from now, rounded up to
+// the next tick.
+//*****************************************************************
+void
+lacp_timer_start(lacp_timer_t *timer, unsigned int msec)
+{
+    struct lacp_timer_wheel *w = this_wheel();
+    unsigned long long ticks;
+
+    if (timer->t_pprev) {
+        wheel_unlink(timer);
+    }
+
+    ticks = (msec + LACPD_TIMER_TICK_MS - 1) / LACPD_TIMER_TICK_MS;
+    if (ticks == 0) {
+        ticks = 1;
+    }
+
+    timer->t_expires = now_tick() + ticks;
+    wheel_insert(w, timer);
+
+    if ((w->armed_tick == 0) || (timer->t_expires < w->armed_tick)) {
+        wheel_arm(w, timer->t_expires);
+    }
+} // lacp_timer_start
+
+//*****************************************************************
+// Function : lacp_timer_start_phase
+// (Re)starts the timer to expire at the next tick, within period
+// msec from now, that lies phase msec into a period.  Periods are
+// counted from a fixed epoch, so timers started with the same
+// period and different phases fire in different ticks, while the
+// time to expiry never exceeds the period.
+//*****************************************************************
+void
+lacp_timer_start_phase(lacp_timer_t *timer, unsigned int period,
+                       unsigned int phase)
+{
+    struct lacp_timer_wheel *w = this_wheel();
+    unsigned long long period_ticks;
+    unsigned long long phase_ticks;
+    unsigned long long now;
+    unsigned long long expires;
+
+    period_ticks = period / LACPD_TIMER_TICK_MS;
+    if (period_ticks <= 1) {
+        lacp_timer_start(timer, period);
+        return;
+    }
+
+    if (timer->t_pprev) {
+        wheel_unlink(timer);
+    }
+
+    phase_ticks = (phase / LACPD_TIMER_TICK_MS) % period_ticks;
+
+    now = now_tick();
+    expires = now - (now % period_ticks) + phase_ticks;
+    if (expires <= now) {
+        expires += period_ticks;
+    }
+
+    timer->t_expires = expires;
+    wheel_insert(w, timer);
+
+    if ((w->armed_tick == 0) || (timer->t_expires < w->armed_tick)) {
+        wheel_arm(w, timer->t_expires);
+    }
+} // lacp_timer_start_phase
+
+//*****************************************************************
+// Function : lacp_timer_stop
+//*****************************************************************
+void
+lacp_timer_stop(lacp_timer_t *timer)
+{
+    if (timer->t_pprev) {
+        wheel_unlink(timer);
+    }
+} // lacp_timer_stop
+
+//*****************************************************************
+// Function : lacp_timer_running
+//*****************************************************************
+bool
+lacp_timer_running(const lacp_timer_t *timer)
+{
+    return (timer->t_pprev != NULL);
+} // lacp_timer_running
+
+//*****************************************************************
+// Function : lacp_timer_remaining
+// Returns msec left before the timer expires, 0 if it is stopped.
+//*****************************************************************
+unsigned int
+lacp_timer_remaining(const lacp_timer_t *timer)
+{
+    unsigned long long now;
+
+    if (timer->t_pprev == NULL) {
+        return 0;
+    }
+
+    now = now_tick();
+    if (timer->t_expires <= now) {
+        return 0;
+    }
+
+    return (timer->t_expires - now) * LACPD_TIMER_TICK_MS;
+} // lacp_timer_remaining
+
+//*****************************************************************
+// Function : lacp_timer_run
+// Fires every timer that is due and re-arms the timerfd for the
+// next occupied slot.
+//*****************************************************************
+void
+lacp_timer_run(void)
+{
+    struct lacp_timer_wheel *w = this_wheel();
+    unsigned long long now;
+    unsigned long long tick;
+    unsigned int ii;
+
+    now = now_tick();
+
+    /* Each slot needs visiting at most once, however late we are. */
+    if (now - w->tick > LACP_TIMER_WHEEL_SLOTS) {
+        w->tick = now - LACP_TIMER_WHEEL_SLOTS;
+    }
+
+    for (tick = w->tick + 1; tick <= now; tick++) {
+        lacp_timer_t *pending;
+        lacp_timer_t *timer;
+        lacp_timer_t **head = &w->slots[tick & LACP_TIMER_WHEEL_MASK];
+
+        if (*head == NULL) {
+            continue;
+        }
+
+        /* Move the slot to a local list first.  Handlers may start or
+         * stop any timer, including ones still on this list. */
+        pending = *head;
+        pending->t_pprev = &pending;
+        *head = NULL;
+
+        while ((timer = pending) != NULL) {
+            wheel_unlink(timer);
+
+            if (timer->t_expires > now) {
+                wheel_insert(w, timer);
+                continue;
+            }
+
+            if (timer->t_handler) {
+                timer->t_handler(timer);
+            }
+        }
+    }
+
+    w->tick = now;
+    w->armed_tick = 0;
+
+    for (ii = 1; ii <= LACP_TIMER_WHEEL_SLOTS; ii++) {
+        if (w->slots[(now + ii) & LACP_TIMER_WHEEL_MASK]) {
+            wheel_arm(w, now + ii);
+            break;
+        }
+    }
+} // lacp_timer_run
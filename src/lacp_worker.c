@@ -0,0 +1,282 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacp_worker.c
+ *
+ *   Protocol workers.
+ *
+ *   With LACPD_PROTOCOL_WORKERS above 1, lacpd runs that many protocol
+ *   threads, each with its own event queue, timer wheel and TX batch,
+ *   and every port belongs to exactly one of them.  A port's home is
+ *   picked by its aggregation key, so all the ports that can end up in
+ *   the same LAG run on the same worker; per-port work (LACPDUs,
+ *   timers, periodic transmits) never needs a lock.  What is shared
+ *   between LAGs -- the aggregators, the LAG selection pools and the
+ *   checkpoint -- is only touched under lacp_lock().
+ *
+ *   The owner table says where each port runs.  Every port starts on
+ *   worker 0.  Messages for a port are queued on its current owner; an
+ *   owner that gets the configuration message enabling LACP with a key
+ *   homed elsewhere disables the port, forwards the message to the new
+ *   worker and only then updates the table.  Messages that still reach
+ *   the old owner are forwarded in turn, so a port's messages are seen
+ *   in order.  LACPDUs caught in the switch are dropped; the partner
+ *   retransmits them anyway.
+ *
+ *   With one worker all of this compiles away.
+ */
+
+#include <string.h>
+#include <sys/types.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include <lacp_cmn.h>
+#include <pm_cmn.h>
+#include <mvlan_lacp.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "mlacp_fproto.h"
+#include "lacp_worker.h"
+
+VLOG_DEFINE_THIS_MODULE(lacp_worker);
+
+#if LACPD_PROTOCOL_WORKERS > 1
+__thread int lacp_worker_id;
+
+/* Indexed by PM_HANDLE2PORT().  Written by the owner only. */
+static int port_owner[LACP_MAX_PORTS];
+
+/* Each worker only writes its own. */
+struct lacp_worker_stats {
+    unsigned long forwarded;
+    unsigned long migrated;
+    unsigned long misrouted;
+};
+
+static struct lacp_worker_stats worker_stats[LACPD_PROTOCOL_WORKERS];
+
+static int
+worker_of_key(int key)
+{
+    return (unsigned int)key % LACPD_PROTOCOL_WORKERS;
+} // worker_of_key
+
+static void
+worker_count(unsigned long *counter)
+{
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+} // worker_count
+
+//*****************************************************************
+// Function : lacp_worker_owner
+//*****************************************************************
+int
+lacp_worker_owner(int port)
+{
+    if (port < 0 || port >= LACP_MAX_PORTS) {
+        return 0;
+    }
+
+    return __atomic_load_n(&port_owner[port], __ATOMIC_ACQUIRE);
+} // lacp_worker_owner
+
+/* The configuration message that (re)starts LACP on a port, the one
+ * that may move it. */
+static bool
+worker_is_port_start(const ML_event *pevent)
+{
+    const struct MLt_vpm_api__lport_lacp_change *pmsg = pevent->msg;
+
+    return (pevent->sender.peer == ml_lport_index &&
+            pevent->msgnum == MLm_vpm_api__set_lacp_lport_params_event &&
+            pmsg->lacp_state == LACP_STATE_ENABLED &&
+            !(pmsg->flags & LACP_LPORT_DYNAMIC_FIELDS_PRESENT));
+} // worker_is_port_start
+#endif /* LACPD_PROTOCOL_WORKERS > 1 */
+
+//*****************************************************************
+// Function : lacp_worker_start
+//*****************************************************************
+void
+lacp_worker_start(int worker)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    lacp_worker_id = worker;
+#else
+    ovs_assert(worker == 0);
+#endif
+} // lacp_worker_start
+
+//*****************************************************************
+// Function : lacp_worker_route
+//*****************************************************************
+int
+lacp_worker_route(int peer, int msgnum, const void *body)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    if (peer == ml_lport_index) {
+        switch (msgnum) {
+        case MLm_vpm_api__set_lacp_lport_params_event:
+        {
+            const struct MLt_vpm_api__lport_lacp_change *pmsg = body;
+            return lacp_worker_owner(PM_HANDLE2PORT(pmsg->lport_handle));
+        }
+        case MLm_vpm_api__lport_state_up:
+        case MLm_vpm_api__lport_state_down:
+        {
+            const struct MLt_vpm_api__lport_state_change *pmsg = body;
+            return lacp_worker_owner(PM_HANDLE2PORT(pmsg->lport_handle));
+        }
+        case MLm_vpm_api__set_lport_fallback_status:
+        {
+            const struct MLt_vpm_api__lport_fallback_status *pmsg = body;
+            return lacp_worker_owner(PM_HANDLE2PORT(pmsg->lport_handle));
+        }
+        case MLm_vpm_api__set_lacp_sport_params:
+        case MLm_vpm_api__unset_lacp_sport_params:
+            return LACP_WORKER_ALL;
+        default:
+            break;
+        }
+    } else if (peer == ml_cfgMgr_index) {
+        switch (msgnum) {
+        case MLm_lacp_api__setActorSysPriority:
+        case MLm_lacp_api__setActorSysMac:
+            return LACP_WORKER_ALL;
+        case MLm_lacp_api__set_lport_overrides:
+        {
+            const struct MLt_lacp_api__set_lport_overrides *pmsg = body;
+            return lacp_worker_owner(PM_HANDLE2PORT(pmsg->lport_handle));
+        }
+        default:
+            break;
+        }
+    }
+#endif
+
+    return 0;
+} // lacp_worker_route
+
+//*****************************************************************
+// Function : lacp_worker_redirect
+//*****************************************************************
+bool
+lacp_worker_redirect(const ML_event *pevent)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    const struct MLt_vpm_api__lport_lacp_change *pmsg;
+    int target;
+    int port = -1;
+
+    if (pevent->msgnum == MLm_vpm_api__config_batch) {
+        // Split by ml_send_event(); its items come through here.
+        return false;
+    }
+
+    target = lacp_worker_route(pevent->sender.peer, pevent->msgnum,
+                               pevent->msg);
+    if (target == LACP_WORKER_ALL) {
+        return false;
+    }
+
+    if (target == lacp_worker_id) {
+        if (!worker_is_port_start(pevent)) {
+            return false;
+        }
+
+        pmsg = pevent->msg;
+        target = worker_of_key(pmsg->port_key);
+        if (target == lacp_worker_id) {
+            return false;
+        }
+
+        port = PM_HANDLE2PORT(pmsg->lport_handle);
+        VLOG_DBG("Moving port %d to protocol worker %d", port, target);
+
+        // Timers and aggregator go with LACP; the new owner starts
+        // the port from scratch.
+        if (LACP_port_find(pmsg->lport_handle) != NULL) {
+            LACP_disable_lacp(pmsg->lport_handle);
+        }
+    }
+
+    // Queue the message before the table changes, so a message sent
+    // to the new owner in between cannot overtake it.
+    ml_send_event_to(target, ml_event_copy(pevent, pevent->msg));
+
+    if (port >= 0) {
+        __atomic_store_n(&port_owner[port], target, __ATOMIC_RELEASE);
+        worker_count(&worker_stats[lacp_worker_id].migrated);
+    } else {
+        worker_count(&worker_stats[lacp_worker_id].forwarded);
+    }
+
+    return true;
+#else
+    return false;
+#endif
+} // lacp_worker_redirect
+
+//*****************************************************************
+// Function : lacp_worker_count_misrouted
+//*****************************************************************
+void
+lacp_worker_count_misrouted(void)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    worker_count(&worker_stats[lacp_worker_id].misrouted);
+#endif
+} // lacp_worker_count_misrouted
+
+//*****************************************************************
+// Function : lacp_worker_dump
+//*****************************************************************
+void
+lacp_worker_dump(struct ds *ds)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    int n_ports[LACPD_PROTOCOL_WORKERS];
+    int worker;
+    int port;
+
+    memset(n_ports, 0, sizeof n_ports);
+    for (port = 0; port < LACP_MAX_PORTS; port++) {
+        if (lacp_ports[port].in_use) {
+            n_ports[lacp_worker_owner(port)]++;
+        }
+    }
+
+    ds_put_format(ds, "Protocol workers: %d\n", LACPD_PROTOCOL_WORKERS);
+    ds_put_format(ds, "    %-6s %6s %10s %10s %10s\n", "worker", "ports",
+                  "forwarded", "migrated", "misrouted");
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        const struct lacp_worker_stats *s = &worker_stats[worker];
+
+        ds_put_format(ds, "    %-6d %6d %10lu %10lu %10lu\n", worker,
+                      n_ports[worker],
+                      __atomic_load_n(&s->forwarded, __ATOMIC_RELAXED),
+                      __atomic_load_n(&s->migrated, __ATOMIC_RELAXED),
+                      __atomic_load_n(&s->misrouted, __ATOMIC_RELAXED));
+    }
+#else
+    ds_put_format(ds, "Protocol workers: 1\n");
+#endif
+} // lacp_worker_dump
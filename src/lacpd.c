@@ -37,6 +37,7 @@
 #include <getopt.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <sys/time.h>
 
@@ -61,13 +62,13 @@
 
 VLOG_DEFINE_THIS_MODULE(lacpd);
 
-#define DIAGNOSTIC_BUFFER_LEN 16000
-
 bool exiting = false;
 static unixctl_cb_func lacpd_unixctl_dump;
 static unixctl_cb_func lacpd_unixctl_getlacpinterfaces;
 static unixctl_cb_func lacpd_unixctl_getlacpcounters;
 static unixctl_cb_func lacpd_unixctl_getlacpstate;
+static unixctl_cb_func lacpd_unixctl_getlacplatency;
+static unixctl_cb_func lacpd_unixctl_memstats;
 static unixctl_cb_func ops_lacpd_exit;
 
 extern int lacpd_shutdown;
@@ -164,6 +165,48 @@ lacpd_unixctl_getlacpstate(struct unixctl_conn *conn, int argc,
     ds_destroy(&ds);
 } /* lacpd_unixctl_getlacpstate */
 
+/**
+ * ovs-appctl interface callback function to dump the convergence
+ * latency histograms and the last convergence of each LAG interface.
+ *
+ * @param conn connection to ovs-appctl interface.
+ * @param argc number of arguments.
+ * @param argv array of arguments.
+ * @param OVS_UNUSED aux argument not used.
+ */
+static void
+lacpd_unixctl_getlacplatency(struct unixctl_conn *conn, int argc,
+                             const char *argv[], void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    lacpd_latency_dump(&ds, argc, argv);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+} /* lacpd_unixctl_getlacplatency */
+
+/**
+ * ovs-appctl interface callback function to report the memory used by
+ * each subsystem of the daemon.
+ *
+ * @param conn connection to ovs-appctl interface.
+ * @param argc number of arguments.
+ * @param argv array of arguments.
+ * @param OVS_UNUSED aux argument not used.
+ */
+static void
+lacpd_unixctl_memstats(struct unixctl_conn *conn, int argc OVS_UNUSED,
+                       const char *argv[] OVS_UNUSED, void *aux OVS_UNUSED)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+
+    lacpd_memstats_dump(&ds);
+
+    unixctl_command_reply(conn, ds_cstr(&ds));
+    ds_destroy(&ds);
+} /* lacpd_unixctl_memstats */
+
 
 /**
  * callback handler function for diagnostic dump basic
@@ -176,56 +219,34 @@ lacpd_unixctl_getlacpstate(struct unixctl_conn *conn, int argc,
 static void lacpd_diag_dump_basic_cb(const char *feature , char **buf)
 {
     struct ds ds = DS_EMPTY_INITIALIZER;
+    const char* argv[] = {"", "port"};
 
     if (!buf)
         return;
-    *buf =  xcalloc(1,DIAGNOSTIC_BUFFER_LEN);
-    if (*buf) {
-        /* populate basic diagnostic data to buffer  */
-        ds_put_format(&ds, "System Ports: \n");
-        const char* argv[] = {"", "port"};
-        lacpd_debug_dump(&ds, 2, argv);
-        sprintf(*buf, "%s", ds_cstr(&ds));
-
-        ds_put_format(&ds, "\nLAG interfaces: \n");
-        lacpd_lag_ports_dump(&ds, 0, NULL);
-        sprintf(*buf, "%s", ds_cstr(&ds));
-
-        ds_put_format(&ds, "\nLACP PDUs counters: \n");
-        lacpd_pdus_counters_dump(&ds, 0, NULL);
-        sprintf(*buf, "%s", ds_cstr(&ds));
-
-        ds_put_format(&ds, "\nLACP state: \n");
-
-        lacpd_state_dump(&ds, 0, NULL);
-        sprintf(*buf, "%s", ds_cstr(&ds));
-        VLOG_INFO("basic diag-dump data populated for feature %s",feature);
-    } else{
-        VLOG_ERR("Memory allocation failed for feature %s , %d bytes",
-                 feature , DIAGNOSTIC_BUFFER_LEN);
-    }
-    return ;
-} /* lacpd_diag_dump_basic_cb */
 
+    /* populate basic diagnostic data; the buffer is sized to fit it */
+    ds_put_format(&ds, "System Ports: \n");
+    lacpd_debug_dump(&ds, 2, argv);
 
-/**
- * lacpd daemon's timer handler function.
- */
-static void
-timerHandler(void)
-{
-    ML_event *timerEvent;
+    ds_put_format(&ds, "\nLAG interfaces: \n");
+    lacpd_lag_ports_dump(&ds, 0, NULL);
 
-    timerEvent = (ML_event *)malloc(sizeof(ML_event));
-    if (NULL == timerEvent) {
-        VLOG_ERR("Out of memory for LACP timer message.");
-        return;
-    }
-    memset(timerEvent, 0, sizeof(ML_event));
-    timerEvent->sender.peer = ml_timer_index;
+    ds_put_format(&ds, "\nLACP PDUs counters: \n");
+    lacpd_pdus_counters_dump(&ds, 0, NULL);
+
+    ds_put_format(&ds, "\nLACP state: \n");
+
+    lacpd_state_dump(&ds, 0, NULL);
+
+    ds_put_format(&ds, "\nProtocol thread: \n");
+    mlacp_event_queue_dump(&ds);
+    mlacp_event_cost_dump(&ds);
+
+    *buf = ds_steal_cstr(&ds);
+    VLOG_INFO("basic diag-dump data populated for feature %s",feature);
+    return ;
+} /* lacpd_diag_dump_basic_cb */
 
-    ml_send_event(timerEvent);
-} /* timerHandler */
 
 /**
  * lacpd daemon's main initialization function.  Responsible for
@@ -239,22 +260,26 @@ lacpd_init(const char *db_path, struct unixctl_server *appctl)
     int rc;
     sigset_t sigset;
     pthread_t ovs_if_thread;
-    pthread_t lacpd_thread;
+    pthread_t lacpd_thread[LACPD_PROTOCOL_WORKERS];
     pthread_t lacpdu_rx_thread;
+    int ii;
 
     /* Block all signals so the spawned threads don't receive any. */
     sigemptyset(&sigset);
     sigfillset(&sigset);
     pthread_sigmask(SIG_BLOCK, &sigset, NULL);
 
-    /* Spawn off the main LACP protocol thread. */
-    rc = pthread_create(&lacpd_thread,
-                        (pthread_attr_t *)NULL,
-                        lacpd_protocol_thread,
-                        NULL);
-    if (rc) {
-        VLOG_ERR("pthread_create for LACPD protocol thread failed! rc=%d", rc);
-        exit(-rc);
+    /* Spawn off the LACP protocol threads, one per worker. */
+    for (ii = 0; ii < LACPD_PROTOCOL_WORKERS; ii++) {
+        rc = pthread_create(&lacpd_thread[ii],
+                            (pthread_attr_t *)NULL,
+                            lacpd_protocol_thread,
+                            (void *)(intptr_t)ii);
+        if (rc) {
+            VLOG_ERR("pthread_create for LACPD protocol thread failed! rc=%d",
+                     rc);
+            exit(-rc);
+        }
     }
 
     /* Initialize IDL through a new connection to the dB. */
@@ -267,10 +292,14 @@ lacpd_init(const char *db_path, struct unixctl_server *appctl)
     unixctl_command_register("lacpd/dump", "", 0, 2, lacpd_unixctl_dump, NULL);
     unixctl_command_register("lacpd/getlacpinterfaces", "", 0, 1,
                              lacpd_unixctl_getlacpinterfaces, NULL);
-    unixctl_command_register("lacpd/getlacpcounters", "", 0, 1,
-                             lacpd_unixctl_getlacpcounters, NULL);
+    unixctl_command_register("lacpd/getlacpcounters", "[--raw] [lag_name]",
+                             0, 2, lacpd_unixctl_getlacpcounters, NULL);
     unixctl_command_register("lacpd/getlacpstate", "", 0, 1,
                              lacpd_unixctl_getlacpstate, NULL);
+    unixctl_command_register("lacpd/getlacplatency", "[lag_name]", 0, 1,
+                             lacpd_unixctl_getlacplatency, NULL);
+    unixctl_command_register("lacpd/memstats", "", 0, 0,
+                             lacpd_unixctl_memstats, NULL);
 
     /* Spawn off the OVSDB interface thread. */
     rc = pthread_create(&ovs_if_thread,
@@ -408,8 +437,6 @@ ops_lacpd_exit(struct unixctl_conn *conn, int argc OVS_UNUSED,
 int
 main(int argc, char *argv[])
 {
-    int mlacp_tindex;
-    struct itimerval timerVal;
     char *appctl_path = NULL;
     struct unixctl_server *appctl;
     char *ovsdb_sock;
@@ -462,16 +489,8 @@ main(int argc, char *argv[])
 
     VLOG_INFO_ONCE("%s (OpenSwitch Link Aggregation Daemon) started", program_name);
 
-    /* Set up timer to fire off every second. */
-    timerVal.it_interval.tv_sec  = 1;
-    timerVal.it_interval.tv_usec = 0;
-    timerVal.it_value.tv_sec  = 1;
-    timerVal.it_value.tv_usec = 0;
-
-    if ((mlacp_tindex = setitimer(ITIMER_REAL, &timerVal, NULL)) != 0) {
-        VLOG_ERR("lacpd main: Timer start failed!\n");
-    }
-
+    /* Protocol timers run off a timerfd watched by the RX thread
+     * (see lacp_timer.c); this thread only waits for signals. */
     /* Wait for all signals in an infinite loop. */
     sigfillset(&sigset);
     while (!lacpd_shutdown) {
@@ -479,10 +498,6 @@ main(int argc, char *argv[])
         sigwait(&sigset, &signum);
         switch (signum) {
 
-        case SIGALRM:
-            timerHandler();
-            break;
-
         case SIGTERM:
         case SIGINT:
             VLOG_WARN("%s, sig %d caught", __FUNCTION__, signum);
@@ -0,0 +1,567 @@
+/*
+ * (c) Copyright 2015 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/***************************************************************************
+ *    File               : mlacp_event.c
+ *    Description        : Event queue of the LACP protocol thread
+ ***************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+#include <openvswitch/vlog.h>
+
+#include <mqueue.h>
+#include <pm_cmn.h>
+#include <lacp_cmn.h>
+#include <mvlan_lacp.h>
+#include "lacp.h"
+#include "mlacp_recv.h"
+#include "mlacp_fproto.h"
+#include "lacp_worker.h"
+
+VLOG_DEFINE_THIS_MODULE(mlacp_event);
+
+/* Capacity of the protocol thread's event ring.  Every queued event
+ * takes one ring entry.  Events small enough to fit in a slot (single
+ * LACPDU batches, timer ticks) are carved out of the ring's preallocated
+ * slots instead of the heap; larger batches and configuration messages
+ * are still malloc'ed. */
+#define LACPD_EVENT_RING_SIZE   4096
+#define LACPD_EVENT_SLOT_SIZE   (sizeof(ML_event) + \
+                                 sizeof(struct MLt_drivers_mlacp__rxPduBatch) + \
+                                 sizeof(struct MLt_drivers_mlacp__rxPdu))
+
+/* Events are queued on priority lanes, so timer ticks and received
+ * LACPDUs do not wait behind a burst of configuration messages (see
+ * mqueue.c).  A lower lane is served after being passed over
+ * LACPD_EVENT_STARVE_LIMIT times in a row.
+ *
+ * Link state changes may overtake the configuration message that
+ * enables LACP on the port.  That message is therefore applied with
+ * the port's latest published link state (see mlacpVapiLportEvent). */
+enum lacpd_event_lane {
+    LACPD_LANE_TIMER,
+    LACPD_LANE_RX_PDU,
+    LACPD_LANE_LINK,
+    LACPD_LANE_CONFIG,
+    LACPD_N_LANES
+};
+
+#define LACPD_EVENT_STARVE_LIMIT    16
+
+static const char *const lacpd_lane_names[LACPD_N_LANES] = {
+    [LACPD_LANE_TIMER]  = "timer",
+    [LACPD_LANE_RX_PDU] = "rx_pdu",
+    [LACPD_LANE_LINK]   = "link",
+    [LACPD_LANE_CONFIG] = "config",
+};
+
+/* Message Queues of the LACPD protocol threads, one per worker. */
+mqueue_t lacpd_main_rcvq[LACPD_PROTOCOL_WORKERS];
+
+/* Time lacpd_thread spent on each kind of event, including sending the
+ * LACPDUs it made the state machines transmit.  Indexed by sender class
+ * and msgnum; message numbers from ML_EVENT_N_MSGNUMS up share the last
+ * row.  Each protocol thread only writes its own table. */
+enum ml_event_class {
+    ML_EVENT_CLASS_TIMER,
+    ML_EVENT_CLASS_LPORT,
+    ML_EVENT_CLASS_RX_PDU,
+    ML_EVENT_CLASS_CFG_MGR,
+    ML_EVENT_CLASS_OTHER,
+    ML_EVENT_N_CLASSES
+};
+
+#define ML_EVENT_N_MSGNUMS      32
+
+struct ml_event_cost {
+    unsigned long       count;
+    unsigned long long  total_ns;
+    unsigned long long  max_ns;
+};
+
+static struct ml_event_cost ml_event_costs[LACPD_PROTOCOL_WORKERS]
+                                          [ML_EVENT_N_CLASSES]
+                                          [ML_EVENT_N_MSGNUMS];
+
+static const char *const ml_event_class_names[ML_EVENT_N_CLASSES] = {
+    [ML_EVENT_CLASS_TIMER]   = "timer",
+    [ML_EVENT_CLASS_LPORT]   = "lport",
+    [ML_EVENT_CLASS_RX_PDU]  = "rx_pdu",
+    [ML_EVENT_CLASS_CFG_MGR] = "cfg_mgr",
+    [ML_EVENT_CLASS_OTHER]   = "other",
+};
+
+/************************************************************************
+ * Event Receiver Functions
+ ************************************************************************/
+int
+ml_init_event_rcvr(void)
+{
+    int worker;
+    int rc = 0;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        rc = mqueue_init_lanes(&lacpd_main_rcvq[worker], LACPD_N_LANES,
+                               LACPD_EVENT_RING_SIZE, LACPD_EVENT_SLOT_SIZE,
+                               LACPD_EVENT_STARVE_LIMIT);
+        if (rc) {
+            VLOG_ERR("Failed LACP main receive queue init: %s",
+                     strerror(rc));
+            break;
+        }
+    }
+
+    return rc;
+} /* ml_init_event_rcvr */
+
+ML_event *
+ml_event_alloc(int size)
+{
+    ML_event *event;
+
+    event = mqueue_slot_alloc(&lacpd_main_rcvq[lacp_worker_self()], size);
+    if (event != NULL) {
+        memset(event, 0, size);
+    } else {
+        event = xzalloc(size);
+    }
+
+    return event;
+} /* ml_event_alloc */
+
+/* Size of the body of a configuration message. */
+static size_t
+ml_event_body_size(int msgnum)
+{
+    switch (msgnum) {
+    case MLm_lacp_api__setActorSysPriority:
+        return sizeof(struct MLt_lacp_api__actorSysPriority);
+    case MLm_lacp_api__setActorSysMac:
+        return sizeof(struct MLt_lacp_api__actorSysMac);
+    case MLm_lacp_api__set_lport_overrides:
+        return sizeof(struct MLt_lacp_api__set_lport_overrides);
+    case MLm_vpm_api__create_sport:
+        return sizeof(struct MLt_vpm_api__create_sport);
+    case MLm_vpm_api__delete_sport:
+        return sizeof(struct MLt_vpm_api__delete_sport);
+    case MLm_vpm_api__set_lacp_sport_params:
+    case MLm_vpm_api__unset_lacp_sport_params:
+        return sizeof(struct MLt_vpm_api__lacp_sport_params);
+    case MLm_vpm_api__set_lacp_lport_params_event:
+        return sizeof(struct MLt_vpm_api__lport_lacp_change);
+    case MLm_vpm_api__lport_state_up:
+    case MLm_vpm_api__lport_state_down:
+        return sizeof(struct MLt_vpm_api__lport_state_change);
+    case MLm_vpm_api__set_lport_fallback_status:
+        return sizeof(struct MLt_vpm_api__lport_fallback_status);
+    default:
+        return 0;
+    }
+} /* ml_event_body_size */
+
+/* Returns a new event with the sender, message number and body of a
+ * configuration message.  body is that of event, which need not be
+ * just after it (it may be an item of a batch). */
+ML_event *
+ml_event_copy(const ML_event *event, const void *body)
+{
+    size_t size = ml_event_body_size(event->msgnum);
+    ML_event *copy;
+
+    copy = ml_event_alloc(sizeof(ML_event) + size);
+    copy->sender = event->sender;
+    copy->msgnum = event->msgnum;
+    memcpy(copy + 1, body, size);
+
+    return copy;
+} /* ml_event_copy */
+
+static enum lacpd_event_lane
+ml_event_lane(const ML_event *event)
+{
+    switch (event->sender.peer) {
+    case ml_timer_index:
+        return LACPD_LANE_TIMER;
+    case ml_rx_pdu_index:
+        return LACPD_LANE_RX_PDU;
+    case ml_lport_index:
+        if ((event->msgnum == MLm_vpm_api__lport_state_up) ||
+            (event->msgnum == MLm_vpm_api__lport_state_down)) {
+            return LACPD_LANE_LINK;
+        }
+        return LACPD_LANE_CONFIG;
+    default:
+        return LACPD_LANE_CONFIG;
+    }
+} /* ml_event_lane */
+
+int
+ml_send_event_to(int worker, ML_event *event)
+{
+    enum lacpd_event_lane lane = ml_event_lane(event);
+    int rc;
+
+    /* Only LACPDUs may be dropped when the queue is full; they are
+     * retransmitted by the partner anyway.  Timer ticks and config
+     * messages wait for the protocol thread to make room. */
+    while (((rc = mqueue_send_lane(&lacpd_main_rcvq[worker], event,
+                                   lane)) == ENOBUFS) &&
+           (lane != LACPD_LANE_RX_PDU)) {
+        sched_yield();
+    }
+
+    if ((rc == ENOBUFS) || (rc == ENOMEM)) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_ERR_RL(&rl, "Failed to send to LACP main receive queue: %s",
+                    strerror(rc));
+        ml_event_free(event);
+        return rc;
+    }
+
+    if (rc) {
+        /* The event is queued and belongs to the protocol thread now;
+         * only waking it up failed. */
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+        VLOG_ERR_RL(&rl, "Failed to signal LACP main receive queue: %s",
+                    strerror(rc));
+    }
+
+    return 0;
+} /* ml_send_event_to */
+
+#if LACPD_PROTOCOL_WORKERS > 1
+/* Splits a configuration batch into one batch per worker, keeping the
+ * order of the items; items for every worker go into every batch. */
+static int
+ml_send_batch(ML_event *event)
+{
+    struct MLt_vpm_api__config_batch *batch = (void *)(event + 1);
+    ML_event *shards[LACPD_PROTOCOL_WORKERS];
+    int worker;
+    int target;
+    int ii;
+
+    memset(shards, 0, sizeof shards);
+
+    for (ii = 0; ii < batch->count; ii++) {
+        const struct MLt_vpm_api__config_item *item = &batch->items[ii];
+
+        target = lacp_worker_route(item->peer, item->msgnum, &item->u);
+
+        for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+            struct MLt_vpm_api__config_batch *shard;
+
+            if (target != LACP_WORKER_ALL && target != worker) {
+                continue;
+            }
+
+            if (shards[worker] == NULL) {
+                shards[worker] = ml_event_alloc(sizeof(ML_event) +
+                                                sizeof(*batch) +
+                                                batch->count * sizeof(*item));
+                shards[worker]->sender = event->sender;
+                shards[worker]->msgnum = event->msgnum;
+            }
+
+            shard = (void *)(shards[worker] + 1);
+            shard->items[shard->count++] = *item;
+        }
+    }
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        if (shards[worker] != NULL) {
+            ml_send_event_to(worker, shards[worker]);
+        }
+    }
+
+    ml_event_free(event);
+
+    return 0;
+} /* ml_send_batch */
+#endif
+
+/* Queues an event on the protocol thread that handles it.  Timer and
+ * RX events carry their worker in sender.instance. */
+int
+ml_send_event(ML_event *event)
+{
+#if LACPD_PROTOCOL_WORKERS > 1
+    int worker;
+
+    if ((event->sender.peer == ml_timer_index) ||
+        (event->sender.peer == ml_rx_pdu_index)) {
+        return ml_send_event_to(event->sender.instance, event);
+    }
+
+    if (event->msgnum == MLm_vpm_api__config_batch) {
+        return ml_send_batch(event);
+    }
+
+    worker = lacp_worker_route(event->sender.peer, event->msgnum, event + 1);
+    if (worker == LACP_WORKER_ALL) {
+        for (worker = 1; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+            ml_send_event_to(worker, ml_event_copy(event, event + 1));
+        }
+        worker = 0;
+    }
+
+    return ml_send_event_to(worker, event);
+#else
+    return ml_send_event_to(0, event);
+#endif
+} /* ml_send_event */
+
+ML_event *
+ml_wait_for_next_event(void)
+{
+    int rc;
+    ML_event *event = NULL;
+
+    rc = mqueue_wait(&lacpd_main_rcvq[lacp_worker_self()],
+                     (void **)(void *)&event);
+    if (!rc) {
+        /* Set up event->msg pointer to just after the event
+         * structure itself. This must be done here since the
+         * sender's event->msg pointer points sender's memory
+         * space, and will result in fatal errors if we try to
+         * access it in LACP process space.
+         */
+        event->msg = (void *)(event+1);
+    } else {
+        VLOG_ERR("LACP main receive queue wait error, rc=%s",
+                 strerror(rc));
+    }
+
+    return event;
+} /* ml_wait_for_next_event */
+
+void
+ml_event_free(ML_event *event)
+{
+    int worker;
+
+    if (event != NULL) {
+        /* A slot goes back to the queue it was carved from, whichever
+         * worker frees it. */
+        for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+            if (mqueue_slot_free(&lacpd_main_rcvq[worker], event)) {
+                return;
+            }
+        }
+        free(event);
+    }
+} /* ml_event_free */
+
+unsigned int
+ml_event_queue_depth(void)
+{
+    unsigned int depth = 0;
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        depth += mqueue_depth(&lacpd_main_rcvq[worker]);
+    }
+
+    return depth;
+} /* ml_event_queue_depth */
+
+size_t
+ml_event_queue_memory(void)
+{
+    size_t bytes = 0;
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        bytes += mqueue_memory(&lacpd_main_rcvq[worker]);
+    }
+
+    return bytes;
+} /* ml_event_queue_memory */
+
+/************************************************************************
+ * Event Cost Accounting
+ ************************************************************************/
+unsigned long long
+ml_event_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} /* ml_event_clock_ns */
+
+static enum ml_event_class
+ml_event_class_of(const ML_event *event)
+{
+    switch (event->sender.peer) {
+    case ml_timer_index:
+        return ML_EVENT_CLASS_TIMER;
+    case ml_lport_index:
+        return ML_EVENT_CLASS_LPORT;
+    case ml_rx_pdu_index:
+        return ML_EVENT_CLASS_RX_PDU;
+    case ml_cfgMgr_index:
+        return ML_EVENT_CLASS_CFG_MGR;
+    default:
+        return ML_EVENT_CLASS_OTHER;
+    }
+} /* ml_event_class_of */
+
+/* Charges the time since start_ns (from ml_event_clock_ns()) to the
+ * event's sender class and message number.  Protocol thread only. */
+void
+ml_event_account(const ML_event *event, unsigned long long start_ns)
+{
+    unsigned long long ns = ml_event_clock_ns() - start_ns;
+    struct ml_event_cost *cost;
+    unsigned int msgnum;
+
+    msgnum = MIN((unsigned int)event->msgnum, ML_EVENT_N_MSGNUMS - 1);
+    cost = &ml_event_costs[lacp_worker_self()][ml_event_class_of(event)]
+                          [msgnum];
+
+    /* Single writer; the stores are atomic only for the dump. */
+    __atomic_store_n(&cost->count, cost->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&cost->total_ns, cost->total_ns + ns, __ATOMIC_RELAXED);
+    if (ns > cost->max_ns) {
+        __atomic_store_n(&cost->max_ns, ns, __ATOMIC_RELAXED);
+    }
+} /* ml_event_account */
+
+/************************************************************************
+ * Status Dump Functions
+ ************************************************************************/
+static void
+ml_event_queue_dump(struct ds *ds, int worker)
+{
+    mqueue_t *q = &lacpd_main_rcvq[worker];
+    mqueue_stats_t stats;
+    unsigned int ii;
+
+    mqueue_get_stats(q, &stats);
+
+    if (LACPD_PROTOCOL_WORKERS > 1) {
+        ds_put_format(ds, "Protocol event queue of worker %d:\n", worker);
+    } else {
+        ds_put_format(ds, "Protocol event queue:\n");
+    }
+    if (q->q_capacity) {
+        ds_put_format(ds, "    mode          : ring\n");
+        ds_put_format(ds, "    capacity      : %u\n", q->q_capacity);
+        ds_put_format(ds, "    slot size     : %zu\n", q->q_slot_size);
+    } else {
+        ds_put_format(ds, "    mode          : list\n");
+    }
+    ds_put_format(ds, "    depth         : %u\n", stats.total.depth);
+    ds_put_format(ds, "    max depth     : %u\n", stats.total.depth_max);
+    ds_put_format(ds, "    sent          : %lu\n", stats.total.sent);
+    ds_put_format(ds, "    received      : %lu\n", stats.total.received);
+    ds_put_format(ds, "    overflow      : %lu\n", stats.total.overflow);
+    ds_put_format(ds, "    slot misses   : %lu\n", stats.slot_misses);
+    ds_put_format(ds, "    avg dwell     : %llu nsec\n",
+                  stats.total.received ?
+                  stats.total.dwell_total_ns / stats.total.received : 0);
+    ds_put_format(ds, "    max dwell     : %llu nsec\n",
+                  stats.total.dwell_max_ns);
+
+    if (stats.n_lanes != LACPD_N_LANES) {
+        return;
+    }
+
+    ds_put_format(ds, "    %-8s %12s %9s %6s %9s %12s %12s %9s\n",
+                  "lane", "received", "overflow", "depth", "max depth",
+                  "avg dwell ns", "max dwell ns", "promoted");
+    for (ii = 0; ii < stats.n_lanes; ii++) {
+        const mqueue_lane_stats_t *ls = &stats.lanes[ii];
+
+        ds_put_format(ds, "    %-8s %12lu %9lu %6u %9u %12llu %12llu %9lu\n",
+                      lacpd_lane_names[ii], ls->received, ls->overflow,
+                      ls->depth, ls->depth_max,
+                      ls->received ? ls->dwell_total_ns / ls->received : 0,
+                      ls->dwell_max_ns, ls->promoted);
+    }
+} /* ml_event_queue_dump */
+
+void
+mlacp_event_queue_dump(struct ds *ds)
+{
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        ml_event_queue_dump(ds, worker);
+    }
+} /* mlacp_event_queue_dump */
+
+void
+mlacp_event_cost_dump(struct ds *ds)
+{
+    unsigned long long class_ns;
+    unsigned long class_count;
+    unsigned long long total;
+    unsigned long long max;
+    unsigned long count;
+    int worker;
+    int cls;
+    int msgnum;
+
+    ds_put_format(ds, "Protocol thread event cost:\n");
+    ds_put_format(ds, "    %-8s %6s %12s %14s %10s %10s\n", "class", "msgnum",
+                  "count", "total usec", "avg nsec", "max nsec");
+
+    for (cls = 0; cls < ML_EVENT_N_CLASSES; cls++) {
+        class_count = 0;
+        class_ns = 0;
+
+        for (msgnum = 0; msgnum < ML_EVENT_N_MSGNUMS; msgnum++) {
+            count = 0;
+            total = 0;
+            max = 0;
+
+            for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+                const struct ml_event_cost *cost =
+                    &ml_event_costs[worker][cls][msgnum];
+
+                count += __atomic_load_n(&cost->count, __ATOMIC_RELAXED);
+                total += __atomic_load_n(&cost->total_ns, __ATOMIC_RELAXED);
+                max = MAX(max, __atomic_load_n(&cost->max_ns,
+                                               __ATOMIC_RELAXED));
+            }
+            if (count == 0) {
+                continue;
+            }
+            class_count += count;
+            class_ns += total;
+
+            ds_put_format(ds, "    %-8s %5d%s %12lu %14llu %10llu %10llu\n",
+                          ml_event_class_names[cls], msgnum,
+                          (msgnum == ML_EVENT_N_MSGNUMS - 1) ? "+" : " ",
+                          count, total / 1000, total / count, max);
+        }
+
+        if (class_count) {
+            ds_put_format(ds, "    %-8s %6s %12lu %14llu %10llu\n",
+                          ml_event_class_names[cls], "all", class_count,
+                          class_ns / 1000, class_ns / class_count);
+        }
+    }
+} /* mlacp_event_cost_dump */
@@ -19,23 +19,30 @@
  *    Description        : Master (mcpu) LACP Manager's main entry point
  ***************************************************************************/
 
+#define _GNU_SOURCE
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <limits.h>
 #include <net/if.h>
 #include <arpa/inet.h>
+#include <stdint.h>
 #include <sys/epoll.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <linux/if_ether.h>
 #include <linux/if_packet.h>
 #include <linux/filter.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
 
 #include <util.h>
 #include <openvswitch/vlog.h>
 
-#include <mqueue.h>
 #include <pm_cmn.h>
 #include <lacp_cmn.h>
 #include <mlacp_debug.h>
@@ -45,6 +52,10 @@
 #include "mlacp_fproto.h"
 #include "lacp_support.h"
 #include "lacp_ops_if.h"
+#include "lacp_checkpoint.h"
+#include "lacp_export.h"
+#include "lacp_rx_filter.h"
+#include "lacp_worker.h"
 
 VLOG_DEFINE_THIS_MODULE(mlacp_main);
 
@@ -54,9 +65,6 @@ VLOG_DEFINE_THIS_MODULE(mlacp_main);
 static int lacp_init_done = FALSE;
 int lacpd_shutdown = 0;
 
-/* Message Queue for LACPD main protocol thread */
-mqueue_t lacpd_main_rcvq;
-
 /* epoll FD for LACPDU RX. */
 int epfd = -1;
 
@@ -93,74 +101,895 @@ static struct sock_fprog lacpd_fprog = {
     .len = sizeof(lacpd_filter_f) / sizeof(struct sock_filter)
 };
 
+/* Attaches the in-kernel LACPDU filter (lacp_rx_filter.c) to an RX
+ * socket, or the classic filter above if it is not loaded. */
+static int
+mlacp_rx_attach_filter(int fd)
+{
+    int prog = lacp_rx_filter_prog();
+
+    if (prog >= 0 &&
+        setsockopt(fd, SOL_SOCKET, SO_ATTACH_BPF, &prog, sizeof(prog)) == 0) {
+        return 0;
+    }
+
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                      &lacpd_fprog, sizeof(lacpd_fprog));
+} /* mlacp_rx_attach_filter */
+
+/* epoll tags of the protocol workers' timer wheel timerfds
+ * (lacp_timer.c), one per worker. */
+static const int rx_timer_tags[LACPD_PROTOCOL_WORKERS];
+
+/* A received packet, ready to be copied into an RX batch event. */
+struct rx_pkt {
+    port_handle_t   lport_handle;
+    const char      *data;
+    unsigned int    len;
+};
+
+#ifdef LACPD_RX_TPACKET
+/* Shared RX ring
+ *
+ * One PACKET_MMAP (TPACKET_V3) socket, not bound to any interface,
+ * receives slow-protocol frames for all interfaces.  Frames are
+ * demultiplexed to iface_data by sll_ifindex.  The same socket is used
+ * for LACPDU TX by addressing each frame to the interface's ifindex, so
+ * the number of fds and the kernel buffer footprint do not grow with
+ * the number of LACP interfaces.
+ */
+#define RX_RING_BLOCK_SIZE      (1 << 16)
+#define RX_RING_BLOCK_NR        16
+#define RX_RING_FRAME_SIZE      256
+#define RX_RING_BLOCK_TOV_MS    1
+
+struct rx_ring {
+    int             fd;
+    char            *map;
+    unsigned int    next_block;
+};
+
+static struct rx_ring rx_ring = { .fd = -1 };
+#endif /* LACPD_RX_TPACKET */
+
+#if defined(LACPD_RX_TPACKET) || defined(LACPD_NETLINK_LINK)
+#define RX_IFINDEX_MAP
+
+/* ifindex -> iface_data, open addressing, for the RX ring and the
+ * netlink link listener.  Slots are never reclaimed, only their
+ * iface_data pointer is cleared, so the RX thread can read the table
+ * while the protocol threads update it (under lacp_lock()). */
+#define RX_IFINDEX_MAP_SIZE     1024
+
+static struct {
+    int                 ifindex;
+    struct iface_data   *idp;
+} rx_ifindex_map[RX_IFINDEX_MAP_SIZE];
+#endif /* LACPD_RX_TPACKET || LACPD_NETLINK_LINK */
+
+#ifdef LACPD_NETLINK_LINK
+/* Netlink link listener
+ *
+ * switchd only writes link_state to OVSDB some time after the link
+ * went down, and lacpd's OVSDB thread takes a while longer to notice.
+ * With LACPD_NETLINK_LINK the RX thread also listens to RTNLGRP_LINK,
+ * and tells the port's protocol worker as soon as the kernel reports
+ * that a LACP interface lost its link.  OVSDB stays the source of truth
+ * for link up and link speed.  When the link is back, OVSDB may not
+ * have reported the down yet, or may never report it if the flap was
+ * too short for switchd to notice.  The listener waits
+ * LACPD_NETLINK_UP_HOLDOFF_MS, and resends link up only if OVSDB's
+ * link_seqno for the interface is still the one it had at the down:
+ * then no link up will come from OVSDB.  Otherwise OVSDB's own down
+ * and up follow, and link up is left to them.  The rx_link_* arrays
+ * are indexed like rx_ifindex_map and only touched by the RX thread.
+ */
+#define RX_NETLINK_BUF_SIZE     8192
+
+enum rx_link_state {
+    RX_LINK_UP,             /* nothing sent, or link up sent */
+    RX_LINK_DOWN,           /* link down sent */
+    RX_LINK_HELD,           /* link down sent, the kernel has it back */
+};
+
+static int rx_netlink_fd = -1;
+static uint8_t rx_link_state[RX_IFINDEX_MAP_SIZE];
+static unsigned int rx_link_seqno[RX_IFINDEX_MAP_SIZE]; /* at the down */
+static unsigned long long rx_link_due[RX_IFINDEX_MAP_SIZE]; /* msec */
+static int rx_link_n_held;
+
+/* Written by the RX thread only. */
+static unsigned long rx_link_n_msgs;
+static unsigned long rx_link_n_down;
+static unsigned long rx_link_n_up;
+static unsigned long rx_link_n_left;
+static unsigned long rx_link_n_errors;
+#endif /* LACPD_NETLINK_LINK */
+
+/* TX batch
+ *
+ * LACPDUs built while a protocol thread handles one event (all ports
+ * whose periodic timer expired in the same tick, or the replies to one
+ * RX batch) are copied here and sent with one sendmmsg() when the event
+ * is done.  The frames go out through a single packet socket that is
+ * not bound to any interface and, having protocol 0, receives nothing;
+ * each frame is addressed to its interface's ifindex.  If that socket
+ * cannot be opened, frames are sent one at a time as before.
+ */
+struct tx_batch {
+    int                 fd;
+    unsigned int        count;
+    unsigned long long  first_usec;     /* when the first frame queued */
+    port_handle_t       lports[LACPD_TX_BATCH_SIZE];
+    struct mmsghdr      msgs[LACPD_TX_BATCH_SIZE];
+    struct iovec        iovs[LACPD_TX_BATCH_SIZE];
+    struct sockaddr_ll  addrs[LACPD_TX_BATCH_SIZE];
+    unsigned char       bufs[LACPD_TX_BATCH_SIZE][LACP_PKT_SIZE];
+
+    /* Written by the batch's protocol thread, read by lacpd/dump tx. */
+    unsigned long       n_flushes;
+    unsigned long       n_frames;
+    unsigned long       n_syscalls;
+    unsigned long       n_errors;
+    unsigned long       max_batch;
+    unsigned long long  latency_usec_total;
+    unsigned long long  latency_usec_max;
+};
+
+/* One per protocol worker. */
+static struct tx_batch tx_batch[LACPD_PROTOCOL_WORKERS] = {
+    [0 ... LACPD_PROTOCOL_WORKERS - 1] = { .fd = -1 }
+};
+
 /************************************************************************
- * Event Receiver Functions
+ * Status Dump Functions
  ************************************************************************/
-int
-ml_init_event_rcvr(void)
+void
+mlacp_tx_dump(struct ds *ds)
 {
-    int rc;
+    unsigned long flushes = 0;
+    unsigned long frames = 0;
+    unsigned long syscalls = 0;
+    unsigned long errors = 0;
+    unsigned long max_batch = 0;
+    unsigned long long latency_total = 0;
+    unsigned long long latency_max = 0;
+    int worker;
+
+    /* Summed over the protocol workers. */
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        struct tx_batch *b = &tx_batch[worker];
+
+        flushes += __atomic_load_n(&b->n_flushes, __ATOMIC_RELAXED);
+        frames += __atomic_load_n(&b->n_frames, __ATOMIC_RELAXED);
+        syscalls += __atomic_load_n(&b->n_syscalls, __ATOMIC_RELAXED);
+        errors += __atomic_load_n(&b->n_errors, __ATOMIC_RELAXED);
+        max_batch = MAX(max_batch,
+                        __atomic_load_n(&b->max_batch, __ATOMIC_RELAXED));
+        latency_total += __atomic_load_n(&b->latency_usec_total,
+                                         __ATOMIC_RELAXED);
+        latency_max = MAX(latency_max,
+                          __atomic_load_n(&b->latency_usec_max,
+                                          __ATOMIC_RELAXED));
+    }
+
+    ds_put_format(ds, "LACPDU transmit:\n");
+    ds_put_format(ds, "    mode          : %s\n",
+                  (tx_batch[0].fd >= 0) ? "sendmmsg" : "sendto");
+    ds_put_format(ds, "    batch size    : %u\n", LACPD_TX_BATCH_SIZE);
+    ds_put_format(ds, "    flushes       : %lu\n", flushes);
+    ds_put_format(ds, "    frames        : %lu\n", frames);
+    ds_put_format(ds, "    syscalls      : %lu\n", syscalls);
+    ds_put_format(ds, "    errors        : %lu\n", errors);
+    ds_put_format(ds, "    max batch     : %lu\n", max_batch);
+    ds_put_format(ds, "    avg latency   : %llu usec\n",
+                  flushes ? (latency_total / flushes) : 0);
+    ds_put_format(ds, "    max latency   : %llu usec\n", latency_max);
+} /* mlacp_tx_dump */
+
+void
+mlacp_link_dump(struct ds *ds)
+{
+    ds_put_format(ds, "Netlink link listener:\n");
+#ifdef LACPD_NETLINK_LINK
+    ds_put_format(ds, "    state         : %s\n",
+                  (rx_netlink_fd >= 0) ? "listening" : "failed");
+    ds_put_format(ds, "    messages      : %lu\n",
+                  __atomic_load_n(&rx_link_n_msgs, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    link down     : %lu\n",
+                  __atomic_load_n(&rx_link_n_down, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    link up       : %lu\n",
+                  __atomic_load_n(&rx_link_n_up, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    up from OVSDB : %lu\n",
+                  __atomic_load_n(&rx_link_n_left, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    held          : %d\n",
+                  __atomic_load_n(&rx_link_n_held, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    errors        : %lu\n",
+                  __atomic_load_n(&rx_link_n_errors, __ATOMIC_RELAXED));
+#else
+    ds_put_format(ds, "    state         : disabled (LACPD_NETLINK_LINK)\n");
+#endif
+} /* mlacp_link_dump */
+
+/************************************************************************
+ * LACPDU Send and Receive Functions
+ ************************************************************************/
+/* Copies received packets into one RX batch event and posts it to a
+ * protocol worker. */
+static void
+mlacp_rx_post_batch(int worker, const struct rx_pkt *pkts, int count)
+{
+    int ii;
+    ML_event *event;
+    int total_msg_size;
+    struct MLt_drivers_mlacp__rxPduBatch *batch;
 
-    rc = mqueue_init(&lacpd_main_rcvq);
-    if (rc) {
-        VLOG_ERR("Failed LACP main receive queue init: %s",
-                 strerror(rc));
+    if (count == 0) {
+        return;
     }
 
-    return rc;
-} /* ml_init_event_rcvr */
+    total_msg_size = sizeof(ML_event) +
+                     sizeof(struct MLt_drivers_mlacp__rxPduBatch) +
+                     count * sizeof(struct MLt_drivers_mlacp__rxPdu);
+
+    event = ml_event_alloc(total_msg_size);
+    event->sender.peer = ml_rx_pdu_index;
+    event->sender.instance = worker;
+    event->msgnum = MLm_drivers_mlacp__rxPduBatch;
+
+    /* Set up batch pointer to just after the event
+     * structure itself. This must be done here since the
+     * sender's event->msg pointer points sender's memory
+     * space, and will result in fatal errors if we try to
+     * access it in LACP process space.
+     */
+    batch = (struct MLt_drivers_mlacp__rxPduBatch *)(event+1);
+    batch->count = count;
+    batch->rx_usec = lacp_latency_now();
+
+    for (ii = 0; ii < count; ii++) {
+        batch->pdus[ii].lport_handle = pkts[ii].lport_handle;
+        batch->pdus[ii].pktLen = pkts[ii].len;
+        memcpy(batch->pdus[ii].data, pkts[ii].data, pkts[ii].len);
+    }
 
-int
-ml_send_event(ML_event *event)
+    if (ml_send_event(event)) {
+        /* Count the drops against each port.  Port table slots are
+         * never freed, so this is safe from the RX thread. */
+        for (ii = 0; ii < count; ii++) {
+            lacp_port_stats_t *stats =
+                &lacp_ports[PM_HANDLE2PORT(pkts[ii].lport_handle)].stats;
+
+            __atomic_add_fetch(&stats->pdus_queue_overflow, 1,
+                               __ATOMIC_RELAXED);
+        }
+    }
+} /* mlacp_rx_post_batch */
+
+/* Posts received packets to the protocol workers that own their
+ * ports, keeping each port's packets in order. */
+static void
+mlacp_rx_send_batch(const struct rx_pkt *pkts, int count)
 {
-    int rc;
+#if LACPD_PROTOCOL_WORKERS > 1
+    struct rx_pkt shards[LACPD_PROTOCOL_WORKERS][LACPD_RX_BATCH_SIZE];
+    int n_shard[LACPD_PROTOCOL_WORKERS];
+    int worker;
+    int ii;
+
+    memset(n_shard, 0, sizeof n_shard);
+
+    for (ii = 0; ii < count; ii++) {
+        worker = lacp_worker_owner(PM_HANDLE2PORT(pkts[ii].lport_handle));
+        shards[worker][n_shard[worker]++] = pkts[ii];
+    }
 
-    rc = mqueue_send(&lacpd_main_rcvq, event);
-    if (rc) {
-        VLOG_ERR("Failed to send to LACP main receive queue: %s",
-                 strerror(rc));
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        mlacp_rx_post_batch(worker, shards[worker], n_shard[worker]);
     }
+#else
+    mlacp_rx_post_batch(0, pkts, count);
+#endif
+} /* mlacp_rx_send_batch */
+
+/* Adds the protocol workers' timer wheel timerfds to the epoll loop. */
+static void
+mlacp_rx_timer_init(void)
+{
+    struct epoll_event event;
+    int worker;
 
-    return rc;
-} /* ml_send_event */
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        event.events = EPOLLIN;
+        event.data.ptr = (void *)&rx_timer_tags[worker];
+
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, lacp_timer_fd(worker),
+                      &event) != 0) {
+            VLOG_ERR("Failed to register timerfd with epoll loop. err=%s",
+                     strerror(errno));
+        }
+    }
+} /* mlacp_rx_timer_init */
 
-ML_event *
-ml_wait_for_next_event(void)
+/* A worker's timer wheel timerfd fired; have that protocol thread run
+ * the wheel.  The wheel itself is only touched by its protocol
+ * thread. */
+static void
+mlacp_rx_timer_expiry(int worker)
 {
-    int rc;
-    ML_event *event = NULL;
-
-    rc = mqueue_wait(&lacpd_main_rcvq, (void **)(void *)&event);
-    if (!rc) {
-        /* Set up event->msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        event->msg = (void *)(event+1);
+    uint64_t expirations;
+    ML_event *timerEvent;
+
+    if (read(lacp_timer_fd(worker), &expirations,
+             sizeof(expirations)) < 0) {
+        /* Re-armed before we got here. */
+        return;
+    }
+
+    timerEvent = ml_event_alloc(sizeof(ML_event));
+    timerEvent->sender.peer = ml_timer_index;
+    timerEvent->sender.instance = worker;
+
+    ml_send_event(timerEvent);
+} /* mlacp_rx_timer_expiry */
+
+/* Sends one frame on an interface's socket, bypassing the TX batch.
+ * Safe from any thread.  Returns what sendto() returned. */
+static ssize_t
+mlacp_tx_pdu_direct(const struct iface_data *idp, const void *data,
+                    int length, int flags)
+{
+#ifdef LACPD_RX_TPACKET
+    if ((rx_ring.fd >= 0) && (idp->pdu_sockfd == rx_ring.fd)) {
+        /* Shared socket isn't bound; address the frame explicitly. */
+        struct sockaddr_ll addr;
+
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = AF_PACKET;
+        addr.sll_ifindex = idp->ifindex;
+        addr.sll_protocol = htons(ETH_P_SLOW);
+        addr.sll_halen = MAC_ADDR_LENGTH;
+        memcpy(addr.sll_addr, lacp_mcast_addr, MAC_ADDR_LENGTH);
+
+        return sendto(idp->pdu_sockfd, data, length, flags,
+                      (struct sockaddr *)&addr, sizeof(addr));
+    }
+#endif
+
+    return sendto(idp->pdu_sockfd, data, length, flags, NULL, 0);
+} /* mlacp_tx_pdu_direct */
+
+/* Marker responder
+ *
+ * Answering a Marker PDU takes no protocol state: the response is the
+ * same frame with our source address and the TLV type changed to
+ * Marker Response.  The RX thread turns it around in place, on the
+ * socket it came in on, so a partner moving flows between links does
+ * not wait behind busy protocol threads.  Anything but a well-formed
+ * Marker Information PDU on a port with LACP up still goes to the
+ * protocol thread.
+ *
+ * Returns true if the frame was answered here.
+ */
+static bool
+mlacp_rx_marker_respond(const struct iface_data *idp, char *data,
+                        unsigned int len)
+{
+    marker_pdu_payload_t *marker = (marker_pdu_payload_t *)data;
+    lacp_per_port_variables_t *plpinfo;
+    lacp_port_stats_t *stats;
+
+    if ((len < sizeof(*marker)) ||
+        (marker->subtype != MARKER_SUBTYPE) ||
+        (marker->version_number != MARKER_VERSION) ||
+        (marker->tlv_type_marker != MARKER_INFO_TLV_TYPE) ||
+        (marker->marker_info_length != MARKER_TLV_INFO_LENGTH) ||
+        (marker->tlv_type_terminator != TERMINATOR_TLV_TYPE) ||
+        (marker->terminator_length != TERMINATOR_LENGTH)) {
+        return false;
+    }
+
+    /* Port table slots are never freed, so this is safe from the RX
+     * thread; the protocol thread updates these counters the same
+     * way.  A port without LACP up is left to the protocol thread,
+     * which drops the frame (LACP_process_input_pkt()). */
+    plpinfo = &lacp_ports[idp->index];
+    if (!__atomic_load_n(&plpinfo->in_use, __ATOMIC_RELAXED) ||
+        (__atomic_load_n(&plpinfo->lport_handle, __ATOMIC_RELAXED) !=
+         PM_SMPT2HANDLE(0, 0, idp->index, idp->cycl_port_type)) ||
+        (__atomic_load_n(&plpinfo->lacp_up, __ATOMIC_RELAXED) == FALSE)) {
+        return false;
+    }
+
+    stats = &plpinfo->stats;
+    __atomic_add_fetch(&stats->marker_pdus_received, 1, __ATOMIC_RELAXED);
+
+    /* The requester's port, system and transaction id stay as they
+     * are.  my_mac_addr only changes with the system MAC.  The rest
+     * is cleared, as LACP_build_marker_response_payload() does. */
+    mlacp_tx_pdu_header((unsigned char *)data);
+    marker->tlv_type_marker = MARKER_TLV_TYPE;
+    marker->pad = 0;
+    memset(marker->reserved, 0, sizeof(marker->reserved));
+
+    if (mlacp_tx_pdu_direct(idp, data, sizeof(*marker), MSG_DONTWAIT) < 0) {
+        static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+        VLOG_WARN_RL(&rl, "Failed to send Marker response for "
+                     "interface=%s, rc=%d", idp->name, errno);
+        __atomic_add_fetch(&stats->pdus_tx_failed, 1, __ATOMIC_RELAXED);
     } else {
-        VLOG_ERR("LACP main receive queue wait error, rc=%s",
-                 strerror(rc));
+        __atomic_add_fetch(&stats->marker_response_pdus_sent, 1,
+                           __ATOMIC_RELAXED);
     }
 
-    return event;
-} /* ml_wait_for_next_event */
+    return true;
+} /* mlacp_rx_marker_respond */
 
-void
-ml_event_free(ML_event *event)
+#ifdef RX_IFINDEX_MAP
+static unsigned int
+rx_ifindex_hash(int ifindex)
 {
-    if (event != NULL) {
-        free(event);
+    return ((unsigned int)ifindex * 2654435761u) & (RX_IFINDEX_MAP_SIZE - 1);
+} /* rx_ifindex_hash */
+
+/* Slot of ifindex in rx_ifindex_map, or -1. */
+static int
+rx_ifindex_find(int ifindex)
+{
+    unsigned int ii;
+    unsigned int slot = rx_ifindex_hash(ifindex);
+
+    for (ii = 0; ii < RX_IFINDEX_MAP_SIZE; ii++) {
+        int key = __atomic_load_n(&rx_ifindex_map[slot].ifindex,
+                                  __ATOMIC_ACQUIRE);
+        if (key == ifindex) {
+            return slot;
+        } else if (key == 0) {
+            break;
+        }
+        slot = (slot + 1) & (RX_IFINDEX_MAP_SIZE - 1);
     }
-} /* ml_event_free */
 
-/************************************************************************
- * LACPDU Send and Receive Functions
- ************************************************************************/
+    return -1;
+} /* rx_ifindex_find */
+
+static struct iface_data *
+rx_ifindex_lookup(int ifindex)
+{
+    int slot = rx_ifindex_find(ifindex);
+
+    if (slot < 0) {
+        return NULL;
+    }
+
+    return __atomic_load_n(&rx_ifindex_map[slot].idp, __ATOMIC_ACQUIRE);
+} /* rx_ifindex_lookup */
+
+static int
+rx_ifindex_set(int ifindex, struct iface_data *idp)
+{
+    unsigned int ii;
+    unsigned int slot = rx_ifindex_hash(ifindex);
+
+    for (ii = 0; ii < RX_IFINDEX_MAP_SIZE; ii++) {
+        int key = rx_ifindex_map[slot].ifindex;
+
+        if (key == ifindex || (key == 0 && idp != NULL)) {
+            __atomic_store_n(&rx_ifindex_map[slot].idp, idp,
+                             __ATOMIC_RELEASE);
+            __atomic_store_n(&rx_ifindex_map[slot].ifindex, ifindex,
+                             __ATOMIC_RELEASE);
+            return 0;
+        } else if (key == 0) {
+            /* Clearing an ifindex that was never set. */
+            return 0;
+        }
+        slot = (slot + 1) & (RX_IFINDEX_MAP_SIZE - 1);
+    }
+
+    return -1;
+} /* rx_ifindex_set */
+#endif /* RX_IFINDEX_MAP */
+
+#ifdef LACPD_RX_TPACKET
+/* Sets up the shared RX ring.  Called from mlacp_init(), before any
+ * thread that registers interfaces is started, so rx_ring.fd never
+ * changes while they read it.
+ * On failure lacpd falls back to one socket per interface. */
+static void
+mlacp_rx_ring_init(void)
+{
+    int fd;
+    int version = TPACKET_V3;
+    struct tpacket_req3 req;
+    void *map;
+
+    if ((fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_SLOW))) < 0) {
+        VLOG_ERR("Failed to open RX ring socket, rc=%s", strerror(errno));
+        return;
+    }
+
+    if (mlacp_rx_attach_filter(fd) < 0) {
+        VLOG_ERR("Failed to attach RX ring socket filter, rc=%s",
+                 strerror(errno));
+        goto error;
+    }
+
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                   &version, sizeof(version)) < 0) {
+        VLOG_ERR("Failed to set TPACKET_V3 on RX ring, rc=%s",
+                 strerror(errno));
+        goto error;
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = RX_RING_BLOCK_SIZE;
+    req.tp_block_nr = RX_RING_BLOCK_NR;
+    req.tp_frame_size = RX_RING_FRAME_SIZE;
+    req.tp_frame_nr = (RX_RING_BLOCK_SIZE * RX_RING_BLOCK_NR) /
+                      RX_RING_FRAME_SIZE;
+    req.tp_retire_blk_tov = RX_RING_BLOCK_TOV_MS;
+
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        VLOG_ERR("Failed to set up RX ring, rc=%s", strerror(errno));
+        goto error;
+    }
+
+    map = mmap(NULL, RX_RING_BLOCK_SIZE * RX_RING_BLOCK_NR,
+               PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+    if (map == MAP_FAILED) {
+        VLOG_ERR("Failed to map RX ring, rc=%s", strerror(errno));
+        goto error;
+    }
+
+    rx_ring.map = map;
+    rx_ring.next_block = 0;
+    rx_ring.fd = fd;
+    VLOG_INFO("LACPDU RX ring enabled: %d blocks of %d bytes",
+              RX_RING_BLOCK_NR, RX_RING_BLOCK_SIZE);
+    return;
+
+error:
+    close(fd);
+} /* mlacp_rx_ring_init */
+
+/* Adds the shared RX ring, if there is one, to the epoll loop. */
+static void
+mlacp_rx_ring_register(void)
+{
+    struct epoll_event event;
+
+    if (rx_ring.fd < 0) {
+        return;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = (void *)&rx_ring;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, rx_ring.fd, &event) != 0) {
+        VLOG_ERR("Failed to register RX ring with epoll loop. err=%s",
+                 strerror(errno));
+    }
+} /* mlacp_rx_ring_register */
+
+/* Hands every block the kernel has retired back to the protocol thread,
+ * LACPD_RX_BATCH_SIZE packets per event. */
+static void
+mlacp_rx_ring_drain(void)
+{
+    struct rx_pkt pkts[LACPD_RX_BATCH_SIZE];
+    int count = 0;
+
+    for (;;) {
+        unsigned int ii;
+        struct tpacket_block_desc *bd;
+        struct tpacket3_hdr *ppd;
+
+        bd = (struct tpacket_block_desc *)
+             (rx_ring.map + (rx_ring.next_block * RX_RING_BLOCK_SIZE));
+
+        if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+              TP_STATUS_USER)) {
+            break;
+        }
+
+        ppd = (struct tpacket3_hdr *)((char *)bd +
+                                      bd->hdr.bh1.offset_to_first_pkt);
+
+        for (ii = 0; ii < bd->hdr.bh1.num_pkts; ii++) {
+            struct sockaddr_ll *sll;
+            struct iface_data *idp;
+
+            sll = (struct sockaddr_ll *)((char *)ppd +
+                                         TPACKET_ALIGN(sizeof(*ppd)));
+            idp = rx_ifindex_lookup(sll->sll_ifindex);
+
+            /* Skip our own transmits and interfaces not running LACP. */
+            if ((sll->sll_pkttype != PACKET_OUTGOING) &&
+                (idp != NULL) && (idp->pdu_registered == true) &&
+                (ppd->tp_snaplen > 0) && (ppd->tp_snaplen <= LACP_PKT_SIZE) &&
+                !mlacp_rx_marker_respond(idp, (char *)ppd + ppd->tp_mac,
+                                         ppd->tp_snaplen)) {
+
+                pkts[count].lport_handle = PM_SMPT2HANDLE(0, 0, idp->index,
+                                                          idp->cycl_port_type);
+                pkts[count].data = (char *)ppd + ppd->tp_mac;
+                pkts[count].len = ppd->tp_snaplen;
+                count++;
+
+                if (count == LACPD_RX_BATCH_SIZE) {
+                    mlacp_rx_send_batch(pkts, count);
+                    count = 0;
+                }
+            }
+
+            ppd = (struct tpacket3_hdr *)((char *)ppd + ppd->tp_next_offset);
+        }
+
+        /* Flush before handing the block back, since pkts points
+         * into it. */
+        mlacp_rx_send_batch(pkts, count);
+        count = 0;
+
+        __atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                         __ATOMIC_RELEASE);
+        rx_ring.next_block = (rx_ring.next_block + 1) % RX_RING_BLOCK_NR;
+    }
+} /* mlacp_rx_ring_drain */
+#endif /* LACPD_RX_TPACKET */
+
+#ifdef LACPD_NETLINK_LINK
+/* Opens the netlink link listener and adds it to the epoll loop.
+ * Without it, link changes only reach lacpd through OVSDB. */
+static void
+mlacp_rx_netlink_init(void)
+{
+    int fd;
+    struct sockaddr_nl addr;
+    struct epoll_event event;
+
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                NETLINK_ROUTE);
+    if (fd < 0) {
+        VLOG_ERR("Failed to open netlink link socket, rc=%s",
+                 strerror(errno));
+        return;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        VLOG_ERR("Failed to join RTNLGRP_LINK, rc=%s", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    event.events = EPOLLIN;
+    event.data.ptr = (void *)&rx_netlink_fd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        VLOG_ERR("Failed to register netlink socket with epoll loop. "
+                 "err=%s", strerror(errno));
+        close(fd);
+        return;
+    }
+
+    rx_netlink_fd = fd;
+    VLOG_INFO("Netlink link listener enabled");
+} /* mlacp_rx_netlink_init */
+
+/* Sends a link state change of a LACP interface to its protocol
+ * worker, the same message the OVSDB thread sends. */
+static void
+mlacp_rx_netlink_post(const struct iface_data *idp, bool up,
+                      unsigned int speed)
+{
+    ML_event *event;
+    struct MLt_vpm_api__lport_state_change *msg;
+
+    event = ml_event_alloc(sizeof(ML_event) + sizeof(*msg));
+    event->sender.peer = ml_lport_index;
+    event->msgnum = (up ? MLm_vpm_api__lport_state_up :
+                          MLm_vpm_api__lport_state_down);
+
+    msg = (struct MLt_vpm_api__lport_state_change *)(event+1);
+    msg->lport_handle = PM_SMPT2HANDLE(0, 0, idp->index, idp->cycl_port_type);
+    msg->link_speed = speed;
+
+    ml_send_event(event);
+} /* mlacp_rx_netlink_post */
+
+static unsigned long long
+rx_link_now_msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+} /* rx_link_now_msec */
+
+static void
+rx_link_set_state(int slot, enum rx_link_state state)
+{
+    if (rx_link_state[slot] == RX_LINK_HELD) {
+        __atomic_store_n(&rx_link_n_held, rx_link_n_held - 1,
+                         __ATOMIC_RELAXED);
+    }
+    if (state == RX_LINK_HELD) {
+        __atomic_store_n(&rx_link_n_held, rx_link_n_held + 1,
+                         __ATOMIC_RELAXED);
+    }
+    rx_link_state[slot] = state;
+} /* rx_link_set_state */
+
+/* Handles the kernel's view of one interface's link. */
+static void
+mlacp_rx_netlink_link(int ifindex, bool running)
+{
+    int slot;
+    struct iface_data *idp;
+    struct lacpd_iface_cfg cfg;
+
+    slot = rx_ifindex_find(ifindex);
+    if (slot < 0) {
+        /* Not a LACP interface. */
+        return;
+    }
+
+    idp = __atomic_load_n(&rx_ifindex_map[slot].idp, __ATOMIC_ACQUIRE);
+    if ((idp == NULL) || !lacpd_iface_cfg_get(idp->index, &cfg)) {
+        rx_link_set_state(slot, RX_LINK_UP);
+        return;
+    }
+
+    if (!running) {
+        if (rx_link_state[slot] == RX_LINK_HELD) {
+            /* Still down as far as the protocol worker knows. */
+            rx_link_set_state(slot, RX_LINK_DOWN);
+        } else if ((rx_link_state[slot] == RX_LINK_UP) &&
+                   (cfg.link_state == INTERFACE_LINK_STATE_UP)) {
+            /* Once per link down, and only if OVSDB has not caught up
+             * already. */
+            rx_link_set_state(slot, RX_LINK_DOWN);
+            rx_link_seqno[slot] = cfg.link_seqno;
+            __atomic_store_n(&rx_link_n_down, rx_link_n_down + 1,
+                             __ATOMIC_RELAXED);
+            VLOG_DBG("Netlink: interface %s lost its link", cfg.name);
+            mlacp_rx_netlink_post(idp, false, 0);
+        }
+    } else if (rx_link_state[slot] == RX_LINK_DOWN) {
+        /* Give OVSDB time to report the flap; see
+         * mlacp_rx_netlink_run(). */
+        rx_link_set_state(slot, RX_LINK_HELD);
+        rx_link_due[slot] = rx_link_now_msec() + LACPD_NETLINK_UP_HOLDOFF_MS;
+    }
+} /* mlacp_rx_netlink_link */
+
+/* Ends the hold-off of the interfaces whose link came back at least
+ * LACPD_NETLINK_UP_HOLDOFF_MS ago.  Resends link up if OVSDB has seen
+ * no link change since the down, that is, if it missed the flap. */
+static void
+mlacp_rx_netlink_run(void)
+{
+    unsigned long long now;
+    struct iface_data *idp;
+    struct lacpd_iface_cfg cfg;
+    int slot;
+
+    if (rx_link_n_held == 0) {
+        return;
+    }
+
+    now = rx_link_now_msec();
+    for (slot = 0; slot < RX_IFINDEX_MAP_SIZE; slot++) {
+        if ((rx_link_state[slot] != RX_LINK_HELD) ||
+            (rx_link_due[slot] > now)) {
+            continue;
+        }
+        rx_link_set_state(slot, RX_LINK_UP);
+
+        idp = __atomic_load_n(&rx_ifindex_map[slot].idp, __ATOMIC_ACQUIRE);
+        if ((idp == NULL) || !lacpd_iface_cfg_get(idp->index, &cfg)) {
+            continue;
+        }
+
+        if ((cfg.link_seqno == rx_link_seqno[slot]) &&
+            (cfg.link_state == INTERFACE_LINK_STATE_UP)) {
+            __atomic_store_n(&rx_link_n_up, rx_link_n_up + 1,
+                             __ATOMIC_RELAXED);
+            VLOG_DBG("Netlink: interface %s link is back", cfg.name);
+            mlacp_rx_netlink_post(idp, true, cfg.link_speed);
+        } else {
+            __atomic_store_n(&rx_link_n_left, rx_link_n_left + 1,
+                             __ATOMIC_RELAXED);
+            VLOG_DBG("Netlink: interface %s link is back, OVSDB saw the "
+                     "flap", cfg.name);
+        }
+    }
+} /* mlacp_rx_netlink_run */
+
+/* epoll_wait() timeout until the next hold-off ends, -1 if none. */
+static int
+mlacp_rx_netlink_timeout(void)
+{
+    unsigned long long now;
+    unsigned long long due = ULLONG_MAX;
+    int slot;
+
+    if (rx_link_n_held == 0) {
+        return -1;
+    }
+
+    for (slot = 0; slot < RX_IFINDEX_MAP_SIZE; slot++) {
+        if (rx_link_state[slot] == RX_LINK_HELD) {
+            due = MIN(due, rx_link_due[slot]);
+        }
+    }
+
+    now = rx_link_now_msec();
+    return (due > now) ? (int)(due - now) : 0;
+} /* mlacp_rx_netlink_timeout */
+
+/* Reads all pending link notifications. */
+static void
+mlacp_rx_netlink_drain(void)
+{
+    char buf[RX_NETLINK_BUF_SIZE] __attribute__ ((aligned(NLMSG_ALIGNTO)));
+
+    for (;;) {
+        int len;
+        struct nlmsghdr *nlh;
+
+        len = recv(rx_netlink_fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(1, 5);
+
+                /* ENOBUFS: notifications were lost.  OVSDB still
+                 * reports the link changes, only later. */
+                __atomic_store_n(&rx_link_n_errors, rx_link_n_errors + 1,
+                                 __ATOMIC_RELAXED);
+                VLOG_WARN_RL(&rl, "Netlink link listener read failed: %s",
+                             strerror(errno));
+            }
+            break;
+        }
+
+        for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            const struct ifinfomsg *ifi;
+
+            if (((nlh->nlmsg_type != RTM_NEWLINK) &&
+                 (nlh->nlmsg_type != RTM_DELLINK)) ||
+                (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)))) {
+                continue;
+            }
+
+            ifi = NLMSG_DATA(nlh);
+            __atomic_store_n(&rx_link_n_msgs, rx_link_n_msgs + 1,
+                             __ATOMIC_RELAXED);
+            mlacp_rx_netlink_link(ifi->ifi_index,
+                                  (nlh->nlmsg_type == RTM_NEWLINK) &&
+                                  (ifi->ifi_flags & IFF_RUNNING));
+        }
+    }
+} /* mlacp_rx_netlink_drain */
+#endif /* LACPD_NETLINK_LINK */
+
 void *
 mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
 {
+    int ii;
+    struct mmsghdr msgs[LACPD_RX_BATCH_SIZE];
+    struct iovec iovs[LACPD_RX_BATCH_SIZE];
+    char bufs[LACPD_RX_BATCH_SIZE][LACP_PKT_SIZE];
+
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
 
@@ -170,13 +999,42 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
         return NULL;
     }
 
+    mlacp_rx_timer_init();
+
+#ifdef LACPD_RX_TPACKET
+    mlacp_rx_ring_register();
+#endif
+
+#ifdef LACPD_NETLINK_LINK
+    mlacp_rx_netlink_init();
+#endif
+
+    /* LACPDU size hard-coded to 124 max.
+     * See MLt_drivers_mlacp__rxPdu in mlacp_recv.h
+     */
+    memset(msgs, 0, sizeof(msgs));
+    for (ii = 0; ii < LACPD_RX_BATCH_SIZE; ii++) {
+        iovs[ii].iov_base = bufs[ii];
+        iovs[ii].iov_len = LACP_PKT_SIZE;
+        msgs[ii].msg_hdr.msg_iov = &iovs[ii];
+        msgs[ii].msg_hdr.msg_iovlen = 1;
+    }
+
     for (;;) {
         int n;
         int nfds;
         struct epoll_event events[MAX_EVENTS];
 
+#ifdef LACPD_NETLINK_LINK
+        /* Wait for events on epfd, or for the next link up hold-off
+         * to end. */
+        nfds = epoll_wait(epfd, events, MAX_EVENTS,
+                          mlacp_rx_netlink_timeout());
+        mlacp_rx_netlink_run();
+#else
         /* Wait infinite time (-1) for events on epfd */
         nfds = epoll_wait(epfd, events, MAX_EVENTS, -1);
+#endif
 
         if (nfds < 0) {
             VLOG_ERR("epoll_wait returned error %s", strerror(errno));
@@ -187,13 +1045,32 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
 
         for (n = 0; n < nfds; n++) {
             int count;
-            int clientlen;
-            struct sockaddr_ll clientaddr;
-            ML_event *event;
-            int total_msg_size;
-            struct MLt_drivers_mlacp__rxPdu *pkt_event;
+            int num_pkts = 0;
+            struct rx_pkt pkts[LACPD_RX_BATCH_SIZE];
             struct iface_data *idp = NULL;
 
+            if ((events[n].data.ptr >= (void *)&rx_timer_tags[0]) &&
+                (events[n].data.ptr <
+                 (void *)&rx_timer_tags[LACPD_PROTOCOL_WORKERS])) {
+                mlacp_rx_timer_expiry((const int *)events[n].data.ptr -
+                                      rx_timer_tags);
+                continue;
+            }
+
+#ifdef LACPD_RX_TPACKET
+            if (events[n].data.ptr == (void *)&rx_ring) {
+                mlacp_rx_ring_drain();
+                continue;
+            }
+#endif
+
+#ifdef LACPD_NETLINK_LINK
+            if (events[n].data.ptr == (void *)&rx_netlink_fd) {
+                mlacp_rx_netlink_drain();
+                continue;
+            }
+#endif
+
             idp = (struct iface_data *)events[n].data.ptr;
             if (idp == NULL) {
                 VLOG_ERR("Interface data missing for epoll event!");
@@ -208,46 +1085,40 @@ mlacp_rx_pdu_thread(void *data  __attribute__ ((unused)))
                 continue;
             }
 
-            /* LACPDU size hard-coded to 124 max.
-             * See MLt_drivers_mlacp__rxPdu in mlacp_recv.h
-             */
-            total_msg_size = sizeof(ML_event) + sizeof(struct MLt_drivers_mlacp__rxPdu);
-
-            event = xzalloc(total_msg_size);
-            event->sender.peer = ml_rx_pdu_index;
-
-            /* Set up pkt_event pointer to just after the event
-             * structure itself. This must be done here since the
-             * sender's event->msg pointer points sender's memory
-             * space, and will result in fatal errors if we try to
-             * access it in LACP process space.
-             */
-            pkt_event = (struct MLt_drivers_mlacp__rxPdu *)(event+1);
-
-            clientlen = sizeof(clientaddr);
-            count = recvfrom(idp->pdu_sockfd, (void *)pkt_event->data,
-                              LACP_PKT_SIZE, 0,
-                             (struct sockaddr *)&clientaddr,
-                             (unsigned int *)&clientlen);
+            /* Drain whatever is queued on the socket, up to the batch
+             * size, and hand it over as a single event. */
+            count = recvmmsg(idp->pdu_sockfd, msgs, LACPD_RX_BATCH_SIZE,
+                             MSG_DONTWAIT, NULL);
             if (count < 0) {
-                /* General socket error. */
-                VLOG_ERR("Read failed, fd=%d: errno=%d",
-                         idp->pdu_sockfd, errno);
-                free(event);
+                if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+                    /* General socket error. */
+                    VLOG_ERR("Read failed, fd=%d: errno=%d",
+                             idp->pdu_sockfd, errno);
+                }
                 continue;
 
             } else if (!count) {
                 /* Socket is closed.  Get out. */
                 VLOG_ERR("socket=%d closed", idp->pdu_sockfd);
-                free(event);
                 continue;
+            }
+
+            for (ii = 0; ii < count; ii++) {
+                unsigned int len = msgs[ii].msg_len;
 
-            } else if (count <= LACP_PKT_SIZE) {
-                pkt_event->lport_handle = PM_SMPT2HANDLE(0, 0, idp->index,
-                                                         idp->cycl_port_type);
-                pkt_event->pktLen = count;
-                ml_send_event(event);
+                if ((len == 0) || (len > LACP_PKT_SIZE) ||
+                    mlacp_rx_marker_respond(idp, bufs[ii], len)) {
+                    continue;
+                }
+
+                pkts[num_pkts].lport_handle = PM_SMPT2HANDLE(0, 0, idp->index,
+                                                             idp->cycl_port_type);
+                pkts[num_pkts].data = bufs[ii];
+                pkts[num_pkts].len = len;
+                num_pkts++;
             }
+
+            mlacp_rx_send_batch(pkts, num_pkts);
         } /* for nfds */
     } /* for(;;) */
 
@@ -264,6 +1135,9 @@ register_mcast_addr(port_handle_t lport_handle)
     struct iface_data *idp = NULL;
     struct sockaddr_ll addr;
     struct epoll_event event;
+#ifdef RX_IFINDEX_MAP
+    int lock;
+#endif
 
     /* Find the interface data first. */
     port = PM_HANDLE2PORT(lport_handle);
@@ -312,6 +1186,30 @@ register_mcast_addr(port_handle_t lport_handle)
 
     VLOG_DBG("%s: port %s, ifindex=%d\n", __FUNCTION__, idp->name, if_idx);
 
+    idp->ifindex = if_idx;
+    lacp_rx_filter_port(port, if_idx);
+
+#ifdef RX_IFINDEX_MAP
+    lock = lacp_lock();
+    rc = rx_ifindex_set(if_idx, idp);
+    lacp_unlock(lock);
+    if (rc != 0) {
+        VLOG_ERR("RX interface map full, port=%s", idp->name);
+        return;
+    }
+#endif
+
+#ifdef LACPD_RX_TPACKET
+    /* With the shared RX ring there is no per-interface socket; the ring
+     * socket is used for both RX and TX. */
+    if (rx_ring.fd >= 0) {
+        idp->pdu_sockfd = rx_ring.fd;
+        idp->pdu_registered = true;
+        VLOG_DBG("Registered interface %s with RX ring.", idp->name);
+        return;
+    }
+#endif
+
     /* Create raw socket on interface to receive LACPDUs. */
     if ((sockfd = socket(PF_PACKET, SOCK_RAW, 0)) < 0) {
         rc = errno;
@@ -320,8 +1218,7 @@ register_mcast_addr(port_handle_t lport_handle)
         return;
     }
 
-    rc = setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_FILTER,
-                    &lacpd_fprog, sizeof(lacpd_fprog));
+    rc = mlacp_rx_attach_filter(sockfd);
     if (rc < 0) {
         VLOG_ERR("Failed to attach socket filter for %s, rc=%s",
                  idp->name, strerror(rc));
@@ -370,6 +1267,9 @@ deregister_mcast_addr(port_handle_t lport_handle)
     int rc;
     int port;
     struct iface_data *idp = NULL;
+#ifdef RX_IFINDEX_MAP
+    int lock;
+#endif
 
     /* Find the interface data first. */
     port = PM_HANDLE2PORT(lport_handle);
@@ -387,6 +1287,22 @@ deregister_mcast_addr(port_handle_t lport_handle)
         return;
     }
 
+#ifdef RX_IFINDEX_MAP
+    lock = lacp_lock();
+    rx_ifindex_set(idp->ifindex, NULL);
+    lacp_unlock(lock);
+#endif
+
+    lacp_rx_filter_port(port, 0);
+
+#ifdef LACPD_RX_TPACKET
+    if ((rx_ring.fd >= 0) && (idp->pdu_sockfd == rx_ring.fd)) {
+        idp->pdu_sockfd = 0;
+        idp->pdu_registered = false;
+        return;
+    }
+#endif
+
     rc = epoll_ctl(epfd, EPOLL_CTL_DEL, idp->pdu_sockfd, NULL);
     if (rc == 0) {
         VLOG_DBG("Deregistered sockfd %d for interface %s with epoll loop.",
@@ -402,10 +1318,178 @@ deregister_mcast_addr(port_handle_t lport_handle)
 
 } /* deregister_mcast_addr */
 
+/* Writes the Ethernet header of a Slow Protocols frame into the
+ * LACP_HEADROOM_SIZE bytes at data. */
+void
+mlacp_tx_pdu_header(unsigned char *data)
+{
+    /* Set up LACPDU header dest/src MAC addresses. */
+    memcpy(data, lacp_mcast_addr, MAC_ADDR_LENGTH);
+    memcpy(&data[MAC_ADDR_LENGTH], my_mac_addr, MAC_ADDR_LENGTH);
+
+    /* Add Ethernet Type to the header. According to standard
+     * IEEE802.1AX Slow Protocols EtherType is 88-09 hexadecimal*/
+    data[12] = SLOW_PROTOCOLS_ETHERTYPE_PART1;
+    data[13] = SLOW_PROTOCOLS_ETHERTYPE_PART2;
+} /* mlacp_tx_pdu_header */
+
+static unsigned long long
+mlacp_tx_now_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+} /* mlacp_tx_now_usec */
+
+static void
+mlacp_tx_init(void)
+{
+    int worker;
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        tx_batch[worker].fd = socket(PF_PACKET, SOCK_RAW, 0);
+        if (tx_batch[worker].fd < 0) {
+            VLOG_WARN("Failed to open LACPDU TX socket, rc=%s; "
+                      "sending LACPDUs unbatched", strerror(errno));
+        }
+    }
+} /* mlacp_tx_init */
+
+/* Copies a frame into the worker's TX batch, flushing it first if it
+ * is full. */
+static void
+mlacp_tx_enqueue(struct iface_data *idp, unsigned char *data, int length,
+                 port_handle_t lport_handle)
+{
+    struct tx_batch *b = &tx_batch[lacp_worker_self()];
+    struct sockaddr_ll *addr;
+    unsigned int ii;
+
+    if (b->count == LACPD_TX_BATCH_SIZE) {
+        mlacp_tx_flush();
+    }
+
+    if (b->count == 0) {
+        b->first_usec = mlacp_tx_now_usec();
+    }
+
+    ii = b->count++;
+
+    memcpy(b->bufs[ii], data, length);
+    b->iovs[ii].iov_base = b->bufs[ii];
+    b->iovs[ii].iov_len = length;
+
+    addr = &b->addrs[ii];
+    memset(addr, 0, sizeof(*addr));
+    addr->sll_family = AF_PACKET;
+    addr->sll_ifindex = idp->ifindex;
+    addr->sll_protocol = htons(ETH_P_SLOW);
+    addr->sll_halen = MAC_ADDR_LENGTH;
+    memcpy(addr->sll_addr, lacp_mcast_addr, MAC_ADDR_LENGTH);
+
+    memset(&b->msgs[ii], 0, sizeof(b->msgs[ii]));
+    b->msgs[ii].msg_hdr.msg_name = addr;
+    b->msgs[ii].msg_hdr.msg_namelen = sizeof(*addr);
+    b->msgs[ii].msg_hdr.msg_iov = &b->iovs[ii];
+    b->msgs[ii].msg_hdr.msg_iovlen = 1;
+
+    b->lports[ii] = lport_handle;
+} /* mlacp_tx_enqueue */
+
+/* Counts a LACPDU or Marker response in its port's statistics once it
+ * is known whether it was sent.  Protocol threads only; port table
+ * slots are never freed. */
+static void
+mlacp_tx_count(port_handle_t lport_handle, const unsigned char *frame,
+               bool sent)
+{
+    lacp_per_port_variables_t *plpinfo;
+    int port = PM_HANDLE2PORT(lport_handle);
+
+    if ((port < 0) || (port >= LACP_MAX_PORTS)) {
+        return;
+    }
+    plpinfo = &lacp_ports[port];
+
+    if (!sent) {
+        __atomic_add_fetch(&plpinfo->stats.pdus_tx_failed, 1,
+                           __ATOMIC_RELAXED);
+    } else if (((const lacpdu_payload_t *)frame)->subtype == LACP_SUBTYPE) {
+        LACP_STAT_INC(plpinfo, lacp_pdus_sent);
+    } else {
+        /* The RX thread counts the Marker responses it sends itself. */
+        __atomic_add_fetch(&plpinfo->stats.marker_response_pdus_sent, 1,
+                           __ATOMIC_RELAXED);
+    }
+} /* mlacp_tx_count */
+
+/* Sends every frame in the worker's TX batch.  Called by each protocol
+ * thread once it is done with an event. */
+void
+mlacp_tx_flush(void)
+{
+    struct tx_batch *b = &tx_batch[lacp_worker_self()];
+    unsigned int sent = 0;
+    unsigned int ii;
+    unsigned long syscalls = 0;
+    unsigned long errors = 0;
+    unsigned long long latency;
+    int rc;
+
+    if (b->count == 0) {
+        return;
+    }
+
+    while (sent < b->count) {
+        rc = sendmmsg(b->fd, &b->msgs[sent], b->count - sent, 0);
+        syscalls++;
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* The first unsent frame failed; skip it and carry on. */
+            VLOG_ERR("Failed to send LACPDU for lport=0x%llx, rc=%d",
+                     b->lports[sent], errno);
+            mlacp_tx_count(b->lports[sent], b->bufs[sent], false);
+            errors++;
+            sent++;
+        } else {
+            for (ii = sent; ii < sent + rc; ii++) {
+                mlacp_tx_count(b->lports[ii], b->bufs[ii], true);
+            }
+            sent += rc;
+        }
+    }
+
+    latency = mlacp_tx_now_usec() - b->first_usec;
+
+    __atomic_store_n(&b->n_flushes, b->n_flushes + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->n_frames, b->n_frames + b->count, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->n_syscalls, b->n_syscalls + syscalls,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&b->n_errors, b->n_errors + errors, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->latency_usec_total,
+                     b->latency_usec_total + latency, __ATOMIC_RELAXED);
+    if (b->count > b->max_batch) {
+        __atomic_store_n(&b->max_batch, b->count, __ATOMIC_RELAXED);
+    }
+    if (latency > b->latency_usec_max) {
+        __atomic_store_n(&b->latency_usec_max, latency, __ATOMIC_RELAXED);
+    }
+
+    b->count = 0;
+} /* mlacp_tx_flush */
+
+/* Sends a frame whose header was set up by mlacp_tx_pdu_header().  With
+ * the TX socket open the frame is only queued; it goes out on the next
+ * mlacp_tx_flush().  The frame is counted in the port's statistics,
+ * as sent or as failed, once it is known which. */
 int
 mlacp_tx_pdu(unsigned char* data, int length, port_handle_t lport_handle)
 {
-    int rc;
+    ssize_t rc;
     int port;
     struct iface_data *idp = NULL;
 
@@ -416,48 +1500,53 @@ mlacp_tx_pdu(unsigned char* data, int length, port_handle_t lport_handle)
     if (idp == NULL) {
         VLOG_ERR("Failed to find interface data for LACPDU TX! "
                  "lport=0x%llx", lport_handle);
+        mlacp_tx_count(lport_handle, data, false);
         return 1;
     }
 
     if (idp->pdu_registered != true) {
         VLOG_ERR("Trying to send LACPDU before registering, "
                  "port=%s", idp->name);
+        mlacp_tx_count(lport_handle, data, false);
         return 1;
     }
 
     VLOG_DBG("%s: lport 0x%llx, port=%s, data=%p, len=%d",
              __FUNCTION__, lport_handle, idp->name, data, length);
 
-    /* Set up LACPDU header dest/src MAC addresses. */
-    memcpy(data, lacp_mcast_addr, MAC_ADDR_LENGTH);
-    memcpy(&data[MAC_ADDR_LENGTH], my_mac_addr, MAC_ADDR_LENGTH);
-
-    /* Add Ethernet Type to the header. According to standard
-     * IEEE802.1AX Slow Protocols EtherType is 88-09 hexadecimal*/
-    data[12] = SLOW_PROTOCOLS_ETHERTYPE_PART1;
-    data[13] = SLOW_PROTOCOLS_ETHERTYPE_PART2;
+    if ((tx_batch[lacp_worker_self()].fd >= 0) &&
+        (length <= LACP_PKT_SIZE)) {
+        mlacp_tx_enqueue(idp, data, length, lport_handle);
+        return 0;
+    }
 
-    rc = sendto(idp->pdu_sockfd, data, length, 0, NULL, 0);
+    rc = mlacp_tx_pdu_direct(idp, data, length, 0);
     if (rc == -1) {
         VLOG_ERR("Failed to send LACPDU for interface=%s, rc=%d",
                  idp->name, errno);
+        mlacp_tx_count(lport_handle, data, false);
         return 1;
     }
 
+    mlacp_tx_count(lport_handle, data, true);
     return 0;
 } /* mlacp_tx_pdu */
 
 /************************************************************************
  * LACP Protocol Thread
  ************************************************************************/
+/* arg is the protocol worker number, cast to a pointer. */
 void *
-lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
+lacpd_protocol_thread(void *arg)
 {
     ML_event *pevent;
+    unsigned long long start_ns;
 
     /* Detach thread to avoid memory leak upon exit. */
     pthread_detach(pthread_self());
 
+    lacp_worker_start((int)(intptr_t)arg);
+
     VLOG_DBG("%s : waiting for events in the main loop", __FUNCTION__);
 
     /*******************************************************************
@@ -476,6 +1565,10 @@ lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
             continue;
         }
 
+        start_ns = ml_event_clock_ns();
+
+        db_writeback_pass_begin();
+
         if (pevent->sender.peer == ml_lport_index) {
             /***********************************************************
              * Msg from OVSDB interface for lports.
@@ -511,6 +1604,19 @@ lacpd_protocol_thread(void *arg  __attribute__ ((unused)))
                      __FUNCTION__, pevent->msgnum, pevent->sender.peer);
         }
 
+        /* Send out whatever this event made the state machines transmit. */
+        mlacp_tx_flush();
+
+        /* Queue its OVSDB changes, hw_bond_config included, as one. */
+        db_writeback_pass_end();
+
+        /* Save the protocol state for the next lacpd, if it is time. */
+        lacp_checkpoint_run();
+
+        /* Publish the port state for show commands, if it is time. */
+        lacp_export_run();
+
+        ml_event_account(pevent, start_ns);
         ml_event_free(pevent);
 
     } /* while loop */
@@ -541,8 +1647,29 @@ mlacp_init(u_long  first_time)
     /* Initialize super ports. */
     mvlan_sport_init(first_time);
 
-    /* Initialize LACP data structures. */
-    LACP_AVL_INIT_TREE(lacp_per_port_vars_tree, lacp_compare_port_handle);
+    /* Initialize LACP protocol timers. */
+    if (lacp_timer_init()) {
+        VLOG_ERR("Failed to initialize LACP timers.");
+        status = -1;
+        goto end;
+    }
+
+    /* Open the LACPDU TX socket. */
+    mlacp_tx_init();
+
+    /* Load the in-kernel LACPDU filter, before any RX socket opens. */
+    lacp_rx_filter_init();
+
+#ifdef LACPD_RX_TPACKET
+    /* Open the shared RX ring, before any interface registers. */
+    mlacp_rx_ring_init();
+#endif
+
+    /* Load the previous lacpd's state, before OVSDB configures ports. */
+    lacp_checkpoint_init(LACPD_CHECKPOINT_FILE);
+
+    /* Create the state export, before the protocol threads start. */
+    lacp_export_init(LACPD_EXPORT_FILE);
 
     /* Initialize LACP main task event receiver queue. */
     if (ml_init_event_rcvr()) {
@@ -40,6 +40,7 @@
 #include "lacp_support.h"
 #include "lacp_ops_if.h"
 #include "mvlan_sport.h"
+#include "lacp_worker.h"
 
 VLOG_DEFINE_THIS_MODULE(mlacp_recv);
 
@@ -62,10 +63,38 @@ VLOG_DEFINE_THIS_MODULE(mlacp_recv);
 void
 mlacp_process_rx_pdu(struct ML_event *pevent)
 {
-    struct MLt_drivers_mlacp__rxPdu *pRxPduMsg = pevent->msg;
-    unsigned char *data = (unsigned char *)pRxPduMsg->data;
+    struct MLt_drivers_mlacp__rxPdu *pRxPduMsg;
+    struct MLt_drivers_mlacp__rxPduBatch *pBatchMsg;
 
-    LACP_process_input_pkt(pRxPduMsg->lport_handle, data, pRxPduMsg->pktLen);
+    switch (pevent->msgnum) {
+        case MLm_drivers_mlacp__rxPdu:
+        {
+            pRxPduMsg = pevent->msg;
+            if (!lacp_worker_owns(PM_HANDLE2PORT(pRxPduMsg->lport_handle))) {
+                lacp_worker_count_misrouted();
+                break;
+            }
+            LACP_process_input_pkt(pRxPduMsg->lport_handle,
+                                   (unsigned char *)pRxPduMsg->data,
+                                   pRxPduMsg->pktLen);
+        }
+        break;
+
+        case MLm_drivers_mlacp__rxPduBatch:
+        {
+            pBatchMsg = pevent->msg;
+            lacp_latency_rx_begin(pBatchMsg->rx_usec);
+            LACP_process_input_batch(pBatchMsg->pdus, pBatchMsg->count);
+            lacp_latency_rx_end();
+        }
+        break;
+
+        default:
+        {
+            VLOG_ERR("%s : Unknown req (%d)", __FUNCTION__, pevent->msgnum);
+        }
+        break;
+    }
 
 } // mlacp_process_rx_pdu
 
@@ -77,8 +106,7 @@ mlacp_process_timer(void)
 {
     RENTRY();
 
-    LACP_periodic_tx();
-    LACP_current_while_expiry();
+    lacp_timer_run();
 
     REXIT();
 
@@ -93,6 +121,11 @@ mlacp_process_vlan_msg(ML_event *pevent)
 {
     RENTRY();
 
+    if (lacp_worker_redirect(pevent)) {
+        REXIT();
+        return;
+    }
+
     //***************************************************************
     // The card is known to be up & running when VLAN mgr gives us
     // any LACP related message.
@@ -133,8 +166,10 @@ mlacp_process_vlan_msg(ML_event *pevent)
             // This is just a notification that something changed.
             // If partner SYSPRI or partner SYSID fields changed,
             // it will become UNSELECTED and trigger FSM state change.
+            // Sent by another protocol worker, which already applied
+            // the change (see mlacpVapiSportParamsChange()).
             struct  MLt_vpm_api__lacp_sport_params *pmsg = pevent->msg;
-            mlacpVapiSportParamsChange(pevent->msgnum, pmsg);
+            mlacpVapiSportParamsNotify(pmsg);
         }
         break;
 
@@ -168,8 +203,15 @@ mlacp_process_vlan_msg(ML_event *pevent)
 void
 mlacp_process_api_msg(ML_event *pevent)
 {
+    int lock;
+
     RENTRY();
 
+    if (lacp_worker_redirect(pevent)) {
+        REXIT();
+        return;
+    }
+
     switch (pevent->msgnum) {
 
         case MLm_lacp_api__setActorSysPriority:
@@ -221,7 +263,9 @@ mlacp_process_api_msg(ML_event *pevent)
             super_port_t *psport;
             int status;
 
+            lock = lacp_lock();
             status = mvlan_sport_create(pMsg, &psport);
+            lacp_unlock(lock);
 
             RDEBUG(DL_LACP_RCV, "Create LAG.  handle=0x%llx\n", pMsg->handle);
 
@@ -237,11 +281,13 @@ mlacp_process_api_msg(ML_event *pevent)
             super_port_t *psport;
             int status = R_SUCCESS;
 
+            lock = lacp_lock();
             status = mvlan_get_sport(pMsg->handle, &psport,
                                      MLm_vpm_api__get_sport);
             if (R_SUCCESS == status) {
 
                 status = mvlan_destroy_sport(psport);
+                lacp_unlock(lock);
 
                 RDEBUG(DL_LACP_RCV, "Delete LAG.  handle=0x%llx\n", pMsg->handle);
 
@@ -249,6 +295,7 @@ mlacp_process_api_msg(ML_event *pevent)
                     VLOG_ERR("Failed to delete LAG sport, status=%d", status);
                 }
             } else {
+                lacp_unlock(lock);
                 VLOG_ERR("Failed to find sport on delete, handle=0x%llx.",
                          pMsg->handle);
             }
@@ -266,7 +313,9 @@ mlacp_process_api_msg(ML_event *pevent)
                    "Set" : "Unset",
                    pMsg->sport_handle);
 
+            lock = lacp_lock();
             status = mvlan_api_modify_sport_params(pMsg, pevent->msgnum);
+            lacp_unlock(lock);
 
             if (status != R_SUCCESS) {
                 VLOG_ERR("Failed to set/unset LAG Sport parms, status=%d", status);
@@ -274,6 +323,12 @@ mlacp_process_api_msg(ML_event *pevent)
         }
         break;
 
+        case MLm_vpm_api__config_batch:
+        {
+            mlacp_process_config_batch(pevent);
+        }
+        break;
+
         default:
         {
             VLOG_ERR("%s : Unknown req (%d)", __FUNCTION__, pevent->msgnum);
@@ -285,6 +340,45 @@ mlacp_process_api_msg(ML_event *pevent)
 
 } // mlacp_process_api_msg
 
+//*****************************************************************
+// Function : mlacp_process_config_batch
+// Applies the configuration messages of a batch in order, as if each
+// had been an event of its own.  Aggregator changes are collected and
+// their ports unselected once, at the end.
+//*****************************************************************
+void
+mlacp_process_config_batch(struct ML_event *pevent)
+{
+    struct MLt_vpm_api__config_batch *pBatchMsg = pevent->msg;
+    struct MLt_vpm_api__config_item *pItem;
+    ML_event item_event;
+    int ii;
+
+    RENTRY();
+
+    mlacpVapiSportParamsHold();
+
+    for (ii = 0; ii < pBatchMsg->count; ii++) {
+        pItem = &pBatchMsg->items[ii];
+
+        memset(&item_event, 0, sizeof(item_event));
+        item_event.sender.peer = pItem->peer;
+        item_event.msgnum = pItem->msgnum;
+        item_event.msg = &pItem->u;
+
+        if (pItem->peer == ml_lport_index) {
+            mlacp_process_vlan_msg(&item_event);
+        } else if (pItem->msgnum != MLm_vpm_api__config_batch) {
+            mlacp_process_api_msg(&item_event);
+        }
+    }
+
+    mlacpVapiSportParamsRelease();
+
+    REXIT();
+
+} // mlacp_process_config_batch
+
 //*****************************************************************
 // Function : mlacpVapiLportEvent
 //*****************************************************************
@@ -292,6 +386,18 @@ void
 mlacpVapiLportEvent(struct ML_event *pevent)
 {
     struct MLt_vpm_api__lport_lacp_change *placp_msg = pevent->msg;
+    struct lacpd_iface_cfg cfg;
+
+    //***************************************************************
+    // Link state changes are queued ahead of configuration messages
+    // (see mlacp_event.c), so the link state in the message may be
+    // stale, and a link change meant for this port may have been
+    // handled before LACP was enabled on it.  Use the latest one.
+    //***************************************************************
+    if (lacpd_iface_cfg_get(PM_HANDLE2PORT(placp_msg->lport_handle), &cfg)) {
+        placp_msg->link_state = cfg.link_state;
+        placp_msg->link_speed = cfg.link_speed;
+    }
 
     //***************************************************************
     // Assuming that every time we get called with the whole set of
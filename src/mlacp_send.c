@@ -52,6 +52,7 @@ mlacp_blocking_send_select_aggregator(LAG_t *const lag,
 {
     struct MLt_vpm_api__lacp_match_params match_params = {0};
     int status = R_SUCCESS;
+    int lock;
 
     match_params.lport_handle   = lacp_port->lport_handle;
 
@@ -105,7 +106,9 @@ mlacp_blocking_send_select_aggregator(LAG_t *const lag,
 
     // OpenSwitch: Change to direct function call.  Also sport_handle
     //        is written directly into match_params struct.
+    lock = lacp_lock();
     status = mvlan_api_select_aggregator(&match_params);
+    lacp_unlock(lock);
 
     if (R_SUCCESS == status) {
         lacp_port->sport_handle = match_params.sport_handle;
@@ -132,6 +135,7 @@ mlacp_blocking_send_attach_aggregator(lacp_per_port_variables_t *lacp_port)
 {
     struct MLt_vpm_api__lacp_attach attach = {0};
     int status = R_SUCCESS;
+    int lock;
 
     attach.lport_handle      = lacp_port->lport_handle;
     attach.sport_handle      = lacp_port->sport_handle;
@@ -142,7 +146,9 @@ mlacp_blocking_send_attach_aggregator(lacp_per_port_variables_t *lacp_port)
            sizeof(macaddr_3_t));
 
     // OpenSwitch: Change to direct function call.
+    lock = lacp_lock();
     status = mvlan_api_attach_lport_to_aggregator(&attach);
+    lacp_unlock(lock);
 
     if (R_SUCCESS == status) {
         if (lacp_port->debug_level & DBG_LACP_SEND) {
@@ -167,12 +173,15 @@ mlacp_blocking_send_detach_aggregator(lacp_per_port_variables_t *lacp_port)
 {
     struct MLt_vpm_api__lacp_attach detach = {0};
     int status = R_SUCCESS;
+    int lock;
 
     detach.lport_handle   = lacp_port->lport_handle;
     detach.sport_handle   = lacp_port->sport_handle;
 
     // OpenSwitch: Change to direct function call.
+    lock = lacp_lock();
     status = mvlan_api_detach_lport_from_aggregator(&detach);
+    lacp_unlock(lock);
 
     if (R_SUCCESS == status) {
         if (lacp_port->debug_level & DBG_LACP_SEND) {
@@ -286,8 +295,11 @@ int
 mlacp_blocking_send_clear_aggregator(unsigned long long sport_handle)
 {
     int status = R_SUCCESS;
+    int lock;
 
+    lock = lacp_lock();
     status = mvlan_api_clear_sport_params(sport_handle);
+    lacp_unlock(lock);
 
     if (status != R_SUCCESS) {
         VLOG_ERR("Failed to clear sport params for 0x%llx",
@@ -22,11 +22,273 @@
  *
  */
 
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <sched.h>
+#include <time.h>
 
 #include "mqueue.h"
 
+/*
+ * Ring mode.
+ *
+ * Bounded multi-producer queue based on per-cell sequence numbers.  A
+ * producer owns cell (pos & mask) when its c_seq equals pos; it stores
+ * the data and publishes by setting c_seq to pos + 1.  The consumer owns
+ * the cell when c_seq equals pos + 1 and hands it back to producers of
+ * the next lap by setting c_seq to pos + capacity.  The same ring type
+ * holds both pending messages and the free list of preallocated slots,
+ * so a send/wait cycle performs no heap allocation.
+ *
+ * Pending messages may be split over several priority lanes, one ring
+ * each, with one semaphore counting the messages in all of them.  The
+ * receiver takes from the highest priority lane that has a message.
+ * Each lane counts how many messages in a row were taken from other
+ * lanes while it had one, and once that reaches starve_limit the lane
+ * is served next, so no lane waits more than about starve_limit
+ * messages per lane above it.
+ */
+static int
+ring_init(mqueue_ring_t *ring, unsigned int capacity)
+{
+    unsigned int ii;
+    void *cells;
+
+    if (posix_memalign(&cells, MQUEUE_CACHE_LINE,
+                       capacity * sizeof(mqueue_cell_t)) != 0) {
+        return ENOMEM;
+    }
+
+    ring->r_cells = cells;
+    ring->r_mask = capacity - 1;
+    ring->r_head = 0;
+    ring->r_tail = 0;
+
+    for (ii = 0; ii < capacity; ii++) {
+        ring->r_cells[ii].c_seq = ii;
+        ring->r_cells[ii].c_data = NULL;
+        ring->r_cells[ii].c_stamp = 0;
+    }
+
+    return 0;
+
+} // ring_init
+
+static int
+ring_push(mqueue_ring_t *ring, void *data, unsigned long long stamp)
+{
+    mqueue_cell_t *cell;
+    unsigned long pos;
+    unsigned long seq;
+    long diff;
+
+    pos = __atomic_load_n(&ring->r_head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        cell = &ring->r_cells[pos & ring->r_mask];
+        seq = __atomic_load_n(&cell->c_seq, __ATOMIC_ACQUIRE);
+        diff = (long)seq - (long)pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->r_head, &pos, pos + 1,
+                                            1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full.
+            return 0;
+        } else {
+            pos = __atomic_load_n(&ring->r_head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->c_data = data;
+    cell->c_stamp = stamp;
+    __atomic_store_n(&cell->c_seq, pos + 1, __ATOMIC_RELEASE);
+
+    return 1;
+
+} // ring_push
+
+static int
+ring_pop(mqueue_ring_t *ring, void **data, unsigned long long *stamp)
+{
+    mqueue_cell_t *cell;
+    unsigned long pos;
+    unsigned long seq;
+    long diff;
+
+    pos = __atomic_load_n(&ring->r_tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        cell = &ring->r_cells[pos & ring->r_mask];
+        seq = __atomic_load_n(&cell->c_seq, __ATOMIC_ACQUIRE);
+        diff = (long)seq - (long)(pos + 1);
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->r_tail, &pos, pos + 1,
+                                            1, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Empty, or the producer that owns this cell has not
+            // published it yet.
+            return 0;
+        } else {
+            pos = __atomic_load_n(&ring->r_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    *data = cell->c_data;
+    if (stamp) {
+        *stamp = cell->c_stamp;
+    }
+    __atomic_store_n(&cell->c_seq, pos + ring->r_mask + 1, __ATOMIC_RELEASE);
+
+    return 1;
+
+} // ring_pop
+
+static unsigned long long
+mqueue_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+} // mqueue_now_ns
+
+static unsigned int
+ring_depth(mqueue_ring_t *ring)
+{
+    unsigned long head;
+    unsigned long tail;
+
+    // Read without synchronizing with the producers or the consumer, so
+    // the result is only a snapshot.
+    tail = __atomic_load_n(&(ring->r_tail), __ATOMIC_RELAXED);
+    head = __atomic_load_n(&(ring->r_head), __ATOMIC_RELAXED);
+
+    return (head > tail) ? (unsigned int)(head - tail) : 0;
+
+} // ring_depth
+
+static unsigned int
+lane_depth(mqueue_t *queue, mqueue_lane_t *lane)
+{
+    int value;
+
+    if (queue->q_capacity) {
+        return ring_depth(&(lane->l_ring));
+    }
+
+    if (sem_getvalue(&(queue->q_avail), &value) != 0 || value < 0) {
+        return 0;
+    }
+
+    return value;
+
+} // lane_depth
+
+// Raises *max to value.  There may be several producers.
+static void
+mqueue_stat_max(unsigned int *max, unsigned int value)
+{
+    unsigned int cur = __atomic_load_n(max, __ATOMIC_RELAXED);
+
+    while ((value > cur) &&
+           !__atomic_compare_exchange_n(max, &cur, value, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        continue;
+    }
+
+} // mqueue_stat_max
+
+// Sender side accounting, after the message was queued.
+static void
+mqueue_sent(mqueue_t *queue, mqueue_lane_t *lane)
+{
+    __atomic_add_fetch(&lane->l_sent, 1, __ATOMIC_RELAXED);
+    mqueue_stat_max(&lane->l_depth_max, lane_depth(queue, lane));
+
+} // mqueue_sent
+
+// Receiver side accounting.  A queue has one receiver.
+static void
+mqueue_received(mqueue_lane_t *lane, unsigned long long stamp)
+{
+    unsigned long long dwell = mqueue_now_ns() - stamp;
+
+    __atomic_store_n(&lane->l_received, lane->l_received + 1,
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&lane->l_dwell_total_ns,
+                     lane->l_dwell_total_ns + dwell, __ATOMIC_RELAXED);
+    if (dwell > lane->l_dwell_max_ns) {
+        __atomic_store_n(&lane->l_dwell_max_ns, dwell, __ATOMIC_RELAXED);
+    }
+
+} // mqueue_received
+
+// Picks the lane to receive from: the highest priority lane with
+// messages, or the first lower one that has been skipped starve_limit
+// times.  Returns -1 if every lane looks empty.
+static int
+mqueue_pick_lane(mqueue_t *queue)
+{
+    mqueue_lane_t *lane;
+    unsigned int ii;
+    int best = -1;
+
+    for (ii = 0; ii < queue->q_n_lanes; ii++) {
+        lane = &(queue->q_lanes[ii]);
+
+        if (ring_depth(&(lane->l_ring)) == 0) {
+            continue;
+        }
+        if (best < 0) {
+            best = ii;
+        } else if (lane->l_skipped >= queue->q_starve_limit) {
+            return ii;
+        }
+    }
+
+    return best;
+
+} // mqueue_pick_lane
+
+// After receiving from lane picked: every other lane that still has
+// messages was skipped once more.
+static void
+mqueue_skip_lanes(mqueue_t *queue, unsigned int picked)
+{
+    mqueue_lane_t *lane;
+    bool promoted = false;
+    unsigned int ii;
+
+    for (ii = 0; ii < queue->q_n_lanes; ii++) {
+        lane = &(queue->q_lanes[ii]);
+
+        if ((ii == picked) || (ring_depth(&(lane->l_ring)) == 0)) {
+            lane->l_skipped = 0;
+        } else {
+            lane->l_skipped++;
+            promoted |= (ii < picked);
+        }
+    }
+
+    if (promoted) {
+        __atomic_add_fetch(&(queue->q_lanes[picked].l_promoted), 1,
+                           __ATOMIC_RELAXED);
+    }
+
+} // mqueue_skip_lanes
+
 int
 mqueue_init(mqueue_t *queue)
 {
@@ -39,6 +301,14 @@ mqueue_init(mqueue_t *queue)
     queue->q_tail.q_back = &(queue->q_head);
     queue->q_tail.q_data = NULL;
 
+    queue->q_capacity = 0;
+    queue->q_slots = NULL;
+    queue->q_slot_size = 0;
+    queue->q_starve_limit = 0;
+    queue->q_slot_misses = 0;
+    queue->q_n_lanes = 1;
+    memset(queue->q_lanes, 0, sizeof(queue->q_lanes));
+
     /* Initialize semaphore to value zero and PSHARED zero. */
     if (sem_init(&(queue->q_avail), 0, 0) != 0) {
         return errno;
@@ -48,20 +318,118 @@ mqueue_init(mqueue_t *queue)
 
 } // mqueue_init
 
+int
+mqueue_init_ring(mqueue_t *queue, unsigned int capacity, size_t slot_size)
+{
+    return mqueue_init_lanes(queue, 1, capacity, slot_size, 0);
+
+} // mqueue_init_ring
+
+int
+mqueue_init_lanes(mqueue_t *queue, unsigned int n_lanes,
+                  unsigned int capacity, size_t slot_size,
+                  unsigned int starve_limit)
+{
+    unsigned int size = 1;
+    unsigned int ii;
+    void *slots;
+    int rc;
+
+    if ((NULL == queue) || (0 == capacity) || (0 == n_lanes) ||
+        (n_lanes > MQUEUE_MAX_LANES)) {
+        return EINVAL;
+    }
+
+    if ((rc = mqueue_init(queue)) != 0) {
+        return rc;
+    }
+
+    // Ring positions are masked, so round up to a power of two.  Slots
+    // are rounded up to whole cache lines so that two producers never
+    // write to the same line.
+    while (size < capacity) {
+        size <<= 1;
+    }
+    slot_size = (slot_size + MQUEUE_CACHE_LINE - 1) &
+                ~((size_t)MQUEUE_CACHE_LINE - 1);
+
+    if (posix_memalign(&slots, MQUEUE_CACHE_LINE, size * slot_size) != 0) {
+        return ENOMEM;
+    }
+
+    if ((rc = ring_init(&(queue->q_free), size)) != 0) {
+        free(slots);
+        return rc;
+    }
+
+    for (ii = 0; ii < n_lanes; ii++) {
+        if ((rc = ring_init(&(queue->q_lanes[ii].l_ring), size)) != 0) {
+            while (ii-- > 0) {
+                free(queue->q_lanes[ii].l_ring.r_cells);
+            }
+            free(queue->q_free.r_cells);
+            free(slots);
+            return rc;
+        }
+    }
+
+    queue->q_slots = slots;
+    queue->q_slot_size = slot_size;
+
+    for (ii = 0; ii < size; ii++) {
+        ring_push(&(queue->q_free), queue->q_slots + (ii * slot_size), 0);
+    }
+
+    queue->q_n_lanes = n_lanes;
+    queue->q_starve_limit = starve_limit;
+    queue->q_capacity = size;
+
+    return 0;
+
+} // mqueue_init_lanes
+
 int
 mqueue_send(mqueue_t *queue, void* data)
+{
+    return mqueue_send_lane(queue, data, 0);
+
+} // mqueue_send
+
+int
+mqueue_send_lane(mqueue_t *queue, void *data, unsigned int lane)
 {
     qelem_t *new_elem;
+    mqueue_lane_t *l;
 
     if ((NULL == queue) || (NULL == data)) {
         return EINVAL;
     }
 
+    if (lane >= queue->q_n_lanes) {
+        lane = queue->q_n_lanes - 1;
+    }
+    l = &(queue->q_lanes[lane]);
+
+    if (queue->q_capacity) {
+        if (!ring_push(&(l->l_ring), data, mqueue_now_ns())) {
+            __atomic_add_fetch(&l->l_overflow, 1, __ATOMIC_RELAXED);
+            return ENOBUFS;
+        }
+
+        if (sem_post(&(queue->q_avail)) != 0) {
+            return errno;
+        }
+
+        mqueue_sent(queue, l);
+        return 0;
+    }
+
     if ((new_elem = (qelem_t *) malloc(sizeof(qelem_t))) == NULL) {
         return ENOMEM;
     }
 
     new_elem->q_data = data;
+    new_elem->q_stamp = mqueue_now_ns();
 
     pthread_mutex_lock(&(queue->q_mutex));
     insque(new_elem, queue->q_tail.q_back);
@@ -72,21 +440,43 @@ mqueue_send(mqueue_t *queue, void* data)
     }
     pthread_mutex_unlock(&(queue->q_mutex));
 
+    mqueue_sent(queue, l);
     return 0;
 
-} // mqueue_send
+} // mqueue_send_lane
 
 int
 mqueue_wait(mqueue_t *queue, void **data)
 {
     qelem_t *new_elem;
+    unsigned long long stamp;
+    int lane;
 
     if ((NULL == queue) || (NULL == data)) {
         return EINVAL;
     }
 
     // Block until a new event is available.
-    sem_wait(&(queue->q_avail));
+    while ((sem_wait(&(queue->q_avail)) != 0) && (errno == EINTR)) {
+        continue;
+    }
+
+    if (queue->q_capacity) {
+        // The semaphore guarantees a message was pushed, but a producer
+        // that claimed an earlier cell may still be filling it in.
+        for (;;) {
+            lane = mqueue_pick_lane(queue);
+            if ((lane >= 0) &&
+                ring_pop(&(queue->q_lanes[lane].l_ring), data, &stamp)) {
+                break;
+            }
+            sched_yield();
+        }
+
+        mqueue_skip_lanes(queue, lane);
+        mqueue_received(&(queue->q_lanes[lane]), stamp);
+        return 0;
+    }
 
     pthread_mutex_lock(&(queue->q_mutex));
     new_elem = queue->q_head.q_forw;
@@ -94,9 +484,139 @@ mqueue_wait(mqueue_t *queue, void **data)
     pthread_mutex_unlock(&(queue->q_mutex));
 
     *data = new_elem->q_data;
+    mqueue_received(&(queue->q_lanes[0]), new_elem->q_stamp);
 
     free(new_elem);
 
     return 0;
 
 } // mqueue_wait
+
+void *
+mqueue_slot_alloc(mqueue_t *queue, size_t size)
+{
+    void *slot;
+
+    if ((NULL == queue) || (0 == queue->q_capacity) ||
+        (size > queue->q_slot_size)) {
+        return NULL;
+    }
+
+    if (!ring_pop(&(queue->q_free), &slot, NULL)) {
+        __atomic_add_fetch(&queue->q_slot_misses, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    return slot;
+
+} // mqueue_slot_alloc
+
+int
+mqueue_slot_free(mqueue_t *queue, void *slot)
+{
+    char *p = slot;
+
+    if ((NULL == queue) || (0 == queue->q_capacity) ||
+        (p < queue->q_slots) ||
+        (p >= queue->q_slots + (queue->q_capacity * queue->q_slot_size))) {
+        // Not one of ours.
+        return 0;
+    }
+
+    ring_push(&(queue->q_free), slot, 0);
+
+    return 1;
+
+} // mqueue_slot_free
+
+unsigned int
+mqueue_depth(mqueue_t *queue)
+{
+    unsigned int depth = 0;
+    unsigned int ii;
+
+    if (NULL == queue) {
+        return 0;
+    }
+
+    for (ii = 0; ii < queue->q_n_lanes; ii++) {
+        depth += lane_depth(queue, &(queue->q_lanes[ii]));
+    }
+
+    return depth;
+
+} // mqueue_depth
+
+size_t
+mqueue_memory(mqueue_t *queue)
+{
+    size_t bytes = sizeof(*queue);
+
+    if (NULL == queue) {
+        return 0;
+    }
+
+    if (queue->q_capacity) {
+        // The slots, and a ring of cells for the free slots and each
+        // lane.
+        bytes += (size_t)queue->q_capacity * queue->q_slot_size;
+        bytes += (size_t)(queue->q_n_lanes + 1) * queue->q_capacity *
+                 sizeof(mqueue_cell_t);
+    } else {
+        bytes += (size_t)mqueue_depth(queue) * sizeof(qelem_t);
+    }
+
+    return bytes;
+
+} // mqueue_memory
+
+void
+mqueue_get_stats(mqueue_t *queue, mqueue_stats_t *stats)
+{
+    mqueue_lane_stats_t *ls;
+    mqueue_lane_stats_t *t;
+    mqueue_lane_t *lane;
+    unsigned int ii;
+
+    memset(stats, 0, sizeof(*stats));
+
+    if (NULL == queue) {
+        return;
+    }
+
+    t = &(stats->total);
+    stats->slot_misses = __atomic_load_n(&queue->q_slot_misses,
+                                         __ATOMIC_RELAXED);
+    stats->n_lanes = queue->q_n_lanes;
+
+    for (ii = 0; ii < queue->q_n_lanes; ii++) {
+        lane = &(queue->q_lanes[ii]);
+        ls = &(stats->lanes[ii]);
+
+        ls->sent = __atomic_load_n(&lane->l_sent, __ATOMIC_RELAXED);
+        ls->received = __atomic_load_n(&lane->l_received, __ATOMIC_RELAXED);
+        ls->overflow = __atomic_load_n(&lane->l_overflow, __ATOMIC_RELAXED);
+        ls->promoted = __atomic_load_n(&lane->l_promoted, __ATOMIC_RELAXED);
+        ls->depth = lane_depth(queue, lane);
+        ls->depth_max = __atomic_load_n(&lane->l_depth_max,
+                                        __ATOMIC_RELAXED);
+        ls->dwell_total_ns = __atomic_load_n(&lane->l_dwell_total_ns,
+                                             __ATOMIC_RELAXED);
+        ls->dwell_max_ns = __atomic_load_n(&lane->l_dwell_max_ns,
+                                           __ATOMIC_RELAXED);
+
+        t->sent += ls->sent;
+        t->received += ls->received;
+        t->overflow += ls->overflow;
+        t->promoted += ls->promoted;
+        t->depth += ls->depth;
+        if (ls->depth_max > t->depth_max) {
+            t->depth_max = ls->depth_max;
+        }
+        t->dwell_total_ns += ls->dwell_total_ns;
+        if (ls->dwell_max_ns > t->dwell_max_ns) {
+            t->dwell_max_ns = ls->dwell_max_ns;
+        }
+    }
+
+} // mqueue_get_stats
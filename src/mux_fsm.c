@@ -29,129 +29,157 @@
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
 #include "lacp_ops_if.h"
+#include "lacp_rx_filter.h"
 
 VLOG_DEFINE_THIS_MODULE(mux_fsm);
 
+/*****************************************************************************
+ *                 Prototypes for global functions
+ ****************************************************************************/
+void start_wait_while_timer(lacp_per_port_variables_t *);
+int detach_mux_from_aggregator(lacp_per_port_variables_t *);
+int attach_mux_to_aggregator(lacp_per_port_variables_t *);
+
+/*****************************************************************************
+ *                 Prototypes for static functions
+ ****************************************************************************/
+static void detached_state_action(lacp_per_port_variables_t *);
+static void waiting_state_action(lacp_per_port_variables_t *);
+static void attached_state_action(lacp_per_port_variables_t *);
+static void collecting_state_action(lacp_per_port_variables_t *);
+static void collecting_distributing_state_action(lacp_per_port_variables_t *);
+static void disable_collecting_distributing(lacp_per_port_variables_t *);
+static void enable_collecting(lacp_per_port_variables_t *);
+static void enable_distributing(lacp_per_port_variables_t *);
+
+/*****************************************************************************
+ * A table cell names the next state and the action to run.  The action is
+ * normally a number that LACP_mux_fsm() switches on.  Built with
+ * LACPD_FSM_DIRECT_DISPATCH, the cell holds the action routine itself.
+ ****************************************************************************/
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+typedef struct mux_fsm_entry {
+    unsigned int next_state;
+    void (*action)(lacp_per_port_variables_t *);
+} MUX_FSM_ENTRY;
+
+static void mux_no_action(lacp_per_port_variables_t *);
+
+#define NO_ACTION_FN                        mux_no_action
+#define ACTION_DETACHED_FN                  detached_state_action
+#define ACTION_WAITING_FN                   waiting_state_action
+#define ACTION_ATTACHED_FN                  attached_state_action
+#define ACTION_COLLECTING_FN                collecting_state_action
+#define ACTION_COLLECTING_DISTRIBUTING_FN   collecting_distributing_state_action
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION##_FN }
+#else
+typedef FSM_ENTRY MUX_FSM_ENTRY;
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION }
+#endif
+
 /*****************************************************************************
  *   Static Variables
  ****************************************************************************/
 
 /* mux machine fsm table */
-static FSM_ENTRY mux_machine_fsm_table[MUX_FSM_NUM_INPUTS]
-                                      [MUX_FSM_NUM_STATES] =
+static const MUX_FSM_ENTRY mux_machine_fsm_table[MUX_FSM_NUM_INPUTS]
+                                                [MUX_FSM_NUM_STATES] =
 {
 /*****************************************************************************
  * Input Event E1 - selected = SELECTED
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,       NO_ACTION},         // Begin state
-   {MUX_FSM_WAITING_STATE,      ACTION_WAITING},    // detached
-   {MUX_FSM_RETAIN_STATE,       NO_ACTION},         // waiting
-   {MUX_FSM_RETAIN_STATE,       NO_ACTION},         // attached
-   {MUX_FSM_RETAIN_STATE,       NO_ACTION},         // collecting
-   {MUX_FSM_RETAIN_STATE,       NO_ACTION}},        // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,       NO_ACTION),         // Begin state
+   FSM_CELL(MUX_FSM_WAITING_STATE,      ACTION_WAITING),    // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,       NO_ACTION),         // waiting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,       NO_ACTION),         // attached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,       NO_ACTION),         // collecting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,       NO_ACTION)},        // collecting_distributing
 
 /*****************************************************************************
  * Input Event E2 - selected = UNSELECTED
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},          // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // detached
-   {MUX_FSM_DETACHED_STATE,    ACTION_DETACHED},    // waiting
-   {MUX_FSM_DETACHED_STATE,    ACTION_DETACHED},    // attached
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED},    // collecting
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED}},   // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // detached
+   FSM_CELL(MUX_FSM_DETACHED_STATE,    ACTION_DETACHED),    // waiting
+   FSM_CELL(MUX_FSM_DETACHED_STATE,    ACTION_DETACHED),    // attached
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED),    // collecting
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED)},   // collecting_distributing
 
 /*****************************************************************************
  * Input Event E3 - selected = SELECTED and Ready = TRUE
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},          // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // detached
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED},    // waiting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // attached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // collecting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION}},         // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // detached
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED),    // waiting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // attached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // collecting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION)},         // collecting_distributing
 
 /*****************************************************************************
  * Input Event E4 - selected = StandBy
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},          // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // detached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // waiting
-   {MUX_FSM_DETACHED_STATE,    ACTION_DETACHED},    // attached
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED},    // collecting
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED}},   // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // waiting
+   FSM_CELL(MUX_FSM_DETACHED_STATE,    ACTION_DETACHED),    // attached
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED),    // collecting
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED)},   // collecting_distributing
 
 /*****************************************************************************
  * Input Event E5 - selected = SELECTED and partner.sync = True
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},         // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},         // detached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},         // waiting
-   {MUX_FSM_COLLECTING_STATE,  ACTION_COLLECTING}, // attached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},         // collecting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION}},        // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),         // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),         // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),         // waiting
+   FSM_CELL(MUX_FSM_COLLECTING_STATE,  ACTION_COLLECTING), // attached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),         // collecting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION)},        // collecting_distributing
 
 /*****************************************************************************
  * Input Event E6 -  partner.sync = False
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},           // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},           // detached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},           // waiting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},           // attached
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED},     // collecting
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED}},    // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),           // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),           // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),           // waiting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),           // attached
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED),     // collecting
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED)},    // collecting_distributing
 
 /*****************************************************************************
  * Input Event E7 - Begin = True
  *****************************************************************************/
-  {{MUX_FSM_DETACHED_STATE,      ACTION_DETACHED},  // Begin state
-   {MUX_FSM_DETACHED_STATE,      ACTION_DETACHED},  // detached
-   {MUX_FSM_DETACHED_STATE,      ACTION_DETACHED},  // waiting
-   {MUX_FSM_DETACHED_STATE,      ACTION_DETACHED},  // attached
-   {MUX_FSM_DETACHED_STATE,      ACTION_DETACHED},  // collecting
-   {MUX_FSM_DETACHED_STATE,      ACTION_DETACHED}}, // collecting_distributing
+  {FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED),  // Begin state
+   FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED),  // detached
+   FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED),  // waiting
+   FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED),  // attached
+   FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED),  // collecting
+   FSM_CELL(MUX_FSM_DETACHED_STATE,      ACTION_DETACHED)}, // collecting_distributing
 
 /*****************************************************************************
  * Input Event E8 - selected = SELECTED, partner.sync = True and
  *                  partner.collecting = TRUE
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},          // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // detached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // waiting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // attached
-   {MUX_FSM_COLLECTING_DISTRIBUTING_STATE, ACTION_COLLECTING_DISTRIBUTING},  // collecting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION}},         // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // waiting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // attached
+   FSM_CELL(MUX_FSM_COLLECTING_DISTRIBUTING_STATE, ACTION_COLLECTING_DISTRIBUTING),  // collecting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION)},         // collecting_distributing
 
 /*****************************************************************************
  * Input Event E9 - selected = SELECTED, partner.sync = True and
  *                  partner.collecting = FALSE
  *****************************************************************************/
-  {{MUX_FSM_RETAIN_STATE,      NO_ACTION},          // Begin state
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // detached
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // waiting
-   {MUX_FSM_RETAIN_STATE,      NO_ACTION},          // attached
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED},    // collecting
-   {MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED}}    // collecting_distributing
+  {FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // Begin state
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // detached
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // waiting
+   FSM_CELL(MUX_FSM_RETAIN_STATE,      NO_ACTION),          // attached
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED),    // collecting
+   FSM_CELL(MUX_FSM_ATTACHED_STATE,    ACTION_ATTACHED)}    // collecting_distributing
 };
 
-/*****************************************************************************
- *                 Prototypes for global functions
- ****************************************************************************/
-void start_wait_while_timer(lacp_per_port_variables_t *);
-int detach_mux_from_aggregator(lacp_per_port_variables_t *);
-int attach_mux_to_aggregator(lacp_per_port_variables_t *);
-
-/*****************************************************************************
- *                 Prototypes for static functions
- ****************************************************************************/
-static void detached_state_action(lacp_per_port_variables_t *);
-static void waiting_state_action(lacp_per_port_variables_t *);
-static void attached_state_action(lacp_per_port_variables_t *);
-static void collecting_state_action(lacp_per_port_variables_t *);
-static void collecting_distributing_state_action(lacp_per_port_variables_t *);
-static void disable_collecting_distributing(lacp_per_port_variables_t *);
-static void enable_collecting(lacp_per_port_variables_t *);
-static void enable_distributing(lacp_per_port_variables_t *);
-
 /*----------------------------------------------------------------------
  * Function: LACP_mux_fsm(int event, int current_state, int port_number)
  * Synopsis: Entry routine for mux state machine.
@@ -166,6 +194,18 @@ LACP_mux_fsm(int event,
              int current_state,
              lacp_per_port_variables_t *plpinfo)
 {
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+    const MUX_FSM_ENTRY *cell;
+
+    cell = &mux_machine_fsm_table[event][current_state];
+
+    if (cell->next_state != MUX_FSM_RETAIN_STATE) {
+        plpinfo->prev_mux_fsm_state = plpinfo->mux_fsm_state;
+        plpinfo->mux_fsm_state = cell->next_state;
+    }
+
+    cell->action(plpinfo);
+#else
     int action;
     char previous_state_string[STATE_STRING_SIZE];
     char current_state_string[STATE_STRING_SIZE];
@@ -179,7 +219,7 @@ LACP_mux_fsm(int event,
                                 action);
 
     if (current_state != MUX_FSM_RETAIN_STATE) {
-        if (plpinfo->debug_level & DBG_MUX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
 
             //***********************************************************
             // receive_fsm  debug is DBG_RX_FSM
@@ -202,7 +242,7 @@ LACP_mux_fsm(int event,
         plpinfo->mux_fsm_state = current_state;
 
     } else {
-        if (plpinfo->debug_level & DBG_MUX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
             RDBG("%s : retain old state (%d)\n",
                  __FUNCTION__, plpinfo->mux_fsm_state);
         }
@@ -243,24 +283,38 @@ LACP_mux_fsm(int event,
         default:
         break;
     }
+#endif
 
     /* update interface lacp_status data with any changes */
+    lacp_rx_filter_update(plpinfo);
     db_update_interface(plpinfo);
 
     REXIT();
 } // LACP_mux_fsm
 
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+//******************************************************************
+// Function : mux_no_action
+//******************************************************************
+static void
+mux_no_action(lacp_per_port_variables_t *plpinfo)
+{
+} // mux_no_action
+#endif
+
 //******************************************************************
 // Function : detached_state_action
 //******************************************************************
 static void
 detached_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
+    lacp_latency_mux_state(plpinfo, MUX_FSM_DETACHED_STATE);
+
     detach_mux_from_aggregator(plpinfo);
 
     plpinfo->actor_oper_port_state.synchronization = FALSE;
@@ -291,7 +345,7 @@ detached_state_action(lacp_per_port_variables_t *plpinfo)
                      plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // detached_state_action
@@ -304,11 +358,13 @@ waiting_state_action(lacp_per_port_variables_t *plpinfo)
 {
     LAG_t *lag = plpinfo->lag;
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
+    lacp_latency_mux_state(plpinfo, MUX_FSM_WAITING_STATE);
+
     start_wait_while_timer(plpinfo);
 
     if ((plpinfo->lacp_control.selected == UNSELECTED)) {
@@ -325,7 +381,7 @@ waiting_state_action(lacp_per_port_variables_t *plpinfo)
         LACP_mux_fsm(E3, plpinfo->mux_fsm_state, plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // waiting_state_action
@@ -336,11 +392,13 @@ waiting_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 attached_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
+    lacp_latency_mux_state(plpinfo, MUX_FSM_ATTACHED_STATE);
+
     attach_mux_to_aggregator(plpinfo);
 
     plpinfo->actor_oper_port_state.synchronization = TRUE;
@@ -378,7 +436,7 @@ attached_state_action(lacp_per_port_variables_t *plpinfo)
                      plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // attached_state_action
@@ -389,11 +447,13 @@ attached_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 collecting_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
+    lacp_latency_mux_state(plpinfo, MUX_FSM_COLLECTING_STATE);
+
     plpinfo->actor_oper_port_state.distributing = FALSE;
 
     enable_collecting(plpinfo);
@@ -440,7 +500,7 @@ collecting_state_action(lacp_per_port_variables_t *plpinfo)
                      plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // collecting_state_action
@@ -451,11 +511,13 @@ collecting_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 collecting_distributing_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
+    lacp_latency_mux_state(plpinfo, MUX_FSM_COLLECTING_DISTRIBUTING_STATE);
+
     plpinfo->actor_oper_port_state.distributing = TRUE;
 
     enable_distributing(plpinfo);
@@ -495,7 +557,7 @@ collecting_distributing_state_action(lacp_per_port_variables_t *plpinfo)
                      plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // collecting_distributing_state_action
@@ -503,7 +565,8 @@ collecting_distributing_state_action(lacp_per_port_variables_t *plpinfo)
 void
 start_wait_while_timer(lacp_per_port_variables_t *plpinfo)
 {
-    plpinfo->wait_while_timer_expiry_counter = AGGREGATE_WAIT_COUNT;
+    lacp_timer_start(&plpinfo->wait_while_timer,
+                     AGGREGATE_WAIT_COUNT * LACP_TIMER_MSEC_PER_SEC);
 }
 
 //******************************************************************
@@ -515,7 +578,7 @@ disable_collecting_distributing(lacp_per_port_variables_t *plpinfo)
 {
     (void)mlacp_blocking_send_disable_collect_dist(plpinfo);
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -526,7 +589,7 @@ enable_collecting(lacp_per_port_variables_t *plpinfo)
 {
     (void)mlacp_blocking_send_enable_collecting(plpinfo);
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -537,7 +600,7 @@ enable_distributing(lacp_per_port_variables_t *plpinfo)
 {
     (void)mlacp_blocking_send_enable_distributing(plpinfo);
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -554,14 +617,14 @@ attach_mux_to_aggregator(lacp_per_port_variables_t *plpinfo)
 
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
     // YAGqa36972 : Don't send lport_attach during the reverse transition
     if ((plpinfo->prev_mux_fsm_state == MUX_FSM_COLLECTING_STATE) ||
         (plpinfo->prev_mux_fsm_state == MUX_FSM_COLLECTING_DISTRIBUTING_STATE)) {
 
-        if (plpinfo->debug_level & DBG_MUX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
             RDBG("%s : prev_mux_fsm_state is COLLECTING_DISTRIBUTING "
                  "and so returning (lport 0x%llx)\n",
                  __FUNCTION__, plpinfo->lport_handle);
@@ -592,7 +655,7 @@ detach_mux_from_aggregator(lacp_per_port_variables_t *plpinfo)
 
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_MUX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_MUX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
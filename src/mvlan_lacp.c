@@ -25,10 +25,14 @@
 #include <string.h>
 #include <netinet/in.h>
 
+#include <hash.h>
+#include <hmap.h>
+
 #include <mlacp_debug.h>
 #include <lacp_cmn.h>
 #include <pm_cmn.h>
 #include <nlib.h>
+#include "lacp_pool.h"
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
 #include "lacp_ops_if.h"
@@ -46,11 +50,79 @@ typedef enum match_type {
 
 static struct NList *placp_params_list;
 
+// Aggregator indexes over placp_params_list.  The exact index hashes
+// every field an EXACT_MATCH compares; the key index hashes only the
+// actor key, which PARTIAL_MATCH and PRIORITY_MATCH must still honour
+// unless the aggregator has none yet.  Candidates found through either
+// index are still checked with mvlan_match_aggregator().
+static struct hmap aggr_exact_index = HMAP_INITIALIZER(&aggr_exact_index);
+static struct hmap aggr_key_index = HMAP_INITIALIZER(&aggr_key_index);
+static unsigned int aggr_seq;
+
+static struct lacp_pool sport_params_pool =
+    LACP_POOL_INITIALIZER("aggr params", lacp_int_sport_params_t, 32);
+
 /* OpenSwitch: matches port type, actor key, partner sys prio, partner sys id */
 static int mvlan_match_aggregator(lacp_sport_params_t *psport_param,
                                   struct MLt_vpm_api__lacp_match_params *plag_param,
                                   match_type_t match);
 
+static uint32_t
+mvlan_aggr_exact_hash(int port_type, int actor_key, int partner_key,
+                      int partner_system_priority,
+                      const char *partner_system_id)
+{
+    uint32_t hash;
+
+    hash = hash_int(port_type, 0);
+    hash = hash_int(actor_key, hash);
+    hash = hash_int(partner_key, hash);
+    hash = hash_int(partner_system_priority, hash);
+
+    return hash_bytes(partner_system_id, MAC_BYTEADDR_SIZE, hash);
+
+} // mvlan_aggr_exact_hash
+
+static uint32_t
+mvlan_aggr_key_hash(int actor_key)
+{
+    return hash_int(actor_key, 0);
+
+} // mvlan_aggr_key_hash
+
+static void
+mvlan_aggr_index_insert(lacp_int_sport_params_t *placp_sport_params)
+{
+    lacp_sport_params_t *params = &placp_sport_params->lacp_params;
+
+    hmap_insert(&aggr_exact_index, &placp_sport_params->exact_node,
+                mvlan_aggr_exact_hash(params->port_type,
+                                      params->actor_key,
+                                      params->partner_key,
+                                      params->partner_system_priority,
+                                      params->partner_system_id));
+    hmap_insert(&aggr_key_index, &placp_sport_params->key_node,
+                mvlan_aggr_key_hash(params->actor_key));
+
+} // mvlan_aggr_index_insert
+
+static void
+mvlan_aggr_index_remove(lacp_int_sport_params_t *placp_sport_params)
+{
+    hmap_remove(&aggr_exact_index, &placp_sport_params->exact_node);
+    hmap_remove(&aggr_key_index, &placp_sport_params->key_node);
+
+} // mvlan_aggr_index_remove
+
+// Must be called whenever an indexed field of the aggregator changes.
+static void
+mvlan_aggr_index_update(lacp_int_sport_params_t *placp_sport_params)
+{
+    mvlan_aggr_index_remove(placp_sport_params);
+    mvlan_aggr_index_insert(placp_sport_params);
+
+} // mvlan_aggr_index_update
+
 /*-----------------------------------------------------------------------------
  * mvlan_api_modify_sport_params   --
  *
@@ -307,15 +379,12 @@ mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
     if (psport->placp_params == NULL) {
         // Alloc only the first time. Note that the parameters could be
         // specified one at a time.
-        placp_sport_params = (lacp_int_sport_params_t *)malloc(sizeof(lacp_int_sport_params_t));
+        placp_sport_params = lacp_pool_alloc(&sport_params_pool);
 
         if (placp_sport_params == NULL ) {
             VLOG_ERR("mvlan_set_sport_params: No mem");
             status = MVLAN_SPORT_NO_MEM;
             goto end;
-
-        } else {
-            memset(placp_sport_params, 0, sizeof(lacp_int_sport_params_t));
         }
 
         // The very first time it's guaranteed to have (only) the tuple.
@@ -398,14 +467,17 @@ mvlan_set_sport_params(struct MLt_vpm_api__lacp_sport_params *pin_lacp_params)
 
     if (first_time == TRUE) {
         placp_sport_params->psport = psport;
+        placp_sport_params->seq = ++aggr_seq;
         placp_params_list = n_list_insert((struct NList *)
                                           placp_params_list,
                                           (void *)placp_sport_params,0);
+        mvlan_aggr_index_insert(placp_sport_params);
         psport->placp_params = placp_sport_params;
 
         RDEBUG(DL_VPM, "created new set of aggr params (%s)\n", psport->name);
 
     } else {
+        mvlan_aggr_index_update(placp_sport_params);
         RDEBUG(DL_VPM, "updated aggr params (%s)\n", psport->name);
     }
 
@@ -420,6 +492,30 @@ end:
 
 } // mvlan_set_sport_params
 
+/*-----------------------------------------------------------------------------
+ * mvlan_release_sport_params   --
+ *
+ *        placp_params - The params of a super port, may be NULL
+ *
+ * Description  -- Takes the parameters out of the aggregator list and
+ *                 indexes and returns them to their pool.
+ *---------------------------------------------------------------------------*/
+void
+mvlan_release_sport_params(void *placp_params)
+{
+    lacp_int_sport_params_t *placp_sport_params = placp_params;
+
+    if (placp_sport_params == NULL) {
+        return;
+    }
+
+    placp_params_list = n_list_remove_data((struct NList *)(placp_params_list),
+                                           (void *)placp_sport_params);
+    mvlan_aggr_index_remove(placp_sport_params);
+    lacp_pool_free(&sport_params_pool, placp_sport_params);
+
+} // mvlan_release_sport_params
+
 /*-----------------------------------------------------------------------------
  * mvlan_unset_sport_params   --
  *
@@ -454,12 +550,9 @@ mvlan_unset_sport_params(struct MLt_vpm_api__lacp_sport_params *in_lacp_params)
             RDEBUG(DL_VPM, "%s: placp_sport_params null!\n", __FUNCTION__);
     }
 
-    placp_params_list = n_list_remove_data((struct NList *)(placp_params_list),
-                                           (void *)placp_sport_params);
+    mvlan_release_sport_params(placp_sport_params);
     psport->placp_params = NULL;
 
-    free(placp_sport_params);
-
     // OpenSwitch: Inform LACP that aggregator's data has been changed.
     mlacpVapiSportParamsChange(MLm_vpm_api__unset_lacp_sport_params, in_lacp_params);
 
@@ -468,6 +561,132 @@ end:
 
 } // mvlan_unset_sport_params
 
+static void
+mvlan_debug_aggregator_candidate(lacp_int_sport_params_t *ptemp_lacp_sport_params,
+                                 struct MLt_vpm_api__lacp_match_params *placp_match_params)
+{
+    super_port_t *psport = ptemp_lacp_sport_params->psport;
+
+    RDEBUG(DL_VPM, "matching attributes of sport 0x%llx (%s) with "
+           "incoming params\n", psport->handle, psport->name);
+
+    RDEBUG(DL_VPM, "Existing sport params are :\n");
+    RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
+           ptemp_lacp_sport_params->lacp_params.port_type,
+           ptemp_lacp_sport_params->lacp_params.actor_key,
+           ptemp_lacp_sport_params->lacp_params.partner_key);
+    RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
+           "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
+           "aggr_type %d\n",
+           ptemp_lacp_sport_params->lacp_params.partner_system_priority,
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[0],
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[1],
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[2],
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[3],
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[4],
+           ptemp_lacp_sport_params->lacp_params.partner_system_id[5],
+           ptemp_lacp_sport_params->lacp_params.aggr_type);
+
+    RDEBUG(DL_VPM, "Incoming params are :\n");
+    RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
+           placp_match_params->port_type,
+           placp_match_params->actor_key,
+           placp_match_params->partner_key);
+    RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
+           "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
+           "local_port_number %d, flags=0x%x\n\n",
+           placp_match_params->partner_system_priority,
+           placp_match_params->partner_system_id[0],
+           placp_match_params->partner_system_id[1],
+           placp_match_params->partner_system_id[2],
+           placp_match_params->partner_system_id[3],
+           placp_match_params->partner_system_id[4],
+           placp_match_params->partner_system_id[5],
+           placp_match_params->local_port_number,
+           placp_match_params->flags);
+
+} // mvlan_debug_aggregator_candidate
+
+// Checks one indexed candidate, keeping the newest match in *pbest so
+// the result is the same as the first match in placp_params_list.
+static void
+mvlan_try_aggregator(lacp_int_sport_params_t *pcandidate,
+                     struct MLt_vpm_api__lacp_match_params *placp_match_params,
+                     match_type_t match,
+                     lacp_int_sport_params_t **pbest)
+{
+    if (*pbest != NULL && pcandidate->seq <= (*pbest)->seq) {
+        return;
+    }
+
+    if (VLOG_IS_DBG_ENABLED()) {
+        mvlan_debug_aggregator_candidate(pcandidate, placp_match_params);
+    }
+
+    if (mvlan_match_aggregator(&(pcandidate->lacp_params),
+                               placp_match_params, match)) {
+        *pbest = pcandidate;
+    }
+
+} // mvlan_try_aggregator
+
+/*-----------------------------------------------------------------------------
+ * mvlan_find_aggregator   --
+ *
+ *        placp_match_params - The params to match
+ *        match              - The kind of match wanted
+ *
+ * Description  -- Looks up the aggregator mvlan_select_aggregator() would
+ *                 use.  EXACT_MATCH only visits aggregators whose indexed
+ *                 fields hash the same as the incoming ones.  The other
+ *                 match types visit aggregators with the same actor key
+ *                 and those with no actor key yet.
+ *
+ * Return value --
+ *
+ *            The matching aggregator, NULL if none
+ *---------------------------------------------------------------------------*/
+static lacp_int_sport_params_t *
+mvlan_find_aggregator(struct MLt_vpm_api__lacp_match_params *placp_match_params,
+                      match_type_t match)
+{
+    lacp_int_sport_params_t *pbest = NULL;
+    lacp_int_sport_params_t *pcandidate;
+    uint32_t hash;
+
+    if (EXACT_MATCH == match) {
+        hash = mvlan_aggr_exact_hash(placp_match_params->port_type,
+                                     placp_match_params->actor_key,
+                                     placp_match_params->partner_key,
+                                     placp_match_params->partner_system_priority,
+                                     placp_match_params->partner_system_id);
+        HMAP_FOR_EACH_WITH_HASH (pcandidate, exact_node, hash,
+                                 &aggr_exact_index) {
+            mvlan_try_aggregator(pcandidate, placp_match_params, match,
+                                 &pbest);
+        }
+    } else {
+        hash = mvlan_aggr_key_hash(placp_match_params->actor_key);
+        HMAP_FOR_EACH_WITH_HASH (pcandidate, key_node, hash,
+                                 &aggr_key_index) {
+            mvlan_try_aggregator(pcandidate, placp_match_params, match,
+                                 &pbest);
+        }
+
+        if (placp_match_params->actor_key != LACP_LAG_INVALID_ACTOR_KEY) {
+            hash = mvlan_aggr_key_hash(LACP_LAG_INVALID_ACTOR_KEY);
+            HMAP_FOR_EACH_WITH_HASH (pcandidate, key_node, hash,
+                                     &aggr_key_index) {
+                mvlan_try_aggregator(pcandidate, placp_match_params, match,
+                                     &pbest);
+            }
+        }
+    }
+
+    return pbest;
+
+} // mvlan_find_aggregator
+
 /*-----------------------------------------------------------------------------
  * mvlan_select_aggregator   --
  *
@@ -494,167 +713,109 @@ mvlan_select_aggregator(struct MLt_vpm_api__lacp_match_params *placp_match_param
     int                     status = R_SUCCESS;
     super_port_t            *psport;
     lacp_int_sport_params_t *ptemp_lacp_sport_params = NULL;
-    struct NList            *plist;
-    struct NList            *plist_start = NULL;
-    int                     found_match = FALSE;
     struct  MLt_vpm_api__lacp_sport_params pmsg;
 
-    plist_start = plist = placp_params_list;
-
-    while (plist != NULL) {
-        ptemp_lacp_sport_params = (lacp_int_sport_params_t *)(N_LIST_ELEMENT(plist));
-
-        psport = ptemp_lacp_sport_params->psport;
-        RDEBUG(DL_VPM, "matching attributes of sport 0x%llx (%s) with "
-               "incoming params\n", psport->handle, psport->name);
-
-        RDEBUG(DL_VPM, "Existing sport params are :\n");
-        RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
-               ptemp_lacp_sport_params->lacp_params.port_type,
-               ptemp_lacp_sport_params->lacp_params.actor_key,
-               ptemp_lacp_sport_params->lacp_params.partner_key);
-        RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
-               "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
-               "aggr_type %d\n",
-               ptemp_lacp_sport_params->lacp_params.partner_system_priority,
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[0],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[1],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[2],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[3],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[4],
-               ptemp_lacp_sport_params->lacp_params.partner_system_id[5],
-               ptemp_lacp_sport_params->lacp_params.aggr_type);
-
-        RDEBUG(DL_VPM, "Incoming params are :\n");
-        RDEBUG(DL_VPM, "port_type 0x%x, actor_key 0x%x, partner_key 0x%x\n",
-               placp_match_params->port_type,
-               placp_match_params->actor_key,
-               placp_match_params->partner_key);
-        RDEBUG(DL_VPM, "partner_sys_pri 0x%x, "
-               "partner_sys_id %02x:%02x:%02x:%02x:%02x:%02x, "
-               "local_port_number %d, flags=0x%x\n\n",
-               placp_match_params->partner_system_priority,
-               placp_match_params->partner_system_id[0],
-               placp_match_params->partner_system_id[1],
-               placp_match_params->partner_system_id[2],
-               placp_match_params->partner_system_id[3],
-               placp_match_params->partner_system_id[4],
-               placp_match_params->partner_system_id[5],
-               placp_match_params->local_port_number,
-               placp_match_params->flags);
-
-        if (mvlan_match_aggregator(&(ptemp_lacp_sport_params->lacp_params),
-                                   placp_match_params, match)) {
-            found_match = TRUE;
-            RDEBUG(DL_VPM, "matched!  psport->handle=0x%llx, match_type=%d.\n",
-                   psport->handle, match);
-
-            // If we found something that wasn't exact_match, go ahead and update
-            // the partner information so the next call to select can find it.
-            //
-            // This is needed because there may be a small time delay between the
-            // time select is made and attach to LAG is called due to protocol
-            // timers.
-            //
-            // By updating the information here as soon as a selection is made,
-            // we allow back-to-back selections of the same parameters to end up
-            // with the same LAG before any attach is performed.
-            //
-            // When a priority match happens we still need to update the values in
-            // the super port in order to replace the old information with the new
-            // one coming from a higher priority port
-            if (PARTIAL_MATCH == match || PRIORITY_MATCH == match) {
-                memcpy(ptemp_lacp_sport_params->lacp_params.partner_system_id,
-                       placp_match_params->partner_system_id,
-                       sizeof(ptemp_lacp_sport_params->lacp_params.partner_system_id));
-
-                ptemp_lacp_sport_params->lacp_params.partner_system_priority =
-                    placp_match_params->partner_system_priority;
-                ptemp_lacp_sport_params->lacp_params.partner_key =
-                    placp_match_params->partner_key;
-
-                // Set the port with the max priority, we set this even when the match is
-                // PARTIAL_MATCH because that match should happen when the first lport is
-                // attached to a sport
-                ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
-                                    placp_match_params->actor_oper_port_priority;
-
-                // Check if the partner priority is higher than the current max partner priority
-                // In partial match we always update partner max port priority
-                if (PARTIAL_MATCH == match ||
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
-                    placp_match_params->partner_oper_port_priority) {
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
-                                    placp_match_params->partner_oper_port_priority;
-                }
-                ptemp_lacp_sport_params->lacp_params.flags |=
-                                    (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_SYSID_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_KEY_FIELD_PRESENT
-                                     | LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT
-                                     | LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT
-                                    );
-
-                // Also update port_type and actor_key now that
-                // OpenSwitch's managing these parameters.
-                ptemp_lacp_sport_params->lacp_params.port_type =
-                    placp_match_params->port_type;
-                ptemp_lacp_sport_params->lacp_params.actor_key =
-                    placp_match_params->actor_key;
-
-                RDEBUG(DL_VPM, "Updating DB with new LAG info: LAG.%d, port_type=%d",
-                       (int)PM_HANDLE2LAG(psport->handle), placp_match_params->port_type);
-
-                // OpenSwitch: update database with new LAG information when first selected.
-                db_update_lag_partner_info((int)PM_HANDLE2LAG(psport->handle));
-            }
-            // (EXACT_MATCH == match)
-            else{
-                // In exact_match we need to update the max_actor_port_priority and
-                // max_partner_port_priority of the sport only if the matched port
-                // has port_priority field present and has higher priority
-                if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT) &&
-                    ptemp_lacp_sport_params->lacp_params.actor_max_port_priority >
-                    placp_match_params->actor_oper_port_priority){
-
-                    ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
-                                                         placp_match_params->actor_oper_port_priority;
-                }
-                if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT) &&
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
-                    placp_match_params->partner_oper_port_priority){
+    ptemp_lacp_sport_params = mvlan_find_aggregator(placp_match_params, match);
 
-                    ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
-                                                         placp_match_params->partner_oper_port_priority;
-                }
-            }
+    if (ptemp_lacp_sport_params == NULL) {
+        RDEBUG(DL_VPM, "mvlan_api_select_aggregator: The specified parameters do not exist\n");
+        status  =  MVLAN_LACP_SPORT_PARAMS_NOT_FOUND;
+        goto end;
+    }
 
-            if (PRIORITY_MATCH == match) {
-                // Only necessary to set the flags and the sport handle
-                pmsg.flags = ptemp_lacp_sport_params->lacp_params.flags;
-                pmsg.sport_handle = psport->handle;
-                mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params, &pmsg);
-            }
+    psport = ptemp_lacp_sport_params->psport;
+    RDEBUG(DL_VPM, "matched!  psport->handle=0x%llx, match_type=%d.\n",
+           psport->handle, match);
 
-            break;
+    // If we found something that wasn't exact_match, go ahead and update
+    // the partner information so the next call to select can find it.
+    //
+    // This is needed because there may be a small time delay between the
+    // time select is made and attach to LAG is called due to protocol
+    // timers.
+    //
+    // By updating the information here as soon as a selection is made,
+    // we allow back-to-back selections of the same parameters to end up
+    // with the same LAG before any attach is performed.
+    //
+    // When a priority match happens we still need to update the values in
+    // the super port in order to replace the old information with the new
+    // one coming from a higher priority port
+    if (PARTIAL_MATCH == match || PRIORITY_MATCH == match) {
+        memcpy(ptemp_lacp_sport_params->lacp_params.partner_system_id,
+               placp_match_params->partner_system_id,
+               sizeof(ptemp_lacp_sport_params->lacp_params.partner_system_id));
+
+        ptemp_lacp_sport_params->lacp_params.partner_system_priority =
+            placp_match_params->partner_system_priority;
+        ptemp_lacp_sport_params->lacp_params.partner_key =
+            placp_match_params->partner_key;
+
+        // Set the port with the max priority, we set this even when the match is
+        // PARTIAL_MATCH because that match should happen when the first lport is
+        // attached to a sport
+        ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
+                            placp_match_params->actor_oper_port_priority;
+
+        // Check if the partner priority is higher than the current max partner priority
+        // In partial match we always update partner max port priority
+        if (PARTIAL_MATCH == match ||
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
+            placp_match_params->partner_oper_port_priority) {
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
+                            placp_match_params->partner_oper_port_priority;
         }
-
-        plist = N_LIST_NEXT(plist);
-
-        if (plist == (void *) plist_start) {
-            break;
+        ptemp_lacp_sport_params->lacp_params.flags |=
+                            (LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_SYSID_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_KEY_FIELD_PRESENT
+                             | LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT
+                             | LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT
+                            );
+
+        // Also update port_type and actor_key now that
+        // OpenSwitch's managing these parameters.
+        ptemp_lacp_sport_params->lacp_params.port_type =
+            placp_match_params->port_type;
+        ptemp_lacp_sport_params->lacp_params.actor_key =
+            placp_match_params->actor_key;
+
+        mvlan_aggr_index_update(ptemp_lacp_sport_params);
+
+        RDEBUG(DL_VPM, "Updating DB with new LAG info: LAG.%d, port_type=%d",
+               (int)PM_HANDLE2LAG(psport->handle), placp_match_params->port_type);
+
+        // OpenSwitch: update database with new LAG information when first selected.
+        db_update_lag_partner_info((int)PM_HANDLE2LAG(psport->handle));
+    }
+    // (EXACT_MATCH == match)
+    else{
+        // In exact_match we need to update the max_actor_port_priority and
+        // max_partner_port_priority of the sport only if the matched port
+        // has port_priority field present and has higher priority
+        if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT) &&
+            ptemp_lacp_sport_params->lacp_params.actor_max_port_priority >
+            placp_match_params->actor_oper_port_priority){
+
+            ptemp_lacp_sport_params->lacp_params.actor_max_port_priority =
+                                                 placp_match_params->actor_oper_port_priority;
         }
+        if ((ptemp_lacp_sport_params->lacp_params.flags & LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT) &&
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority >
+            placp_match_params->partner_oper_port_priority){
 
-    } // while (plist != NULL)
+            ptemp_lacp_sport_params->lacp_params.partner_max_port_priority =
+                                                 placp_match_params->partner_oper_port_priority;
+        }
+    }
 
-    if (found_match == FALSE) {
-        RDEBUG(DL_VPM, "mvlan_api_select_aggregator: The specified parameters do not exist\n");
-        status  =  MVLAN_LACP_SPORT_PARAMS_NOT_FOUND;
-        goto end;
+    if (PRIORITY_MATCH == match) {
+        // Only necessary to set the flags and the sport handle
+        pmsg.flags = ptemp_lacp_sport_params->lacp_params.flags;
+        pmsg.sport_handle = psport->handle;
+        mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params, &pmsg);
     }
 
-    ptemp_lacp_sport_params  = plist->data;
-    psport = ptemp_lacp_sport_params->psport;
     placp_match_params->sport_handle = psport->handle;
 
 end:
@@ -973,7 +1134,7 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
 
     RDEBUG(DL_VPM, "Detaching all lports");
 
-    plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+    plpinfo = LACP_port_first();
 
     while (plpinfo) {
         if (plpinfo->sport_handle == sport_handle) {
@@ -985,8 +1146,11 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
             LACP_mux_fsm(E2, plpinfo->mux_fsm_state, plpinfo);
             plpinfo->lacp_control.ready_n = FALSE;
         }
-        plpinfo = LACP_AVL_NEXT(plpinfo->avlnode);
+        plpinfo = LACP_port_next(plpinfo);
     }
+    mlacpVapiSportParamsNotifyOthers(sport_handle,
+                                     LACP_LAG_PARTNER_SYSPRI_FIELD_PRESENT |
+                                     LACP_LAG_PARTNER_SYSID_FIELD_PRESENT);
     // All logical ports have been detached from this aggregator (sport).
     // Clean up partner information so that we can reuse this sport
     // for subsequent aggregation.
@@ -1007,6 +1171,7 @@ mvlan_api_clear_sport_params(unsigned long long sport_handle)
                                               LACP_LAG_PARTNER_KEY_FIELD_PRESENT            |
                                               LACP_LAG_ACTOR_PORT_PRIORITY_FIELD_PRESENT    |
                                               LACP_LAG_PARTNER_PORT_PRIORITY_FIELD_PRESENT);
+    mvlan_aggr_index_update(sport_lacp_params);
 
     // OpenSwitch: do not clear actor key & port type. For OpenSwitch,
     // LAGs & actor keys are specified and bound together until deleted.
@@ -41,6 +41,9 @@ lacp_avl_tree_t sport_handle_tree = {0};
 
 static bool sport_init_done = FALSE;
 
+// Super ports in sport_handle_tree, for lacpd/memstats.
+static unsigned int n_sports;
+
 static int mvlan_validate_sport(struct MLt_vpm_api__create_sport *pcreate,
                                 super_port_t **ppsport);
 
@@ -201,6 +204,7 @@ mvlan_sport_create(struct MLt_vpm_api__create_sport  *psport_create,
         status = -1;
         goto end;
     }
+    __atomic_add_fetch(&n_sports, 1, __ATOMIC_RELAXED);
 
     // OpenSwitch: moved check for psport_create to beginning of
     //        this function.  (Found by Coverity).
@@ -252,8 +256,9 @@ mvlan_destroy_sport(super_port_t *psport)
     psport_node = (lacp_avl_node_t *)( psport + 1);
 
     LACP_AVL_DELETE(sport_handle_tree, *psport_node);
+    __atomic_sub_fetch(&n_sports, 1, __ATOMIC_RELAXED);
 
-    free(psport->placp_params);
+    mvlan_release_sport_params(psport->placp_params);
     free(psport);
 
     return status;
@@ -305,3 +310,23 @@ mvlan_get_sport(port_handle_t handle, super_port_t **ppsport, int type)
     return status;
 
 } // mvlan_get_sport
+
+/*-----------------------------------------------------------------------------
+ * mvlan_sport_memory  --
+ *
+ *        psports - Set to the number of super ports
+ *
+ * Description  -- Bytes allocated for the super ports themselves; their
+ *                 LACP parameters and port lists come from object pools.
+ *                 Safe from any thread.
+ *
+ * Return value -- The number of bytes
+ *---------------------------------------------------------------------------*/
+size_t
+mvlan_sport_memory(unsigned int *psports)
+{
+    *psports = __atomic_load_n(&n_sports, __ATOMIC_RELAXED);
+
+    return *psports * (sizeof(super_port_t) + sizeof(lacp_avl_node_t));
+
+} // mvlan_sport_memory
@@ -36,6 +36,7 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <string.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -51,6 +52,12 @@
 
 #include "lacp_ops_if.h"
 #include "lacp.h"
+#include "lacp_checkpoint.h"
+#include "lacp_export.h"
+#include "lacp_rx_filter.h"
+#include "lacp_worker.h"
+#include "lacp_idmap.h"
+#include "lacp_pool.h"
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
 #include "mvlan_sport.h"
@@ -61,6 +68,8 @@
 #include <openswitch-dflt.h>
 #include <openvswitch/vlog.h>
 #include <poll-loop.h>
+#include <latch.h>
+#include <timeval.h>
 #include <hash.h>
 #include <shash.h>
 
@@ -76,22 +85,18 @@ VLOG_DEFINE_THIS_MODULE(lacpd_ovsdb_if);
  * Pool definitions
  *
  *********************************/
-#define BITS_PER_BYTE           8
 #define MAX_ENTRIES_IN_POOL     256
-/* Wait up to 3 seconds when calling poll_block. */
-#define LACP_POLL_INTERVAL      3000
 
-#define IS_AVAILABLE(a, idx)  ((a[idx/BITS_PER_BYTE] & (1 << (idx % BITS_PER_BYTE))) == 0)
+/* Header line of "lacpd/getlacpcounters --raw"; bump the version if the
+ * record layout changes. */
+#define LACPD_RAW_COUNTERS_FIELDS \
+    "lacpd-counters-v2 lag interface lacp_pdus_sent " \
+    "marker_response_pdus_sent lacp_pdus_received marker_pdus_received " \
+    "lacp_pdus_fast_path pdus_dropped pdus_malformed pdus_queue_overflow " \
+    "pdus_tx_failed"
 
-#define CLEAR(a, idx)   a[idx/BITS_PER_BYTE] &= ~(1 << (idx % BITS_PER_BYTE))
-#define SET(a, idx)     a[idx/BITS_PER_BYTE] |= (1 << (idx % BITS_PER_BYTE))
-
-#define POOL(name, size)     unsigned char name[size/BITS_PER_BYTE+1]
-
-int allocate_next(unsigned char *pool, int size);
-static void free_index(unsigned char *pool, int idx);
-
-POOL(port_index, MAX_ENTRIES_IN_POOL);
+/* Interface indexes, 0 to MAX_ENTRIES_IN_POOL - 1. */
+static struct lacp_idmap port_index;
 
 /*********************************************************/
 
@@ -117,6 +122,12 @@ POOL(port_index, MAX_ENTRIES_IN_POOL);
 
 struct ovsdb_idl *idl;           /*!< Session handle for OVSDB IDL session. */
 static unsigned int idl_seqno;
+
+/* True if a row on the IDL track list was deleted. */
+#define IDL_IFACE_ROW_DELETED(ROW) \
+    (ovsrec_interface_row_get_seqno(ROW, OVSDB_IDL_CHANGE_DELETE) > 0)
+#define IDL_PORT_ROW_DELETED(ROW) \
+    (ovsrec_port_row_get_seqno(ROW, OVSDB_IDL_CHANGE_DELETE) > 0)
 static int system_configured = false;
 static char system_id[OPS_MAC_STR_SIZE] = {0};
 static int system_priority = DFLT_SYSTEM_LACP_CONFIG_SYSTEM_PRIORITY;
@@ -136,17 +147,152 @@ static struct shash all_interfaces = SHASH_INITIALIZER(&all_interfaces);
  */
 static struct shash interfaces_recently_added = SHASH_INITIALIZER(&interfaces_recently_added);
 
+/* Interfaces whose iface_data->ckpt_hold is set (warm restart). */
+static int n_ckpt_holds;
+
 /**
  * A hash map of daemon's internal data for all the ports maintained by lacpd.
  */
 static struct shash all_ports = SHASH_INITIALIZER(&all_ports);
 
+/**
+ * Interface data indexed by the interface index allocated from port_index.
+ * Lets the per-PDU lookups avoid walking all_interfaces.
+ */
+static struct iface_data *iface_by_index[MAX_ENTRIES_IN_POOL];
+
+/*************************************************************************//**
+ * @ingroup lacpd_ovsdb_if
+ * @brief LACP status of one interface, as last reported by the protocol
+ * thread.  Queued for write-back to OVSDB by db_update_interface().
+ ****************************************************************************/
+struct iface_status_snapshot {
+    system_variables_t  actor_system;
+    u_short             actor_port_priority;
+    u_short             actor_port_number;
+    u_short             actor_key;
+    state_parameters_t  actor_state;
+    system_variables_t  partner_system;
+    u_short             partner_port_priority;
+    u_short             partner_port_number;
+    u_short             partner_key;
+    state_parameters_t  partner_state;
+    bool                lacp_current;
+    bool                lag_speed_valid;    /*!< Port is in a LAG */
+    unsigned int        lag_member_speed;
+};
+
+/* LAG membership and status changes queued for write-back, in order. */
+enum writeback_op_type {
+    WB_OP_ADD_LAG_PORT,
+    WB_OP_DELETE_LAG_PORT,
+    WB_OP_UPDATE_LAG_PARTNER,
+    WB_OP_CLEAR_LAG_PARTNER,
+    WB_OP_HW_BOND_CONFIG,
+};
+
+struct writeback_op {
+    struct writeback_op *next;
+    enum writeback_op_type type;
+    uint16_t            lag_id;
+    int                 port;               /*!< Hardware port, for logs */
+    int                 index;              /*!< Interface index */
+    state_parameters_t  local_state;
+    bool                lag_speed_valid;
+    unsigned int        lag_member_speed;
+    bool                update_rx;          /*!< hw_bond_config changes */
+    bool                rx_enabled;
+    bool                update_tx;
+    bool                tx_enabled;
+    unsigned long long  lat_start;          /*!< Latency trace of an RX enable */
+    unsigned long long  lat_queued;
+};
+
+/**
+ * OVSDB write-back.
+ *
+ * The protocol thread does not write to OVSDB.  It records interface
+ * status in wb_iface_status[] (the latest value wins) and appends LAG
+ * membership changes to wb_ops, then wakes up the OVSDB thread through
+ * wb_latch.  lacpd_run() applies everything that accumulated in one
+ * non-blocking transaction, at most once every
+ * LACPD_DB_FLUSH_INTERVAL_MS.  All wb_* data is protected by wb_mutex.
+ */
+static pthread_mutex_t wb_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct iface_status_snapshot wb_iface_status[MAX_ENTRIES_IN_POOL];
+static bool wb_iface_dirty[MAX_ENTRIES_IN_POOL];
+static int wb_dirty_index[MAX_ENTRIES_IN_POOL];
+static int wb_n_dirty;
+static struct writeback_op *wb_ops;
+static struct writeback_op **wb_ops_tail = &wb_ops;
+static bool wb_pending;
+static struct latch wb_latch;
+
+/**
+ * Hardware programming in flight.
+ *
+ * The mux machine never waits for hw_bond_config to be written: its
+ * requests are queued as WB_OP_HW_BOND_CONFIG ops and the state machine
+ * carries on.  wb_hw_in_flight[] counts, per interface index, the ones
+ * whose transaction has not committed yet.  An op stays queued until
+ * then; if the transaction fails for any reason but TXN_ERROR it is put
+ * back at the head of wb_ops, ahead of the requests queued since, and
+ * goes out with the next flush.  Written under wb_mutex, read by
+ * lacpd_hw_ops_in_flight() without it.
+ */
+static unsigned int wb_hw_in_flight[MAX_ENTRIES_IN_POOL];
+static unsigned long wb_hw_queued;
+static unsigned long wb_hw_completed;
+static unsigned long wb_hw_retried;
+static unsigned long wb_hw_dropped;
+static unsigned long wb_hw_merged;
+
+/**
+ * Changes made while a protocol thread handles one event are staged in
+ * wb_pass_ops, and db_writeback_pass_end() appends them to wb_ops all
+ * at once.  The member changes of a LAG coming up or going down in one
+ * pass thus always share a transaction, and switchd reprograms the
+ * trunk once rather than once per member.  A hw_bond_config request for
+ * an interface that already has one staged is merged into it.  Outside
+ * a pass (wb_pass_ops_tail is NULL) changes are queued right away.
+ */
+static __thread struct writeback_op *wb_pass_ops;
+static __thread struct writeback_op **wb_pass_ops_tail;
+static __thread unsigned int wb_pass_merged;
+
+/* OVSDB thread only.  wb_txn_ops holds the ops applied to wb_txn,
+ * wb_status_index[] lists the interfaces whose status it writes, and
+ * wb_lat_index[] the interfaces whose RX enable it times (see
+ * lacp_latency.c). */
+static struct ovsdb_idl_txn *wb_txn;
+static struct writeback_op *wb_txn_ops;
+static struct writeback_op **wb_txn_ops_tail = &wb_txn_ops;
+static long long int wb_last_flush;
+static int wb_status_index[MAX_ENTRIES_IN_POOL];
+static int wb_n_status;
+static int wb_lat_index[MAX_ENTRIES_IN_POOL];
+static int wb_n_lat;
+
+/**
+ * Interface configuration published to the protocol thread, indexed by
+ * interface index.  The OVSDB thread is the only writer.  The sequence
+ * number is odd while a slot is being written, and readers retry until
+ * they copy a slot whose sequence is even and unchanged, so neither side
+ * ever waits for the other.
+ */
+struct iface_cfg_slot {
+    unsigned int            seq;
+    struct lacpd_iface_cfg  cfg;
+};
+
+static struct iface_cfg_slot iface_cfg_slots[MAX_ENTRIES_IN_POOL];
+
 /*************************************************************************//**
  * @ingroup lacpd_ovsdb_if
  * @brief lacpd's internal data structure to store per port data.
  ****************************************************************************/
 struct port_data {
-    char                *name;              /*!< Name of the port */
+    const char          *name;              /*!< Name of the port, the all_ports key */
     uint16_t            lag_id;             /*!< LAG ID of the port */
     struct shash        cfg_member_ifs;     /*!< Configured member interfaces */
     struct shash        eligible_member_ifs;/*!< Interfaces eligible to form a LAG */
@@ -154,13 +300,28 @@ struct port_data {
     enum ovsrec_port_lacp_e lacp_mode;      /*!< port's LACP mode */
     unsigned int        lag_member_speed;   /*!< link speed of LAG members */
     const struct ovsrec_port *cfg;          /*!< Port's idl entry */
-    char                *speed_str;         /*!< Most recent speed value */
+    bool                speed_set;          /*!< bond_speed in lacp_status is set */
+    unsigned int        speed;              /*!< lag_member_speed it was set from */
+    char                speed_str[16];      /*!< Most recent speed value */
 
     int                 current_status;     /*!< Currently recorded status of LAG */
     int                 timeout_mode;       /*!< 0=long, 1=short */
     int                 sys_prio;           /*!< Port override for system priority */
-    char                *sys_id;            /*!< Port override for system mac */
+    struct ether_addr   sys_id;             /*!< Port override for system mac */
+    bool                sys_id_set;         /*!< sys_id is valid */
     bool                fallback_enabled ;  /*!< Default = false*/
+    bool                status_dirty;       /*!< lacp_status needs write-back */
+    bool                bond_dirty;         /*!< bond_status needs a recount */
+    bool                status_in_txn;      /*!< Status written into wb_txn */
+
+    /* Member bond_status counts, kept up to date by
+     * update_interface_bond_status_map_entry(). */
+    int                 n_bond_up;
+    int                 n_bond_blocked;
+    int                 n_bond_down;
+    const char          *bond_summary;      /*!< Currently set bond_status key */
+    long                bond_speed;         /*!< Currently set bond_speed, -1=none */
+    bool                bond_status_valid;  /*!< false=bond_status must be rewritten */
 };
 
 /* current_status values */
@@ -172,12 +333,8 @@ struct port_data {
 
 /* NOTE: These LAG IDs are only used for LACP state machine.
  *       They are not necessarily the same as h/w LAG ID. */
-#define LAG_ID_IN_USE   1
-#define VALID_LAG_ID(x) ((x)>=min_lag_id && (x)<=max_lag_id)
-
 const uint16_t min_lag_id = 1;
-uint16_t max_lag_id = 0; // This will be set in init_lag_id_pool
-uint16_t *lag_id_pool = NULL;
+static struct lacp_idmap lag_ids;
 
 /* To serialize updates to OVSDB.  Both LACP and OVS
  * interface threads calls to update OVSDB states. */
@@ -203,72 +360,51 @@ pthread_mutex_t ovsdb_mutex = PTHREAD_MUTEX_INITIALIZER;
 static int update_interface_lag_eligibility(struct iface_data *idp);
 static int update_interface_hw_bond_config_map_entry(struct iface_data *idp,
                                                      const char *key, const char *value);
-static void update_member_interface_bond_status(struct port_data *portp);
+static void update_lag_member_bond_status(struct iface_data *idp);
 static void update_interface_bond_status_map_entry(struct iface_data *idp);
 static void update_port_bond_status_map_entry(struct port_data *portp);
+static int flush_port_bond_status(void);
+static void bond_state_account(struct iface_data *idp, struct port_data *portp,
+                               enum lacpd_bond_state state);
 
 static char *lacp_mode_str(enum ovsrec_port_lacp_e mode);
 static void db_clear_interface(struct iface_data *idp);
 static void db_update_port_status(struct port_data *portp);
 void db_clear_lag_partner_info_port(struct port_data *portp);
+static void db_writeback_flush(void);
+static void db_writeback_wait(void);
+static void db_writeback_forget(int index);
+static void db_writeback_txn_done(enum ovsdb_idl_txn_status status);
+static void db_writeback_retire_ops(enum ovsdb_idl_txn_status status);
+static void db_writeback_status_done(bool committed);
+static void db_writeback_queue_hw_bond_op(int index,
+                                          bool update_rx, bool rx_enabled,
+                                          bool update_tx, bool tx_enabled);
+static void publish_iface_cfg(struct iface_data *idp);
+static void unpublish_iface_cfg(int index);
 
 /**********************************************************************/
 /*                               UTILS                                */
 /**********************************************************************/
-static void
-init_lag_id_pool(uint16_t count)
-{
-    if (lag_id_pool == NULL) {
-        /* Track how many we're allocating. */
-        max_lag_id = count;
-
-        /* Allocate an extra one to skip LAG ID 0. */
-        lag_id_pool = (uint16_t *)xcalloc(count+1, sizeof(uint16_t));
-        VLOG_DBG("lacpd: allocated %d LAG IDs", count);
-    }
-} /* init_lag_id_pool */
-
 static uint16_t
 alloc_lag_id(void)
 {
-    if (lag_id_pool != NULL) {
-        uint16_t id;
-
-        for (id=min_lag_id; id<=max_lag_id; id++) {
+    int id = lacp_idmap_alloc(&lag_ids);
 
-            if (lag_id_pool[id] == LAG_ID_IN_USE) {
-                continue;
-            }
-
-            /* Found an available LAG_ID. */
-            lag_id_pool[id] = LAG_ID_IN_USE;
-            return id;
-        }
-    } else {
-        VLOG_ERR("LAG ID pool not initialized!");
+    /* No free LAG ID available if we get here. */
+    if (id < 0) {
+        return 0;
     }
 
-    /* No free LAG ID available if we get here. */
-    return 0;
+    return id;
 
 } /* alloc_lag_id */
 
 static void
 free_lag_id(uint16_t id)
 {
-    if ((lag_id_pool != NULL) && VALID_LAG_ID(id)) {
-        if (lag_id_pool[id] == LAG_ID_IN_USE) {
-            lag_id_pool[id] = 0;
-        } else {
-            VLOG_ERR("Trying to free an unused LAGID (%d)!", id);
-        }
-    } else {
-        if (lag_id_pool == NULL) {
-            VLOG_ERR("Attempt to free LAG ID when"
-                     "pool is not initialized!");
-        } else {
-            VLOG_ERR("Attempt to free invalid LAG ID %d!", id);
-        }
+    if (!lacp_idmap_free(&lag_ids, id)) {
+        VLOG_ERR("Attempt to free invalid or unused LAG ID %d!", id);
     }
 
 } /* free_lag_id */
@@ -308,20 +444,84 @@ valid_lacp_timeout(const char *cp)
 struct iface_data *
 find_iface_data_by_index(int index)
 {
-    struct iface_data *idp;
-    struct shash_node *sh_node;
+    if (index < 0 || index >= MAX_ENTRIES_IN_POOL) {
+        return NULL;
+    }
 
-    SHASH_FOR_EACH(sh_node, &all_interfaces) {
-        idp = sh_node->data;
-        if (idp) {
-            if (idp->index == index) {
-                return idp;
-            }
+    return iface_by_index[index];
+} /* find_iface_data_by_index */
+
+/* Publishes the configuration the protocol thread needs for idp. */
+static void
+publish_iface_cfg(struct iface_data *idp)
+{
+    struct iface_cfg_slot *slot;
+
+    if (idp->index < 0 || idp->index >= MAX_ENTRIES_IN_POOL) {
+        return;
+    }
+
+    slot = &iface_cfg_slots[idp->index];
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    snprintf(slot->cfg.name, sizeof slot->cfg.name, "%s", idp->name);
+    slot->cfg.cfg_lag_id = idp->cfg_lag_id;
+    slot->cfg.lacp_enabled = (idp->lacp_state == LACP_STATE_ENABLED);
+    slot->cfg.valid = true;
+    slot->cfg.link_state = idp->link_state;
+    slot->cfg.link_seqno = idp->link_seqno;
+    slot->cfg.link_speed = idp->link_speed;
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+} /* publish_iface_cfg */
+
+static void
+unpublish_iface_cfg(int index)
+{
+    struct iface_cfg_slot *slot = &iface_cfg_slots[index];
+
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->cfg.valid = false;
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+} /* unpublish_iface_cfg */
+
+bool
+lacpd_iface_cfg_get(int index, struct lacpd_iface_cfg *cfg)
+{
+    struct iface_cfg_slot *slot;
+    unsigned int seq;
+
+    if (index < 0 || index >= MAX_ENTRIES_IN_POOL) {
+        return false;
+    }
+
+    slot = &iface_cfg_slots[index];
+
+    do {
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
         }
+        memcpy(cfg, &slot->cfg, sizeof *cfg);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) ||
+             seq != __atomic_load_n(&slot->seq, __ATOMIC_RELAXED));
+
+    return cfg->valid;
+} /* lacpd_iface_cfg_get */
+
+unsigned int
+lacpd_hw_ops_in_flight(int index)
+{
+    if (index < 0 || index >= MAX_ENTRIES_IN_POOL) {
+        return 0;
     }
 
-    return NULL;
-} /* find_iface_data_by_index */
+    return __atomic_load_n(&wb_hw_in_flight[index], __ATOMIC_RELAXED);
+} /* lacpd_hw_ops_in_flight */
 
 
 /**********************************************************************/
@@ -341,235 +541,236 @@ alloc_msg(int size)
     return msg;
 } /* alloc_msg */
 
+/**
+ * Configuration batching.
+ *
+ * Between cfg_batch_begin() and cfg_batch_end(), the configuration
+ * messages built with cfg_msg_new() are appended to one
+ * MLm_vpm_api__config_batch event instead of being queued one by one.
+ * The protocol thread applies them in the order they were built.  A
+ * batch is queued when it holds LACPD_CONFIG_BATCH_SIZE messages, so a
+ * large reconfiguration does not keep the protocol thread from its
+ * timers for too long.  Link state changes are not batched; they have
+ * a lane of their own (see mlacp_event.c).  OVSDB thread only.
+ */
+static ML_event *cfg_batch_event;
+static bool cfg_batching;
+
 static void
-set_port_overrides(struct port_data *portp, struct iface_data *idp)
+cfg_batch_flush(void)
+{
+    ML_event *event = cfg_batch_event;
+
+    if (event != NULL) {
+        cfg_batch_event = NULL;
+        ml_send_event(event);
+    }
+} /* cfg_batch_flush */
+
+static void
+cfg_batch_begin(void)
+{
+    cfg_batching = true;
+} /* cfg_batch_begin */
+
+static void
+cfg_batch_end(void)
+{
+    cfg_batch_flush();
+    cfg_batching = false;
+} /* cfg_batch_end */
+
+/**
+ * Returns a zeroed message body of the given size, to be filled in and
+ * handed to cfg_msg_send().  The body is either that of a new event, or
+ * the next item of the current batch.
+ */
+static void *
+cfg_msg_new(int peer, int msgnum, size_t size)
 {
+    struct MLt_vpm_api__config_batch *batch;
+    struct MLt_vpm_api__config_item *item;
     ML_event *event;
-    struct MLt_lacp_api__set_lport_overrides *msg;
-    int msgSize;
 
-    msgSize = sizeof(ML_event)+sizeof(struct MLt_lacp_api__set_lport_overrides);
+    if (!cfg_batching) {
+        event = alloc_msg(sizeof(ML_event) + size);
+        if (event == NULL) {
+            return NULL;
+        }
 
-    event = (ML_event*)alloc_msg(msgSize);
+        event->sender.peer = peer;
+        event->msgnum = msgnum;
 
-    if (event != NULL) {
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_lacp_api__set_lport_overrides;
+        /* The body is just after the event structure itself; the
+         * receiver sets event->msg (see ml_wait_for_next_event()). */
+        return event + 1;
+    }
 
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_lacp_api__set_lport_overrides *)(event+1);
+    if (cfg_batch_event == NULL) {
+        cfg_batch_event = alloc_msg(sizeof(ML_event) +
+                                    sizeof(struct MLt_vpm_api__config_batch) +
+                                    LACPD_CONFIG_BATCH_SIZE *
+                                    sizeof(struct MLt_vpm_api__config_item));
+        if (cfg_batch_event == NULL) {
+            return NULL;
+        }
+
+        cfg_batch_event->sender.peer = ml_cfgMgr_index;
+        cfg_batch_event->msgnum = MLm_vpm_api__config_batch;
+    }
+
+    batch = (struct MLt_vpm_api__config_batch *)(cfg_batch_event + 1);
+    item = &batch->items[batch->count];
+    item->peer = peer;
+    item->msgnum = msgnum;
+
+    ovs_assert(size <= sizeof(item->u));
+    return &item->u;
+} /* cfg_msg_new */
+
+/**
+ * Sends a message built with cfg_msg_new(), or adds it to the batch.
+ */
+static void
+cfg_msg_send(void *msg)
+{
+    struct MLt_vpm_api__config_batch *batch;
 
+    if (!cfg_batching) {
+        ml_send_event((ML_event *)msg - 1);
+        return;
+    }
+
+    batch = (struct MLt_vpm_api__config_batch *)(cfg_batch_event + 1);
+    batch->count++;
+    if (batch->count == LACPD_CONFIG_BATCH_SIZE) {
+        cfg_batch_flush();
+    }
+} /* cfg_msg_send */
+
+static void
+set_port_overrides(struct port_data *portp, struct iface_data *idp)
+{
+    struct MLt_lacp_api__set_lport_overrides *msg;
+
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_lacp_api__set_lport_overrides,
+                      sizeof(*msg));
+
+    if (msg != NULL) {
         msg->lport_handle = PM_SMPT2HANDLE(0,0,idp->index,
                                            idp->cycl_port_type);
         msg->priority = portp->sys_prio;
 
         memset(msg->actor_sys_mac, 0, sizeof(msg->actor_sys_mac));
 
-        if (portp->sys_id) {
-            struct ether_addr *eth_addr_p;
-            struct ether_addr eth_addr;
-
-            eth_addr_p = ether_aton_r(portp->sys_id, &eth_addr);
-
-            if (eth_addr_p != NULL) {
-                memcpy(msg->actor_sys_mac, eth_addr_p, sizeof(msg->actor_sys_mac));
-            }
+        if (portp->sys_id_set) {
+            memcpy(msg->actor_sys_mac, &portp->sys_id, sizeof(msg->actor_sys_mac));
         }
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 }
 
 static void
 clear_port_overrides(struct iface_data *idp)
 {
-    ML_event *event;
     struct MLt_lacp_api__set_lport_overrides *msg;
-    int msgSize;
-
-    msgSize = sizeof(ML_event)+sizeof(struct MLt_lacp_api__set_lport_overrides);
-
-    event = (ML_event*)alloc_msg(msgSize);
 
-    if (event != NULL) {
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_lacp_api__set_lport_overrides;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_lacp_api__set_lport_overrides *)(event+1);
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_lacp_api__set_lport_overrides,
+                      sizeof(*msg));
 
+    if (msg != NULL) {
         msg->lport_handle = PM_SMPT2HANDLE(0,0,idp->index,
                                            idp->cycl_port_type);
         msg->priority = 0;
         memset(msg->actor_sys_mac, 0, sizeof(msg->actor_sys_mac));
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 }
 
 static void
 send_sys_pri_msg(int priority)
 {
-    ML_event *event;
     struct MLt_lacp_api__actorSysPriority *msg;
-    int msgSize;
 
     VLOG_DBG("%s: priority=%d", __FUNCTION__, priority);
 
-    msgSize = sizeof(ML_event)+sizeof(struct MLt_lacp_api__actorSysPriority);
-
-    event = (ML_event*)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_lacp_api__setActorSysPriority;
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_lacp_api__setActorSysPriority,
+                      sizeof(*msg));
 
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_lacp_api__actorSysPriority *)(event+1);
+    if (msg != NULL) {
         msg->actor_system_priority = priority;
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_sys_pri_msg */
 
 static void
 send_sys_mac_msg(struct ether_addr *macAddr)
 {
-    ML_event *event;
     struct MLt_lacp_api__actorSysMac *macMsg;
-    int msgSize;
 
     VLOG_DBG("%s: entry", __FUNCTION__);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_lacp_api__actorSysMac);
-
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_lacp_api__setActorSysMac;
-
-        /* Set up macMsg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        macMsg = (struct MLt_lacp_api__actorSysMac *)(event+1);
+    macMsg = cfg_msg_new(ml_cfgMgr_index, MLm_lacp_api__setActorSysMac,
+                         sizeof(*macMsg));
 
+    if (macMsg != NULL) {
         /* Copy MAC address. */
         memcpy(macMsg->actor_sys_mac, macAddr, ETH_ALEN);
 
-        ml_send_event(event);
+        cfg_msg_send(macMsg);
     }
 } /* send_sys_mac_msg */
 
 static void
 send_lag_create_msg(int lag_id)
 {
-    ML_event *event;
     struct MLt_vpm_api__create_sport *msg;
-    int msgSize;
 
     VLOG_DBG("%s: lag_id=%d", __FUNCTION__, lag_id);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__create_sport);
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_vpm_api__create_sport,
+                      sizeof(*msg));
 
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_vpm_api__create_sport;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__create_sport *)(event+1);
+    if (msg != NULL) {
         msg->handle = PM_LAG2HANDLE(lag_id);
         msg->type = STYPE_802_3AD;
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_lag_create_msg */
 
 static void
 send_lag_delete_msg(int lag_id)
 {
-    ML_event *event;
     struct MLt_vpm_api__delete_sport *msg;
-    int msgSize;
 
     VLOG_DBG("%s: lag_id=%d", __FUNCTION__, lag_id);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__delete_sport);
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_vpm_api__delete_sport,
+                      sizeof(*msg));
 
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_vpm_api__delete_sport;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__delete_sport *)(event+1);
+    if (msg != NULL) {
         msg->handle = PM_LAG2HANDLE(lag_id);
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_lag_delete_msg */
 
 static void
 send_config_lag_msg(int lag_id, int actor_key, int cycl_ptype)
 {
-    ML_event *event;
     struct MLt_vpm_api__lacp_sport_params *msg;
-    int msgSize;
 
     VLOG_DBG("%s: lag_id=%d, actor_key=%d, cycl_ptype=%d",
              __FUNCTION__, lag_id, actor_key, cycl_ptype);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__lacp_sport_params);
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_vpm_api__set_lacp_sport_params,
+                      sizeof(*msg));
 
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. (This is for the VPM side) ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_vpm_api__set_lacp_sport_params;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__lacp_sport_params *)(event+1);
+    if (msg != NULL) {
         msg->sport_handle = PM_LAG2HANDLE(lag_id);
         msg->flags = (LACP_LAG_PORT_TYPE_FIELD_PRESENT |
                       LACP_LAG_ACTOR_KEY_FIELD_PRESENT);
@@ -577,68 +778,40 @@ send_config_lag_msg(int lag_id, int actor_key, int cycl_ptype)
         msg->port_type = cycl_ptype;
         msg->actor_key = actor_key;
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_config_lag_msg */
 
 static void
 send_unconfig_lag_msg(int lag_id)
 {
-    ML_event *event;
     struct MLt_vpm_api__lacp_sport_params *msg;
-    int msgSize;
 
     VLOG_DBG("%s: lag_id=%d", __FUNCTION__, lag_id);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__lacp_sport_params);
+    msg = cfg_msg_new(ml_cfgMgr_index, MLm_vpm_api__unset_lacp_sport_params,
+                      sizeof(*msg));
 
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. (This is for the VPM side) ***/
-        event->sender.peer = ml_cfgMgr_index;
-        event->msgnum = MLm_vpm_api__unset_lacp_sport_params;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__lacp_sport_params *)(event+1);
+    if (msg != NULL) {
         msg->sport_handle = PM_LAG2HANDLE(lag_id);
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_unconfig_lag_msg */
 
 static void
 send_config_lport_msg(struct iface_data *info_ptr)
 {
-    ML_event *event;
     struct MLt_vpm_api__lport_lacp_change *msg;
-    int msgSize;
     struct port_data *portp;
 
     VLOG_DBG("%s: port=%s, hw_port=%d, index=%d", __FUNCTION__,
              info_ptr->name, info_ptr->hw_port_number, info_ptr->index);
 
-    msgSize = sizeof(ML_event) + sizeof(struct MLt_vpm_api__lport_lacp_change);
+    msg = cfg_msg_new(ml_lport_index, MLm_vpm_api__set_lacp_lport_params_event,
+                      sizeof(*msg));
 
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From LPORT peer. ***/
-        event->sender.peer = ml_lport_index;
-        event->msgnum = MLm_vpm_api__set_lacp_lport_params_event;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__lport_lacp_change *)(event+1);
+    if (msg != NULL) {
         msg->lport_handle = PM_SMPT2HANDLE(0,0,info_ptr->index,
                                            info_ptr->cycl_port_type);
         msg->link_state = info_ptr->link_state;  // INTERFACE_LINK_STATE_DOWN or INTERFACE_LINK_STATE_UP
@@ -683,51 +856,30 @@ send_config_lport_msg(struct iface_data *info_ptr)
                 msg->sys_priority = portp->sys_prio;
             }
 
-            if (portp->lacp_mode != PORT_LACP_OFF && portp->sys_id != NULL) {
-                struct ether_addr *eth_addr_p;
-                struct ether_addr eth_addr;
-
-                eth_addr_p = ether_aton_r(portp->sys_id, &eth_addr);
-
-                if (eth_addr_p != NULL) {
-                    msg->flags |= LACP_LPORT_SYS_ID_FIELD_PRESENT;
-                    memcpy(msg->sys_id, eth_addr_p, ETH_ALEN);
-                }
+            if (portp->lacp_mode != PORT_LACP_OFF && portp->sys_id_set) {
+                msg->flags |= LACP_LPORT_SYS_ID_FIELD_PRESENT;
+                memcpy(msg->sys_id, &portp->sys_id, ETH_ALEN);
             }
         }
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_config_lport_msg */
 
 static void
 send_lport_lacp_change_msg(struct iface_data *info_ptr, unsigned int flags)
 {
-    ML_event *event;
     struct MLt_vpm_api__lport_lacp_change *msg;
-    int msgSize;
 
     VLOG_DBG("%s: port=%s, hw_port=%d, index=%d, flags=0x%x", __FUNCTION__,
              info_ptr->name, info_ptr->hw_port_number, info_ptr->index, flags);
 
-    msgSize = sizeof(ML_event)+sizeof(struct MLt_vpm_api__lport_lacp_change);
-
-    event = (ML_event*)alloc_msg(msgSize);
+    msg = cfg_msg_new(ml_lport_index, MLm_vpm_api__set_lacp_lport_params_event,
+                      sizeof(*msg));
 
-    if (event != NULL) {
-        /*** From LPORT peer. ***/
-        event->sender.peer = ml_lport_index;
-        event->msgnum = MLm_vpm_api__set_lacp_lport_params_event;
-
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__lport_lacp_change *)(event+1);
-        msg->lport_handle = PM_SMPT2HANDLE(0,0,info_ptr->index,
-                                           info_ptr->cycl_port_type);
+    if (msg != NULL) {
+        msg->lport_handle = PM_SMPT2HANDLE(0,0,info_ptr->index,
+                                           info_ptr->cycl_port_type);
 
         /* NOTE: 802.3ad requires port number to be non-zero.  So we'll
          *       just use 1-based port number, instead of 0-based.
@@ -741,7 +893,7 @@ send_lport_lacp_change_msg(struct iface_data *info_ptr, unsigned int flags)
 
         msg->flags = (flags | LACP_LPORT_DYNAMIC_FIELDS_PRESENT);
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_lport_lacp_change_msg */
 
@@ -784,37 +936,22 @@ send_link_state_change_msg(struct iface_data *info_ptr)
 static void
 send_fallback_status_msg(struct iface_data *info_ptr, bool fallback_status)
 {
-    ML_event *event;
     struct MLt_vpm_api__lport_fallback_status *msg;
-    int msgSize;
 
     VLOG_DBG("%s: interface=%s, fallback=%d",
              __FUNCTION__,
             info_ptr->name,
             fallback_status);
 
-    msgSize = sizeof(ML_event)
-              + sizeof(struct MLt_vpm_api__lport_fallback_status);
-
-    event = (ML_event *)alloc_msg(msgSize);
-
-    if (event != NULL) {
-        /*** From CfgMgr peer. ***/
-        event->sender.peer = ml_lport_index;
-        event->msgnum = MLm_vpm_api__set_lport_fallback_status;
+    msg = cfg_msg_new(ml_lport_index, MLm_vpm_api__set_lport_fallback_status,
+                      sizeof(*msg));
 
-        /* Set up msg pointer to just after the event
-         * structure itself. This must be done here since the
-         * sender's event->msg pointer points sender's memory
-         * space, and will result in fatal errors if we try to
-         * access it in LACP process space.
-         */
-        msg = (struct MLt_vpm_api__lport_fallback_status *)(event+1);
+    if (msg != NULL) {
         msg->lport_handle = PM_SMPT2HANDLE(0, 0, info_ptr->index,
                                            info_ptr->cycl_port_type);
         msg->status = fallback_status;
 
-        ml_send_event(event);
+        cfg_msg_send(msg);
     }
 } /* send_fallback_status_msg */
 
@@ -826,6 +963,7 @@ configure_lacp_on_interface(struct port_data *portp, struct iface_data *idp)
     idp->cfg_lag_id = portp->lag_id;
     idp->lacp_state = (portp->lacp_mode == PORT_LACP_OFF ?
                        LACP_STATE_DISABLED : LACP_STATE_ENABLED);
+    publish_iface_cfg(idp);
 
 #if 0
     idp->cycl_port_type = speed_to_lport_type(portp->port_max_speed);
@@ -849,66 +987,126 @@ configure_lacp_on_interface(struct port_data *portp, struct iface_data *idp)
 
 } /* configure_lacp_on_interface */
 
+/* Columns replicated from OVSDB.  Columns that lacpd only writes, or
+ * only reads when a row is inserted, are replicated without change
+ * alerts, so other daemons updating them do not wake lacpd up.  Changes
+ * to tracked columns are handled row by row in lacpd_reconfigure(). */
+enum lacpd_idl_mode {
+    LACPD_IDL_ALERT,        /* read; changes wake lacpd */
+    LACPD_IDL_TRACK,        /* read; changed rows are tracked */
+    LACPD_IDL_NO_ALERT,     /* written, or read on row insert only */
+};
+
+static const struct lacpd_idl_column {
+    const struct ovsdb_idl_table_class *table;
+    const struct ovsdb_idl_column *column;
+    enum lacpd_idl_mode mode;
+} lacpd_idl_columns[] = {
+    { &ovsrec_table_system, &ovsrec_system_col_cur_cfg, LACPD_IDL_ALERT },
+    { &ovsrec_table_system, &ovsrec_system_col_system_mac, LACPD_IDL_ALERT },
+    { &ovsrec_table_system, &ovsrec_system_col_lacp_config, LACPD_IDL_ALERT },
+
+    { &ovsrec_table_port, &ovsrec_port_col_name, LACPD_IDL_TRACK },
+    { &ovsrec_table_port, &ovsrec_port_col_lacp, LACPD_IDL_TRACK },
+    { &ovsrec_table_port, &ovsrec_port_col_interfaces, LACPD_IDL_TRACK },
+    { &ovsrec_table_port, &ovsrec_port_col_other_config, LACPD_IDL_TRACK },
+    { &ovsrec_table_port, &ovsrec_port_col_lacp_status, LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_port, &ovsrec_port_col_bond_status, LACPD_IDL_NO_ALERT },
+
+    { &ovsrec_table_interface, &ovsrec_interface_col_name, LACPD_IDL_TRACK },
+    { &ovsrec_table_interface, &ovsrec_interface_col_duplex, LACPD_IDL_TRACK },
+    { &ovsrec_table_interface, &ovsrec_interface_col_link_state,
+      LACPD_IDL_TRACK },
+    { &ovsrec_table_interface, &ovsrec_interface_col_link_speed,
+      LACPD_IDL_TRACK },
+    { &ovsrec_table_interface, &ovsrec_interface_col_other_config,
+      LACPD_IDL_TRACK },
+    { &ovsrec_table_interface, &ovsrec_interface_col_type,
+      LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_interface, &ovsrec_interface_col_hw_intf_info,
+      LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_interface, &ovsrec_interface_col_hw_bond_config,
+      LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_interface, &ovsrec_interface_col_lacp_current,
+      LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_interface, &ovsrec_interface_col_lacp_status,
+      LACPD_IDL_NO_ALERT },
+    { &ovsrec_table_interface, &ovsrec_interface_col_bond_status,
+      LACPD_IDL_NO_ALERT },
+};
+
 /**
  * @details
- * Establishes an IDL session with OVSDB server. Registers the following
- * tables/columns for caching and change notification:
- *
- *     System:cur_cfg
- *     Port:name, lacp, and interfaces columns.
- *     Interface:name, link_state, link_speed, hw_bond_config columns.
+ * Logs the replicated columns of each table, so the daemon's OVSDB
+ * footprint can be checked from the log.
+ */
+static void
+lacpd_log_idl_columns(void)
+{
+    const struct ovsdb_idl_table_class *table = NULL;
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(lacpd_idl_columns); i++) {
+        const struct lacpd_idl_column *c = &lacpd_idl_columns[i];
+
+        if (c->table != table) {
+            if (table) {
+                VLOG_INFO("%s", ds_cstr(&ds));
+                ds_clear(&ds);
+            }
+            table = c->table;
+            ds_put_format(&ds, "Replicating %s:", table->name);
+        }
+        ds_put_format(&ds, " %s%s", c->column->name,
+                      c->mode == LACPD_IDL_NO_ALERT ? " (no alert)" :
+                      c->mode == LACPD_IDL_TRACK ? " (tracked)" : "");
+    }
+    if (table) {
+        VLOG_INFO("%s", ds_cstr(&ds));
+    }
+
+    ds_destroy(&ds);
+} /* lacpd_log_idl_columns */
+
+/**
+ * @details
+ * Establishes an IDL session with OVSDB server, and registers the
+ * tables and columns in lacpd_idl_columns for caching and change
+ * notification.
  */
 void
 lacpd_ovsdb_if_init(const char *db_path)
 {
+    size_t i;
+
     /* Initialize IDL through a new connection to the DB. */
     idl = ovsdb_idl_create(db_path, &ovsrec_idl_class, false, true);
     idl_seqno = ovsdb_idl_get_seqno(idl);
     ovsdb_idl_set_lock(idl, "ops_lacpd");
     ovsdb_idl_verify_write_only(idl);
 
-    /* Cache System table. */
-    ovsdb_idl_add_table(idl, &ovsrec_table_system);
-    ovsdb_idl_add_column(idl, &ovsrec_system_col_cur_cfg);
-    ovsdb_idl_add_column(idl, &ovsrec_system_col_system_mac);
-    ovsdb_idl_add_column(idl, &ovsrec_system_col_lacp_config);
-
-    /* Cache Subsystem table. */
-    ovsdb_idl_add_table(idl, &ovsrec_table_subsystem);
-    ovsdb_idl_add_column(idl, &ovsrec_subsystem_col_other_info);
-
-    /* Cache Port table and columns. */
-    ovsdb_idl_add_table(idl, &ovsrec_table_port);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_name);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_lacp);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_interfaces);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_lacp_status);
-    ovsdb_idl_omit_alert(idl, &ovsrec_port_col_lacp_status);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_other_config);
-    ovsdb_idl_add_column(idl, &ovsrec_port_col_bond_status);
-    ovsdb_idl_omit_alert(idl, &ovsrec_port_col_bond_status);
-
-    /* Cache Interface table and columns. */
-    ovsdb_idl_add_table(idl, &ovsrec_table_interface);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_name);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_type);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_duplex);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_link_state);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_link_speed);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_hw_bond_config);
-    ovsdb_idl_omit_alert(idl, &ovsrec_interface_col_hw_bond_config);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_hw_intf_info);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_lacp_current);
-    ovsdb_idl_omit_alert(idl, &ovsrec_interface_col_lacp_current);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_lacp_status);
-    ovsdb_idl_omit_alert(idl, &ovsrec_interface_col_lacp_status);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_other_config);
-    ovsdb_idl_add_column(idl, &ovsrec_interface_col_bond_status);
-    ovsdb_idl_omit_alert(idl, &ovsrec_interface_col_bond_status);
-
-    /* Initialize LAG ID pool. */
+    /* Cache the System, Port and Interface columns we use. */
+    for (i = 0; i < ARRAY_SIZE(lacpd_idl_columns); i++) {
+        const struct lacpd_idl_column *c = &lacpd_idl_columns[i];
+
+        ovsdb_idl_add_table(idl, c->table);
+        ovsdb_idl_add_column(idl, c->column);
+        if (c->mode == LACPD_IDL_NO_ALERT) {
+            ovsdb_idl_omit_alert(idl, c->column);
+        } else if (c->mode == LACPD_IDL_TRACK) {
+            ovsdb_idl_track_add_column(idl, c->column);
+        }
+    }
+    lacpd_log_idl_columns();
+
+    /* Initialize LAG ID and interface index pools. */
     /* OPS_TODO: read # of LAGs from somewhere? */
-    init_lag_id_pool(128);
+    lacp_idmap_init(&lag_ids, "LAG ID", min_lag_id, 128);
+    lacp_idmap_init(&port_index, "Interface index", 0, MAX_ENTRIES_IN_POOL);
+
+    /* Wakes the OVSDB thread when LACP status needs writing back. */
+    latch_init(&wb_latch);
 
 } /* lacpd_ovsdb_if_init */
 
@@ -918,6 +1116,17 @@ lacpd_ovsdb_if_exit(void)
     shash_destroy_free_data(&all_ports);
     shash_destroy_free_data(&all_interfaces);
     shash_destroy_free_data(&interfaces_recently_added);
+    if (wb_txn) {
+        ovsdb_idl_txn_destroy(wb_txn);
+        wb_txn = NULL;
+    }
+    while (wb_txn_ops) {
+        struct writeback_op *op = wb_txn_ops;
+
+        wb_txn_ops = op->next;
+        free(op);
+    }
+    latch_destroy(&wb_latch);
     ovsdb_idl_destroy(idl);
 } /* lacpd_ovsdb_if_exit */
 
@@ -927,8 +1136,16 @@ del_old_interface(struct shash_node *sh_node)
 {
     if (sh_node) {
         struct iface_data *idp = sh_node->data;
-        free(idp->name);
-        free_index(port_index, idp->index);
+        bond_state_account(idp, NULL, BOND_STATE_NONE);
+        if (idp->ckpt_hold) {
+            n_ckpt_holds--;
+        }
+        if (idp->index >= 0) {
+            iface_by_index[idp->index] = NULL;
+            unpublish_iface_cfg(idp->index);
+            db_writeback_forget(idp->index);
+            lacp_idmap_free(&port_index, idp->index);
+        }
         free(idp);
         shash_delete(&all_interfaces, sh_node);
     }
@@ -958,15 +1175,17 @@ add_new_interface(const struct ovsrec_interface *ifrow)
     } else {
         int port_priority = 0;
 
-        /* Save the interface name. */
-        idp->name = xstrdup(ifrow->name);
+        /* The all_interfaces key is the interface's copy of its name. */
+        idp->name = shash_find(&all_interfaces, ifrow->name)->name;
 
         /* Allocate interface index. */
         /* -- use hw_intf_info:switch_intf_id for now.
          * -- may be overridden with OVS's other_config:lacp-port-id. */
-        idp->index = allocate_next(port_index, MAX_ENTRIES_IN_POOL);
+        idp->index = lacp_idmap_alloc(&port_index);
         if (idp->index < 0) {
             VLOG_ERR("Invalid interface index=%d", idp->index);
+        } else {
+            iface_by_index[idp->index] = idp;
         }
 
         /* Save the reference to IDL row. */
@@ -1029,16 +1248,26 @@ add_new_interface(const struct ovsrec_interface *ifrow)
             idp->actor_priority = IS_VALID_ACTOR_PRI(port_priority) ? port_priority : DEFAULT_PORT_PRIORITY;
         }
 
-        /* Initialize the interface to be not part of any LAG.
-           This column gets updated later. */
-        update_interface_hw_bond_config_map_entry(
-            idp,
-            INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
-            INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
-        update_interface_hw_bond_config_map_entry(
-            idp,
-            INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
-            INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+        publish_iface_cfg(idp);
+
+        if (lacp_checkpoint_hold(idp->name)) {
+            /* The previous lacpd had the interface aggregated; leave
+               it so until the protocol thread restores or detaches it.
+               See release_checkpoint_holds(). */
+            idp->ckpt_hold = true;
+            n_ckpt_holds++;
+        } else {
+            /* Initialize the interface to be not part of any LAG.
+               This column gets updated later. */
+            update_interface_hw_bond_config_map_entry(
+                idp,
+                INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
+                INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+            update_interface_hw_bond_config_map_entry(
+                idp,
+                INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
+                INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+        }
 
         VLOG_DBG("Created local data for interface %s", ifrow->name);
     }
@@ -1054,47 +1283,63 @@ add_new_interface(const struct ovsrec_interface *ifrow)
 static int
 update_interface_cache(void)
 {
-    struct shash sh_idl_interfaces;
     const struct ovsrec_interface *ifrow;
     struct shash_node *sh_node, *sh_next;
+    bool deleted = false;
     int rc = 0;
 
-    /* Collect all the interfaces in the DB. */
-    shash_init(&sh_idl_interfaces);
-    OVSREC_INTERFACE_FOR_EACH(ifrow, idl) {
-        if (!shash_add_once(&sh_idl_interfaces, ifrow->name, ifrow)) {
-            VLOG_WARN("interface %s specified twice", ifrow->name);
+    /* Only the rows on the IDL track list changed since the last pass. */
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        if (IDL_IFACE_ROW_DELETED(ifrow)) {
+            deleted = true;
         }
     }
 
-    /* Delete old interfaces. */
-    SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_interfaces) {
-        struct iface_data *idp =
-            shash_find_data(&sh_idl_interfaces, sh_node->name);
-        if (!idp) {
-            VLOG_DBG("Found a deleted interface %s", sh_node->name);
-            del_old_interface(sh_node);
+    /* Delete old interfaces.  A deleted row stays in memory until the
+     * track list is cleared, so it is matched by address. */
+    if (deleted) {
+        SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_interfaces) {
+            struct iface_data *idp = sh_node->data;
+            if (IDL_IFACE_ROW_DELETED(idp->cfg)) {
+                VLOG_DBG("Found a deleted interface %s", sh_node->name);
+                del_old_interface(sh_node);
+            }
         }
     }
 
     /* Add new interfaces. */
-    SHASH_FOR_EACH(sh_node, &sh_idl_interfaces) {
-        struct iface_data *idp =
-            shash_find_data(&all_interfaces, sh_node->name);
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        struct iface_data *idp;
+
+        if (IDL_IFACE_ROW_DELETED(ifrow)) {
+            continue;
+        }
+        idp = shash_find_data(&all_interfaces, ifrow->name);
         if (!idp) {
-            VLOG_DBG("Found an added interface %s", sh_node->name);
-            add_new_interface(sh_node->data);
+            VLOG_DBG("Found an added interface %s", ifrow->name);
+            add_new_interface(ifrow);
             rc++;
+        } else if (OVSREC_IDL_IS_ROW_INSERTED(ifrow, idl_seqno)) {
+            /* Row replaced, e.g. after the IDL reconnected. */
+            idp->cfg = ifrow;
+            idp->bond_status_synced = false;
         }
     }
 
     /* Check for changes in the interface row entries. */
-    SHASH_FOR_EACH(sh_node, &all_interfaces) {
-        struct iface_data *idp = sh_node->data;
-        const struct ovsrec_interface *ifrow =
-            shash_find_data(&sh_idl_interfaces, sh_node->name);
+    OVSREC_INTERFACE_FOR_EACH_TRACKED(ifrow, idl) {
+        struct iface_data *idp;
         unsigned int flag = 0;
 
+        if (IDL_IFACE_ROW_DELETED(ifrow)) {
+            continue;
+        }
+
+        idp = shash_find_data(&all_interfaces, ifrow->name);
+        if (idp == NULL || idp->cfg != ifrow) {
+            continue;
+        }
+
         /* Internal interfaces doesn't participate in LAGs. */
         if (idp->intf_type == INTERFACE_TYPE_INTERNAL) {
             VLOG_INFO("Skipping the interface %s ", ifrow->name);
@@ -1192,12 +1437,16 @@ update_interface_cache(void)
                 (new_speed != idp->link_speed) ||
                 (new_duplex != idp->duplex)) {
 
+                if (new_link_state != idp->link_state) {
+                    idp->link_seqno++;
+                }
                 idp->link_state = new_link_state;
                 idp->link_speed = new_speed;
                 idp->duplex = new_duplex;
+                publish_iface_cfg(idp);
                 if (idp->port_datap != NULL) {
-                    update_member_interface_bond_status(idp->port_datap);
-                    update_port_bond_status_map_entry(idp->port_datap);
+                    update_lag_member_bond_status(idp);
+                    idp->port_datap->bond_dirty = true;
                     rc++;
                 }
 
@@ -1234,9 +1483,6 @@ update_interface_cache(void)
         }
     }
 
-    /* Destroy the shash of the IDL interfaces. */
-    shash_destroy(&sh_idl_interfaces);
-
     return rc;
 } /* update_interface_cache */
 
@@ -1318,38 +1564,77 @@ update_port_fallback_flag(const struct ovsrec_port *row,
 }
 
 /**
- * Update bond_status configuration for the configured member interfaces
- * of one LAG.
+ * Update bond_status configuration for one interface, if it is a
+ * configured member of a LAG.
  *
  * NOTE: ovsdb_mutex must be taken prior to calling this function.
  *
- * @param portp port_data pointer to the port entry.
+ * @param idp  iface_data pointer to the interface entry.
  */
 static void
-update_member_interface_bond_status(struct port_data *portp)
+update_lag_member_bond_status(struct iface_data *idp)
 {
-    struct shash_node *node, *next;
+    if (idp->port_datap &&
+        !strncmp(idp->port_datap->name,
+                 LAG_PORT_NAME_PREFIX,
+                 LAG_PORT_NAME_PREFIX_LENGTH)) {
+        update_interface_bond_status_map_entry(idp);
+    }
+} /* update_lag_member_bond_status */
 
-    /* If the port is NULL, then return */
-    if(!portp) {
-        VLOG_WARN("Calling update_member_interface_bond_status with portp NULL.");
-        return;
+/* Adds delta to the bond counter of portp that matches state. */
+static void
+bond_counter_adjust(struct port_data *portp, enum lacpd_bond_state state,
+                    int delta)
+{
+    switch (state) {
+    case BOND_STATE_UP:
+        portp->n_bond_up += delta;
+        break;
+    case BOND_STATE_BLOCKED:
+        portp->n_bond_blocked += delta;
+        break;
+    case BOND_STATE_DOWN:
+        portp->n_bond_down += delta;
+        break;
+    default:
+        break;
     }
+} /* bond_counter_adjust */
 
-    if (!strncmp(portp->name,
-                 LAG_PORT_NAME_PREFIX,
-                 LAG_PORT_NAME_PREFIX_LENGTH)) {
-        SHASH_FOR_EACH_SAFE(node, next, &portp->cfg_member_ifs) {
-            struct iface_data *idp = shash_find_data(&all_interfaces,
-                                                     node->name);
-            update_interface_bond_status_map_entry(idp);
-        }
+/* Moves idp's contribution to the bond counters to (portp, state).
+ * portp may be NULL when the interface leaves its LAG. */
+static void
+bond_state_account(struct iface_data *idp, struct port_data *portp,
+                   enum lacpd_bond_state state)
+{
+    if (idp->bond_port) {
+        bond_counter_adjust(idp->bond_port, idp->bond_state, -1);
+    }
+
+    idp->bond_port = portp;
+    idp->bond_state = state;
+
+    if (portp) {
+        bond_counter_adjust(portp, state, 1);
+    }
+} /* bond_state_account */
+
+/* Drops idp from portp's bond counters, if it is counted there. */
+static void
+bond_state_forget(struct iface_data *idp, struct port_data *portp)
+{
+    if (idp->bond_port == portp) {
+        bond_state_account(idp, NULL, idp->bond_state);
     }
-} /* update_member_interface_bond_status */
+} /* bond_state_forget */
 
 /**
  * Update bond_status configuration for a given interface
  *
+ * The LAG's bond counters are adjusted by the change, and the column is
+ * written only when the value differs from the one last set.
+ *
  * NOTE: ovsdb_mutex must be taken prior to calling this function.
  *
  * @param idp  iface_data pointer to the interface entry.
@@ -1362,9 +1647,10 @@ update_interface_bond_status_map_entry(struct iface_data *idp)
     struct smap_node *node;
     bool rx_enable = false;
     bool tx_enable = false;
+    enum lacpd_bond_state state;
+    bool changed;
 
     ifrow = idp->cfg;
-    smap_init(&smap);
 
     if (idp->link_state == INTERFACE_LINK_STATE_UP) {
 
@@ -1388,25 +1674,44 @@ update_interface_bond_status_map_entry(struct iface_data *idp)
             }
         }
 
-        if (tx_enable && rx_enable) {
-            smap_replace(&smap,
-                         INTERFACE_BOND_STATUS_UP,
-                         INTERFACE_BOND_STATUS_ENABLED_TRUE);
-        } else {
-            smap_replace(&smap,
-                         INTERFACE_BOND_STATUS_BLOCKED,
-                         INTERFACE_BOND_STATUS_ENABLED_TRUE);
-        }
+        state = (tx_enable && rx_enable) ? BOND_STATE_UP : BOND_STATE_BLOCKED;
     }
     /* Interface link is down */
     else {
+        state = BOND_STATE_DOWN;
+    }
+
+    changed = (state != idp->bond_state);
+    if (changed || idp->bond_port != idp->port_datap) {
+        bond_state_account(idp, idp->port_datap, state);
+    }
+
+    if (!changed && idp->bond_status_synced) {
+        return;
+    }
+
+    smap_init(&smap);
+    switch (state) {
+    case BOND_STATE_UP:
+        smap_replace(&smap,
+                     INTERFACE_BOND_STATUS_UP,
+                     INTERFACE_BOND_STATUS_ENABLED_TRUE);
+        break;
+    case BOND_STATE_BLOCKED:
+        smap_replace(&smap,
+                     INTERFACE_BOND_STATUS_BLOCKED,
+                     INTERFACE_BOND_STATUS_ENABLED_TRUE);
+        break;
+    default:
         smap_replace(&smap,
                      INTERFACE_BOND_STATUS_DOWN,
                      INTERFACE_BOND_STATUS_ENABLED_TRUE);
+        break;
     }
 
     ovsrec_interface_set_bond_status(ifrow, &smap);
     smap_destroy(&smap);
+    idp->bond_status_synced = true;
 } /* update_interface_bond_status_map_entry */
 
 /**
@@ -1423,6 +1728,8 @@ remove_interface_bond_status_map_entry(struct iface_data *idp)
     const struct ovsrec_interface *ifrow;
     struct smap smap;
 
+    bond_state_account(idp, NULL, BOND_STATE_NONE);
+
     ifrow = idp->cfg;
     smap_init(&smap);
     smap_remove(&smap, INTERFACE_BOND_STATUS_DOWN);
@@ -1431,6 +1738,7 @@ remove_interface_bond_status_map_entry(struct iface_data *idp)
 
     ovsrec_interface_set_bond_status(ifrow, &smap);
     smap_destroy(&smap);
+    idp->bond_status_synced = true;
 } /* remove_interface_bond_status_map_entry */
 
 /**
@@ -1454,15 +1762,11 @@ remove_interface_bond_status_map_entry(struct iface_data *idp)
 static void
 update_port_bond_status_map_entry(struct port_data *portp)
 {
-    const struct ovsrec_interface *ifrow;
     struct smap smap;
-    struct shash_node *node, *next;
-    struct smap_node *snode;
-    int total_intf = 0;
-    int blocked_intf = 0;
-    int up_intf = 0;
-    int down_intf = 0;
-    char* speed_str;
+    const char *summary = NULL;
+    long speed = -1;
+    int total_intf;
+    char speed_str[24];
 
     /* If the port is NULL, then return */
     if(!portp) {
@@ -1475,62 +1779,75 @@ update_port_bond_status_map_entry(struct port_data *portp)
         return;
     }
 
-    smap_init(&smap);
+    total_intf = portp->n_bond_up + portp->n_bond_blocked + portp->n_bond_down;
 
-    SHASH_FOR_EACH_SAFE(node, next, &portp->cfg_member_ifs) {
+    if (portp->n_bond_down == total_intf) {
+        summary = PORT_BOND_STATUS_DOWN;
+    } else if (portp->n_bond_blocked == total_intf) {
+        summary = PORT_BOND_STATUS_BLOCKED;
+    } else if (portp->n_bond_up > 0) {
+        summary = PORT_BOND_STATUS_UP;
+    }
 
-        struct iface_data *idp = shash_find_data(&all_interfaces, node->name);
-        if (idp) {
-            ifrow = idp->cfg;
-            SMAP_FOR_EACH(snode, &ifrow->bond_status) {
-
-                if (!strncmp(snode->key,
-                             INTERFACE_BOND_STATUS_UP,
-                             strlen(INTERFACE_BOND_STATUS_UP))) {
-                    up_intf++;
-                } else if (!strncmp(snode->key,
-                           INTERFACE_BOND_STATUS_BLOCKED,
-                           strlen(INTERFACE_BOND_STATUS_BLOCKED))) {
-                    blocked_intf++;
-                } else if (!strncmp(snode->key,
-                           INTERFACE_BOND_STATUS_DOWN,
-                           strlen(INTERFACE_BOND_STATUS_DOWN))) {
-                    down_intf++;
-                }
+    /* If the LAG has no member interfaces, then bond_speed is empty. */
+    if (total_intf != 0) {
+        speed = (long)portp->lag_member_speed * MEGA_BITS_PER_SEC;
+    }
 
-                total_intf++;
-            }
-        }
+    /* Nothing to write if the summary is unchanged. */
+    if (portp->bond_status_valid &&
+        summary == portp->bond_summary &&
+        speed == portp->bond_speed) {
+        return;
     }
 
-    if (down_intf == total_intf) {
-           smap_replace(&smap,
-                        PORT_BOND_STATUS_DOWN,
-                        PORT_BOND_STATUS_ENABLED_TRUE);
-    } else if (blocked_intf == total_intf) {
-        smap_replace(&smap,
-                     PORT_BOND_STATUS_BLOCKED,
-                     PORT_BOND_STATUS_ENABLED_TRUE);
-    } else if (up_intf > 0) {
-        smap_replace(&smap,
-                     PORT_BOND_STATUS_UP,
-                     PORT_BOND_STATUS_ENABLED_TRUE);
+    smap_init(&smap);
+
+    if (summary) {
+        smap_replace(&smap, summary, PORT_BOND_STATUS_ENABLED_TRUE);
     }
 
     /* Update bond_speed */
-    /* If the LAG has no member interfaces, then bond_speed is empty. */
-    if (total_intf == 0) {
-        smap_remove(&smap, PORT_BOND_STATUS_MAP_BOND_SPEED);
-    } else {
-        long speed_in_bps = (long)portp->lag_member_speed * MEGA_BITS_PER_SEC;
-        asprintf(&speed_str, "%ld", speed_in_bps);
+    if (speed >= 0) {
+        snprintf(speed_str, sizeof speed_str, "%ld", speed);
         smap_replace(&smap, PORT_BOND_STATUS_MAP_BOND_SPEED, speed_str);
     }
 
     ovsrec_port_set_bond_status(portp->cfg, &smap);
     smap_destroy(&smap);
+
+    portp->bond_summary = summary;
+    portp->bond_speed = speed;
+    portp->bond_status_valid = true;
 } /* update_port_bond_status_map_entry */
 
+/**
+ * Writes the bond_status of every LAG marked bond_dirty, once per LAG
+ * however many of its members changed.
+ *
+ * NOTE: ovsdb_mutex must be taken prior to calling this function.
+ *
+ * @return the number of LAGs that were marked.
+ */
+static int
+flush_port_bond_status(void)
+{
+    struct shash_node *node;
+    int n = 0;
+
+    SHASH_FOR_EACH(node, &all_ports) {
+        struct port_data *portp = node->data;
+
+        if (portp->bond_dirty) {
+            portp->bond_dirty = false;
+            update_port_bond_status_map_entry(portp);
+            n++;
+        }
+    }
+
+    return n;
+} /* flush_port_bond_status */
+
 /**
  * Common function to set interface's LAG eligibility status for all LAG types.
  * Depending on the LAG type, this function either updates the DB by writing
@@ -1574,6 +1891,7 @@ set_interface_lag_eligibility(struct port_data *portp, struct iface_data *idp,
         /* Override lacp_state based on eligibility. */
         idp->lacp_state = (eligible? LACP_STATE_ENABLED :
                                      LACP_STATE_DISABLED);
+        publish_iface_cfg(idp);
 
         /* If lacp mode, and state is disabled, set RX/TX to disabled */
         if (idp->lacp_state == LACP_STATE_DISABLED) {
@@ -1600,13 +1918,11 @@ set_interface_lag_eligibility(struct port_data *portp, struct iface_data *idp,
     /* update eligible LAG member list. */
     if (eligible) {
         shash_add(&portp->eligible_member_ifs, idp->name, (void *)idp);
-        update_member_interface_bond_status(portp);
-        update_port_bond_status_map_entry(portp);
     } else {
-        update_member_interface_bond_status(portp);
-        update_port_bond_status_map_entry(portp);
         shash_find_and_delete(&portp->eligible_member_ifs, idp->name);
     }
+    update_lag_member_bond_status(idp);
+    portp->bond_dirty = true;
     idp->lag_eligible = eligible;
 
 } /* set_interface_lag_eligibility */
@@ -1764,6 +2080,7 @@ handle_port_config(const struct ovsrec_port *row, struct port_data *portp)
                 VLOG_DBG("Found a deleted interface %s", node->name);
 
                 set_interface_lag_eligibility(portp, idp, false);
+                bond_state_forget(idp, portp);
                 /* If this interface was added to another port in this same cycle
                  * of SHASH_FOR_EACH(sh_node, &all_ports), then we don't have to
                  * delete it.*/
@@ -1934,7 +2251,7 @@ handle_port_config(const struct ovsrec_port *row, struct port_data *portp)
                           EV_KV("intf_id", "%s", node->name)) < 0) {
                 VLOG_ERR("Could not log event LAG_INTERFACE_ADD");
             }
-            update_member_interface_bond_status(portp);
+            update_lag_member_bond_status(idp);
             rc++;
         }
     }
@@ -1987,24 +2304,21 @@ handle_port_config(const struct ovsrec_port *row, struct port_data *portp)
             }
         }
 
-        /* If there's a change in the system-id, send the update. */
-        if ((sys_id == NULL && portp->sys_id != NULL) ||
-            (sys_id != NULL && portp->sys_id == NULL) ||
-            (sys_id != NULL && portp->sys_id != NULL &&
-                strcmp(sys_id, portp->sys_id) != 0)) {
-            if (sys_id == NULL) {
-                free(portp->sys_id);
-                portp->sys_id = NULL;
+        /* If there's a change in the system-id, send the update.  It is
+         * kept as a mac address, saved *after* it's been validated. */
+        if (sys_id == NULL) {
+            if (portp->sys_id_set) {
+                portp->sys_id_set = false;
+                changed = true;
+            }
+        } else {
+            eth_addr_p = ether_aton_r(sys_id, &eth_addr);
+            if (eth_addr_p &&
+                (!portp->sys_id_set ||
+                 memcmp(&portp->sys_id, eth_addr_p, sizeof(eth_addr)))) {
+                portp->sys_id = *eth_addr_p;
+                portp->sys_id_set = true;
                 changed = true;
-            } else {
-                /* Convert the string to a mac address. */
-                eth_addr_p = ether_aton_r(sys_id, &eth_addr);
-                if (eth_addr_p) {
-                    /* Save the system-id *after* it's been validated. */
-                    free(portp->sys_id);
-                    portp->sys_id = strdup(sys_id);
-                    changed = true;
-                }
             }
         }
         if (changed) {
@@ -2021,7 +2335,8 @@ handle_port_config(const struct ovsrec_port *row, struct port_data *portp)
         update_port_fallback_flag(row, portp, lacp_changed);
     }
 
-    update_port_bond_status_map_entry(portp);
+    /* Recounted once the whole configuration is handled. */
+    portp->bond_dirty = true;
 
     /* Destroy the shash of the IDL interfaces. */
     shash_destroy(&sh_idl_port_intfs);
@@ -2059,7 +2374,6 @@ del_old_port(struct shash_node *sh_node)
             send_lag_delete_msg(portp->lag_id);
             free_lag_id(portp->lag_id);
         }
-        free(portp->name);
         free(portp);
         shash_delete(&all_ports, sh_node);
     }
@@ -2083,11 +2397,8 @@ add_new_port(const struct ovsrec_port *port_row)
         size_t i;
 
         portp->cfg = port_row;
-        if ((portp->name = xstrdup(port_row->name)) == NULL) {
-            free(portp);
-            VLOG_FATAL("%s : out of memory", __FUNCTION__);
-            return;
-        }
+        /* The all_ports key is the port's copy of its name. */
+        portp->name = shash_find(&all_ports, port_row->name)->name;
         portp->lacp_mode = PORT_LACP_OFF;
 
         shash_init(&portp->cfg_member_ifs);
@@ -2110,14 +2421,14 @@ add_new_port(const struct ovsrec_port *port_row)
                      intf->name, portp->name);
 
             shash_add(&portp->cfg_member_ifs, intf->name, (void *)idp);
-            update_member_interface_bond_status(portp);
             idp->port_datap = portp;
             idp->fallback_enabled = false;
+            update_lag_member_bond_status(idp);
         }
         VLOG_DBG("Created local data for Port %s", port_row->name);
 
         /* update bond status */
-        update_port_bond_status_map_entry(portp);
+        portp->bond_dirty = true;
     }
 } /* add_new_port */
 
@@ -2131,46 +2442,65 @@ add_new_port(const struct ovsrec_port *port_row)
 static int
 update_port_cache(void)
 {
-    struct shash sh_idl_ports;
     const struct ovsrec_port *row;
     struct shash_node *sh_node, *sh_next;
+    bool deleted = false;
     int rc = 0;
 
-    /* Collect all the ports in the DB. */
-    shash_init(&sh_idl_ports);
-    OVSREC_PORT_FOR_EACH(row, idl) {
-        if (!shash_add_once(&sh_idl_ports, row->name, row)) {
-            VLOG_WARN("port %s specified twice", row->name);
+    /* Only the rows on the IDL track list changed since the last pass. */
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        if (IDL_PORT_ROW_DELETED(row)) {
+            deleted = true;
         }
     }
 
-    /* Delete old ports. */
-    SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_ports) {
-        struct port_data *portp = shash_find_data(&sh_idl_ports, sh_node->name);
-        if (!portp) {
-            VLOG_DBG("Found a deleted port %s", sh_node->name);
-            del_old_port(sh_node);
-            rc++;
+    /* Delete old ports.  A deleted row stays in memory until the track
+     * list is cleared, so it is matched by address. */
+    if (deleted) {
+        SHASH_FOR_EACH_SAFE(sh_node, sh_next, &all_ports) {
+            struct port_data *portp = sh_node->data;
+            if (IDL_PORT_ROW_DELETED(portp->cfg)) {
+                VLOG_DBG("Found a deleted port %s", sh_node->name);
+                del_old_port(sh_node);
+                rc++;
+            }
         }
     }
 
     /* Add new ports. */
-    SHASH_FOR_EACH(sh_node, &sh_idl_ports) {
-        struct port_data *portp = shash_find_data(&all_ports, sh_node->name);
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        struct port_data *portp;
+
+        if (IDL_PORT_ROW_DELETED(row)) {
+            continue;
+        }
+        portp = shash_find_data(&all_ports, row->name);
         if (!portp) {
-            VLOG_DBG("Found an added port %s", sh_node->name);
-            add_new_port(sh_node->data);
+            VLOG_DBG("Found an added port %s", row->name);
+            add_new_port(row);
+        } else if (OVSREC_IDL_IS_ROW_INSERTED(row, idl_seqno)) {
+            /* Row replaced, e.g. after the IDL reconnected. */
+            portp->cfg = row;
+            portp->bond_status_valid = false;
         }
     }
 
     /* Check for changes in the port row entries. */
-    SHASH_FOR_EACH(sh_node, &all_ports) {
-        const struct ovsrec_port *row = shash_find_data(&sh_idl_ports,
-                                                        sh_node->name);
+    OVSREC_PORT_FOR_EACH_TRACKED(row, idl) {
+        struct port_data *portp;
+
+        if (IDL_PORT_ROW_DELETED(row)) {
+            continue;
+        }
+
+        portp = shash_find_data(&all_ports, row->name);
+        if (portp == NULL || portp->cfg != row) {
+            continue;
+        }
+
         /* Check for changes to row. */
         if (OVSREC_IDL_IS_ROW_INSERTED(row, idl_seqno) ||
             OVSREC_IDL_IS_ROW_MODIFIED(row, idl_seqno)) {
-            struct port_data *portp = sh_node->data;
 
             if (OVSREC_IDL_IS_ROW_INSERTED(row, idl_seqno)) {
                 portp->timeout_mode = LACP_PORT_TIMEOUT_DEFAULT;
@@ -2188,9 +2518,6 @@ update_port_cache(void)
         shash_delete(&interfaces_recently_added, sh_node);
     }
 
-    /* Destroy the shash of the IDL ports. */
-    shash_destroy(&sh_idl_ports);
-
     return rc;
 } /* update_port_cache */
 
@@ -2265,6 +2592,43 @@ update_system_prio_n_id(const struct ovsrec_system *sys, bool lacpd_init)
 /* update_system_prio_n_id */
 
 
+/**
+ * Ends the warm restart holds taken by add_new_interface().  Once the
+ * Ports table has been processed, an interface that still runs LACP has
+ * been handed to the protocol thread, which either restores it or
+ * detaches it; any other interface is no longer in the LAG the previous
+ * lacpd had it in, and is cleared the way add_new_interface() would have.
+ */
+static void
+release_checkpoint_holds(void)
+{
+    struct shash_node *node;
+
+    SHASH_FOR_EACH(node, &all_interfaces) {
+        struct iface_data *idp = node->data;
+
+        if (!idp->ckpt_hold) {
+            continue;
+        }
+
+        idp->ckpt_hold = false;
+        n_ckpt_holds--;
+
+        if (idp->lag_eligible && idp->lacp_state == LACP_STATE_ENABLED) {
+            continue;
+        }
+
+        update_interface_hw_bond_config_map_entry(
+            idp,
+            INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
+            INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+        update_interface_hw_bond_config_map_entry(
+            idp,
+            INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
+            INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE);
+    }
+} /* release_checkpoint_holds */
+
 static int
 lacpd_reconfigure(void)
 {
@@ -2277,6 +2641,10 @@ lacpd_reconfigure(void)
         return 0;
     }
 
+    /* Hand the protocol thread everything below in as few events
+     * as possible. */
+    cfg_batch_begin();
+
     /* Update system priority and system id */
     sys = ovsrec_system_first(idl);
     update_system_prio_n_id(sys, false);
@@ -2291,8 +2659,21 @@ lacpd_reconfigure(void)
         rc++;
     }
 
+    if (n_ckpt_holds) {
+        release_checkpoint_holds();
+        rc++;
+    }
+
+    /* Each LAG whose members changed, once. */
+    if (flush_port_bond_status()) {
+        rc++;
+    }
+
+    cfg_batch_end();
+
     /* Update IDL sequence # after we've handled everything. */
     idl_seqno = new_idl_seqno;
+    ovsdb_idl_track_clear(idl);
 
     return rc;
 } /* lacpd_reconfigure */
@@ -2318,11 +2699,10 @@ lacpd_chk_for_system_configured(void)
 
 } /* lacpd_chk_for_system_configured */
 
-static char *
-format_system_id(system_variables_t *system_id)
+static void
+format_system_id(const system_variables_t *system_id, char *buf, size_t size)
 {
-    char *result = NULL;
-    asprintf(&result, "%d,%02x:%02x:%02x:%02x:%02x:%02x",
+    snprintf(buf, size, "%d,%02x:%02x:%02x:%02x:%02x:%02x",
              ntohs(system_id->system_priority),
              htons(system_id->system_mac_addr[0]) >> 8,
              htons(system_id->system_mac_addr[0]) & 0xff,
@@ -2330,49 +2710,40 @@ format_system_id(system_variables_t *system_id)
              htons(system_id->system_mac_addr[1]) & 0xff,
              htons(system_id->system_mac_addr[2]) >> 8,
              htons(system_id->system_mac_addr[2]) & 0xff);
-
-    return result;
 }
 
-static char *
-format_port_id(u_short port_priority, u_short port_number)
+static void
+format_port_id(u_short port_priority, u_short port_number,
+               char *buf, size_t size)
 {
-    char *result = NULL;
-    asprintf(&result, "%d,%d", ntohs(port_priority), ntohs(port_number));
-
-    return result;
+    snprintf(buf, size, "%d,%d", ntohs(port_priority), ntohs(port_number));
 }
 
-static char *
-format_key(u_short key)
+static void
+format_key(u_short key, char *buf, size_t size)
 {
-    char *result = NULL;
-    asprintf(&result, "%d", ntohs(key));
-
-    return result;
+    snprintf(buf, size, "%d", ntohs(key));
 }
 
-static char *
-format_state(state_parameters_t state)
-{
-    char *result = NULL;
-    asprintf(&result,
-             INTERFACE_LACP_STATUS_STATE_ACTIVE
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_TIMEOUT
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_AGGREGATION
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_SYNCHRONIZATION
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_COLLECTING
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_DISTRIBUTING
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_DEFAULTED
-             ":%c,"
-             INTERFACE_LACP_STATUS_STATE_EXPIRED
-             ":%c",
+#define LACP_STATUS_STATE_FORMAT \
+    INTERFACE_LACP_STATUS_STATE_ACTIVE ":%c," \
+    INTERFACE_LACP_STATUS_STATE_TIMEOUT ":%c," \
+    INTERFACE_LACP_STATUS_STATE_AGGREGATION ":%c," \
+    INTERFACE_LACP_STATUS_STATE_SYNCHRONIZATION ":%c," \
+    INTERFACE_LACP_STATUS_STATE_COLLECTING ":%c," \
+    INTERFACE_LACP_STATUS_STATE_DISTRIBUTING ":%c," \
+    INTERFACE_LACP_STATUS_STATE_DEFAULTED ":%c," \
+    INTERFACE_LACP_STATUS_STATE_EXPIRED ":%c"
+
+/* Each %c becomes one character, so the format is as long as the
+ * result. */
+BUILD_ASSERT_DECL(sizeof(LACP_STATUS_STATE_FORMAT) <=
+                  sizeof(((struct lacp_status_values *)NULL)->state));
+
+static void
+format_state(state_parameters_t state, char *buf, size_t size)
+{
+    snprintf(buf, size, LACP_STATUS_STATE_FORMAT,
              state.lacp_activity ? '1' : '0',
              state.lacp_timeout ? '1' : '0',
              state.aggregation ? '1' : '0',
@@ -2381,23 +2752,164 @@ format_state(state_parameters_t state)
              state.distributing ? '1' : '0',
              state.defaulted ? '1' : '0',
              state.expired ? '1' : '0');
-
-    return result;
 }
 
-static void
-db_clear_interface(struct iface_data *idp)
-{
-    bool *bptr = NULL;
-    const struct ovsrec_interface *ifrow;
-    struct smap smap;
+/* lacp_status_refresh() results */
+#define LACP_STATUS_SYSTEM_ID   0x1
+#define LACP_STATUS_PORT_ID     0x2
+#define LACP_STATUS_KEY         0x4
+#define LACP_STATUS_STATE       0x8
+
+/* lacp_status keys of one side. */
+struct lacp_status_keys {
+    const char *system_id;
+    const char *port_id;
+    const char *key;
+    const char *state;
+};
 
-    /*
-     * Note that this can only be called in the context of
-     * the idl loop, so we are already holding the OVSDB_LOCK.
-     * More specifically, we've scheduled a txn, so we don't
-     * need to call ovsdb_idl_txn_create(), either.
-     */
+static const struct lacp_status_keys actor_status_keys = {
+    INTERFACE_LACP_STATUS_MAP_ACTOR_SYSTEM_ID,
+    INTERFACE_LACP_STATUS_MAP_ACTOR_PORT_ID,
+    INTERFACE_LACP_STATUS_MAP_ACTOR_KEY,
+    INTERFACE_LACP_STATUS_MAP_ACTOR_STATE,
+};
+
+static const struct lacp_status_keys partner_status_keys = {
+    INTERFACE_LACP_STATUS_MAP_PARTNER_SYSTEM_ID,
+    INTERFACE_LACP_STATUS_MAP_PARTNER_PORT_ID,
+    INTERFACE_LACP_STATUS_MAP_PARTNER_KEY,
+    INTERFACE_LACP_STATUS_MAP_PARTNER_STATE,
+};
+
+static bool
+same_system(const system_variables_t *a, const system_variables_t *b)
+{
+    /* Not memcmp(): the structure has padding. */
+    return (a->system_priority == b->system_priority &&
+            !memcmp(a->system_mac_addr, b->system_mac_addr,
+                    sizeof a->system_mac_addr));
+}
+
+/**
+ * Brings one side's formatted lacp_status values up to date with the
+ * raw values reported by the protocol thread.  Only the values whose
+ * raw bytes changed are formatted again.
+ *
+ * @return the LACP_STATUS_* bits of the values that changed.
+ */
+static int
+lacp_status_refresh(struct lacp_status_values *vals,
+                    const system_variables_t *system,
+                    u_short port_priority, u_short port_number,
+                    u_short key, state_parameters_t state)
+{
+    int changed = 0;
+
+    if (!vals->valid || !same_system(&vals->system, system)) {
+        vals->system = *system;
+        format_system_id(system, vals->system_id, sizeof vals->system_id);
+        changed |= LACP_STATUS_SYSTEM_ID;
+    }
+
+    if (!vals->valid || vals->port_priority != port_priority ||
+        vals->port_number != port_number) {
+        vals->port_priority = port_priority;
+        vals->port_number = port_number;
+        format_port_id(port_priority, port_number,
+                       vals->port_id, sizeof vals->port_id);
+        changed |= LACP_STATUS_PORT_ID;
+    }
+
+    if (!vals->valid || vals->key_value != key) {
+        vals->key_value = key;
+        format_key(key, vals->key, sizeof vals->key);
+        changed |= LACP_STATUS_KEY;
+    }
+
+    if (!vals->valid ||
+        memcmp(&vals->state_value, &state, sizeof state) != 0) {
+        vals->state_value = state;
+        format_state(state, vals->state, sizeof vals->state);
+        changed |= LACP_STATUS_STATE;
+    }
+
+    vals->valid = true;
+
+    return changed;
+}
+
+/* Puts the values that lacp_status_refresh() reported changed in
+ * smap. */
+static void
+lacp_status_put(struct smap *smap, const char *name,
+                const struct lacp_status_values *vals,
+                const struct lacp_status_keys *keys, int changed)
+{
+    const char *key = NULL;
+    const char *value = NULL;
+    int bit;
+
+    for (bit = LACP_STATUS_SYSTEM_ID; bit <= LACP_STATUS_STATE; bit <<= 1) {
+        if (!(changed & bit)) {
+            continue;
+        }
+
+        switch (bit) {
+        case LACP_STATUS_SYSTEM_ID:
+            key = keys->system_id;
+            value = vals->system_id;
+            break;
+        case LACP_STATUS_PORT_ID:
+            key = keys->port_id;
+            value = vals->port_id;
+            break;
+        case LACP_STATUS_KEY:
+            key = keys->key;
+            value = vals->key;
+            break;
+        case LACP_STATUS_STATE:
+            key = keys->state;
+            value = vals->state;
+            break;
+        }
+
+        smap_replace(smap, key, value);
+        VLOG_DBG("updating interface %s (lacp_status:%s = %s)",
+                 name, key, value);
+    }
+}
+
+/* Returns the bond_speed value for portp's lag_member_speed if it is
+ * not the one last set, NULL if it is. */
+static const char *
+port_speed_update(struct port_data *portp)
+{
+    if (portp->speed_set && portp->speed == portp->lag_member_speed) {
+        return NULL;
+    }
+
+    portp->speed_set = true;
+    portp->speed = portp->lag_member_speed;
+    snprintf(portp->speed_str, sizeof portp->speed_str, "%d",
+             portp->lag_member_speed);
+
+    return portp->speed_str;
+}
+
+static void
+db_clear_interface(struct iface_data *idp)
+{
+    bool *bptr = NULL;
+    const struct ovsrec_interface *ifrow;
+    struct smap smap;
+
+    /*
+     * Note that this can only be called in the context of
+     * the idl loop, so we are already holding the OVSDB_LOCK.
+     * More specifically, we've scheduled a txn, so we don't
+     * need to call ovsdb_idl_txn_create(), either.
+     */
 
     VLOG_DBG("clearing interface %s lacpd status", idp->name);
 
@@ -2412,262 +2924,146 @@ db_clear_interface(struct iface_data *idp)
     idp->lacp_current = false;
     idp->lacp_current_set = false;
 
-    free(idp->actor.system_id);
-    idp->actor.system_id = NULL;
-    free(idp->actor.port_id);
-    idp->actor.port_id = NULL;
-    free(idp->actor.key);
-    idp->actor.key = NULL;
-    free(idp->actor.state);
-    idp->actor.state = NULL;
-
-    free(idp->partner.system_id);
-    idp->partner.system_id = NULL;
-    free(idp->partner.port_id);
-    idp->partner.port_id = NULL;
-    free(idp->partner.key);
-    idp->partner.key = NULL;
-    free(idp->partner.state);
-    idp->partner.state = NULL;
+    memset(&idp->actor, 0, sizeof idp->actor);
+    memset(&idp->partner, 0, sizeof idp->partner);
 
     smap_destroy(&smap);
 }
 
-void
-db_update_interface(lacp_per_port_variables_t *plpinfo)
+/* Wakes up the OVSDB thread to flush.  Called holding wb_mutex. */
+static void
+db_writeback_kick(void)
+{
+    if (!wb_pending) {
+        wb_pending = true;
+        latch_set(&wb_latch);
+    }
+} /* db_writeback_kick */
+
+/**
+ * Writes the LACP status of one interface to the IDL.  Runs in the OVSDB
+ * thread as part of the write-back transaction.
+ */
+static void
+db_apply_interface_status(struct iface_data *idp,
+                          struct iface_status_snapshot *snap)
 {
-    struct iface_data *idp = NULL;
-    int port = PM_HANDLE2PORT(plpinfo->lport_handle);
     const struct ovsrec_interface *ifrow;
     bool lacp_current;
-    struct ovsdb_idl_txn *txn = NULL;
-    bool changes = false;
-    bool smap_changes = false;
-    char *system_id, *port_id, *key, *state;
+    int actor_changed, partner_changed;
     struct smap smap;
     struct port_data *portp;
 
-    OVSDB_LOCK;
-
-    /* get interface data */
-    idp = find_iface_data_by_index(port);
-
-    if (idp == NULL) {
-        VLOG_WARN("Unable to find interface for hardware index %d", port);
-        goto end;
-    }
-
     portp = idp->port_datap;
 
     if (!portp) {
         VLOG_WARN("Interface doesn't have any port");
-        goto end;
+        return;
     }
 
     if (portp->lacp_mode == PORT_LACP_OFF) {
         VLOG_WARN("Interface lacp mode is off");
-        goto end;
+        return;
     }
 
-    idp->local_state = plpinfo->actor_oper_port_state;
+    idp->local_state = snap->actor_state;
 
     ifrow = idp->cfg;
 
-    txn = ovsdb_idl_txn_create(idl);
-
-    smap_clone(&smap, &ifrow->lacp_status);
-
-    /* actor data */
-    system_id = format_system_id(&plpinfo->actor_oper_system_variables);
-    port_id = format_port_id(plpinfo->actor_oper_port_priority, plpinfo->actor_oper_port_number);
-    key = format_key(plpinfo->actor_oper_port_key);
-    state = format_state(plpinfo->actor_oper_port_state);
-
-    if (idp->actor.system_id == NULL ||
-        strcmp(idp->actor.system_id, system_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_SYSTEM_ID, system_id);
-        free(idp->actor.system_id);
-        idp->actor.system_id = system_id;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:actor_system_id = %s)",
-            idp->name, system_id);
-    } else {
-        free(system_id);
-    }
-
-    if (idp->actor.port_id == NULL ||
-        strcmp(idp->actor.port_id, port_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_PORT_ID, port_id);
-        free(idp->actor.port_id);
-        idp->actor.port_id = port_id;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:actor_port_id = %s)",
-            idp->name, port_id);
-    } else {
-        free(port_id);
-    }
-
-    if (idp->actor.key == NULL ||
-        strcmp(idp->actor.key, key) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_KEY, key);
-        free(idp->actor.key);
-        idp->actor.key = key;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:actor_key = %s)",
-            idp->name, key);
-    } else {
-        free(key);
-    }
-
-    if (idp->actor.state == NULL ||
-        strcmp(idp->actor.state, state) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_ACTOR_STATE, state);
-        free(idp->actor.state);
-        idp->actor.state = state;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:actor_state = %s)",
-            idp->name, state);
-    } else {
-        free(state);
-    }
-
-    /* partner data */
-    system_id = format_system_id(&plpinfo->partner_oper_system_variables);
-    port_id = format_port_id(plpinfo->partner_oper_port_priority, plpinfo->partner_oper_port_number);
-    key = format_key(plpinfo->partner_oper_key);
-    state = format_state(plpinfo->partner_oper_port_state);
-
-    if (idp->partner.system_id == NULL ||
-        strcmp(idp->partner.system_id, system_id) != 0) {
-        if (strncmp(system_id, NO_SYSTEM_ID, strlen(NO_SYSTEM_ID))) {
-            if (portp &&
-                log_event("LACP_PARTNER_DETECTED",
-                          EV_KV("intf_id", "%s", idp->name),
-                          EV_KV("lag_id", "%s",
-                                portp->name +
-                                    LAG_PORT_NAME_PREFIX_LENGTH),
-                          EV_KV("partner_sys_id", "%s", system_id)) < 0) {
-                VLOG_ERR("Could not log event LACP_PARTNER_DETECTED");
-            }
+    actor_changed = lacp_status_refresh(&idp->actor, &snap->actor_system,
+                                        snap->actor_port_priority,
+                                        snap->actor_port_number,
+                                        snap->actor_key, snap->actor_state);
+    partner_changed = lacp_status_refresh(&idp->partner,
+                                          &snap->partner_system,
+                                          snap->partner_port_priority,
+                                          snap->partner_port_number,
+                                          snap->partner_key,
+                                          snap->partner_state);
+
+    if ((partner_changed & LACP_STATUS_SYSTEM_ID) &&
+        strncmp(idp->partner.system_id, NO_SYSTEM_ID, strlen(NO_SYSTEM_ID))) {
+        if (log_event("LACP_PARTNER_DETECTED",
+                      EV_KV("intf_id", "%s", idp->name),
+                      EV_KV("lag_id", "%s",
+                            portp->name + LAG_PORT_NAME_PREFIX_LENGTH),
+                      EV_KV("partner_sys_id", "%s",
+                            idp->partner.system_id)) < 0) {
+            VLOG_ERR("Could not log event LACP_PARTNER_DETECTED");
         }
-
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_SYSTEM_ID, system_id);
-        free(idp->partner.system_id);
-        idp->partner.system_id = system_id;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:partner_system_id = %s)",
-            idp->name, system_id);
-    } else {
-        free(system_id);
-    }
-
-    if (idp->partner.port_id == NULL ||
-        strcmp(idp->partner.port_id, port_id) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_PORT_ID, port_id);
-        free(idp->partner.port_id);
-        idp->partner.port_id = port_id;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:partner_port_id = %s)",
-            idp->name, port_id);
-    } else {
-        free(port_id);
     }
 
-    if (idp->partner.key == NULL ||
-        strcmp(idp->partner.key, key) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_KEY, key);
-        free(idp->partner.key);
-        idp->partner.key = key;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:partner_key = %s)",
-            idp->name, key);
-    } else {
-        free(key);
-    }
-
-    if (idp->partner.state == NULL ||
-        strcmp(idp->partner.state, state) != 0) {
-        smap_replace(&smap, INTERFACE_LACP_STATUS_MAP_PARTNER_STATE, state);
-        free(idp->partner.state);
-        idp->partner.state = state;
-        smap_changes = true;
-        VLOG_DBG("updating interface %s (lacp_status:partner_state = %s)",
-            idp->name, state);
-    } else {
-        free(state);
-    }
-
-    if (smap_changes) {
+    if (actor_changed || partner_changed) {
+        smap_clone(&smap, &ifrow->lacp_status);
+        lacp_status_put(&smap, idp->name, &idp->actor, &actor_status_keys,
+                        actor_changed);
+        lacp_status_put(&smap, idp->name, &idp->partner,
+                        &partner_status_keys, partner_changed);
         ovsrec_interface_set_lacp_status(ifrow, &smap);
-        changes = true;
+        smap_destroy(&smap);
     }
 
-    smap_destroy(&smap);
-
     /* lacp_current data */
-    lacp_current = (plpinfo->recv_fsm_state == RECV_FSM_CURRENT_STATE);
+    lacp_current = snap->lacp_current;
 
     if (idp->lacp_current_set == false || idp->lacp_current != lacp_current) {
         ovsrec_interface_set_lacp_current(ifrow, &lacp_current, 1);
         VLOG_DBG("updating interface %s (lacp_current = %s)", idp->name,
             lacp_current ? "true" : "false");
-        changes = true;
         idp->lacp_current = lacp_current;
         idp->lacp_current_set = true;
     }
 
-    if (changes) {
-        ovsdb_idl_txn_commit_block(txn);
-    } else {
-        ovsdb_idl_txn_abort(txn);
+    if (snap->lag_speed_valid) {
+        portp->lag_member_speed = snap->lag_member_speed;
     }
-    ovsdb_idl_txn_destroy(txn);
+    portp->status_dirty = true;
+} /* db_apply_interface_status */
 
-    if (portp) {
-        if (plpinfo->lag != NULL) {
-            portp->lag_member_speed = lport_type_to_speed(ntohs(plpinfo->lag->port_type));
-        }
-        db_update_port_status(portp);
-    }
-
-end:
-    OVSDB_UNLOCK;
-} /* db_update_interface */
-
-/**********************************************************************
- * Pool implementation: this is diferrent from the LAG pool manager.
- * This is currently only used for allocating interface indexes.
- **********************************************************************/
-int
-allocate_next(unsigned char *pool, int size)
+/**
+ * Queues the LACP status of the port for write-back to OVSDB.  Called
+ * by the protocol thread after every state machine change; repeated
+ * updates of the same interface before the next flush coalesce.
+ */
+void
+db_update_interface(lacp_per_port_variables_t *plpinfo)
 {
-    int idx = 0;
+    int index = PM_HANDLE2PORT(plpinfo->lport_handle);
+    struct iface_status_snapshot *snap;
 
-    while (pool[idx] == 0xff && (idx * BITS_PER_BYTE) < size) {
-        idx++;
+    if (index < 0 || index >= MAX_ENTRIES_IN_POOL) {
+        VLOG_WARN("Unable to find interface for hardware index %d", index);
+        return;
     }
 
-    if ((idx * BITS_PER_BYTE) < size) {
-        idx *= BITS_PER_BYTE;
-
-        while (idx < size && !IS_AVAILABLE(pool, idx)) {
-            idx++;
-        }
+    pthread_mutex_lock(&wb_mutex);
+
+    snap = &wb_iface_status[index];
+    snap->actor_system = plpinfo->actor_oper_system_variables;
+    snap->actor_port_priority = plpinfo->actor_oper_port_priority;
+    snap->actor_port_number = plpinfo->actor_oper_port_number;
+    snap->actor_key = plpinfo->actor_oper_port_key;
+    snap->actor_state = plpinfo->actor_oper_port_state;
+    snap->partner_system = plpinfo->partner_oper_system_variables;
+    snap->partner_port_priority = plpinfo->partner_oper_port_priority;
+    snap->partner_port_number = plpinfo->partner_oper_port_number;
+    snap->partner_key = plpinfo->partner_oper_key;
+    snap->partner_state = plpinfo->partner_oper_port_state;
+    snap->lacp_current = (plpinfo->recv_fsm_state == RECV_FSM_CURRENT_STATE);
+    snap->lag_speed_valid = (plpinfo->lag != NULL);
+    if (plpinfo->lag != NULL) {
+        snap->lag_member_speed = lport_type_to_speed(ntohs(plpinfo->lag->port_type));
+    }
 
-        if (idx < size && IS_AVAILABLE(pool, idx)) {
-            SET(pool, idx);
-            return idx;
-        }
+    if (!wb_iface_dirty[index]) {
+        wb_iface_dirty[index] = true;
+        wb_dirty_index[wb_n_dirty++] = index;
     }
 
-    return -1;
-} /* allocate_next */
+    db_writeback_kick();
 
-static void
-free_index(unsigned char *pool, int idx)
-{
-    CLEAR(pool, idx);
-} /* free_index */
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_update_interface */
 
 /**@} end of lacpd_ovsdb_if group */
 
@@ -2708,6 +3104,9 @@ lacpd_run(void)
         ovsdb_idl_txn_destroy(txn);
     }
 
+    /* Write back LACP status reported by the protocol thread. */
+    db_writeback_flush();
+
     OVSDB_UNLOCK;
 
     return;
@@ -2716,67 +3115,87 @@ lacpd_run(void)
 void
 lacpd_wait(void)
 {
+    /* No periodic wakeup: the IDL, the write-back latch and the
+     * unixctl server cover everything this thread acts on. */
     ovsdb_idl_wait(idl);
-    poll_timer_wait(LACP_POLL_INTERVAL);
+    db_writeback_wait();
 } /* lacpd_wait */
 
 /**********************************************************************/
 /* Interface attach/detach functions called from LACP state machine.  */
 /**********************************************************************/
+/* Called from the write-back flush, within its transaction.  The
+ * LACP state is checked here rather than by the caller since the
+ * configuration may have changed after the request was queued. */
 static void
-lacpd_thread_intf_update_hw_bond_config(struct iface_data *idp,
-                                        bool update_rx, bool rx_enabled,
-                                        bool update_tx, bool tx_enabled)
+db_apply_hw_bond_config(struct writeback_op *op)
 {
-    struct ovsdb_idl_txn *txn;
+    struct iface_data *idp;
 
-    OVSDB_LOCK;
-    txn = ovsdb_idl_txn_create(idl);
-    if (update_rx) {
+    idp = find_iface_data_by_index(op->index);
+    if (idp == NULL) {
+        VLOG_DBG("Interface index %d went away before its hw_bond_config "
+                 "update", op->index);
+        return;
+    }
+
+    if (idp->lacp_state != LACP_STATE_ENABLED) {
+        /* Probably just a race condition between static <-> dynamic
+         * LAG conversion.  Ignore the request. */
+        VLOG_DBG("Ignoring hw_bond_config update from LACP state "
+                 "machine. LACP is not enabled on %d", op->index);
+        return;
+    }
+
+    if (op->update_rx) {
         update_interface_hw_bond_config_map_entry(
             idp,
             INTERFACE_HW_BOND_CONFIG_MAP_RX_ENABLED,
-            (rx_enabled ?
+            (op->rx_enabled ?
              INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
              INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
-
-        update_member_interface_bond_status(idp->port_datap);
-        update_port_bond_status_map_entry(idp->port_datap);
     }
-    if (update_tx) {
+    if (op->update_tx) {
         update_interface_hw_bond_config_map_entry(
             idp,
             INTERFACE_HW_BOND_CONFIG_MAP_TX_ENABLED,
-            (tx_enabled ?
+            (op->tx_enabled ?
              INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_TRUE :
              INTERFACE_HW_BOND_CONFIG_MAP_ENABLED_FALSE));
-
-        update_member_interface_bond_status(idp->port_datap);
-        update_port_bond_status_map_entry(idp->port_datap);
     }
 
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
-    OVSDB_UNLOCK;
+    if (idp->port_datap) {
+        update_lag_member_bond_status(idp);
+        /* Once per LAG, after all its members (db_writeback_flush()). */
+        idp->port_datap->bond_dirty = true;
+    }
 
-} /* ops_intf_update_hw_bond_config */
+    if (op->lat_start) {
+        idp->lat_start = op->lat_start;
+        idp->lat_queued = op->lat_queued;
+        idp->lat_applied = lacp_latency_now();
+        if (!idp->lat_in_txn) {
+            idp->lat_in_txn = true;
+            wb_lat_index[wb_n_lat++] = idp->index;
+        }
+    }
+} /* db_apply_hw_bond_config */
 
 void
 ops_attach_port_in_hw(uint16_t lag_id, int port)
 {
-    struct iface_data *idp = NULL;
+    struct lacpd_iface_cfg cfg;
 
     VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
 
-    idp = find_iface_data_by_index(port);
-    if (idp) {
-        if (idp->lacp_state == LACP_STATE_ENABLED) {
+    if (lacpd_iface_cfg_get(port, &cfg)) {
+        if (cfg.lacp_enabled) {
             /* Attaching port means just RX. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    true,   /* update_rx */
-                                                    true,   /* rx_enabled */
-                                                    false,  /* update_tx */
-                                                    false); /* tx_enabled */
+            db_writeback_queue_hw_bond_op(port,
+                                          true,   /* update_rx */
+                                          true,   /* rx_enabled */
+                                          false,  /* update_tx */
+                                          false); /* tx_enabled */
         } else {
             VLOG_ERR("LACP state machine trying to attach port %d "
                      "when LACP is not enabled!", port);
@@ -2790,19 +3209,18 @@ ops_attach_port_in_hw(uint16_t lag_id, int port)
 void
 ops_detach_port_in_hw(uint16_t lag_id, int port)
 {
-    struct iface_data *idp = NULL;
+    struct lacpd_iface_cfg cfg;
 
     VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
 
-    idp = find_iface_data_by_index(port);
-    if (idp) {
-        if (idp->lacp_state == LACP_STATE_ENABLED) {
+    if (lacpd_iface_cfg_get(port, &cfg)) {
+        if (cfg.lacp_enabled) {
             /* Detaching port means both RX/TX are disabled. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    true,   /* update_rx */
-                                                    false,  /* rx_enabled */
-                                                    true,   /* update_tx */
-                                                    false); /* tx_enabled */
+            db_writeback_queue_hw_bond_op(port,
+                                          true,   /* update_rx */
+                                          false,  /* rx_enabled */
+                                          true,   /* update_tx */
+                                          false); /* tx_enabled */
         } else {
             /* Probably just a race condition between static <-> dynamic
              * LAG conversion.  Ignore the request. */
@@ -2819,19 +3237,18 @@ ops_detach_port_in_hw(uint16_t lag_id, int port)
 void
 ops_trunk_port_egr_enable(uint16_t lag_id, int port)
 {
-    struct iface_data *idp = NULL;
+    struct lacpd_iface_cfg cfg;
 
     VLOG_DBG("%s: lag_id=%d, port=%d", __FUNCTION__, lag_id, port);
 
-    idp = find_iface_data_by_index(port);
-    if (idp) {
-        if (idp->lacp_state == LACP_STATE_ENABLED) {
+    if (lacpd_iface_cfg_get(port, &cfg)) {
+        if (cfg.lacp_enabled) {
             /* Egress enable means TX. */
-            lacpd_thread_intf_update_hw_bond_config(idp,
-                                                    false, /* update_rx */
-                                                    false, /* rx_enabled */
-                                                    true,  /* update_tx */
-                                                    true); /* tx_enabled */
+            db_writeback_queue_hw_bond_op(port,
+                                          false, /* update_rx */
+                                          false, /* rx_enabled */
+                                          true,  /* update_tx */
+                                          true); /* tx_enabled */
         } else {
             VLOG_ERR("LACP state machine trying to enable egress on "
                      "port %d when LACP is not enabled!", port);
@@ -2842,14 +3259,14 @@ ops_trunk_port_egr_enable(uint16_t lag_id, int port)
     }
 } /* ops_trunk_port_egr_enable */
 
+/* Called from the write-back flush, within its transaction. */
 static void
 db_update_port_status(struct port_data *portp)
 {
     const struct ovsrec_port *prow;
     struct smap smap;
-    struct ovsdb_idl_txn *txn;
     bool changed = false;
-    char *speed_str;
+    const char *speed_str;
 
     prow = portp->cfg;
 
@@ -2938,230 +3355,686 @@ db_update_port_status(struct port_data *portp)
     }
 
     /* update speed */
-    asprintf(&speed_str, "%d", portp->lag_member_speed);
-    if (portp->speed_str == NULL || strcmp(speed_str, portp->speed_str) != 0) {
-        free(portp->speed_str);
-        portp->speed_str = speed_str;
+    speed_str = port_speed_update(portp);
+    if (speed_str) {
         smap_replace(&smap, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
         changed = true;
-    } else {
-        free(speed_str);
     }
 
     if (changed) {
-        txn = ovsdb_idl_txn_create(idl);
-
         ovsrec_port_set_lacp_status(prow, &smap);
-        update_port_bond_status_map_entry(portp);
-
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
+        portp->bond_dirty = true;
     }
 
     smap_destroy(&smap);
 } /* db_update_port_status */
 
-void
-db_add_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+static void
+db_apply_add_lag_port(struct writeback_op *op)
 {
     struct port_data *portp;
     struct iface_data *idp;
-    int index;
-
-    OVSDB_LOCK;
+    uint16_t lag_id = op->lag_id;
+    int port = op->port;
 
     /* get port data */
     portp = find_port_data_by_lag_id(lag_id);
 
     if (portp == NULL) {
         VLOG_WARN("Port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+        return;
     }
 
-    index = PM_HANDLE2PORT(plpinfo->lport_handle);
-    idp = find_iface_data_by_index(index);
+    idp = find_iface_data_by_index(op->index);
 
     if (idp == NULL) {
         VLOG_WARN("Interface not configured in LAG. lag_id = %d, port = %d",
                   lag_id, port);
-        goto end;
+        return;
     }
 
-    idp->local_state = plpinfo->actor_oper_port_state;
+    /* The status snapshot applied in this flush, if any, is newer. */
+    if (!idp->status_in_txn) {
+        idp->local_state = op->local_state;
+    }
 
     shash_add_once(&portp->participant_ifs, idp->name, idp);
 
     VLOG_DBG("Added interface (%d) to lag (%d): %d participants", port, lag_id, (int)shash_count(&portp->participant_ifs));
 
-    if (plpinfo->lag != NULL) {
-        portp->lag_member_speed = lport_type_to_speed(ntohs(plpinfo->lag->port_type));
+    if (op->lag_speed_valid && !idp->status_in_txn) {
+        portp->lag_member_speed = op->lag_member_speed;
+        VLOG_DBG("setting speed: %d\n", portp->lag_member_speed);
+    }
+
+    portp->status_dirty = true;
+
+} /* db_apply_add_lag_port */
+
+static void
+db_apply_delete_lag_port(struct writeback_op *op)
+{
+    struct port_data *portp;
+    struct iface_data *idp;
+    struct shash_node *node;
+    uint16_t lag_id = op->lag_id;
+    int port = op->port;
+
+    idp = find_iface_data_by_index(op->index);
+
+    if (idp == NULL) {
+        VLOG_WARN("Interface not configured in LAG. lag_id = %d, port = %d",
+                  lag_id, port);
+        return;
+    }
+
+    /* get port data */
+    portp = find_port_data_by_lag_id(lag_id);
+
+    if (portp == NULL) {
+        VLOG_WARN("Port not configured for LACP! lag_id = %d", lag_id);
+        db_clear_interface(idp);
+        return;
+    }
+
+    node = shash_find(&portp->participant_ifs, idp->name);
+    if (!node) {
+        VLOG_WARN("Interface %s is not in participant list for lag_id = %d", idp->name, lag_id);
+        return;
+    }
+    shash_delete(&portp->participant_ifs, node);
+
+    VLOG_DBG("Removed interface (%d) from lag (%d): %d participants",
+             port, lag_id, (int)shash_count(&portp->participant_ifs));
+
+    if (op->lag_speed_valid && !idp->status_in_txn) {
+        portp->lag_member_speed = op->lag_member_speed;
         VLOG_DBG("setting speed: %d\n", portp->lag_member_speed);
     }
 
-    db_update_port_status(portp);
-end:
-    OVSDB_UNLOCK;
+    portp->status_dirty = true;
+
+} /* db_apply_delete_lag_port */
+
+void
+db_clear_lag_partner_info_port(struct port_data *portp)
+{
+    const struct ovsrec_port *prow;
+    struct smap smap;
+
+    prow = portp->cfg;
+
+    smap_init(&smap);
+
+    /* set everything to empty */
+    ovsrec_port_set_lacp_status(prow, &smap);
+
+    smap_destroy(&smap);
+
+    portp->speed_set = false;
+    portp->current_status = STATUS_UNINITIALIZED;
+}
+
+static void
+db_apply_clear_lag_partner_info(struct writeback_op *op)
+{
+    struct port_data *portp;
+
+    /* get port */
+    portp = find_port_data_by_lag_id(op->lag_id);
+
+    if (portp == NULL) {
+        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", op->lag_id);
+        return;
+    }
+
+    db_clear_lag_partner_info_port(portp);
+
+} /* db_apply_clear_lag_partner_info */
+
+static void
+db_apply_update_lag_partner_info(struct writeback_op *op)
+{
+    const struct ovsrec_port *prow;
+    struct port_data *portp;
+    struct smap smap;
+    const char *speed_str;
+
+    /* get port */
+    portp = find_port_data_by_lag_id(op->lag_id);
+
+    if (portp == NULL) {
+        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", op->lag_id);
+        return;
+    }
+
+    prow = portp->cfg;
+
+    /* update speed */
+    speed_str = port_speed_update(portp);
+    if (speed_str) {
+        smap_clone(&smap, &prow->lacp_status);
+        smap_replace(&smap, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
+        ovsrec_port_set_lacp_status(prow, &smap);
+        smap_destroy(&smap);
+    }
+
+} /* db_apply_update_lag_partner_info */
+
+/* Updates a wb_hw_* counter.  Called holding wb_mutex. */
+#define db_writeback_count(counter, delta) \
+    __atomic_store_n((counter), *(counter) + (delta), __ATOMIC_RELAXED)
+
+/* Appends the list of changes from ops to *tail to the write-back
+ * queue.  n_merged hw_bond_config requests were folded into them. */
+static void
+db_writeback_publish(struct writeback_op *ops, struct writeback_op **tail,
+                     unsigned int n_merged)
+{
+    struct writeback_op *op;
+
+    pthread_mutex_lock(&wb_mutex);
+    *wb_ops_tail = ops;
+    wb_ops_tail = tail;
+    for (op = ops; op != NULL; op = op->next) {
+        if (op->type == WB_OP_HW_BOND_CONFIG) {
+            db_writeback_count(&wb_hw_in_flight[op->index], 1);
+            db_writeback_count(&wb_hw_queued, 1);
+        }
+    }
+    if (n_merged) {
+        db_writeback_count(&wb_hw_merged, n_merged);
+    }
+    db_writeback_kick();
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_writeback_publish */
+
+/* Folds a hw_bond_config request into the one staged for the same
+ * interface in this pass, if any: every field it updates takes its
+ * value, the latency trace going with the RX change. */
+static bool
+db_writeback_merge_hw_bond_op(const struct writeback_op *op)
+{
+    struct writeback_op *staged;
+
+    for (staged = wb_pass_ops; staged != NULL; staged = staged->next) {
+        if (staged->type != WB_OP_HW_BOND_CONFIG ||
+            staged->index != op->index) {
+            continue;
+        }
+
+        if (op->update_rx) {
+            staged->update_rx = true;
+            staged->rx_enabled = op->rx_enabled;
+            staged->lat_start = op->lat_start;
+            staged->lat_queued = op->lat_queued;
+        }
+        if (op->update_tx) {
+            staged->update_tx = true;
+            staged->tx_enabled = op->tx_enabled;
+        }
+        return true;
+    }
+
+    return false;
+} /* db_writeback_merge_hw_bond_op */
+
+/* Appends a LAG change to the write-back queue, or to the current
+ * pass. */
+static void
+db_writeback_append(struct writeback_op *op)
+{
+    if (wb_pass_ops_tail == NULL) {
+        db_writeback_publish(op, &op->next, 0);
+        return;
+    }
+
+    if (op->type == WB_OP_HW_BOND_CONFIG &&
+        db_writeback_merge_hw_bond_op(op)) {
+        free(op);
+        wb_pass_merged++;
+        return;
+    }
+
+    *wb_pass_ops_tail = op;
+    wb_pass_ops_tail = &op->next;
+} /* db_writeback_append */
+
+void
+db_writeback_pass_begin(void)
+{
+    wb_pass_ops = NULL;
+    wb_pass_ops_tail = &wb_pass_ops;
+    wb_pass_merged = 0;
+} /* db_writeback_pass_begin */
+
+void
+db_writeback_pass_end(void)
+{
+    if (wb_pass_ops != NULL) {
+        db_writeback_publish(wb_pass_ops, wb_pass_ops_tail, wb_pass_merged);
+    }
+    wb_pass_ops = NULL;
+    wb_pass_ops_tail = NULL;
+} /* db_writeback_pass_end */
+
+static void
+db_writeback_queue_op(enum writeback_op_type type, uint16_t lag_id)
+{
+    struct writeback_op *op;
+
+    op = xzalloc(sizeof *op);
+    op->type = type;
+    op->lag_id = lag_id;
+
+    db_writeback_append(op);
+} /* db_writeback_queue_op */
+
+static void
+db_writeback_queue_port_op(enum writeback_op_type type, uint16_t lag_id,
+                           int port, lacp_per_port_variables_t *plpinfo)
+{
+    struct writeback_op *op;
+
+    op = xzalloc(sizeof *op);
+    op->type = type;
+    op->lag_id = lag_id;
+    op->port = port;
+    op->index = PM_HANDLE2PORT(plpinfo->lport_handle);
+    op->local_state = plpinfo->actor_oper_port_state;
+    op->lag_speed_valid = (plpinfo->lag != NULL);
+    if (plpinfo->lag != NULL) {
+        op->lag_member_speed =
+            lport_type_to_speed(ntohs(plpinfo->lag->port_type));
+    }
+
+    db_writeback_append(op);
+} /* db_writeback_queue_port_op */
+
+static void
+db_writeback_queue_hw_bond_op(int index,
+                              bool update_rx, bool rx_enabled,
+                              bool update_tx, bool tx_enabled)
+{
+    struct writeback_op *op;
+
+    op = xzalloc(sizeof *op);
+    op->type = WB_OP_HW_BOND_CONFIG;
+    op->index = index;
+    op->update_rx = update_rx;
+    op->rx_enabled = rx_enabled;
+    op->update_tx = update_tx;
+    op->tx_enabled = tx_enabled;
+
+    if (update_rx && rx_enabled) {
+        lacp_per_port_variables_t *plpinfo = LACP_port_by_index(index);
+
+        /* Called from the mux machine, so the trace is current. */
+        op->lat_start = plpinfo ?
+            lacp_latency_trace_start(&LACP_PORT_COLD(plpinfo)->latency) : 0;
+        if (op->lat_start) {
+            op->lat_queued = lacp_latency_now();
+        }
+    }
+
+    db_writeback_append(op);
+} /* db_writeback_queue_hw_bond_op */
 
+void
+db_add_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
+{
+    db_writeback_queue_port_op(WB_OP_ADD_LAG_PORT, lag_id, port, plpinfo);
 } /* db_add_lag_port */
 
 void
 db_delete_lag_port(uint16_t lag_id, int port, lacp_per_port_variables_t *plpinfo)
 {
-    struct port_data *portp;
-    struct iface_data *idp;
+    db_writeback_queue_port_op(WB_OP_DELETE_LAG_PORT, lag_id, port, plpinfo);
+} /* db_delete_lag_port */
+
+void
+db_clear_lag_partner_info(uint16_t lag_id)
+{
+    db_writeback_queue_op(WB_OP_CLEAR_LAG_PARTNER, lag_id);
+} /* db_clear_lag_partner_info */
+
+void
+db_update_lag_partner_info(uint16_t lag_id)
+{
+    db_writeback_queue_op(WB_OP_UPDATE_LAG_PARTNER, lag_id);
+} /* db_update_lag_partner_info */
+
+/**
+ * Applies everything queued by the protocol thread since the last flush
+ * in one transaction.  Called from lacpd_run() holding OVSDB_LOCK.  The
+ * transaction is committed without blocking; while it is in flight new
+ * changes keep accumulating for the next one.
+ */
+static void
+db_writeback_flush(void)
+{
+    struct writeback_op *ops;
+    struct writeback_op *op;
+    enum ovsdb_idl_txn_status status;
+    struct iface_status_snapshot *snaps = NULL;
+    int *indexes = NULL;
+    int n_dirty;
+    int ii;
     struct shash_node *node;
-    int index;
-    struct ovsdb_idl_txn *txn = NULL;
 
-    OVSDB_LOCK;
+    if (wb_txn) {
+        status = ovsdb_idl_txn_commit(wb_txn);
+        if (status == TXN_INCOMPLETE) {
+            return;
+        }
+        if (status != TXN_SUCCESS && status != TXN_UNCHANGED) {
+            static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 5);
+            VLOG_WARN_RL(&rl, "LACP status write-back failed: %s",
+                         ovsdb_idl_txn_status_to_string(status));
+        }
+        db_writeback_txn_done(status);
+    }
 
-    index = PM_HANDLE2PORT(plpinfo->lport_handle);
-    idp = find_iface_data_by_index(index);
+    latch_poll(&wb_latch);
 
-    if (idp == NULL) {
-        VLOG_WARN("Interface not configured in LAG. lag_id = %d, port = %d",
-                  lag_id, port);
-        goto end;
+    pthread_mutex_lock(&wb_mutex);
+
+    if (!wb_pending ||
+        time_msec() < wb_last_flush + LACPD_DB_FLUSH_INTERVAL_MS) {
+        pthread_mutex_unlock(&wb_mutex);
+        return;
     }
 
-    /* get port data */
-    portp = find_port_data_by_lag_id(lag_id);
+    /* Take the queued changes so the protocol thread is not held up
+     * while the IDL is updated. */
+    ops = wb_ops;
+    wb_ops = NULL;
+    wb_ops_tail = &wb_ops;
+
+    n_dirty = wb_n_dirty;
+    if (n_dirty) {
+        snaps = xmalloc(n_dirty * sizeof *snaps);
+        indexes = xmalloc(n_dirty * sizeof *indexes);
+        for (ii = 0; ii < n_dirty; ii++) {
+            indexes[ii] = wb_dirty_index[ii];
+            snaps[ii] = wb_iface_status[indexes[ii]];
+            wb_iface_dirty[indexes[ii]] = false;
+        }
+    }
+    wb_n_dirty = 0;
+    wb_pending = false;
 
-    if (portp == NULL) {
-        VLOG_WARN("Port not configured for LACP! lag_id = %d", lag_id);
-        txn = ovsdb_idl_txn_create(idl);
+    pthread_mutex_unlock(&wb_mutex);
 
-        db_clear_interface(idp);
+    wb_last_flush = time_msec();
+    wb_txn = ovsdb_idl_txn_create(idl);
 
-        ovsdb_idl_txn_commit_block(txn);
-        ovsdb_idl_txn_destroy(txn);
+    /* The latest status of every interface that changed first, so the
+     * LAG level changes below see its current lag_member_speed. */
+    for (ii = 0; ii < n_dirty; ii++) {
+        struct iface_data *idp = find_iface_data_by_index(indexes[ii]);
 
-        goto end;
+        if (idp == NULL) {
+            VLOG_WARN("Unable to find interface for hardware index %d",
+                      indexes[ii]);
+            continue;
+        }
+        db_apply_interface_status(idp, &snaps[ii]);
+        idp->status_in_txn = true;
+        wb_status_index[wb_n_status++] = idp->index;
     }
+    free(snaps);
+    free(indexes);
 
-    node = shash_find(&portp->participant_ifs, idp->name);
-    if (!node) {
-        VLOG_WARN("Interface %s is not in participant list for lag_id = %d", idp->name, lag_id);
-        goto end;
-    }
-    shash_delete(&portp->participant_ifs, node);
+    /* Then LAG membership changes, in the order they were made. */
+    while ((op = ops) != NULL) {
+        ops = op->next;
 
-    VLOG_DBG("Removed interface (%d) from lag (%d): %d participants",
-             port, lag_id, (int)shash_count(&portp->participant_ifs));
+        switch (op->type) {
+        case WB_OP_ADD_LAG_PORT:
+            db_apply_add_lag_port(op);
+            break;
+        case WB_OP_DELETE_LAG_PORT:
+            db_apply_delete_lag_port(op);
+            break;
+        case WB_OP_UPDATE_LAG_PARTNER:
+            db_apply_update_lag_partner_info(op);
+            break;
+        case WB_OP_CLEAR_LAG_PARTNER:
+            db_apply_clear_lag_partner_info(op);
+            break;
+        case WB_OP_HW_BOND_CONFIG:
+            db_apply_hw_bond_config(op);
+            break;
+        }
 
-    if (plpinfo->lag != NULL) {
-        portp->lag_member_speed = lport_type_to_speed(plpinfo->lag->port_type);
-        VLOG_DBG("setting speed: %d\n", portp->lag_member_speed);
+        /* Kept until the transaction is done, see
+         * db_writeback_retire_ops(). */
+        op->next = NULL;
+        *wb_txn_ops_tail = op;
+        wb_txn_ops_tail = &op->next;
     }
 
-    db_update_port_status(portp);
+    /* Finally each affected LAG's status, once. */
+    SHASH_FOR_EACH(node, &all_ports) {
+        struct port_data *portp = node->data;
 
-end:
-    OVSDB_UNLOCK;
+        if (portp->status_dirty) {
+            portp->status_dirty = false;
+            portp->status_in_txn = true;
+            db_update_port_status(portp);
+        }
+        if (portp->bond_dirty) {
+            portp->status_in_txn = true;
+        }
+    }
+    flush_port_bond_status();
 
-} /* db_delete_lag_port */
+    status = ovsdb_idl_txn_commit(wb_txn);
+    if (status != TXN_INCOMPLETE) {
+        db_writeback_txn_done(status);
+    }
+} /* db_writeback_flush */
 
-void
-db_clear_lag_partner_info_port(struct port_data *portp)
+/* Destroys the finished write-back transaction.  If it committed,
+ * completes the latency traces of the RX enables it carried.  Its ops
+ * are freed or queued again by db_writeback_retire_ops(). */
+static void
+db_writeback_txn_done(enum ovsdb_idl_txn_status status)
 {
-    const struct ovsrec_port *prow;
-    struct smap smap;
+    unsigned long long now = lacp_latency_now();
+    bool committed = (status == TXN_SUCCESS || status == TXN_UNCHANGED);
+    int ii;
 
-    prow = portp->cfg;
+    for (ii = 0; ii < wb_n_lat; ii++) {
+        struct iface_data *idp = find_iface_data_by_index(wb_lat_index[ii]);
 
-    smap_init(&smap);
+        /* The interface may have been deleted, and its index reused. */
+        if (idp == NULL || !idp->lat_in_txn) {
+            continue;
+        }
+        idp->lat_in_txn = false;
+        if (!committed) {
+            continue;
+        }
 
-    /* set everything to empty */
-    ovsrec_port_set_lacp_status(prow, &smap);
+        idp->lat_last_usec[LACP_LAT_DB_QUEUE] =
+            idp->lat_applied - idp->lat_queued;
+        idp->lat_last_usec[LACP_LAT_DB_COMMIT] = now - idp->lat_applied;
+        idp->lat_last_usec[LACP_LAT_TOTAL] = now - idp->lat_start;
+        lacp_latency_record(LACP_LAT_DB_QUEUE,
+                            idp->lat_applied - idp->lat_queued);
+        lacp_latency_record(LACP_LAT_DB_COMMIT, now - idp->lat_applied);
+        lacp_latency_record(LACP_LAT_TOTAL, now - idp->lat_start);
+    }
+    wb_n_lat = 0;
 
-    smap_destroy(&smap);
+    db_writeback_status_done(committed);
+    db_writeback_retire_ops(status);
 
-    free(portp->speed_str);
-    portp->speed_str = NULL;
-    portp->current_status = STATUS_UNINITIALIZED;
-}
+    ovsdb_idl_txn_destroy(wb_txn);
+    wb_txn = NULL;
+} /* db_writeback_txn_done */
 
-void
-db_clear_lag_partner_info(uint16_t lag_id)
+/* Ends the status writes of the finished write-back transaction.  If
+ * it did not commit, the rows no longer hold the status it wrote: the
+ * values last written to the interfaces and LAGs it touched are
+ * forgotten, and the interfaces are marked dirty again, so their latest
+ * status goes out with the next flush. */
+static void
+db_writeback_status_done(bool committed)
 {
-    struct port_data *portp;
-    struct ovsdb_idl_txn *txn = NULL;
+    struct writeback_op *op;
+    struct shash_node *node;
+    int ii;
 
-    /* acquire lock */
-    OVSDB_LOCK;
+    pthread_mutex_lock(&wb_mutex);
 
-    /* get port */
-    portp = find_port_data_by_lag_id(lag_id);
+    for (ii = 0; ii < wb_n_status; ii++) {
+        int index = wb_status_index[ii];
+        struct iface_data *idp = find_iface_data_by_index(index);
 
-    if (portp == NULL) {
-        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+        /* The interface may have been deleted, and its index reused. */
+        if (idp == NULL || !idp->status_in_txn) {
+            continue;
+        }
+        idp->status_in_txn = false;
+        if (committed) {
+            continue;
+        }
+
+        idp->actor.valid = false;
+        idp->partner.valid = false;
+        idp->lacp_current_set = false;
+        idp->bond_status_synced = false;
+        if (!wb_iface_dirty[index]) {
+            wb_iface_dirty[index] = true;
+            wb_dirty_index[wb_n_dirty++] = index;
+        }
+        db_writeback_kick();
     }
+    wb_n_status = 0;
 
-    txn = ovsdb_idl_txn_create(idl);
+    if (!committed) {
+        /* hw_bond_config requests are queued again by
+         * db_writeback_retire_ops(); their bond_status must be too. */
+        for (op = wb_txn_ops; op != NULL; op = op->next) {
+            struct iface_data *idp;
 
-    db_clear_lag_partner_info_port(portp);
+            if (op->type == WB_OP_HW_BOND_CONFIG &&
+                (idp = find_iface_data_by_index(op->index)) != NULL) {
+                idp->bond_status_synced = false;
+            }
+        }
+    }
 
-    ovsdb_idl_txn_commit_block(txn);
-    ovsdb_idl_txn_destroy(txn);
+    SHASH_FOR_EACH(node, &all_ports) {
+        struct port_data *portp = node->data;
 
-end:
-    OVSDB_UNLOCK;
-} /* db_clear_lag_partner_info */
+        if (!portp->status_in_txn) {
+            continue;
+        }
+        portp->status_in_txn = false;
+        if (committed) {
+            continue;
+        }
 
-void
-db_update_lag_partner_info(uint16_t lag_id)
-{
-    const struct ovsrec_port *prow;
-    struct port_data *portp;
-    struct smap smap;
-    struct ovsdb_idl_txn *txn = NULL;
-    bool changes = false;
-    char *speed_str;
+        portp->speed_set = false;
+        portp->current_status = STATUS_UNINITIALIZED;
+        portp->bond_status_valid = false;
+        portp->status_dirty = true;
+        portp->bond_dirty = true;
+        db_writeback_kick();
+    }
 
-    /* acquire lock */
-    OVSDB_LOCK;
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_writeback_status_done */
 
-    /* get port */
-    portp = find_port_data_by_lag_id(lag_id);
+/* Frees the ops of the finished write-back transaction.  The hardware
+ * programming requests of a transaction that failed, but may succeed
+ * if tried again, are queued again instead, in order and ahead of
+ * everything queued since.  Setting hw_bond_config is idempotent, so
+ * applying them twice does no harm.  The other ops are dropped, as
+ * they always were. */
+static void
+db_writeback_retire_ops(enum ovsdb_idl_txn_status status)
+{
+    bool committed = (status == TXN_SUCCESS || status == TXN_UNCHANGED);
+    bool retry = !committed && status != TXN_ERROR;
+    struct writeback_op *retry_ops = NULL;
+    struct writeback_op **retry_tail = &retry_ops;
+    struct writeback_op *op;
+
+    pthread_mutex_lock(&wb_mutex);
+
+    while ((op = wb_txn_ops) != NULL) {
+        wb_txn_ops = op->next;
+
+        if (op->type == WB_OP_HW_BOND_CONFIG) {
+            if (retry) {
+                *retry_tail = op;
+                retry_tail = &op->next;
+                db_writeback_count(&wb_hw_retried, 1);
+                continue;
+            }
+            db_writeback_count(&wb_hw_in_flight[op->index], -1);
+            if (committed) {
+                db_writeback_count(&wb_hw_completed, 1);
+            } else {
+                db_writeback_count(&wb_hw_dropped, 1);
+            }
+        }
+        free(op);
+    }
+    wb_txn_ops_tail = &wb_txn_ops;
 
-    if (portp == NULL) {
-        VLOG_WARN("Updating port not configured for LACP! lag_id = %d", lag_id);
-        goto end;
+    if (retry_ops) {
+        *retry_tail = wb_ops;
+        if (wb_ops == NULL) {
+            wb_ops_tail = retry_tail;
+        }
+        wb_ops = retry_ops;
+        db_writeback_kick();
     }
 
-    prow = portp->cfg;
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_writeback_retire_ops */
 
-    smap_clone(&smap, &prow->lacp_status);
+/* Drops any status queued for an interface that is going away, so a
+ * new interface reusing the index does not inherit it. */
+static void
+db_writeback_forget(int index)
+{
+    int ii;
+
+    pthread_mutex_lock(&wb_mutex);
+    if (wb_iface_dirty[index]) {
+        wb_iface_dirty[index] = false;
+        for (ii = 0; ii < wb_n_dirty; ii++) {
+            if (wb_dirty_index[ii] == index) {
+                wb_dirty_index[ii] = wb_dirty_index[--wb_n_dirty];
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_writeback_forget */
 
-    txn = ovsdb_idl_txn_create(idl);
+static void
+db_writeback_wait(void)
+{
+    latch_wait(&wb_latch);
 
-    /* update speed */
-    asprintf(&speed_str, "%d", portp->lag_member_speed);
-    if (portp->speed_str == NULL || strcmp(speed_str, portp->speed_str) != 0) {
-        free(portp->speed_str);
-        portp->speed_str = speed_str;
-        smap_replace(&smap, PORT_LACP_STATUS_MAP_BOND_SPEED, speed_str);
-        changes = true;
-    } else {
-        free(speed_str);
+    if (wb_txn) {
+        ovsdb_idl_txn_wait(wb_txn);
     }
 
-    if (changes) {
-        ovsrec_port_set_lacp_status(prow, &smap);
-        ovsdb_idl_txn_commit_block(txn);
-    } else {
-        ovsdb_idl_txn_abort(txn);
+    pthread_mutex_lock(&wb_mutex);
+    if (wb_pending) {
+        poll_timer_wait_until(wb_last_flush + LACPD_DB_FLUSH_INTERVAL_MS);
     }
-
-    ovsdb_idl_txn_destroy(txn);
-
-    smap_destroy(&smap);
-
-end:
-    OVSDB_UNLOCK;
-
-} /* db_update_lag_partner_info */
+    pthread_mutex_unlock(&wb_mutex);
+} /* db_writeback_wait */
 
 /**********************************************************************/
 /*                               DEBUG                                */
@@ -3197,6 +4070,8 @@ lacpd_interface_dump(struct ds *ds, struct iface_data *idp)
         ds_put_format(ds, "    LAG eligible         : %s\n",
                       idp->lag_eligible ? "true" : "false");
     }
+    ds_put_format(ds, "    hw_ops_in_flight     : %u\n",
+                  lacpd_hw_ops_in_flight(idp->index));
 } /* lacpd_interface_dump */
 
 static void
@@ -3297,6 +4172,43 @@ lacpd_ports_dump(struct ds *ds, int argc, const char *argv[])
     }
 } /* lacpd_ports_dump */
 
+/**
+ * @details
+ * Dumps the hardware programming requests of the LACP state machines:
+ * how many are waiting for their write-back transaction, and what
+ * became of the others.
+ */
+static void
+lacpd_hw_ops_dump(struct ds *ds)
+{
+    unsigned int in_flight = 0;
+    int n_ifaces = 0;
+    int ii;
+
+    for (ii = 0; ii < MAX_ENTRIES_IN_POOL; ii++) {
+        unsigned int n = lacpd_hw_ops_in_flight(ii);
+
+        if (n) {
+            in_flight += n;
+            n_ifaces++;
+        }
+    }
+
+    ds_put_format(ds, "Hardware programming:\n");
+    ds_put_format(ds, "    in flight     : %u (%d interfaces)\n",
+                  in_flight, n_ifaces);
+    ds_put_format(ds, "    queued        : %lu\n",
+                  __atomic_load_n(&wb_hw_queued, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    completed     : %lu\n",
+                  __atomic_load_n(&wb_hw_completed, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    merged        : %lu\n",
+                  __atomic_load_n(&wb_hw_merged, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    retried       : %lu\n",
+                  __atomic_load_n(&wb_hw_retried, __ATOMIC_RELAXED));
+    ds_put_format(ds, "    dropped       : %lu\n",
+                  __atomic_load_n(&wb_hw_dropped, __ATOMIC_RELAXED));
+} /* lacpd_hw_ops_dump */
+
 /**
  * @details
  * Dumps debug data for entire daemon or for individual component specified
@@ -3313,6 +4225,28 @@ lacpd_debug_dump(struct ds *ds, int argc, const char *argv[])
             lacpd_interfaces_dump(ds, argc, argv);
         } else if (!strcmp(table_name, "port")) {
             lacpd_ports_dump(ds, argc, argv);
+        } else if (!strcmp(table_name, "queue")) {
+            mlacp_event_queue_dump(ds);
+        } else if (!strcmp(table_name, "events")) {
+            mlacp_event_cost_dump(ds);
+        } else if (!strcmp(table_name, "pool")) {
+            lacp_pool_dump(ds);
+        } else if (!strcmp(table_name, "ids")) {
+            lacp_idmap_dump(ds);
+        } else if (!strcmp(table_name, "tx")) {
+            mlacp_tx_dump(ds);
+        } else if (!strcmp(table_name, "checkpoint")) {
+            lacp_checkpoint_dump(ds);
+        } else if (!strcmp(table_name, "export")) {
+            lacp_export_dump(ds);
+        } else if (!strcmp(table_name, "filter")) {
+            lacp_rx_filter_dump(ds);
+        } else if (!strcmp(table_name, "workers")) {
+            lacp_worker_dump(ds);
+        } else if (!strcmp(table_name, "hw")) {
+            lacpd_hw_ops_dump(ds);
+        } else if (!strcmp(table_name, "link")) {
+            mlacp_link_dump(ds);
         }
     } else {
         lacpd_interfaces_dump(ds, 0, NULL);
@@ -3361,17 +4295,20 @@ lacpd_lag_ports_dump(struct ds *ds, int argc, const char *argv[])
  *   2. lacp_per_port_variables_t which contains the pdu counters for each
  *      interface member of a lag.
  * We go through all the configured interfaces for the lag specified in the
- * parameter portp, and we look for an interface in lacp_per_port_vars_tree
- * with the same port number. Once we find it we print the pdu counters.
+ * parameter portp, and we look up the lacp_per_port_variables_t with the
+ * same port number. Once we find it we print the pdu counters.
 */
-void lacpd_dump_pdus_per_interface(struct ds *ds, struct port_data *portp)
+void lacpd_dump_pdus_per_interface(struct ds *ds, struct port_data *portp,
+                                   bool raw)
 {
     struct shash_node *node;
     lacp_per_port_variables_t *lacp_port_variable;
+    lacp_port_stats_t stats;
     int port_number_iface_data;
-    int port_number_lacp_port_variable;
 
-    ds_put_format(ds, " Configured interfaces:\n");
+    if (!raw) {
+        ds_put_format(ds, " Configured interfaces:\n");
+    }
 
     /*Go through all the configured interfaces*/
     SHASH_FOR_EACH(node, &portp->cfg_member_ifs) {
@@ -3386,27 +4323,51 @@ void lacpd_dump_pdus_per_interface(struct ds *ds, struct port_data *portp)
             port_number_iface_data--;
 
             RENTRY();
-            /* Go through lacp_per_port_vars_tree looking for a
-             * lacp_per_port_variables_t corresponding to the port number we
-             * found before. */
-            lacp_port_variable = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-            while (lacp_port_variable) {
-
-                port_number_lacp_port_variable = PM_HANDLE2PORT(lacp_port_variable->lport_handle);
-
-                if (port_number_lacp_port_variable == port_number_iface_data) {
-                    ds_put_format(ds, "  Interface: %s\n", idp->name);
-                    ds_put_format(ds, "    lacp_pdus_sent: %d\n",
-                                  lacp_port_variable->lacp_pdus_sent);
-                    ds_put_format(ds, "    marker_response_pdus_sent: %d\n",
-                                  lacp_port_variable->marker_response_pdus_sent);
-                    ds_put_format(ds, "    lacp_pdus_received: %d\n",
-                                  lacp_port_variable->lacp_pdus_received);
-                    ds_put_format(ds, "    marker_pdus_received: %d\n",
-                                  lacp_port_variable->marker_pdus_received);
-                    break;
-                }
-                lacp_port_variable = LACP_AVL_NEXT(lacp_port_variable->avlnode);
+            /* Look up the lacp_per_port_variables_t for the port number
+             * we found before. */
+            lacp_port_variable = LACP_port_by_index(port_number_iface_data);
+            if (lacp_port_variable && raw) {
+                LACP_port_stats_snapshot(lacp_port_variable, &stats);
+                /* Fixed width hex fields, in LACPD_RAW_COUNTERS_FIELDS
+                 * order. */
+                ds_put_format(ds, "%s %s %016"PRIx64"%016"PRIx64"%016"PRIx64
+                              "%016"PRIx64"%016"PRIx64"%016"PRIx64"%016"PRIx64
+                              "%016"PRIx64"%016"PRIx64"\n",
+                              portp->name, idp->name,
+                              stats.lacp_pdus_sent,
+                              stats.marker_response_pdus_sent,
+                              stats.lacp_pdus_received,
+                              stats.marker_pdus_received,
+                              stats.lacp_pdus_fast_path,
+                              stats.pdus_dropped,
+                              stats.pdus_malformed,
+                              stats.pdus_queue_overflow,
+                              stats.pdus_tx_failed);
+            } else if (lacp_port_variable) {
+                LACP_port_stats_snapshot(lacp_port_variable, &stats);
+                ds_put_format(ds, "  Interface: %s\n", idp->name);
+                ds_put_format(ds, "    lacp_pdus_sent: %"PRIu64"\n",
+                              stats.lacp_pdus_sent);
+                ds_put_format(ds, "    marker_response_pdus_sent: %"PRIu64"\n",
+                              stats.marker_response_pdus_sent);
+                ds_put_format(ds, "    lacp_pdus_received: %"PRIu64"\n",
+                              stats.lacp_pdus_received);
+                ds_put_format(ds, "    marker_pdus_received: %"PRIu64"\n",
+                              stats.marker_pdus_received);
+                ds_put_format(ds, "    lacp_pdus_fast_path: %"PRIu64
+                              " (%u%%)\n",
+                              stats.lacp_pdus_fast_path,
+                              stats.lacp_pdus_received ?
+                              (u_int)((100 * stats.lacp_pdus_fast_path) /
+                                      stats.lacp_pdus_received) : 0);
+                ds_put_format(ds, "    pdus_dropped: %"PRIu64"\n",
+                              stats.pdus_dropped);
+                ds_put_format(ds, "    pdus_malformed: %"PRIu64"\n",
+                              stats.pdus_malformed);
+                ds_put_format(ds, "    pdus_queue_overflow: %"PRIu64"\n",
+                              stats.pdus_queue_overflow);
+                ds_put_format(ds, "    pdus_tx_failed: %"PRIu64"\n",
+                              stats.pdus_tx_failed);
             }
             REXIT();
         }
@@ -3416,13 +4377,23 @@ void lacpd_dump_pdus_per_interface(struct ds *ds, struct port_data *portp)
 /**
  * @details
  * Dumps the PDU counters for all the LAG ports in the daemon or for
- * an individual specified port.
+ * an individual specified port.  With "--raw", prints a header line
+ * naming the fields, then one line per interface with the LAG name,
+ * the interface name and the counters as fixed width hex numbers.
  */
 void
 lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[])
 {
     struct shash_node *sh_node;
     struct port_data *portp = NULL;
+    bool raw = false;
+
+    if (argc > 1 && !strcmp(argv[1], "--raw")) {
+        raw = true;
+        argc--;
+        argv++;
+        ds_put_format(ds, "%s\n", LACPD_RAW_COUNTERS_FIELDS);
+    }
 
     if (argc > 1) { /* a lag is specified in argv */
         portp = shash_find_data(&all_ports, argv[1]);
@@ -3432,8 +4403,10 @@ lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[])
                          LAG_PORT_NAME_PREFIX_LENGTH)
                 && portp->lacp_mode != PORT_LACP_OFF) {
 
-                ds_put_format(ds, "LAG %s:\n", portp->name);
-                lacpd_dump_pdus_per_interface(ds, portp);
+                if (!raw) {
+                    ds_put_format(ds, "LAG %s:\n", portp->name);
+                }
+                lacpd_dump_pdus_per_interface(ds, portp, raw);
             }
         }
     } else { /* dump all ports */
@@ -3445,8 +4418,10 @@ lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[])
                              LAG_PORT_NAME_PREFIX_LENGTH)
                     && portp->lacp_mode != PORT_LACP_OFF) {
 
-                    ds_put_format(ds, "LAG %s:\n", portp->name);
-                    lacpd_dump_pdus_per_interface(ds, portp);
+                    if (!raw) {
+                        ds_put_format(ds, "LAG %s:\n", portp->name);
+                    }
+                    lacpd_dump_pdus_per_interface(ds, portp, raw);
                 }
             }
         }
@@ -3461,8 +4436,8 @@ lacpd_pdus_counters_dump(struct ds *ds, int argc, const char *argv[])
  *   2. lacp_per_port_variables_t which contains lacpd state machine control
  *      variables and the state parameters for each interface member of a lag.
  * We go through all the configured interfaces for the lag specified in
- * the parameter portp, and we look for an interface in
- * lacp_per_port_vars_tree with the same port number. Once we find it we print
+ * the parameter portp, and we look up the lacp_per_port_variables_t with
+ * the same port number. Once we find it we print
  * the lacpd state.
 */
 void lacpd_dump_state_per_interface(struct ds *ds, struct port_data *portp)
@@ -3472,7 +4447,6 @@ void lacpd_dump_state_per_interface(struct ds *ds, struct port_data *portp)
     struct iface_data *idp;
     const char* port_id_char;
     int port_number_iface_data;
-    int port_number_lacp_port_variable;
     int temp_port_priority;
 
     ds_put_format(ds, " Configured interfaces:\n");
@@ -3489,49 +4463,42 @@ void lacpd_dump_state_per_interface(struct ds *ds, struct port_data *portp)
             port_number_iface_data--;
 
             RENTRY();
-            /* Go through lacp_per_port_vars_tree looking for a lacp_per_port_variables_t
-             * corresponding to the port number we found before. */
-            lacp_port_variable = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-            while (lacp_port_variable) {
-
-                port_number_lacp_port_variable = PM_HANDLE2PORT(lacp_port_variable->lport_handle);
-
-                if (port_number_lacp_port_variable == port_number_iface_data) {
-                    ds_put_format(ds, "  Interface: %s\n", idp->name);
-
-                    ds_put_format(ds, "    actor_oper_port_state \n");
-                    ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
-                                    lacp_port_variable->actor_oper_port_state.lacp_activity,
-                                    lacp_port_variable->actor_oper_port_state.lacp_timeout,
-                                    lacp_port_variable->actor_oper_port_state.aggregation,
-                                    lacp_port_variable->actor_oper_port_state.synchronization,
-                                    lacp_port_variable->actor_oper_port_state.collecting,
-                                    lacp_port_variable->actor_oper_port_state.distributing,
-                                    lacp_port_variable->actor_oper_port_state.defaulted,
-                                    lacp_port_variable->actor_oper_port_state.expired);
-                    ds_put_format(ds, "    partner_oper_port_state \n");
-                    ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
-                                    lacp_port_variable->partner_oper_port_state.lacp_activity,
-                                    lacp_port_variable->partner_oper_port_state.lacp_timeout,
-                                    lacp_port_variable->partner_oper_port_state.aggregation,
-                                    lacp_port_variable->partner_oper_port_state.synchronization,
-                                    lacp_port_variable->partner_oper_port_state.collecting,
-                                    lacp_port_variable->partner_oper_port_state.distributing,
-                                    lacp_port_variable->partner_oper_port_state.defaulted,
-                                    lacp_port_variable->partner_oper_port_state.expired);
-                    ds_put_format(ds, "    lacp_control\n");
-                    ds_put_format(ds, "       begin:%d actor_churn:%d partner_churn:%d ready_n:%d selected:%d port_moved:%d ntt:%d port_enabled:%d\n",
-                                    lacp_port_variable->lacp_control.begin,
-                                    lacp_port_variable->lacp_control.actor_churn,
-                                    lacp_port_variable->lacp_control.partner_churn,
-                                    lacp_port_variable->lacp_control.ready_n,
-                                    lacp_port_variable->lacp_control.selected,
-                                    lacp_port_variable->lacp_control.port_moved,
-                                    lacp_port_variable->lacp_control.ntt,
-                                    lacp_port_variable->lacp_control.port_enabled);
-                    break;
-                }
-                lacp_port_variable = LACP_AVL_NEXT(lacp_port_variable->avlnode);
+            /* Look up the lacp_per_port_variables_t for the port number
+             * we found before. */
+            lacp_port_variable = LACP_port_by_index(port_number_iface_data);
+            if (lacp_port_variable) {
+                ds_put_format(ds, "  Interface: %s\n", idp->name);
+
+                ds_put_format(ds, "    actor_oper_port_state \n");
+                ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
+                                lacp_port_variable->actor_oper_port_state.lacp_activity,
+                                lacp_port_variable->actor_oper_port_state.lacp_timeout,
+                                lacp_port_variable->actor_oper_port_state.aggregation,
+                                lacp_port_variable->actor_oper_port_state.synchronization,
+                                lacp_port_variable->actor_oper_port_state.collecting,
+                                lacp_port_variable->actor_oper_port_state.distributing,
+                                lacp_port_variable->actor_oper_port_state.defaulted,
+                                lacp_port_variable->actor_oper_port_state.expired);
+                ds_put_format(ds, "    partner_oper_port_state \n");
+                ds_put_format(ds, "       lacp_activity:%d time_out:%d aggregation:%d sync:%d collecting:%d distributing:%d defaulted:%d expired:%d\n",
+                                lacp_port_variable->partner_oper_port_state.lacp_activity,
+                                lacp_port_variable->partner_oper_port_state.lacp_timeout,
+                                lacp_port_variable->partner_oper_port_state.aggregation,
+                                lacp_port_variable->partner_oper_port_state.synchronization,
+                                lacp_port_variable->partner_oper_port_state.collecting,
+                                lacp_port_variable->partner_oper_port_state.distributing,
+                                lacp_port_variable->partner_oper_port_state.defaulted,
+                                lacp_port_variable->partner_oper_port_state.expired);
+                ds_put_format(ds, "    lacp_control\n");
+                ds_put_format(ds, "       begin:%d actor_churn:%d partner_churn:%d ready_n:%d selected:%d port_moved:%d ntt:%d port_enabled:%d\n",
+                                lacp_port_variable->lacp_control.begin,
+                                lacp_port_variable->lacp_control.actor_churn,
+                                lacp_port_variable->lacp_control.partner_churn,
+                                lacp_port_variable->lacp_control.ready_n,
+                                lacp_port_variable->lacp_control.selected,
+                                lacp_port_variable->lacp_control.port_moved,
+                                lacp_port_variable->lacp_control.ntt,
+                                lacp_port_variable->lacp_control.port_enabled);
             }
             REXIT();
         }
@@ -3578,6 +4545,231 @@ lacpd_state_dump(struct ds *ds, int argc, const char *argv[])
     }
 }/* lacpd_state_dump */
 
+static void
+lacpd_dump_latency_per_interface(struct ds *ds, struct port_data *portp)
+{
+    struct shash_node *node;
+    lacp_per_port_variables_t *plpinfo;
+    struct iface_data *idp;
+
+    SHASH_FOR_EACH(node, &portp->cfg_member_ifs) {
+        idp = shash_find_data(&all_interfaces, node->name);
+        if (idp == NULL || idp->index < 0) {
+            continue;
+        }
+
+        ds_put_format(ds, "  Interface: %s\n   ", idp->name);
+        plpinfo = LACP_port_by_index(idp->index);
+        if (plpinfo) {
+            lacp_latency_trace_dump(ds, &LACP_PORT_COLD(plpinfo)->latency);
+        }
+        ds_put_format(ds, " %s=%u %s=%u %s=%u\n",
+                      lacp_latency_stage_name(LACP_LAT_DB_QUEUE),
+                      idp->lat_last_usec[LACP_LAT_DB_QUEUE],
+                      lacp_latency_stage_name(LACP_LAT_DB_COMMIT),
+                      idp->lat_last_usec[LACP_LAT_DB_COMMIT],
+                      lacp_latency_stage_name(LACP_LAT_TOTAL),
+                      idp->lat_last_usec[LACP_LAT_TOTAL]);
+    }
+} /* lacpd_dump_latency_per_interface */
+
+/**
+ * @details
+ * Dumps the convergence latency histograms, then the stage times, in
+ * usec, of the last convergence of each interface of every LAG port or
+ * of the specified one.
+ */
+void
+lacpd_latency_dump(struct ds *ds, int argc, const char *argv[])
+{
+    struct shash_node *sh_node;
+    struct port_data *portp;
+
+    lacp_latency_dump(ds);
+
+    ds_put_format(ds, "Last convergence (usec):\n");
+    SHASH_FOR_EACH(sh_node, &all_ports) {
+        portp = sh_node->data;
+        if (argc > 1 && strcmp(portp->name, argv[1])) {
+            continue;
+        }
+        if (!strncmp(portp->name,
+                     LAG_PORT_NAME_PREFIX,
+                     LAG_PORT_NAME_PREFIX_LENGTH)
+            && portp->lacp_mode != PORT_LACP_OFF) {
+
+            ds_put_format(ds, "LAG %s:\n", portp->name);
+            lacpd_dump_latency_per_interface(ds, portp);
+        }
+    }
+} /* lacpd_latency_dump */
+
+/**
+ * @details
+ * Bytes of a shash: its buckets, nodes and key copies.
+ */
+static size_t
+shash_memory(const struct shash *sh)
+{
+    const struct shash_node *node;
+    size_t bytes = 0;
+
+    if (sh->map.mask) {
+        bytes += (sh->map.mask + 1) * sizeof(struct hmap_node *);
+    }
+    SHASH_FOR_EACH(node, sh) {
+        bytes += sizeof(*node) + strlen(node->name) + 1;
+    }
+
+    return bytes;
+} /* shash_memory */
+
+/**
+ * @details
+ * Bytes of one column's value in the IDL, excluding the row.
+ */
+static size_t
+idl_datum_memory(const struct ovsdb_datum *datum,
+                 const struct ovsdb_type *type)
+{
+    size_t bytes = datum->n * sizeof(union ovsdb_atom);
+    unsigned int i;
+
+    if (type->value.type != OVSDB_TYPE_VOID) {
+        bytes *= 2;
+    }
+    for (i = 0; i < datum->n; i++) {
+        if (type->key.type == OVSDB_TYPE_STRING) {
+            bytes += strlen(datum->keys[i].string) + 1;
+        }
+        if (type->value.type == OVSDB_TYPE_STRING) {
+            bytes += strlen(datum->values[i].string) + 1;
+        }
+    }
+
+    return bytes;
+} /* idl_datum_memory */
+
+/**
+ * @details
+ * Estimates the bytes the IDL holds for the replicated tables: each row,
+ * its parsed struct and datum array, and the value of each replicated
+ * column.  Parsed copies of map columns are not counted.
+ */
+static size_t
+idl_memory(unsigned int *n_rows)
+{
+    const struct ovsdb_idl_table_class *table;
+    const struct ovsdb_idl_row *row;
+    size_t bytes = 0;
+    size_t i, j;
+
+    *n_rows = 0;
+    for (i = 0; i < ARRAY_SIZE(lacpd_idl_columns); i = j) {
+        table = lacpd_idl_columns[i].table;
+        for (j = i; j < ARRAY_SIZE(lacpd_idl_columns) &&
+                    lacpd_idl_columns[j].table == table; j++) {
+            continue;
+        }
+
+        for (row = ovsdb_idl_first_row(idl, table); row;
+             row = ovsdb_idl_next_row(row)) {
+            size_t k;
+
+            (*n_rows)++;
+            bytes += sizeof(*row) + table->allocation_size +
+                     table->n_columns * sizeof(struct ovsdb_datum);
+            for (k = i; k < j; k++) {
+                const struct ovsdb_idl_column *column =
+                    lacpd_idl_columns[k].column;
+
+                bytes += idl_datum_memory(ovsdb_idl_read(row, column),
+                                          &column->type);
+            }
+        }
+    }
+
+    return bytes;
+} /* idl_memory */
+
+/**
+ * @details
+ * Bytes of the OVSDB thread's own interface and port cache, and of its
+ * per-interface arrays.
+ */
+static size_t
+iface_cache_memory(void)
+{
+    struct shash_node *sh_node;
+    size_t bytes;
+
+    bytes = sizeof(iface_by_index) + sizeof(wb_iface_status) +
+            sizeof(wb_iface_dirty) + sizeof(wb_dirty_index) +
+            sizeof(wb_hw_in_flight) + sizeof(wb_lat_index) +
+            sizeof(iface_cfg_slots);
+
+    bytes += shash_memory(&all_interfaces) +
+             shash_memory(&interfaces_recently_added) +
+             shash_memory(&all_ports);
+    bytes += shash_count(&all_interfaces) * sizeof(struct iface_data);
+
+    SHASH_FOR_EACH(sh_node, &all_ports) {
+        struct port_data *portp = sh_node->data;
+
+        bytes += sizeof(*portp) +
+                 shash_memory(&portp->cfg_member_ifs) +
+                 shash_memory(&portp->eligible_member_ifs) +
+                 shash_memory(&portp->participant_ifs);
+    }
+
+    return bytes;
+} /* iface_cache_memory */
+
+/**
+ * @details
+ * Reports the memory lacpd uses, by subsystem, for lacpd/memstats.
+ */
+void
+lacpd_memstats_dump(struct ds *ds)
+{
+    unsigned long n_lags;
+    unsigned long n_lag_ids;
+    unsigned long n_params;
+    unsigned long n_nodes;
+    unsigned int n_sports;
+    unsigned int n_rows;
+    int n_ports;
+    size_t ports, lags, sports, queues, db, cache;
+
+    ports = LACP_ports_memory(&n_ports);
+    lags = lacp_pool_memory("LAG", &n_lags) +
+           lacp_pool_memory("LAG_Id", &n_lag_ids);
+    sports = mvlan_sport_memory(&n_sports) +
+             lacp_pool_memory("aggr params", &n_params) +
+             lacp_pool_memory("NList", &n_nodes);
+    queues = ml_event_queue_memory();
+    db = idl_memory(&n_rows);
+    cache = iface_cache_memory();
+
+    ds_put_format(ds, "Memory usage (bytes):\n");
+    ds_put_format(ds, "    per-port vars : %10zu  (%d of %d ports in use, "
+                  "%zu + %zu bytes each)\n", ports, n_ports, LACP_MAX_PORTS,
+                  sizeof(lacp_per_port_variables_t), sizeof(lacp_port_cold_t));
+    ds_put_format(ds, "    LAGs          : %10zu  (%lu LAGs, %lu LAG IDs)\n",
+                  lags, n_lags, n_lag_ids);
+    ds_put_format(ds, "    super ports   : %10zu  (%u super ports, "
+                  "%lu list nodes)\n", sports, n_sports, n_nodes);
+    ds_put_format(ds, "    event queues  : %10zu  (%d queues)\n",
+                  queues, LACPD_PROTOCOL_WORKERS);
+    ds_put_format(ds, "    IDL           : %10zu  (%u rows, estimated)\n",
+                  db, n_rows);
+    ds_put_format(ds, "    interfaces    : %10zu  (%d interfaces, "
+                  "%d ports)\n", cache, (int)shash_count(&all_interfaces),
+                  (int)shash_count(&all_ports));
+    ds_put_format(ds, "    total         : %10zu\n",
+                  ports + lags + sports + queues + db + cache);
+} /* lacpd_memstats_dump */
+
 /**********************************************************************/
 /*                        OVS Main Thread                             */
 /**********************************************************************/
@@ -33,100 +33,132 @@
 #include "mlacp_fproto.h"
 #include "mvlan_lacp.h"
 #include "lacp_ops_if.h"
+#include "lacp_rx_filter.h"
 
 VLOG_DEFINE_THIS_MODULE(periodic_tx_fsm);
 
+/****************************************************************************
+ *             Prototypes for static functions
+ ****************************************************************************/
+static void LACP_no_periodic_state_action(lacp_per_port_variables_t *);
+static void LACP_fast_periodic_state_action(lacp_per_port_variables_t *);
+static void LACP_slow_periodic_state_action(lacp_per_port_variables_t *);
+static void LACP_periodic_tx_state_action(lacp_per_port_variables_t *);
+static void LACP_start_periodic_timer(lacp_per_port_variables_t *,
+                                      unsigned int);
+static void LACP_frame_lacpdu(lacpdu_payload_t *);
+static void LACP_update_lacpdu_payload(lacp_per_port_variables_t *,
+                                       lacpdu_payload_t *);
+
+/*****************************************************************************
+ * A table cell names the next state and the action to run.  The action is
+ * normally a number that LACP_periodic_tx_fsm() switches on.  Built with
+ * LACPD_FSM_DIRECT_DISPATCH, the cell holds the action routine itself.
+ ****************************************************************************/
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+typedef struct periodic_tx_fsm_entry {
+    unsigned int next_state;
+    void (*action)(lacp_per_port_variables_t *);
+} PERIODIC_TX_FSM_ENTRY;
+
+static void LACP_periodic_tx_no_action(lacp_per_port_variables_t *);
+
+#define NO_ACTION_FN                LACP_periodic_tx_no_action
+#define ACTION_NO_PERIODIC_FN       LACP_no_periodic_state_action
+#define ACTION_FAST_PERIODIC_FN     LACP_fast_periodic_state_action
+#define ACTION_SLOW_PERIODIC_FN     LACP_slow_periodic_state_action
+#define ACTION_PERIODIC_TX_FN       LACP_periodic_tx_state_action
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION##_FN }
+#else
+typedef FSM_ENTRY PERIODIC_TX_FSM_ENTRY;
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION }
+#endif
+
 /****************************************************************************
  *   Static Variables
  ****************************************************************************/
 
 /* preiodic tx machine fsm table */
-static FSM_ENTRY periodic_tx_machine_fsm_table[PERIODIC_TX_FSM_NUM_INPUTS]
-                                              [PERIODIC_TX_FSM_NUM_STATES] =
+static const PERIODIC_TX_FSM_ENTRY
+periodic_tx_machine_fsm_table[PERIODIC_TX_FSM_NUM_INPUTS]
+                             [PERIODIC_TX_FSM_NUM_STATES] =
 {
 /*****************************************************************************
  *   Input Event E1 - Begin = True
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Begin state
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // No Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Fast Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Slow Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC)}, // Periodic Tx
 
 /*****************************************************************************
  * Input Event E2 - UCT
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Begin state
-   {PERIODIC_TX_FSM_FAST_PERIODIC_STATE,    ACTION_FAST_PERIODIC},
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Fast Periodic
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Slow Periodic
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_FAST_PERIODIC_STATE,    ACTION_FAST_PERIODIC),
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION)}, // Periodic Tx
 
 /*****************************************************************************
  * Input Event E3 - periodic timer expired
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Begin state
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // No Periodic
-   {PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX},
-   {PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX},
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX),
+   FSM_CELL(PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX),
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION)}, // Periodic Tx
 
 /*****************************************************************************
  * Input Event E4 - Partner_Oper_Port_State.LACP_Timeout = Long Timeout
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Begin state
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // No Periodic
-   {PERIODIC_TX_FSM_SLOW_PERIODIC_STATE,    ACTION_SLOW_PERIODIC},
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Slow Periodic
-   {PERIODIC_TX_FSM_SLOW_PERIODIC_STATE,    ACTION_SLOW_PERIODIC}},
+  {FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_SLOW_PERIODIC_STATE,    ACTION_SLOW_PERIODIC),
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_SLOW_PERIODIC_STATE,    ACTION_SLOW_PERIODIC)},
 
 /*****************************************************************************
  *   Input Event E5 - LACP_Enabled = FALSE
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Begin state
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // No Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Fast Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Slow Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC)}, // Periodic Tx
 
 /*****************************************************************************
  * Input Event E6 - Partner_Oper_Port_State.LACP_Timeout = Short Timeout
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Begin state
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // No Periodic
-   {PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION},  // Fast Periodic
-   {PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX},
-   {PERIODIC_TX_FSM_FAST_PERIODIC_STATE,    ACTION_FAST_PERIODIC}},
+  {FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_RETAIN_STATE,           NO_ACTION),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_PERIODIC_TX_STATE,      ACTION_PERIODIC_TX),
+   FSM_CELL(PERIODIC_TX_FSM_FAST_PERIODIC_STATE,    ACTION_FAST_PERIODIC)},
 
 /*****************************************************************************
  * Input Event E7 - port_enabled = FALSE
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Begin state
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // No Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Fast Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Slow Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC)}, // Periodic Tx
 
 /*****************************************************************************
  * Input Event E8 -  (Actor_Oper_Port_State.LACP_Activity = Passive AND
  *                    Actor_Oper_Port_state.LACP_Activity = Passive)
  *****************************************************************************/
-  {{PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Begin state
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // No Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Fast Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC},  // Slow Periodic
-   {PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC}}, // Periodic Tx
+  {FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Begin state
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // No Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Fast Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC),  // Slow Periodic
+   FSM_CELL(PERIODIC_TX_FSM_NO_PERIODIC_STATE,   ACTION_NO_PERIODIC)}, // Periodic Tx
 };
 
-/****************************************************************************
- *             Prototypes for static functions
- ****************************************************************************/
-static void LACP_no_periodic_state_action(lacp_per_port_variables_t *);
-static void LACP_fast_periodic_state_action(lacp_per_port_variables_t *);
-static void LACP_slow_periodic_state_action(lacp_per_port_variables_t *);
-static void LACP_periodic_tx_state_action(lacp_per_port_variables_t *);
-static lacpdu_payload_t *LACP_build_lacpdu_payload(lacp_per_port_variables_t *);
-
 /*----------------------------------------------------------------------
  * Function: LACP_periodic_tx_fsm(event, current_state, port_number)
  * Synopsis: Entry routine for periodic tx state machine.
@@ -141,6 +173,17 @@ LACP_periodic_tx_fsm(int event,
                      int current_state,
                      lacp_per_port_variables_t *plpinfo)
 {
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+    const PERIODIC_TX_FSM_ENTRY *cell;
+
+    cell = &periodic_tx_machine_fsm_table[event][current_state];
+
+    if (cell->next_state != PERIODIC_TX_FSM_RETAIN_STATE) {
+        plpinfo->periodic_tx_fsm_state = cell->next_state;
+    }
+
+    cell->action(plpinfo);
+#else
     int action;
     char previous_state_string[STATE_STRING_SIZE];
     char current_state_string[STATE_STRING_SIZE];
@@ -156,7 +199,7 @@ LACP_periodic_tx_fsm(int event,
     // Update the state only if required so.
     if (current_state != PERIODIC_TX_FSM_RETAIN_STATE) {
 
-        if (plpinfo->debug_level & DBG_TX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
             //***********************************************************
             // receive_fsm  debug is DBG_RX_FSM
             // periodic_fsm debug is DBG_TX_FSM
@@ -178,7 +221,7 @@ LACP_periodic_tx_fsm(int event,
         plpinfo->periodic_tx_fsm_state = current_state;
 
     } else {
-        if (plpinfo->debug_level & DBG_TX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
             RDBG("%s : retain old state (%d)\n",
                  __FUNCTION__, plpinfo->periodic_tx_fsm_state);
         }
@@ -213,12 +256,21 @@ LACP_periodic_tx_fsm(int event,
         default:
         break;
     }
+#endif
 
+    lacp_rx_filter_update(plpinfo);
     db_update_interface(plpinfo);
 
     REXIT();
 } // LACP_periodic_tx_fsm
 
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+static void
+LACP_periodic_tx_no_action(lacp_per_port_variables_t *plpinfo)
+{
+} // LACP_periodic_tx_no_action
+#endif
+
 /*----------------------------------------------------------------------
  * Function: LACP_no_periodic_state_action(int port_number)
  * Synopsis: Function implementing no periodic state
@@ -229,7 +281,7 @@ LACP_periodic_tx_fsm(int event,
 static void
 LACP_no_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -239,8 +291,8 @@ LACP_no_periodic_state_action(lacp_per_port_variables_t *plpinfo)
     // Put the port in NO PERIODIC state.
     plpinfo->periodic_tx_fsm_state = PERIODIC_TX_FSM_NO_PERIODIC_STATE;
 
-    // Reset the expiry counter.
-    plpinfo->periodic_tx_timer_expiry_counter = 0;
+    // Stop the periodic timer.
+    lacp_timer_stop(&plpinfo->periodic_tx_timer);
 
     if ((plpinfo->lacp_control.port_enabled == FALSE) ||
         ((plpinfo->actor_oper_port_state.lacp_activity == LACP_PASSIVE_MODE) &&
@@ -252,7 +304,7 @@ LACP_no_periodic_state_action(lacp_per_port_variables_t *plpinfo)
     // UCT to FAST_PERIODIC state.
     LACP_periodic_tx_fsm(E2, plpinfo->periodic_tx_fsm_state, plpinfo);
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_no_periodic_state_action
@@ -267,7 +319,7 @@ LACP_no_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 LACP_fast_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -275,15 +327,16 @@ LACP_fast_periodic_state_action(lacp_per_port_variables_t *plpinfo)
     // Put the port in FAST_PERIODIC state.
     plpinfo->periodic_tx_fsm_state = PERIODIC_TX_FSM_FAST_PERIODIC_STATE;
 
-    // Reinitialize the expiry counter.
-    plpinfo->periodic_tx_timer_expiry_counter = FAST_PERIODIC_COUNT;
+    // Restart the periodic timer.
+    LACP_start_periodic_timer(plpinfo,
+                              FAST_PERIODIC_COUNT * LACP_TIMER_MSEC_PER_SEC);
 
     // Go to SLOW_PERIODIC state if approp. conditions prevail.
     if (plpinfo->partner_oper_port_state.lacp_timeout == LONG_TIMEOUT) {
         LACP_periodic_tx_fsm(E4, plpinfo->periodic_tx_fsm_state, plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_fast_periodic_state_action
@@ -298,7 +351,7 @@ LACP_fast_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 LACP_slow_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -306,15 +359,16 @@ LACP_slow_periodic_state_action(lacp_per_port_variables_t *plpinfo)
     // Put the port in SLOW_PERIODIC state.
     plpinfo->periodic_tx_fsm_state = PERIODIC_TX_FSM_SLOW_PERIODIC_STATE;
 
-    // Reinitialize the expiry counter.
-    plpinfo->periodic_tx_timer_expiry_counter = SLOW_PERIODIC_COUNT;
+    // Restart the periodic timer.
+    LACP_start_periodic_timer(plpinfo,
+                              SLOW_PERIODIC_COUNT * LACP_TIMER_MSEC_PER_SEC);
 
     // Go to PERIODIC_TX state if approp. conditions prevail.
     if (plpinfo->partner_oper_port_state.lacp_timeout == SHORT_TIMEOUT) {
         LACP_periodic_tx_fsm(E6, plpinfo->periodic_tx_fsm_state, plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_slow_periodic_state_action
@@ -329,7 +383,7 @@ LACP_slow_periodic_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 LACP_periodic_tx_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -358,7 +412,7 @@ LACP_periodic_tx_state_action(lacp_per_port_variables_t *plpinfo)
         }
     }
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_periodic_tx_state_action
@@ -373,12 +427,11 @@ LACP_periodic_tx_state_action(lacp_per_port_variables_t *plpinfo)
 void
 LACP_transmit_lacpdu(lacp_per_port_variables_t *plpinfo)
 {
-    lacpdu_payload_t *lacpdu_payload;
-    int datasize = sizeof(lacpdu_payload_t);
+    lacpdu_payload_t *lacpdu_payload = &plpinfo->tx_lacpdu;
 
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -390,67 +443,99 @@ LACP_transmit_lacpdu(lacp_per_port_variables_t *plpinfo)
         goto exit;
     }
 
-    // Form the LACPDU.
-    if (!(lacpdu_payload = LACP_build_lacpdu_payload(plpinfo))) {
-
-        // Report error and exit
-        VLOG_ERR("Failed to build LACPDU payload");
-        goto exit;
+    // Frame the LACPDU the first time and whenever the system MAC
+    // address changes; afterwards only the actor/partner info varies.
+    if (lacpdu_payload->subtype != LACP_SUBTYPE ||
+        memcmp(&lacpdu_payload->headroom[MAC_ADDR_LENGTH], my_mac_addr,
+               MAC_ADDR_LENGTH) != 0) {
+        LACP_frame_lacpdu(lacpdu_payload);
     }
 
-    // OpenSwitch
-    mlacp_tx_pdu((unsigned char *)lacpdu_payload,
-                 datasize, plpinfo->lport_handle);
-
-    plpinfo->lacp_pdus_sent++;
+    LACP_update_lacpdu_payload(plpinfo, lacpdu_payload);
 
-    // Free LACPDU memory.
-    free(lacpdu_payload);
+    // OpenSwitch.  Counts lacp_pdus_sent once the frame is out.
+    mlacp_tx_pdu((unsigned char *)lacpdu_payload,
+                 sizeof(lacpdu_payload_t), plpinfo->lport_handle);
 
  exit:
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_transmit_lacpdu
 
 /*----------------------------------------------------------------------
- * Function: LACP_build_lacpdu(int port_number)
- * Synopsis: Function to construct the lacpdu.
+ * Function: LACP_start_periodic_timer(plpinfo, period)
+ * Synopsis: Starts the periodic Tx timer.  With LACPD_PERIODIC_TX_SPREAD
+ *           each port fires in its own tick of the period, one tick
+ *           after the port before it, instead of every port whose
+ *           state machine started together transmitting at once.
+ *           The timer still expires within period, so a LACPDU is
+ *           sent at least every fast/slow periodic time.
  * Input  :
- *           port_number = port number on which to act upon.
- * Returns:  pointer to the constructed lacpdu payload or NULL in case
- *           of error.
+ *           plpinfo = port on which to act upon.
+ *           period = periodic time in msec.
+ * Returns:  void
  *----------------------------------------------------------------------*/
-static lacpdu_payload_t *
-LACP_build_lacpdu_payload(lacp_per_port_variables_t *plpinfo)
+static void
+LACP_start_periodic_timer(lacp_per_port_variables_t *plpinfo,
+                          unsigned int period)
 {
-    lacpdu_payload_t *lacpdu_payload;
+#ifdef LACPD_PERIODIC_TX_SPREAD
+    lacp_timer_start_phase(&plpinfo->periodic_tx_timer, period,
+                           (plpinfo->periodic_tx_phase * LACPD_TIMER_TICK_MS) %
+                           period);
+#else
+    lacp_timer_start(&plpinfo->periodic_tx_timer, period);
+#endif
 
-    RENTRY();
+} // LACP_start_periodic_timer
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
-        RDBG("%s : lport_handle 0x%llx\n",
-             __FUNCTION__, plpinfo->lport_handle);
-    }
-
-    // Allocate memory for the lacpdu
-    lacpdu_payload = (lacpdu_payload_t *)malloc(sizeof(lacpdu_payload_t));
-    if (lacpdu_payload == NULL) {
-        VLOG_FATAL("out of memory");
-        goto exit;
-    }
-
-    // Zero out the memory.
+/*----------------------------------------------------------------------
+ * Function: LACP_frame_lacpdu(lacpdu_payload_t *lacpdu_payload)
+ * Synopsis: Fills in the parts of a port's LACPDU that do not depend
+ *           on the protocol state: Ethernet header, TLV types and
+ *           lengths and the terminator.
+ * Input  :
+ *           lacpdu_payload = the port's transmit buffer.
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+LACP_frame_lacpdu(lacpdu_payload_t *lacpdu_payload)
+{
     memset(lacpdu_payload, 0, sizeof(lacpdu_payload_t));
 
+    mlacp_tx_pdu_header(lacpdu_payload->headroom);
+
     // Fill in the general parameters in the lacpdu_payload.
     lacpdu_payload->subtype = LACP_SUBTYPE;
     lacpdu_payload->version_number = LACP_VERSION;
 
-    // Fill in the actor's (local port) parameters in the lacpdu_payload.
     lacpdu_payload->tlv_type_actor = LACP_TLV_ACTOR_INFO;
     lacpdu_payload->actor_info_length = LACP_TLV_INFO_LENGTH;
+    lacpdu_payload->tlv_type_partner = LACP_TLV_PARTNER_INFO;
+    lacpdu_payload->partner_info_length = LACP_TLV_INFO_LENGTH;
+    lacpdu_payload->tlv_type_collector = LACP_TLV_COLLECTOR_INFO;
+    lacpdu_payload->collector_info_length = LACP_TLV_COLLECTOR_INFO_LENGTH;
+    lacpdu_payload->tlv_type_terminator = LACP_TLV_TERMINATOR_INFO;
+    lacpdu_payload->terminator_length = LACP_TLV_TERMINATOR_INFO_LENGTH;
+
+} // LACP_frame_lacpdu
+
+/*----------------------------------------------------------------------
+ * Function: LACP_update_lacpdu_payload(plpinfo, lacpdu_payload)
+ * Synopsis: Writes the actor, partner and collector information into
+ *           a framed LACPDU.
+ * Input  :
+ *           plpinfo = port on which to act upon.
+ *           lacpdu_payload = the port's transmit buffer.
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+LACP_update_lacpdu_payload(lacp_per_port_variables_t *plpinfo,
+                           lacpdu_payload_t *lacpdu_payload)
+{
+    // Fill in the actor's (local port) parameters in the lacpdu_payload.
     lacpdu_payload->actor_system_priority =
         plpinfo->actor_oper_system_variables.system_priority;
 
@@ -461,27 +546,9 @@ LACP_build_lacpdu_payload(lacp_per_port_variables_t *plpinfo)
     lacpdu_payload->actor_key = plpinfo->actor_oper_port_key;
     lacpdu_payload->actor_port_priority = plpinfo->actor_oper_port_priority;
     lacpdu_payload->actor_port = plpinfo->actor_oper_port_number;
-    lacpdu_payload->actor_state.lacp_activity =
-        plpinfo->actor_oper_port_state.lacp_activity;
-    lacpdu_payload->actor_state.lacp_timeout =
-        plpinfo->actor_oper_port_state.lacp_timeout;
-    lacpdu_payload->actor_state.aggregation =
-        plpinfo->actor_oper_port_state.aggregation;
-    lacpdu_payload->actor_state.synchronization =
-        plpinfo->actor_oper_port_state.synchronization;
-    lacpdu_payload->actor_state.collecting =
-        plpinfo->actor_oper_port_state.collecting;
-    lacpdu_payload->actor_state.distributing =
-        plpinfo->actor_oper_port_state.distributing;
-    lacpdu_payload->actor_state.defaulted =
-        plpinfo->actor_oper_port_state.defaulted;
-    lacpdu_payload->actor_state.expired =
-        plpinfo->actor_oper_port_state.expired;
+    lacpdu_payload->actor_state = plpinfo->actor_oper_port_state;
 
     // Fill in the partner's (local port) parameters in the lacpdu_payload.
-    lacpdu_payload->tlv_type_partner = LACP_TLV_PARTNER_INFO;
-    lacpdu_payload->partner_info_length = LACP_TLV_INFO_LENGTH;
-
     lacpdu_payload->partner_system_priority =
         plpinfo->partner_oper_system_variables.system_priority;
     memcpy((char *)lacpdu_payload->partner_system,
@@ -493,37 +560,11 @@ LACP_build_lacpdu_payload(lacp_per_port_variables_t *plpinfo)
         plpinfo->partner_oper_port_priority;
     lacpdu_payload->partner_port =
         plpinfo->partner_oper_port_number;
+    lacpdu_payload->partner_state = plpinfo->partner_oper_port_state;
 
-    // State parameters.
-    lacpdu_payload->partner_state.lacp_activity =
-        plpinfo->partner_oper_port_state.lacp_activity;
-    lacpdu_payload->partner_state.lacp_timeout =
-        plpinfo->partner_oper_port_state.lacp_timeout;
-    lacpdu_payload->partner_state.aggregation =
-        plpinfo->partner_oper_port_state.aggregation;
-    lacpdu_payload->partner_state.synchronization =
-        plpinfo->partner_oper_port_state.synchronization;
-    lacpdu_payload->partner_state.collecting =
-        plpinfo->partner_oper_port_state.collecting;
-    lacpdu_payload->partner_state.distributing =
-        plpinfo->partner_oper_port_state.distributing;
-    lacpdu_payload->partner_state.defaulted =
-        plpinfo->partner_oper_port_state.defaulted;
-    lacpdu_payload->partner_state.expired =
-        plpinfo->partner_oper_port_state.expired;
-
-    lacpdu_payload->tlv_type_collector = LACP_TLV_COLLECTOR_INFO;
-    lacpdu_payload->collector_info_length = LACP_TLV_COLLECTOR_INFO_LENGTH;
     lacpdu_payload->collector_max_delay = plpinfo->collector_max_delay;
-    lacpdu_payload->tlv_type_terminator = LACP_TLV_TERMINATOR_INFO;
-    lacpdu_payload->terminator_length = LACP_TLV_TERMINATOR_INFO_LENGTH;
-
-exit:
 
-  REXIT();
-  return (lacpdu_payload);
-
-} // LACP_build_lacpdu_payload
+} // LACP_update_lacpdu_payload
 
 /****************************************************************************
  *       Transmit machine
@@ -538,7 +579,7 @@ exit:
 void
 LACP_sync_transmit_lacpdu(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
@@ -555,7 +596,7 @@ LACP_sync_transmit_lacpdu(lacp_per_port_variables_t *plpinfo)
 
 exit:
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_sync_transmit_lacpdu
@@ -570,17 +611,22 @@ exit:
 void
 LACP_async_transmit_lacpdu(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n",
              __FUNCTION__, plpinfo->lport_handle);
     }
 
     if (plpinfo->async_tx_count < MAX_ASYNC_TX) {
-        plpinfo->async_tx_count++;
+        // The first async Tx opens a one second window, at the end
+        // of which the count is cleared (see lacp_task.c).
+        if (plpinfo->async_tx_count++ == 0) {
+            lacp_timer_start(&plpinfo->async_tx_timer,
+                             LACP_TIMER_MSEC_PER_SEC);
+        }
         LACP_sync_transmit_lacpdu(plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_TX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_TX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_async_transmit_lacpdu
@@ -33,139 +33,179 @@
 #include "lacp_ops_if.h"
 #include "mvlan_sport.h"
 #include "mlacp_fproto.h"
+#include "lacp_rx_filter.h"
 
 VLOG_DEFINE_THIS_MODULE(receive_fsm);
 
+/*****************************************************************************
+ *                Prototypes for static functions
+ *****************************************************************************/
+static void current_state_action(lacp_per_port_variables_t *, lacpdu_payload_t *);
+static void expired_state_action(lacp_per_port_variables_t *);
+static void defaulted_state_action(lacp_per_port_variables_t *);
+static void lacp_disabled_state_action(lacp_per_port_variables_t *);
+static void port_disabled_state_action(lacp_per_port_variables_t *);
+static void initialize_state_action(lacp_per_port_variables_t *);
+static void update_Selected (lacpdu_payload_t *, lacp_per_port_variables_t *);
+static int update_NTT(lacpdu_payload_t *, lacp_per_port_variables_t *);
+static void recordPDU (lacpdu_payload_t *, lacp_per_port_variables_t *);
+static void choose_Matched(lacpdu_payload_t *, lacp_per_port_variables_t *);
+static void recordDefault(lacp_per_port_variables_t *);
+static void update_Default_Selected(lacp_per_port_variables_t *);
+static void start_current_while_timer(lacp_per_port_variables_t *, int);
+static void generate_mux_event_from_recordPdu(lacp_per_port_variables_t *);
+static void format_state(state_parameters_t, char *);
+static void update_max_port_priority(lacp_per_port_variables_t *);
+static void take_rx_snapshot(lacp_per_port_variables_t *, lacp_rx_snapshot_t *);
+static void log_partner_timeout(lacp_per_port_variables_t *, int);
+static void log_partner_out_of_sync(lacp_per_port_variables_t *);
+
+/*****************************************************************************
+ * A table cell names the next state and the action to run.  The action is
+ * normally a number that LACP_receive_fsm() switches on.  Built with
+ * LACPD_FSM_DIRECT_DISPATCH, the cell holds the action routine itself.
+ ****************************************************************************/
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+typedef void (*recv_fsm_action_t)(lacp_per_port_variables_t *,
+                                  lacpdu_payload_t *, int);
+
+typedef struct recv_fsm_entry {
+    unsigned int next_state;
+    recv_fsm_action_t action;
+} RECV_FSM_ENTRY;
+
+static void recv_no_action(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_current(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_expired(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_defaulted(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_lacp_disabled(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_port_disabled(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+static void recv_initialize(lacp_per_port_variables_t *, lacpdu_payload_t *, int);
+
+#define NO_ACTION_FN                recv_no_action
+#define ACTION_CURRENT_FN           recv_current
+#define ACTION_EXPIRED_FN           recv_expired
+#define ACTION_DEFAULTED_FN         recv_defaulted
+#define ACTION_LACP_DISABLED_FN     recv_lacp_disabled
+#define ACTION_PORT_DISABLED_FN     recv_port_disabled
+#define ACTION_INITIALIZE_FN        recv_initialize
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION##_FN }
+#else
+typedef FSM_ENTRY RECV_FSM_ENTRY;
+
+#define FSM_CELL(STATE, ACTION)     { STATE, ACTION }
+#endif
+
 /*****************************************************************************
  *   Static Variables
  ****************************************************************************/
 
 /* Receive machine fsm table */
-static FSM_ENTRY receive_machine_fsm_table[RECV_FSM_NUM_INPUTS]
-                                          [RECV_FSM_NUM_STATES] =
+static const RECV_FSM_ENTRY receive_machine_fsm_table[RECV_FSM_NUM_INPUTS]
+                                                     [RECV_FSM_NUM_STATES] =
 {
 /*****************************************************************************/
 /* Input Event E1 - Received LACPDU                                          */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,       NO_ACTION},         // Begin state
-   {RECV_FSM_CURRENT_STATE,      ACTION_CURRENT},    // current
-   {RECV_FSM_CURRENT_STATE,      ACTION_CURRENT},    // expired
-   {RECV_FSM_CURRENT_STATE,      ACTION_CURRENT},    // defaulted
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // LACP_disabled
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // port_disabled
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION}},        // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // Begin state
+   FSM_CELL(RECV_FSM_CURRENT_STATE,      ACTION_CURRENT),    // current
+   FSM_CELL(RECV_FSM_CURRENT_STATE,      ACTION_CURRENT),    // expired
+   FSM_CELL(RECV_FSM_CURRENT_STATE,      ACTION_CURRENT),    // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // LACP_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION)},        // initialize
 
 /*****************************************************************************/
 /* Input Event E2 - current_while_timer_expired                              */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,       NO_ACTION},         // Begin state
-   {RECV_FSM_EXPIRED_STATE,      ACTION_EXPIRED},    // current
-   {RECV_FSM_DEFAULTED_STATE,    ACTION_DEFAULTED},  // expired
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // defaulted
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // LACP_disabled
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // port_disabled
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION}},        // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // Begin state
+   FSM_CELL(RECV_FSM_EXPIRED_STATE,      ACTION_EXPIRED),    // current
+   FSM_CELL(RECV_FSM_DEFAULTED_STATE,    ACTION_DEFAULTED),  // expired
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // LACP_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION)},        // initialize
 
 /*****************************************************************************/
 /* Input Event E3 - port_moved = TRUE                                        */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,       NO_ACTION},         // Begin state
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // current
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // expired
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // defaulted
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION},         // LACP_disabled
-   {RECV_FSM_INITIALIZE_STATE,   ACTION_INITIALIZE}, // port_disabled
-   {RECV_FSM_RETAIN_STATE,       NO_ACTION}},        // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // Begin state
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // current
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // expired
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION),         // LACP_disabled
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE,   ACTION_INITIALIZE), // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,       NO_ACTION)},        // initialize
 
 /*****************************************************************************/
 /* Input Event E4 - port_moved = FALSE, port_enabled = FALSE, BEGIN = FALSE  */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,         NO_ACTION},            // Begin state
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}, // current
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}, // expired
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}, // defaulte
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}, // LACP_disabled
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}, // port_disabled
-   {RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED}},// initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,         NO_ACTION),            // Begin state
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED), // current
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED), // expired
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED), // defaulte
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED), // LACP_disabled
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED), // port_disabled
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE,  ACTION_PORT_DISABLED)},// initialize
 
 /*****************************************************************************/
 /* Input Event E5 - UCT                                                      */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,        NO_ACTION},             // Begin state
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},             // current
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},             // expired
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},             // defaulted
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},             // LACP_disabled
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},             // port_disabled
-   {RECV_FSM_PORT_DISABLED_STATE, ACTION_PORT_DISABLED}}, // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // Begin state
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // current
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // expired
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // LACP_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),             // port_disabled
+   FSM_CELL(RECV_FSM_PORT_DISABLED_STATE, ACTION_PORT_DISABLED)}, // initialize
 
 /*****************************************************************************/
 /* Input Event E6 - port_enabled = TRUE, LACP_Enabled = True                 */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,      NO_ACTION},         // Begin state
-   {RECV_FSM_RETAIN_STATE,      NO_ACTION},         // current
-   {RECV_FSM_RETAIN_STATE,      NO_ACTION},         // expired
-   {RECV_FSM_RETAIN_STATE,      NO_ACTION},         // defaulted
-   {RECV_FSM_RETAIN_STATE,      NO_ACTION},         // LACP_disabled
-   {RECV_FSM_EXPIRED_STATE,     ACTION_EXPIRED},    // port_disabled
-   {RECV_FSM_RETAIN_STATE,      NO_ACTION}},        // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION),         // Begin state
+   FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION),         // current
+   FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION),         // expired
+   FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION),         // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION),         // LACP_disabled
+   FSM_CELL(RECV_FSM_EXPIRED_STATE,     ACTION_EXPIRED),    // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,      NO_ACTION)},        // initialize
 
 /*****************************************************************************/
 /* Input Event E7 - port_enabled = TRUE, LACP_Enabled = FALSE                */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,        NO_ACTION},            // Begin state
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // current
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // expired
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // defaulted
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // LACP_disabled
-   {RECV_FSM_LACP_DISABLED_STATE, ACTION_LACP_DISABLED}, // port_disabled
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION}},           // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // Begin state
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // current
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // expired
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // LACP_disabled
+   FSM_CELL(RECV_FSM_LACP_DISABLED_STATE, ACTION_LACP_DISABLED), // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION)},           // initialize
 
 /*****************************************************************************/
 /* Input Event E8 - Begin = TRUE                                             */
 /*****************************************************************************/
-  {{RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // Begin state
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // current
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // expired
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // defaulted
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // LACP_disabled
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE},  // port_disabled
-   {RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE}}, // initialize
+  {FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // Begin state
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // current
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // expired
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // defaulted
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // LACP_disabled
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE),  // port_disabled
+   FSM_CELL(RECV_FSM_INITIALIZE_STATE, ACTION_INITIALIZE)}, // initialize
 
 /*****************************************************************************/
 /* Input Event E9 - Fallback changed                                         */
 /*****************************************************************************/
-  {{RECV_FSM_RETAIN_STATE,        NO_ACTION},            // Begin state
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // current
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // expired
-   {RECV_FSM_DEFAULTED_STATE,     ACTION_DEFAULTED},     // defaulted
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // LACP_disabled
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION},            // port_disabled
-   {RECV_FSM_RETAIN_STATE,        NO_ACTION}}            // initialize
+  {FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // Begin state
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // current
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // expired
+   FSM_CELL(RECV_FSM_DEFAULTED_STATE,     ACTION_DEFAULTED),     // defaulted
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // LACP_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION),            // port_disabled
+   FSM_CELL(RECV_FSM_RETAIN_STATE,        NO_ACTION)}            // initialize
 
 };
 
-
-/*****************************************************************************
- *                Prototypes for static functions
- *****************************************************************************/
-static void current_state_action(lacp_per_port_variables_t *, lacpdu_payload_t *);
-static void expired_state_action(lacp_per_port_variables_t *);
-static void defaulted_state_action(lacp_per_port_variables_t *);
-static void lacp_disabled_state_action(lacp_per_port_variables_t *);
-static void port_disabled_state_action(lacp_per_port_variables_t *);
-static void initialize_state_action(lacp_per_port_variables_t *);
-static void update_Selected (lacpdu_payload_t *, lacp_per_port_variables_t *);
-static void update_NTT(lacpdu_payload_t *, lacp_per_port_variables_t *);
-static void recordPDU (lacpdu_payload_t *, lacp_per_port_variables_t *);
-static void choose_Matched(lacpdu_payload_t *, lacp_per_port_variables_t *);
-static void recordDefault(lacp_per_port_variables_t *);
-static void update_Default_Selected(lacp_per_port_variables_t *);
-static void start_current_while_timer(lacp_per_port_variables_t *, int);
-static void generate_mux_event_from_recordPdu(lacp_per_port_variables_t *);
-static void format_state(state_parameters_t, char *);
-static void update_max_port_priority(lacp_per_port_variables_t *);
-
 /*----------------------------------------------------------------------
  * Function: LACP_receive_fsm(event, current_state, recvd_lacpdu, plpinfo)
  * Synopsis: Entry routine for LACP Receive state machine.
@@ -181,13 +221,21 @@ LACP_receive_fsm(int event, int current_state,
                  lacpdu_payload_t *recvd_lacpdu,
                  lacp_per_port_variables_t *plpinfo)
 {
+    int previous_state = plpinfo->recv_fsm_state;
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+    const RECV_FSM_ENTRY *cell;
+
+    cell = &receive_machine_fsm_table[event][current_state];
+
+    if (cell->next_state != RECV_FSM_RETAIN_STATE) {
+        plpinfo->recv_fsm_state = cell->next_state;
+    }
+
+    cell->action(plpinfo, recvd_lacpdu, previous_state);
+#else
     u_int action;
     char previous_state_string[STATE_STRING_SIZE];
     char current_state_string[STATE_STRING_SIZE];
-    char actor_state_str[STATE_FLAGS_SIZE];
-    char partner_state_str[STATE_FLAGS_SIZE];
-    int port;
-    struct iface_data *idp = NULL;
 
     RENTRY();
     RDEBUG(DL_RX_FSM, "RxFSM: event %d current_state %d\n", event, current_state);
@@ -201,7 +249,7 @@ LACP_receive_fsm(int event, int current_state,
     // Update the state only if required so.
     if (current_state != RECV_FSM_RETAIN_STATE) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             //***********************************************************
             // receive_fsm  debug is DBG_RX_FSM
             // periodic_fsm debug is DBG_TX_FSM
@@ -220,15 +268,12 @@ LACP_receive_fsm(int event, int current_state,
         plpinfo->recv_fsm_state = current_state;
 
     } else {
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : retain old state (%d)\n",
                  __FUNCTION__, plpinfo->recv_fsm_state);
         }
     }
 
-    port = PM_HANDLE2PORT(plpinfo->lport_handle);
-    idp = find_iface_data_by_index(port);
-
     // Call the appropriate action routine.
     switch (action) {
 
@@ -242,16 +287,7 @@ LACP_receive_fsm(int event, int current_state,
 
     case ACTION_DEFAULTED:
         defaulted_state_action(plpinfo);
-        if (log_event("LACP_PARTNER_TIMEOUT",
-                      EV_KV("intf_id", "%s",
-                            idp->name),
-                      EV_KV("lag_id", "sport: %d",
-                            idp->cfg_lag_id),
-                      EV_KV("fsm_state", "%s -> %s",
-                            previous_state_string,
-                            current_state_string)) < 0) {
-            VLOG_ERR("Could not log event LACP_PARTNER_TIMEOUT");
-        }
+        log_partner_timeout(plpinfo, previous_state);
         break;
 
     case ACTION_LACP_DISABLED:
@@ -260,20 +296,7 @@ LACP_receive_fsm(int event, int current_state,
 
     case ACTION_PORT_DISABLED:
         port_disabled_state_action(plpinfo);
-        format_state(plpinfo->actor_oper_port_state,
-                     actor_state_str);
-        format_state(plpinfo->partner_oper_port_state,
-                     partner_state_str);
-        if (log_event("LACP_PARTNER_OUT_OF_SYNC",
-                      EV_KV("intf_id", "%s", idp->name),
-                      EV_KV("lag_id", "sport: %d", idp->cfg_lag_id),
-                      EV_KV("actor_state", "%s",
-                            actor_state_str),
-                      EV_KV("partner_state", "%s",
-                            partner_state_str)
-                      ) < 0) {
-            VLOG_ERR("Could not log event LACP_PARTNER_OUT_OF_SYNC");
-        }
+        log_partner_out_of_sync(plpinfo);
         break;
 
     case ACTION_INITIALIZE:
@@ -284,13 +307,145 @@ LACP_receive_fsm(int event, int current_state,
     default:
         break;
     }
+#endif
 
+    lacp_rx_filter_update(plpinfo);
     db_update_interface(plpinfo);
 
     REXIT();
 
 } // LACP_receive_fsm
 
+#ifdef LACPD_FSM_DIRECT_DISPATCH
+/*----------------------------------------------------------------------
+ * Receive machine actions as called from the table cells.
+ *----------------------------------------------------------------------*/
+static void
+recv_no_action(lacp_per_port_variables_t *plpinfo,
+               lacpdu_payload_t *recvd_lacpdu,
+               int previous_state)
+{
+} // recv_no_action
+
+static void
+recv_current(lacp_per_port_variables_t *plpinfo,
+             lacpdu_payload_t *recvd_lacpdu,
+             int previous_state)
+{
+    current_state_action(plpinfo, recvd_lacpdu);
+} // recv_current
+
+static void
+recv_expired(lacp_per_port_variables_t *plpinfo,
+             lacpdu_payload_t *recvd_lacpdu,
+             int previous_state)
+{
+    expired_state_action(plpinfo);
+} // recv_expired
+
+static void
+recv_defaulted(lacp_per_port_variables_t *plpinfo,
+               lacpdu_payload_t *recvd_lacpdu,
+               int previous_state)
+{
+    defaulted_state_action(plpinfo);
+    log_partner_timeout(plpinfo, previous_state);
+} // recv_defaulted
+
+static void
+recv_lacp_disabled(lacp_per_port_variables_t *plpinfo,
+                   lacpdu_payload_t *recvd_lacpdu,
+                   int previous_state)
+{
+    lacp_disabled_state_action(plpinfo);
+} // recv_lacp_disabled
+
+static void
+recv_port_disabled(lacp_per_port_variables_t *plpinfo,
+                   lacpdu_payload_t *recvd_lacpdu,
+                   int previous_state)
+{
+    port_disabled_state_action(plpinfo);
+    log_partner_out_of_sync(plpinfo);
+} // recv_port_disabled
+
+static void
+recv_initialize(lacp_per_port_variables_t *plpinfo,
+                lacpdu_payload_t *recvd_lacpdu,
+                int previous_state)
+{
+    initialize_state_action(plpinfo);
+} // recv_initialize
+#endif
+
+/*----------------------------------------------------------------------
+ * Function: log_partner_timeout(plpinfo, previous_state)
+ * Synopsis: Logs the LACP_PARTNER_TIMEOUT event for a port that has
+ *           entered the defaulted state.
+ * Input  :
+ *           plpinfo = pointer to lport data
+ *           previous_state = receive machine state before the event
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+log_partner_timeout(lacp_per_port_variables_t *plpinfo, int previous_state)
+{
+    char previous_state_string[STATE_STRING_SIZE];
+    char current_state_string[STATE_STRING_SIZE];
+    struct lacpd_iface_cfg cfg;
+
+    // Read the published copy; the interface table belongs to the
+    // OVSDB thread.
+    lacpd_iface_cfg_get(PM_HANDLE2PORT(plpinfo->lport_handle), &cfg);
+
+    rx_state_string(previous_state, previous_state_string);
+    rx_state_string(plpinfo->recv_fsm_state, current_state_string);
+
+    if (log_event("LACP_PARTNER_TIMEOUT",
+                  EV_KV("intf_id", "%s",
+                        cfg.name),
+                  EV_KV("lag_id", "sport: %d",
+                        cfg.cfg_lag_id),
+                  EV_KV("fsm_state", "%s -> %s",
+                        previous_state_string,
+                        current_state_string)) < 0) {
+        VLOG_ERR("Could not log event LACP_PARTNER_TIMEOUT");
+    }
+} // log_partner_timeout
+
+/*----------------------------------------------------------------------
+ * Function: log_partner_out_of_sync(plpinfo)
+ * Synopsis: Logs the LACP_PARTNER_OUT_OF_SYNC event for a port that has
+ *           entered the port disabled state.
+ * Input  :
+ *           plpinfo = pointer to lport data
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+log_partner_out_of_sync(lacp_per_port_variables_t *plpinfo)
+{
+    char actor_state_str[STATE_FLAGS_SIZE];
+    char partner_state_str[STATE_FLAGS_SIZE];
+    struct lacpd_iface_cfg cfg;
+
+    lacpd_iface_cfg_get(PM_HANDLE2PORT(plpinfo->lport_handle), &cfg);
+
+    format_state(plpinfo->actor_oper_port_state,
+                 actor_state_str);
+    format_state(plpinfo->partner_oper_port_state,
+                 partner_state_str);
+    if (log_event("LACP_PARTNER_OUT_OF_SYNC",
+                  EV_KV("intf_id", "%s", cfg.name),
+                  EV_KV("lag_id", "sport: %d", cfg.cfg_lag_id),
+                  EV_KV("actor_state", "%s",
+                        actor_state_str),
+                  EV_KV("partner_state", "%s",
+                        partner_state_str)
+                  ) < 0) {
+        VLOG_ERR("Could not log event LACP_PARTNER_OUT_OF_SYNC");
+    }
+} // log_partner_out_of_sync
+
 /*----------------------------------------------------------------------
  * Function: current_state_action(plpinfo, recvd_lacpdu)
  * Synopsis: Function implementing current state action
@@ -303,10 +458,31 @@ static void
 current_state_action(lacp_per_port_variables_t *plpinfo,
                      lacpdu_payload_t *recvd_lacpdu)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    lacp_rx_snapshot_t before;
+    lacp_rx_snapshot_t after;
+    int ntt;
+
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
+    take_rx_snapshot(plpinfo, &before);
+
+    // Fast path: the previous LACPDU changed nothing, and neither the
+    // LACPDU nor the port's state has changed since, so running the
+    // actions again would change nothing either.
+    if (plpinfo->rx_fast_path_valid &&
+        !memcmp(plpinfo->rx_info, &recvd_lacpdu->tlv_type_actor,
+                sizeof(plpinfo->rx_info)) &&
+        !memcmp(&plpinfo->rx_snapshot, &before, sizeof(before))) {
+
+        LACP_STAT_INC(plpinfo, lacp_pdus_fast_path);
+
+        start_current_while_timer(plpinfo,
+                                  plpinfo->actor_oper_port_state.lacp_timeout);
+        goto exit;
+    }
+
     update_Selected(recvd_lacpdu, plpinfo);
 
     // OpenSwitch: This used to be after recordPDU() call below.
@@ -315,7 +491,7 @@ current_state_action(lacp_per_port_variables_t *plpinfo,
     //        (ANVL LACP Conformance Test 7.3)
     choose_Matched(recvd_lacpdu, plpinfo);
 
-    update_NTT(recvd_lacpdu, plpinfo);
+    ntt = update_NTT(recvd_lacpdu, plpinfo);
 
     recordPDU(recvd_lacpdu, plpinfo);
 
@@ -326,11 +502,94 @@ current_state_action(lacp_per_port_variables_t *plpinfo,
 
     plpinfo->actor_oper_port_state.expired = FALSE;
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    // Remember the LACPDU if it left a selected member port as it was.
+    take_rx_snapshot(plpinfo, &after);
+
+    plpinfo->rx_fast_path_valid =
+        (ntt == FALSE &&
+         plpinfo->lacp_control.selected == SELECTED &&
+         plpinfo->lag != NULL && LAG_IS_MEMBER(plpinfo->lag, plpinfo) &&
+         !memcmp(&before, &after, sizeof(after)));
+
+    if (plpinfo->rx_fast_path_valid) {
+        memcpy(plpinfo->rx_info, &recvd_lacpdu->tlv_type_actor,
+               sizeof(plpinfo->rx_info));
+        memcpy(&plpinfo->rx_snapshot, &after, sizeof(after));
+    }
+
+exit:
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // current_state_action
 
+/*----------------------------------------------------------------------
+ * Function: LACP_rx_fast_path_ready(plpinfo)
+ * Synopsis: Tells whether a LACPDU identical to the last one received
+ *           would take the current state fast path right now: the port
+ *           is current and nothing the fast path depends on has changed
+ *           since that LACPDU.
+ * Input  :
+ *           plpinfo = pointer to lport data
+ * Returns:  TRUE or FALSE
+ *----------------------------------------------------------------------*/
+int
+LACP_rx_fast_path_ready(lacp_per_port_variables_t *plpinfo)
+{
+    lacp_rx_snapshot_t snap;
+
+    if (plpinfo->lacp_up == FALSE || !plpinfo->rx_fast_path_valid ||
+        plpinfo->recv_fsm_state != RECV_FSM_CURRENT_STATE) {
+        return FALSE;
+    }
+
+    take_rx_snapshot(plpinfo, &snap);
+
+    return !memcmp(&plpinfo->rx_snapshot, &snap, sizeof(snap));
+} // LACP_rx_fast_path_ready
+
+/*----------------------------------------------------------------------
+ * Function: take_rx_snapshot(plpinfo, snap)
+ * Synopsis: Copies the port state that current_state_action() depends
+ *           on, so that two snapshots can be compared with memcmp().
+ * Input  :
+ *           plpinfo = pointer to lport data
+ *           snap = snapshot to fill in
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+static void
+take_rx_snapshot(lacp_per_port_variables_t *plpinfo, lacp_rx_snapshot_t *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    snap->actor_port_number = plpinfo->actor_oper_port_number;
+    snap->actor_port_priority = plpinfo->actor_oper_port_priority;
+    snap->actor_key = plpinfo->actor_oper_port_key;
+    snap->actor_state = plpinfo->actor_oper_port_state;
+    memcpy(snap->actor_system,
+           plpinfo->actor_oper_system_variables.system_mac_addr,
+           MAC_ADDR_LENGTH);
+    snap->actor_system_priority =
+        plpinfo->actor_oper_system_variables.system_priority;
+
+    snap->partner_port_number = plpinfo->partner_oper_port_number;
+    snap->partner_port_priority = plpinfo->partner_oper_port_priority;
+    snap->partner_key = plpinfo->partner_oper_key;
+    snap->partner_state = plpinfo->partner_oper_port_state;
+    memcpy(snap->partner_system,
+           plpinfo->partner_oper_system_variables.system_mac_addr,
+           MAC_ADDR_LENGTH);
+    snap->partner_system_priority =
+        plpinfo->partner_oper_system_variables.system_priority;
+
+    snap->selected = plpinfo->lacp_control.selected;
+    snap->mux_fsm_state = plpinfo->mux_fsm_state;
+    snap->periodic_tx_fsm_state = plpinfo->periodic_tx_fsm_state;
+    snap->port_type = plpinfo->port_type;
+    snap->lacp_up = plpinfo->lacp_up;
+
+} // take_rx_snapshot
+
 /*----------------------------------------------------------------------
  * Function: expired_state_action(plpinfo)
  * Synopsis: Function implementing expired state action
@@ -341,7 +600,7 @@ current_state_action(lacp_per_port_variables_t *plpinfo,
 static void
 expired_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -360,7 +619,7 @@ expired_state_action(lacp_per_port_variables_t *plpinfo)
     plpinfo->actor_oper_port_state.expired = TRUE;
     plpinfo->actor_oper_port_state.defaulted = FALSE;
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // expired_state_action
@@ -375,7 +634,7 @@ expired_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 defaulted_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -433,7 +692,7 @@ defaulted_state_action(lacp_per_port_variables_t *plpinfo)
         plpinfo->lacp_control.selected = UNSELECTED;
         plpinfo->lacp_control.ready_n = FALSE;
     }
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // defaulted_state_action
@@ -448,7 +707,7 @@ defaulted_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 lacp_disabled_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -463,7 +722,7 @@ lacp_disabled_state_action(lacp_per_port_variables_t *plpinfo)
 
     plpinfo->partner_oper_port_state.expired = FALSE;
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // lacp_disabled_state_action
@@ -478,7 +737,7 @@ lacp_disabled_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 port_disabled_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -506,7 +765,7 @@ port_disabled_state_action(lacp_per_port_variables_t *plpinfo)
                          plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // port_disabled_state_action
@@ -521,7 +780,7 @@ port_disabled_state_action(lacp_per_port_variables_t *plpinfo)
 static void
 initialize_state_action(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -541,7 +800,7 @@ initialize_state_action(lacp_per_port_variables_t *plpinfo)
                      NULL,
                      plpinfo);
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // initialize_state_action
@@ -563,10 +822,11 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     lacp_int_sport_params_t     *placp_sport_params;
     int                         status = R_SUCCESS;
     int                         max_port_priority = MAX_PORT_PRIORITY;
+    int                         lock;
 
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -574,7 +834,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     // variable in the local system.
     if (recvd_lacpdu->actor_port != plpinfo->partner_oper_port_number) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->actor_port 0x%x "
                  "plpinfo->partner_oper_port_number 0x%x\n",
                  __FUNCTION__,
@@ -594,7 +854,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     if (recvd_lacpdu->actor_port_priority !=
         plpinfo->partner_oper_port_priority) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->actor_port_priority 0x%x "
                  "plpinfo->partner_oper_port_priority 0x%x\n",
                  __FUNCTION__,
@@ -602,10 +862,11 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
                  plpinfo->partner_oper_port_priority);
         }
 
+        lock = lacp_lock();
         status = mvlan_get_sport(plpinfo->sport_handle , &psport,
                                          MLm_vpm_api__get_sport);
         if (R_SUCCESS == status) {
-            plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+            plpinfo_priority = LACP_port_first();
 
             while (plpinfo_priority) {
                 if (plpinfo_priority->lport_handle != plpinfo->lport_handle &&
@@ -614,12 +875,13 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
                     max_port_priority > plpinfo_priority->partner_oper_port_priority) {
                     max_port_priority = plpinfo_priority->partner_oper_port_priority;
                 }
-                plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
+                plpinfo_priority = LACP_port_next(plpinfo_priority);
             }
 
             placp_sport_params = psport->placp_params;
             placp_sport_params->lacp_params.partner_max_port_priority = max_port_priority;
         }
+        lacp_unlock(lock);
 
         plpinfo->lacp_control.selected = UNSELECTED;
         LACP_mux_fsm(E2,
@@ -634,7 +896,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
                (char *)plpinfo->partner_oper_system_variables.system_mac_addr,
                MAC_ADDR_LENGTH)) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : rcvd_pdu mac %x:%x:%x:%x:%x:%x "
                  "and the mac we had %x:%x:%x:%x:%x:%x:\n",
                  __FUNCTION__,
@@ -665,7 +927,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     if (recvd_lacpdu->actor_system_priority !=
         plpinfo->partner_oper_system_variables.system_priority) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->actor_system_priority 0x%x "
                  "plpinfo->partner_oper_system_variables.system_priority 0x%x\n",
                  __FUNCTION__,
@@ -684,7 +946,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     // in the local system.
     if (recvd_lacpdu->actor_key != plpinfo->partner_oper_key) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->actor_key 0x%x "
                  "plpinfo->partner_oper_key.system_priority 0x%x\n",
                  __FUNCTION__,
@@ -704,7 +966,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
     if (recvd_lacpdu->actor_state.aggregation !=
         plpinfo->partner_oper_port_state.aggregation) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->actor_state.aggregation 0x%x "
                  "plpinfo->partner_oper_port_state.aggregation 0x%x\n",
                  __FUNCTION__,
@@ -722,7 +984,7 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
 
  exit:
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // update_Selected
@@ -733,14 +995,16 @@ update_Selected(lacpdu_payload_t *recvd_lacpdu,
  * Input  :
  *           recvd_lacpdu = received LACPDU
  *           plpinfo = pointer to lport data
- * Returns:  void
+ * Returns:  TRUE if NTT was set.
  *----------------------------------------------------------------------*/
-static void
+static int
 update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
 {
+    int ntt = FALSE;
+
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -748,7 +1012,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     // in the local system.
     if (recvd_lacpdu->partner_port != plpinfo->actor_oper_port_number) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_port 0x%x "
                  "plpinfo->actor_oper_port_number 0x%x\n",
                  __FUNCTION__,
@@ -757,6 +1021,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -768,7 +1033,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_port_priority !=
         plpinfo->actor_oper_port_priority) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_port_priority 0x%x "
                  "plpinfo->actor_oper_port_priority 0x%x\n",
                  __FUNCTION__,
@@ -777,6 +1042,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -789,7 +1055,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
                (char *)plpinfo->actor_oper_system_variables.system_mac_addr,
                MAC_ADDR_LENGTH)) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : rcvd_pdu mac %x:%x:%x:%x:%x:%x "
                  "and the mac we had %x:%x:%x:%x:%x:%x:\n",
                  __FUNCTION__,
@@ -807,6 +1073,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
                  (((char *)(plpinfo->partner_oper_system_variables.system_mac_addr))[5]));
         }
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -818,7 +1085,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_system_priority !=
         plpinfo->actor_oper_system_variables.system_priority) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_system_priority 0x%x "
                  "plpinfo->actor_oper_system_variables.system_priority 0x%x\n",
                  __FUNCTION__,
@@ -827,6 +1094,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -837,7 +1105,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     // in the local system.
     if (recvd_lacpdu->partner_key != plpinfo->actor_oper_port_key) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_key 0x%x "
                  "plpinfo->actor_oper_port_key 0x%x\n",
                  __FUNCTION__,
@@ -846,6 +1114,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -857,7 +1126,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_state.lacp_activity !=
         plpinfo->actor_oper_port_state.lacp_activity) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_state.lacp_activity 0x%x "
                  "plpinfo->actor_oper_port_state.lacp_activity 0x%x\n",
                  __FUNCTION__,
@@ -866,6 +1135,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -877,7 +1147,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_state.lacp_timeout !=
         plpinfo->actor_oper_port_state.lacp_timeout) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_state.lacp_timeout 0x%x "
                  "plpinfo->actor_oper_port_state.lacp_timeout 0x%x\n",
                  __FUNCTION__,
@@ -886,6 +1156,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -898,7 +1169,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_state.synchronization !=
         plpinfo->actor_oper_port_state.synchronization) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_state.synchronization "
                  "0x%x plpinfo->actor_oper_port_state.lacp_timeout 0x%x\n",
                  __FUNCTION__,
@@ -907,6 +1178,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -919,7 +1191,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     if (recvd_lacpdu->partner_state.aggregation !=
         plpinfo->actor_oper_port_state.aggregation) {
 
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : recvd_lacpdu->partner_state.aggregation 0x%x "
                  "plpinfo->actor_oper_port_state.aggregation 0x%x\n",
                  __FUNCTION__,
@@ -928,6 +1200,7 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
         }
 
         plpinfo->lacp_control.ntt = TRUE;
+        ntt = TRUE;
 
         // Transmit a LACPDU.
         LACP_async_transmit_lacpdu(plpinfo);
@@ -937,9 +1210,11 @@ update_NTT(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
 
 exit:
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
+
+    return ntt;
 } // update_NTT
 
 /*----------------------------------------------------------------------
@@ -955,7 +1230,7 @@ recordPDU(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
 {
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -999,7 +1274,7 @@ recordPDU(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
     }
 
     if (plpinfo->partner_oper_port_state.lacp_timeout == LONG_TIMEOUT) {
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : trigger periodic_tx_fsm - long timeout "
                  "lport 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
         }
@@ -1009,7 +1284,7 @@ recordPDU(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
                              plpinfo);
 
     } else if (plpinfo->partner_oper_port_state.lacp_timeout == SHORT_TIMEOUT ) {
-        if (plpinfo->debug_level & DBG_RX_FSM) {
+        if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
             RDBG("%s : trigger periodic_tx_fsm - short timeout "
                  "lport 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
         }
@@ -1023,7 +1298,7 @@ recordPDU(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
 
     REXIT();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // recordPDU
@@ -1034,7 +1309,7 @@ recordPDU(lacpdu_payload_t *recvd_lacpdu, lacp_per_port_variables_t *plpinfo)
 static void
 generate_mux_event_from_recordPdu(lacp_per_port_variables_t *plpinfo)
 {
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -1083,7 +1358,7 @@ generate_mux_event_from_recordPdu(lacp_per_port_variables_t *plpinfo)
                      plpinfo);
     }
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // generate_mux_event_from_recordPdu
@@ -1108,7 +1383,7 @@ choose_Matched(lacpdu_payload_t *recvd_lacpdu,
 
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -1186,7 +1461,7 @@ recordDefault(lacp_per_port_variables_t *plpinfo)
 {
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -1236,7 +1511,7 @@ recordDefault(lacp_per_port_variables_t *plpinfo)
 
     REXIT();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // recordDefault
@@ -1253,7 +1528,7 @@ update_Default_Selected(lacp_per_port_variables_t *plpinfo)
 {
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -1332,7 +1607,7 @@ exit:
 
     REXIT();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // update_Default_Selected
@@ -1349,17 +1624,18 @@ LACP_process_lacpdu(lacp_per_port_variables_t *plpinfo, void *data)
 {
     RENTRY();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
     // If the portocol is down, then do nothing.
     if (plpinfo->lacp_up == FALSE) {
+        LACP_STAT_INC(plpinfo, pdus_dropped);
         return;
     }
 
     // Increment the stats counter.
-    plpinfo->lacp_pdus_received++;
+    LACP_STAT_INC(plpinfo, lacp_pdus_received);
 
     LACP_receive_fsm(E1,
                      plpinfo->recv_fsm_state,
@@ -1367,11 +1643,30 @@ LACP_process_lacpdu(lacp_per_port_variables_t *plpinfo, void *data)
                      plpinfo);
     REXIT();
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // LACP_process_lacpdu
 
+/*----------------------------------------------------------------------
+ * Function: LACP_process_unchanged_lacpdu(plpinfo)
+ * Synopsis: Accounts for a LACPDU identical to the last one received on
+ *           a port for which LACP_rx_fast_path_ready() holds, without
+ *           running the receive machine: this is all its current state
+ *           fast path would have done.
+ * Input  :  plpinfo = pointer to lport data
+ * Returns:  void
+ *----------------------------------------------------------------------*/
+void
+LACP_process_unchanged_lacpdu(lacp_per_port_variables_t *plpinfo)
+{
+    LACP_STAT_INC(plpinfo, lacp_pdus_received);
+    LACP_STAT_INC(plpinfo, lacp_pdus_fast_path);
+
+    start_current_while_timer(plpinfo,
+                              plpinfo->actor_oper_port_state.lacp_timeout);
+} // LACP_process_unchanged_lacpdu
+
 /*----------------------------------------------------------------------
  * Function: start_current_while_timer(plpinfo, lacp_timeout)
  * Synopsis:
@@ -1386,7 +1681,7 @@ start_current_while_timer(lacp_per_port_variables_t *plpinfo,
 {
     int timeout=0;
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : lport_handle 0x%llx\n", __FUNCTION__, plpinfo->lport_handle);
     }
 
@@ -1397,10 +1692,15 @@ start_current_while_timer(lacp_per_port_variables_t *plpinfo,
         timeout = LONG_TIMEOUT_COUNT;
     }
 
-    // Initialize the counter with the timeout value.
-    plpinfo->current_while_timer_expiry_counter = timeout;
+    // Start the timer with the timeout value.
+    if (timeout) {
+        lacp_timer_start(&plpinfo->current_while_timer,
+                         timeout * LACP_TIMER_MSEC_PER_SEC);
+    } else {
+        lacp_timer_stop(&plpinfo->current_while_timer);
+    }
 
-    if (plpinfo->debug_level & DBG_RX_FSM) {
+    if (LACP_FSM_DEBUG(plpinfo, DBG_RX_FSM)) {
         RDBG("%s : exit\n", __FUNCTION__);
     }
 } // start_current_while_timer
@@ -1452,13 +1752,15 @@ update_max_port_priority(lacp_per_port_variables_t *plpinfo)
     lacp_per_port_variables_t *plpinfo_priority;
     struct MLt_vpm_api__lacp_sport_params pmsg;
     int current_port_priority;
+    int lock;
 
+    lock = lacp_lock();
     status = mvlan_get_sport(plpinfo->sport_handle, &psport,
                              MLm_vpm_api__get_sport);
 
     if (R_SUCCESS == status) {
         placp_sport_params = psport->placp_params;
-        plpinfo_priority = LACP_AVL_FIRST(lacp_per_port_vars_tree);
+        plpinfo_priority = LACP_port_first();
         current_port_priority = placp_sport_params->lacp_params.actor_max_port_priority;
 
         while (plpinfo_priority) {
@@ -1468,7 +1770,7 @@ update_max_port_priority(lacp_per_port_variables_t *plpinfo)
 
                 max_port_priority = plpinfo_priority->actor_oper_port_priority;
             }
-            plpinfo_priority = LACP_AVL_NEXT(plpinfo_priority->avlnode);
+            plpinfo_priority = LACP_port_next(plpinfo_priority);
         }
         // If max_port_priority changed, we need to reselect all interfaces
         if (current_port_priority != max_port_priority) {
@@ -1478,4 +1780,5 @@ update_max_port_priority(lacp_per_port_variables_t *plpinfo)
             mlacpVapiSportParamsChange(MLm_vpm_api__set_lacp_sport_params, &pmsg);
         }
     }
+    lacp_unlock(lock);
 } /* update_max_port_priority */
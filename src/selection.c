@@ -23,6 +23,8 @@
 #include "lacp_cmn.h"
 #include <avl.h>
 #include <nlib.h>
+#include <hash.h>
+#include <hmap.h>
 
 #include "lacp_stubs.h"
 #include <pm_cmn.h>
@@ -31,6 +33,7 @@
 #include <lacp_fsm.h>
 
 #include "lacp.h"
+#include "lacp_pool.h"
 #include "lacp_support.h"
 #include "mlacp_fproto.h"
 
@@ -40,17 +43,21 @@
 VLOG_DEFINE_THIS_MODULE(selection);
 
 //*************************************************************
-// List of LAGs for ease & debug.
+// All LAGs, hashed by LAG_Id.
 //*************************************************************
-struct NList *mlacp_lag_tuple_list;
+static struct hmap lag_by_id = HMAP_INITIALIZER(&lag_by_id);
 
-extern int lacp_lag_port_match(void *, void *);
+static struct lacp_pool lag_pool = LACP_POOL_INITIALIZER("LAG", LAG_t, 32);
+static struct lacp_pool lag_id_pool = LACP_POOL_INITIALIZER("LAG_Id", LAG_Id_t, 64);
 
 /*****************************************************************************
  *          Prototypes for static functions
  ****************************************************************************/
 static LAG_Id_t *form_lag_id(lacp_per_port_variables_t *);
 static int compare_lag_id (LAG_Id_t *, LAG_Id_t *);
+static uint32_t hash_lag_id(const LAG_Id_t *);
+static LAG_t *find_lag(LAG_Id_t *, lacp_per_port_variables_t *);
+static void LAG_add_member(LAG_t *, lacp_per_port_variables_t *);
 static int is_port_partner_port(port_handle_t, LAG_t *const);
 static void LAG_select_aggregator(LAG_t *const, lacp_per_port_variables_t *);
 static void print_lag_id(LAG_Id_t *lag_id);
@@ -121,16 +128,121 @@ compare_lag_id(LAG_Id_t *first_lag_id, LAG_Id_t *second_lag_id)
     return TRUE;
 } // compare_lag_id
 
-int
-compare_port_handle(void* lag_port_struct1, void* lag_port_struct2)
+//******************************************************************
+// Function : hash_lag_id
+// Hashes every field compare_lag_id() compares.
+//******************************************************************
+static uint32_t
+hash_lag_id(const LAG_Id_t *lag_id)
+{
+    uint32_t hash;
+
+    hash = hash_int(lag_id->local_system_priority, 0);
+    hash = hash_bytes(lag_id->local_system_mac_addr,
+                      sizeof(macaddr_3_t), hash);
+    hash = hash_int(lag_id->local_port_key, hash);
+    hash = hash_int(lag_id->local_port_priority, hash);
+    hash = hash_int(lag_id->local_port_number, hash);
+
+    hash = hash_int(lag_id->remote_system_priority, hash);
+    hash = hash_bytes(lag_id->remote_system_mac_addr,
+                      sizeof(macaddr_3_t), hash);
+    hash = hash_int(lag_id->remote_port_key, hash);
+    hash = hash_int(lag_id->remote_port_priority, hash);
+    hash = hash_int(lag_id->remote_port_number, hash);
+
+    return hash_int(lag_id->fallback, hash);
+} // hash_lag_id
+
+//******************************************************************
+// Function : find_lag
+// Returns an existing LAG the port with this LAG_Id may join.
+//******************************************************************
+static LAG_t *
+find_lag(LAG_Id_t *lagId, lacp_per_port_variables_t *lacp_port)
 {
-    if (((lacp_lag_ppstruct_t *)lag_port_struct1)->lport_handle >
-        ((lacp_lag_ppstruct_t *)lag_port_struct2)->lport_handle) {
-        return 1;
-    } else {
-        return -1;
+    LAG_t *lag;
+    lacp_per_port_variables_t *plp;
+
+    HMAP_FOR_EACH_WITH_HASH (lag, node, hash_lag_id(lagId), &lag_by_id) {
+        if (lag->port_type != lacp_port->port_type) {
+            continue;
+        }
+
+        if (compare_lag_id(lag->LAG_Id, lagId) == FALSE) {
+            continue;
+        }
+
+        if (lacp_port->debug_level & DBG_SELECT) {
+            print_lag_id(lag->LAG_Id);
+        }
+
+        // OpenSwitch: if partner info has not been received, treat it
+        //        as no match.  We need this since we're automating
+        //        LACP management.  We'll always try to LAG up if
+        //        possible, but if far end doesn't run LACP, we
+        //        cannot allow the two to LAG up; otherwise, it
+        //        results in a LAG being created on our end, but
+        //        two separate ports on the far end, causing loss
+        //        of traffic.
+        LAG_FOR_EACH_MEMBER(plp, lag) {
+            if (memcmp(plp->partner_oper_system_variables.system_mac_addr,
+                       default_partner_system_mac,
+                       MAC_ADDR_LENGTH) != 0) {
+                return lag;
+            }
+        }
     }
-} // compare_port_handle
+
+    return NULL;
+} // find_lag
+
+//******************************************************************
+// Function : LAG_add_member
+//******************************************************************
+static void
+LAG_add_member(LAG_t *lag, lacp_per_port_variables_t *plp)
+{
+    plp->lag_next = lag->members;
+    if (lag->members) {
+        lag->members->lag_pprev = &plp->lag_next;
+    }
+    lag->members = plp;
+    plp->lag_pprev = &lag->members;
+
+    plp->lag = lag;
+} // LAG_add_member
+
+//******************************************************************
+// Function : LAG_remove_member
+// The caller decides what happens to plp->lag.
+//******************************************************************
+void
+LAG_remove_member(LAG_t *lag, lacp_per_port_variables_t *plp)
+{
+    if (!LAG_IS_MEMBER(lag, plp)) {
+        return;
+    }
+
+    *plp->lag_pprev = plp->lag_next;
+    if (plp->lag_next) {
+        plp->lag_next->lag_pprev = plp->lag_pprev;
+    }
+    plp->lag_next = NULL;
+    plp->lag_pprev = NULL;
+} // LAG_remove_member
+
+//******************************************************************
+// Function : LAG_destroy
+// Frees a LAG that has no members left.
+//******************************************************************
+void
+LAG_destroy(LAG_t *lag)
+{
+    hmap_remove(&lag_by_id, &lag->node);
+    lacp_pool_free(&lag_id_pool, lag->LAG_Id);
+    lacp_pool_free(&lag_pool, lag);
+} // LAG_destroy
 
 //******************************************************************
 // Function : LAG_selection
@@ -141,9 +253,6 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     int lock;
     LAG_Id_t *lagId;
     LAG_t *lag;
-    lacp_per_port_variables_t *plp;
-    lacp_lag_ppstruct_t *plag_port_struct = NULL;
-    struct NList *pdummy;
 
     RENTRY();
 
@@ -186,59 +295,21 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                  lacp_port->lport_handle);
         }
 
-        for (plp = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-             plp;
-             plp = LACP_AVL_NEXT(plp->avlnode))
-        {
-            if (!plp->lag) {
-                continue;
-            }
-
-            if (plp->lag->port_type != lacp_port->port_type) {
-                continue;
-            }
-
-            if (lacp_port->debug_level & DBG_SELECT) {
-                print_lag_id(plp->lag->LAG_Id);
-            }
-
-            // OpenSwitch: if partner info has not been received, treat it
-            //        as no match.  We need this since we're automating
-            //        LACP management.  We'll always try to LAG up if
-            //        possible, but if far end doesn't run LACP, we
-            //        cannot allow the two to LAG up; otherwise, it
-            //        results in a LAG being created on our end, but
-            //        two separate ports on the far end, causing loss
-            //        of traffic.
-            if (0 == memcmp(plp->partner_oper_system_variables.system_mac_addr,
-                            default_partner_system_mac,
-                            MAC_ADDR_LENGTH)) {
-                continue;
-            }
-
-            if (compare_lag_id(plp->lag->LAG_Id, lagId) == FALSE) {
-                continue;
-            }
-
-            lag = plp->lag;
-            break;
-        }
+        lag = find_lag(lagId, lacp_port);
 
         /*2*/
         if (lag == NULL) {
             // No LAG found with the same LAG id.  Could be the first
             // port to join a new LAG or the only (individual) port
             // to form an individual LAG.
-            if ((lag = (LAG_t *)malloc(sizeof(LAG_t))) == NULL) {
-                free(lagId);
+            if ((lag = lacp_pool_alloc(&lag_pool)) == NULL) {
+                lacp_pool_free(&lag_id_pool, lagId);
                 VLOG_FATAL("%s : out of memory", __FUNCTION__);
                 lacp_port->selecting_lag = FALSE;
                 lacp_unlock(lock);
                 exit(-1);
                 return;
             }
-            memset(lag, 0, sizeof(LAG_t));
-
             if (lacp_port->debug_level & DBG_SELECT) {
                 RDBG("%s : no LAG found; create new LAG (lport 0x%llx)\n",
                      __FUNCTION__, lacp_port->lport_handle);
@@ -248,21 +319,12 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
             lag->LAG_Id = lagId;
             lag->loop_back = loop_back_check(lacp_port) ? TRUE : FALSE;
 
-            plag_port_struct = calloc(1, sizeof(lacp_lag_ppstruct_t));
-            if (plag_port_struct == NULL) {
-                VLOG_FATAL("%s : out of memory", __FUNCTION__);
-                exit(-1);
-            }
-            plag_port_struct->lport_handle = lacp_port->lport_handle;
-            lag->pplist = n_list_insert_sorted(lag->pplist,
-                                               (void *)plag_port_struct,
-                                               compare_port_handle);
-            lacp_port->lag = lag;
+            LAG_add_member(lag, lacp_port);
 
             //*************************************************************
-            // Insert this LAG into the list.
+            // Insert this LAG into the index.
             //*************************************************************
-            mlacp_lag_tuple_list = n_list_append(mlacp_lag_tuple_list, lag);
+            hmap_insert(&lag_by_id, &lag->node, hash_lag_id(lagId));
 
             //*************************************************************
             // Done.
@@ -288,9 +350,7 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                  lacp_port->lport_handle);
         }
 
-        if (n_list_find_data(lag->pplist,
-                             &lacp_lag_port_match,
-                             &lacp_port->lport_handle) == NULL) {
+        if (!LAG_IS_MEMBER(lag, lacp_port)) {
 
              // Add the port to the LAG, only if this port is not
              // a loop back and not a partner port to any of the
@@ -301,16 +361,7 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                 lacp_port->actor_oper_port_state.aggregation == AGGREGATABLE &&
                 lacp_port->partner_oper_port_state.aggregation == AGGREGATABLE) {
 
-                plag_port_struct = calloc(1, sizeof(lacp_lag_ppstruct_t));
-                if (plag_port_struct == NULL) {
-                    VLOG_FATAL("%s : out of memory", __FUNCTION__);
-                    exit(-1);
-                }
-                plag_port_struct->lport_handle = lacp_port->lport_handle;
-                lag->pplist = n_list_insert_sorted(lag->pplist,
-                                                   (void *)plag_port_struct,
-                                                   compare_port_handle);
-                lacp_port->lag = lag;
+                LAG_add_member(lag, lacp_port);
                 if (lacp_port->debug_level & DBG_SELECT) {
                     RDBG("%s : Port (0x%llx) Added to Existing LAG\n",
                          __FUNCTION__, lacp_port->lport_handle);
@@ -319,7 +370,7 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                 LAG_select_aggregator(lag, lacp_port);
             }
 
-            free(lagId);
+            lacp_pool_free(&lag_id_pool, lagId);
             lacp_port->selecting_lag = FALSE;
             lacp_unlock(lock);
             return;
@@ -349,14 +400,7 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     // removed and the super port cleaned allowing the interface to attach to a
     // default partner
 
-    pdummy = n_list_find_data(lag->pplist,
-                              &lacp_lag_port_match,
-                              &lacp_port->lport_handle);
-    if (pdummy != NULL) {
-        plag_port_struct = pdummy->data;
-    }
-
-    if (plag_port_struct &&
+    if (LAG_IS_MEMBER(lag, lacp_port) &&
         (((lag->loop_back = loop_back_check(lacp_port)) == TRUE) ||
          (compare_lag_id(lag->LAG_Id, lagId) == FALSE) ||
          (lag->port_type != lacp_port->port_type))) {
@@ -369,14 +413,14 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
                      lacp_port);
 
         lacp_port->lacp_control.ready_n = FALSE;
-        lag->pplist =  n_list_remove_data(lag->pplist, plag_port_struct);
+        LAG_remove_member(lag, lacp_port);
 
         if (lacp_port->debug_level & DBG_SELECT) {
             RDBG("%s : Port (0x%llx) Removed from current LAG\n",
                  __FUNCTION__, lacp_port->lport_handle);
         }
 
-        if (lag->pplist == NULL) {
+        if (lag->members == NULL) {
             // It was the last port in the LAG, remove the whole LAG.
 
             // OpenSwitch: clear out sport params so it can be reused later.
@@ -385,24 +429,19 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
             }
 
             lacp_port->lag = NULL;
-            free(lag->LAG_Id);
-
-            // Remove the LAG from the tuple_list before we free it.
-            mlacp_lag_tuple_list = n_list_remove_data(mlacp_lag_tuple_list,
-                                                      lag);
-            free(lag);
+            LAG_destroy(lag);
 
         } else if (lacp_port->debug_level & DBG_SELECT) {
             // --- OpenSwitch: DEBUG ONLY ---
-            lacp_lag_ppstruct_t *ptmp;
+            lacp_per_port_variables_t *ptmp;
             RDBG("LAG.%d not empty:  ", (int)PM_HANDLE2LAG(lag->sp_handle));
-            N_LIST_FOREACH(lag->pplist, ptmp) {
+            LAG_FOR_EACH_MEMBER(ptmp, lag) {
                 RDBG("      0x%llx", ptmp->lport_handle);
-            } N_LIST_FOREACH_END(lag->pplist, ptmp);
+            }
         }
 
         lacp_port->lag = NULL;
-        free(lagId);
+        lacp_pool_free(&lag_id_pool, lagId);
         lacp_port->selecting_lag = FALSE;
         lacp_unlock(lock);
 
@@ -418,7 +457,7 @@ LAG_selection(lacp_per_port_variables_t *lacp_port)
     }
 
     // All is well and no change is required.
-    free(lagId);
+    lacp_pool_free(&lag_id_pool, lagId);
 
     // Port is already in a LAG.  Select an aggregator
     // if one exists with the same keys.
@@ -476,20 +515,23 @@ is_port_partner_port(port_handle_t lport_handle, LAG_t *const lag)
 
     RDEBUG(DL_SELECT, "%s : lport_handle 0x%llx\n", __FUNCTION__, lport_handle);
 
-    if (!lag || lag->pplist == NULL) {
+    if (!lag || lag->members == NULL) {
         return 0;
     }
 
-    for (plpinfo = LACP_AVL_FIRST(lacp_per_port_vars_tree);
-         plpinfo;
-         plpinfo = LACP_AVL_NEXT(plpinfo->avlnode)) {
-        if (n_list_find_data(lag->pplist,
-                             &lacp_lag_port_match,
-                             &lport_handle) == NULL)
-        {
-            continue;
+    // Only a port already in the LAG can be one.
+    LAG_FOR_EACH_MEMBER(plpinfo, lag) {
+        if (plpinfo->lport_handle == lport_handle) {
+            break;
         }
+    }
+    if (plpinfo == NULL) {
+        return 0;
+    }
 
+    for (plpinfo = LACP_port_first();
+         plpinfo;
+         plpinfo = LACP_port_next(plpinfo)) {
         if (plpinfo->partner_oper_port_number == plpinfo->actor_admin_port_number) {
              return 1;
         }
@@ -534,15 +576,12 @@ form_lag_id(lacp_per_port_variables_t *lacp_port)
 
     RENTRY();
 
-    // Allocate memory for LAG ID.
-    if (!(lagId = (LAG_Id_t *)malloc(sizeof(LAG_Id_t)))) {
+    // Allocate a zeroed LAG ID.
+    if (!(lagId = lacp_pool_alloc(&lag_id_pool))) {
         VLOG_FATAL("out of memory");
         return NULL;
     }
 
-    // Zero out the LAG ID.
-    memset(lagId, 0, sizeof(LAG_Id_t));
-
     // Local paramters.
     lagId->local_system_priority =
         lacp_port->actor_oper_system_variables.system_priority;
@@ -0,0 +1,343 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacpd_bench.c
+ *
+ *   Microbenchmarks for the LACP protocol hot paths, run against the
+ *   stubs in lacpd_harness.c:
+ *
+ *     converge   time for N ports in M LAGs to reach Collecting_
+ *                Distributing, and the cost of the first exchange,
+ *                which is dominated by aggregator selection.
+ *     select     the same first exchange as the number of LAGs grows.
+ *     rx_steady  cost of one LACPDU received on a converged port.
+ *     rx_batch   the same, with the LACPDUs handed over in RX batches
+ *                of LACPD_RX_BATCH_SIZE, as the RX thread posts them.
+ *
+ *   Each case runs in its own child process, so every case starts from
+ *   freshly initialized protocol state.  Results are printed one case
+ *   per line as "lacpd-bench-v1 case=<name>" followed by key=value
+ *   pairs, for scripts to compare runs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/wait.h>
+
+#include <util.h>
+
+#include "lacp_cmn.h"
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "mlacp_fproto.h"
+#include "mlacp_recv.h"
+#include "lacpd_harness.h"
+
+#define BENCH_TAG               "lacpd-bench-v1"
+#define BENCH_MAX_ROUNDS        64
+#define BENCH_DEF_RX_PDUS       1000000
+#define BENCH_DEF_ITERATIONS    5
+
+static int n_iterations = BENCH_DEF_ITERATIONS;
+static long n_rx_pdus = BENCH_DEF_RX_PDUS;
+
+/* Sets up lags LAGs with ports_per_lag ports each.  Returns the number
+ * of ports. */
+static int
+bench_setup(int lags, int ports_per_lag)
+{
+    int lag_id;
+    int port = 0;
+    int ii;
+
+    harness_init();
+
+    for (lag_id = 1; lag_id <= lags; lag_id++) {
+        harness_add_lag(lag_id);
+        for (ii = 0; ii < ports_per_lag; ii++) {
+            harness_add_port(port++, lag_id);
+        }
+    }
+
+    return port;
+} /* bench_setup */
+
+/* Delivers the partner's answer to every port that has transmitted.
+ * Returns the number of PDUs delivered. */
+static int
+bench_deliver(int n_ports)
+{
+    lacpdu_payload_t reply;
+    int delivered = 0;
+    int port;
+
+    for (port = 0; port < n_ports; port++) {
+        if (harness_take_reply(port, &reply)) {
+            LACP_process_input_pkt(harness_port_handle(port),
+                                   (unsigned char *)&reply, sizeof(reply));
+            delivered++;
+        }
+    }
+
+    return delivered;
+} /* bench_deliver */
+
+static void
+bench_converge(const char *name, int lags, int ports_per_lag)
+{
+    unsigned long long start;
+    unsigned long long first;
+    unsigned long long end;
+    unsigned long tx_start;
+    int n_ports;
+    int delivered;
+    int rounds;
+
+    n_ports = bench_setup(lags, ports_per_lag);
+    tx_start = harness_tx_frames;
+
+    /* A port sends its first LACPDU as soon as it is initialized, so
+     * the first delivery is where every port selects an aggregator. */
+    start = harness_now_ns();
+    delivered = bench_deliver(n_ports);
+    first = harness_now_ns();
+    rounds = harness_converge(n_ports, BENCH_MAX_ROUNDS);
+    end = harness_now_ns();
+
+    printf(BENCH_TAG " case=%s lags=%d ports=%d rounds=%d"
+           " converged=%d tx_pdus=%lu total_us=%llu"
+           " select_ns_per_port=%llu\n",
+           name, lags, n_ports, rounds < 0 ? rounds : rounds + 1,
+           harness_count_mux_state(n_ports,
+                                   MUX_FSM_COLLECTING_DISTRIBUTING_STATE),
+           harness_tx_frames - tx_start, (end - start) / 1000,
+           delivered ? (first - start) / delivered : 0);
+} /* bench_converge */
+
+static void
+bench_rx_steady(int lags, int ports_per_lag)
+{
+    lacpdu_payload_t *pdus;
+    unsigned long long start;
+    unsigned long long end;
+    unsigned long tx_start;
+    int n_ports;
+    int port;
+    long ii;
+
+    n_ports = bench_setup(lags, ports_per_lag);
+    if (harness_converge(n_ports, BENCH_MAX_ROUNDS) < 0) {
+        printf(BENCH_TAG " case=rx_steady lags=%d ports=%d converged=0\n",
+               lags, n_ports);
+        return;
+    }
+
+    /* What the partners would send every periodic time.  Each one only
+     * restarts the port's current_while timer. */
+    pdus = calloc(n_ports, sizeof(*pdus));
+    for (port = 0; port < n_ports; port++) {
+        harness_partner_pdu(port, &pdus[port]);
+    }
+
+    tx_start = harness_tx_frames;
+    start = harness_now_ns();
+    for (ii = 0; ii < n_rx_pdus; ii++) {
+        port = ii % n_ports;
+        LACP_process_input_pkt(harness_port_handle(port),
+                               (unsigned char *)&pdus[port],
+                               sizeof(pdus[port]));
+    }
+    end = harness_now_ns();
+
+    printf(BENCH_TAG " case=rx_steady lags=%d ports=%d pdus=%ld"
+           " tx_pdus=%lu total_us=%llu ns_per_pdu=%llu\n",
+           lags, n_ports, n_rx_pdus, harness_tx_frames - tx_start,
+           (end - start) / 1000, (end - start) / n_rx_pdus);
+
+    free(pdus);
+} /* bench_rx_steady */
+
+static void
+bench_rx_batch(int lags, int ports_per_lag)
+{
+    struct MLt_drivers_mlacp__rxPdu *batch;
+    lacpdu_payload_t pdu;
+    unsigned long long start;
+    unsigned long long end;
+    unsigned long tx_start;
+    int n_ports;
+    int port;
+    long ii;
+    int jj;
+
+    n_ports = bench_setup(lags, ports_per_lag);
+    if (harness_converge(n_ports, BENCH_MAX_ROUNDS) < 0) {
+        printf(BENCH_TAG " case=rx_batch lags=%d ports=%d converged=0\n",
+               lags, n_ports);
+        return;
+    }
+
+    /* n_ports batches of the partners' LACPDUs, the ports taking turns
+     * as in rx_steady. */
+    batch = calloc(n_ports * LACPD_RX_BATCH_SIZE, sizeof(*batch));
+    for (ii = 0; ii < n_ports * LACPD_RX_BATCH_SIZE; ii++) {
+        port = ii % n_ports;
+        harness_partner_pdu(port, &pdu);
+        batch[ii].lport_handle = harness_port_handle(port);
+        batch[ii].pktLen = sizeof(pdu);
+        memcpy(batch[ii].data, &pdu, sizeof(pdu));
+    }
+
+    tx_start = harness_tx_frames;
+    start = harness_now_ns();
+    for (ii = 0, jj = 0; ii < n_rx_pdus; ii += LACPD_RX_BATCH_SIZE) {
+        LACP_process_input_batch(&batch[jj * LACPD_RX_BATCH_SIZE],
+                                 MIN(LACPD_RX_BATCH_SIZE, n_rx_pdus - ii));
+        jj = (jj + 1) % n_ports;
+    }
+    end = harness_now_ns();
+
+    printf(BENCH_TAG " case=rx_batch lags=%d ports=%d pdus=%ld"
+           " batch=%d tx_pdus=%lu total_us=%llu ns_per_pdu=%llu\n",
+           lags, n_ports, n_rx_pdus, LACPD_RX_BATCH_SIZE,
+           harness_tx_frames - tx_start,
+           (end - start) / 1000, (end - start) / n_rx_pdus);
+
+    free(batch);
+} /* bench_rx_batch */
+
+static void
+bench_run_case(const char *name, void (*fn)(int, int), int lags,
+               int ports_per_lag)
+{
+    pid_t pid;
+    int status;
+
+    fflush(stdout);
+
+    pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        fn(lags, ports_per_lag);
+        fflush(stdout);
+        _exit(0);
+    }
+
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s: case %s lags=%d ports_per_lag=%d failed\n",
+                BENCH_TAG, name, lags, ports_per_lag);
+        exit(1);
+    }
+} /* bench_run_case */
+
+static void
+converge_case(int lags, int ports_per_lag)
+{
+    bench_converge("converge", lags, ports_per_lag);
+} /* converge_case */
+
+static void
+select_case(int lags, int ports_per_lag)
+{
+    bench_converge("select", lags, ports_per_lag);
+} /* select_case */
+
+static void
+usage(const char *prog)
+{
+    printf("usage: %s [-i iterations] [-n rx_pdus] [-m lags -p ports]\n"
+           "  -i  runs of every case (default %d)\n"
+           "  -n  LACPDUs received per rx_steady and rx_batch run "
+           "(default %d)\n"
+           "  -m  only run the cases for this many LAGs\n"
+           "  -p  ... with this many ports per LAG\n",
+           prog, BENCH_DEF_ITERATIONS, BENCH_DEF_RX_PDUS);
+} /* usage */
+
+int
+main(int argc, char **argv)
+{
+    static const int converge_sizes[][2] = {
+        { 1, 2 }, { 1, 8 }, { 8, 4 }, { 32, 4 }, { 64, 4 },
+    };
+    static const int select_lags[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    int lags = 0;
+    int ports_per_lag = 0;
+    size_t ii;
+    int opt;
+    int run;
+
+    while ((opt = getopt(argc, argv, "i:n:m:p:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            n_iterations = atoi(optarg);
+            break;
+        case 'n':
+            n_rx_pdus = atol(optarg);
+            break;
+        case 'm':
+            lags = atoi(optarg);
+            break;
+        case 'p':
+            ports_per_lag = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (n_iterations <= 0 || n_rx_pdus <= 0 || lags < 0 ||
+        ports_per_lag < 0 || (lags == 0) != (ports_per_lag == 0) ||
+        lags * ports_per_lag > LACP_MAX_PORTS) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (run = 0; run < n_iterations; run++) {
+        if (lags) {
+            bench_run_case("converge", converge_case, lags, ports_per_lag);
+            bench_run_case("rx_steady", bench_rx_steady, lags,
+                           ports_per_lag);
+            bench_run_case("rx_batch", bench_rx_batch, lags, ports_per_lag);
+            continue;
+        }
+
+        for (ii = 0; ii < ARRAY_SIZE(converge_sizes); ii++) {
+            bench_run_case("converge", converge_case, converge_sizes[ii][0],
+                           converge_sizes[ii][1]);
+        }
+        for (ii = 0; ii < ARRAY_SIZE(select_lags); ii++) {
+            bench_run_case("select", select_case, select_lags[ii], 2);
+        }
+        bench_run_case("rx_steady", bench_rx_steady, 16, 4);
+        bench_run_case("rx_batch", bench_rx_batch, 16, 4);
+    }
+
+    return 0;
+} /* main */
@@ -0,0 +1,493 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacpd_harness.c
+ *
+ *   Stand-ins for the OVSDB and hardware side of lacpd, so the protocol
+ *   sources can be driven from a test program, plus an emulated
+ *   partner system for every LAG.
+ *
+ *   Protocol timers are not left to expire on the clock: the harness
+ *   expires them itself (harness_fire_timers()), so a LAG converges in
+ *   as many rounds as it needs PDU exchanges rather than in seconds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+
+#include <util.h>
+#include <openvswitch/vlog.h>
+
+#include "lacp_cmn.h"
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+
+#include "lacp.h"
+#include "lacp_ops_if.h"
+#include "lacp_support.h"
+#include "mlacp_fproto.h"
+#include "mvlan_sport.h"
+#include "lacp_timer.h"
+#include "lacpd_harness.h"
+
+VLOG_DEFINE_THIS_MODULE(lacpd_harness);
+
+#define HARNESS_LINK_SPEED      10000
+#define HARNESS_PARTNER_PRIO    32768
+
+struct harness_port {
+    bool                configured;
+    int                 lag_id;
+    unsigned int        partner_system_id;          /* low MAC bytes */
+    int                 partner_key;
+    bool                tx_pending;
+    lacpdu_payload_t    tx_frame;                   /* last one sent */
+};
+
+static struct harness_port ports[LACP_MAX_PORTS];
+
+unsigned long harness_tx_frames;
+unsigned long harness_hw_attach;
+unsigned long harness_hw_detach;
+
+/**********************************************************************
+ * Stubs for ovsdb_if.c
+ **********************************************************************/
+void
+ops_trunk_port_egr_enable(uint16_t lag_id OVS_UNUSED, int port OVS_UNUSED)
+{
+} /* ops_trunk_port_egr_enable */
+
+void
+ops_attach_port_in_hw(uint16_t lag_id OVS_UNUSED, int port OVS_UNUSED)
+{
+    harness_hw_attach++;
+} /* ops_attach_port_in_hw */
+
+void
+ops_detach_port_in_hw(uint16_t lag_id OVS_UNUSED, int port OVS_UNUSED)
+{
+    harness_hw_detach++;
+} /* ops_detach_port_in_hw */
+
+void
+db_update_lag_partner_info(uint16_t lag_id OVS_UNUSED)
+{
+} /* db_update_lag_partner_info */
+
+void
+db_clear_lag_partner_info(uint16_t lag_id OVS_UNUSED)
+{
+} /* db_clear_lag_partner_info */
+
+void
+db_add_lag_port(uint16_t lag_id OVS_UNUSED, int port OVS_UNUSED,
+                lacp_per_port_variables_t *plpinfo OVS_UNUSED)
+{
+} /* db_add_lag_port */
+
+void
+db_delete_lag_port(uint16_t lag_id OVS_UNUSED, int port OVS_UNUSED,
+                   lacp_per_port_variables_t *plpinfo OVS_UNUSED)
+{
+} /* db_delete_lag_port */
+
+void
+db_update_interface(lacp_per_port_variables_t *plpinfo OVS_UNUSED)
+{
+} /* db_update_interface */
+
+bool
+lacpd_iface_cfg_get(int index, struct lacpd_iface_cfg *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+
+    if (index < 0 || index >= LACP_MAX_PORTS || !ports[index].configured) {
+        return false;
+    }
+
+    snprintf(cfg->name, sizeof cfg->name, "%d", index + 1);
+    cfg->cfg_lag_id = ports[index].lag_id;
+    cfg->lacp_enabled = true;
+    cfg->valid = true;
+    cfg->link_state = INTERFACE_LINK_STATE_UP;
+    cfg->link_speed = HARNESS_LINK_SPEED;
+
+    return true;
+} /* lacpd_iface_cfg_get */
+
+unsigned int
+lacpd_hw_ops_in_flight(int index OVS_UNUSED)
+{
+    /* The stubs above program the hardware on the spot. */
+    return 0;
+} /* lacpd_hw_ops_in_flight */
+
+/**********************************************************************
+ * Stubs for mlacp_main.c
+ **********************************************************************/
+void
+register_mcast_addr(port_handle_t lport_handle OVS_UNUSED)
+{
+} /* register_mcast_addr */
+
+void
+deregister_mcast_addr(port_handle_t lport_handle OVS_UNUSED)
+{
+} /* deregister_mcast_addr */
+
+void
+mlacp_tx_pdu_header(unsigned char *data)
+{
+    memcpy(data, lacp_mcast_addr, MAC_ADDR_LENGTH);
+    memcpy(&data[MAC_ADDR_LENGTH], my_mac_addr, MAC_ADDR_LENGTH);
+    data[12] = SLOW_PROTOCOLS_ETHERTYPE_PART1;
+    data[13] = SLOW_PROTOCOLS_ETHERTYPE_PART2;
+} /* mlacp_tx_pdu_header */
+
+int
+mlacp_tx_pdu(unsigned char *data, int length, port_handle_t lport_handle)
+{
+    int port = PM_HANDLE2PORT(lport_handle);
+
+    harness_tx_frames++;
+
+    /* Marker responses are counted, but not answered. */
+    if (port >= LACP_MAX_PORTS || length != sizeof(lacpdu_payload_t) ||
+        ((lacpdu_payload_t *)data)->subtype != LACP_SUBTYPE) {
+        if (port < LACP_MAX_PORTS) {
+            __atomic_add_fetch(&lacp_ports[port].stats.
+                               marker_response_pdus_sent, 1,
+                               __ATOMIC_RELAXED);
+        }
+        return 0;
+    }
+
+    LACP_STAT_INC(&lacp_ports[port], lacp_pdus_sent);
+
+    memcpy(&ports[port].tx_frame, data, length);
+    ports[port].tx_pending = true;
+
+    return 0;
+} /* mlacp_tx_pdu */
+
+/**********************************************************************
+ * Emulated partner
+ **********************************************************************/
+static void
+partner_system(unsigned int system_id, unsigned char *mac)
+{
+    mac[0] = 0x02;
+    mac[1] = 0x4c;
+    mac[2] = 0x41;
+    mac[3] = 0x43;
+    mac[4] = (system_id >> 8) & 0xff;
+    mac[5] = system_id & 0xff;
+} /* partner_system */
+
+/* Ethernet header and TLV framing of a LACPDU, with every actor and
+ * partner field zero. */
+static void
+frame_init(lacpdu_payload_t *frame)
+{
+    memset(frame, 0, sizeof(*frame));
+    mlacp_tx_pdu_header(frame->headroom);
+    frame->subtype = LACP_SUBTYPE;
+    frame->version_number = LACP_VERSION;
+    frame->tlv_type_actor = LACP_TLV_ACTOR_INFO;
+    frame->actor_info_length = LACP_TLV_INFO_LENGTH;
+    frame->tlv_type_partner = LACP_TLV_PARTNER_INFO;
+    frame->partner_info_length = LACP_TLV_INFO_LENGTH;
+    frame->tlv_type_collector = LACP_TLV_COLLECTOR_INFO;
+    frame->collector_info_length = LACP_TLV_COLLECTOR_INFO_LENGTH;
+    frame->tlv_type_terminator = LACP_TLV_TERMINATOR_INFO;
+    frame->terminator_length = LACP_TLV_TERMINATOR_INFO_LENGTH;
+} /* frame_init */
+
+/* Fills the actor side of pdu as the partner of port, and the partner
+ * side from the port's actor information in frame. */
+static void
+partner_fill(int port, const lacpdu_payload_t *frame, lacpdu_payload_t *pdu)
+{
+    struct harness_port *hp = &ports[port];
+
+    memcpy(pdu, frame, sizeof(*pdu));
+    partner_system(hp->partner_system_id, &pdu->headroom[MAC_ADDR_LENGTH]);
+
+    pdu->actor_system_priority = htons(HARNESS_PARTNER_PRIO);
+    partner_system(hp->partner_system_id, (unsigned char *)pdu->actor_system);
+    pdu->actor_key = htons(hp->partner_key);
+    pdu->actor_port_priority = htons(1);
+    pdu->actor_port = htons(port + 1);
+
+    memset(&pdu->actor_state, 0, sizeof(pdu->actor_state));
+    pdu->actor_state.lacp_activity = LACP_ACTIVE_MODE;
+    pdu->actor_state.lacp_timeout = frame->actor_state.lacp_timeout;
+    pdu->actor_state.aggregation = AGGREGATABLE;
+    pdu->actor_state.synchronization = 1;
+    pdu->actor_state.collecting = 1;
+    pdu->actor_state.distributing = 1;
+
+    pdu->partner_system_priority = frame->actor_system_priority;
+    memcpy(pdu->partner_system, frame->actor_system, sizeof(macaddr_3_t));
+    pdu->partner_key = frame->actor_key;
+    pdu->partner_port_priority = frame->actor_port_priority;
+    pdu->partner_port = frame->actor_port;
+    pdu->partner_state = frame->actor_state;
+} /* partner_fill */
+
+bool
+harness_take_reply(int port, lacpdu_payload_t *reply)
+{
+    if (!ports[port].tx_pending) {
+        return false;
+    }
+
+    ports[port].tx_pending = false;
+    partner_fill(port, &ports[port].tx_frame, reply);
+
+    return true;
+} /* harness_take_reply */
+
+void
+harness_partner_answer(int port, const lacpdu_payload_t *frame,
+                       lacpdu_payload_t *pdu)
+{
+    lacpdu_payload_t empty;
+
+    if (frame == NULL) {
+        frame_init(&empty);
+        frame = &empty;
+    }
+
+    partner_fill(port, frame, pdu);
+} /* harness_partner_answer */
+
+void
+harness_partner_pdu(int port, lacpdu_payload_t *pdu)
+{
+    lacp_per_port_variables_t *plpinfo = &lacp_ports[port];
+    lacpdu_payload_t frame;
+
+    /* Same as what the port would send now. */
+    frame_init(&frame);
+
+    frame.actor_system_priority =
+        plpinfo->actor_oper_system_variables.system_priority;
+    memcpy(frame.actor_system,
+           plpinfo->actor_oper_system_variables.system_mac_addr,
+           sizeof(macaddr_3_t));
+    frame.actor_key = plpinfo->actor_oper_port_key;
+    frame.actor_port_priority = plpinfo->actor_oper_port_priority;
+    frame.actor_port = plpinfo->actor_oper_port_number;
+    frame.actor_state = plpinfo->actor_oper_port_state;
+
+    partner_fill(port, &frame, pdu);
+} /* harness_partner_pdu */
+
+/**********************************************************************
+ * Setup and driving
+ **********************************************************************/
+void
+harness_init(void)
+{
+    static const unsigned char system_mac[MAC_ADDR_LENGTH] =
+        { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+    memcpy(my_mac_addr, system_mac, MAC_ADDR_LENGTH);
+
+    mvlan_sport_init(TRUE);
+
+    if (lacp_timer_init()) {
+        fprintf(stderr, "Failed to initialize LACP timers\n");
+        exit(1);
+    }
+} /* harness_init */
+
+void
+harness_add_lag(int lag_id)
+{
+    struct MLt_vpm_api__create_sport create;
+    struct MLt_vpm_api__lacp_sport_params params;
+    super_port_t *psport;
+
+    /* Same as send_lag_create_msg() and send_config_lag_msg(). */
+    memset(&create, 0, sizeof(create));
+    create.handle = PM_LAG2HANDLE(lag_id);
+    create.type = STYPE_802_3AD;
+    if (mvlan_sport_create(&create, &psport) != R_SUCCESS) {
+        fprintf(stderr, "Failed to create LAG %d\n", lag_id);
+        exit(1);
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.sport_handle = PM_LAG2HANDLE(lag_id);
+    params.flags = (LACP_LAG_PORT_TYPE_FIELD_PRESENT |
+                    LACP_LAG_ACTOR_KEY_FIELD_PRESENT);
+    params.port_type = PM_LPORT_INVALID;
+    params.actor_key = lag_id;
+    if (mvlan_api_modify_sport_params(&params,
+                                      MLm_vpm_api__set_lacp_sport_params)
+        != R_SUCCESS) {
+        fprintf(stderr, "Failed to configure LAG %d\n", lag_id);
+        exit(1);
+    }
+} /* harness_add_lag */
+
+port_handle_t
+harness_port_handle(int port)
+{
+    return PM_SMPT2HANDLE(0, 0, port, PM_LPORT_10GIGE);
+} /* harness_port_handle */
+
+void
+harness_partner_init(int port, int lag_id)
+{
+    ports[port].lag_id = lag_id;
+    ports[port].partner_system_id = lag_id;
+    ports[port].partner_key = lag_id + 1000;
+} /* harness_partner_init */
+
+void
+harness_partner_set(int port, unsigned int system_id, int key)
+{
+    ports[port].partner_system_id = system_id;
+    ports[port].partner_key = key;
+} /* harness_partner_set */
+
+void
+harness_add_port(int port, int lag_id)
+{
+    ports[port].configured = true;
+    harness_partner_init(port, lag_id);
+
+    /* Same as send_config_lport_msg() for an active LACP member. */
+    LACP_initialize_port(harness_port_handle(port),
+                         port + 1,
+                         (LACP_LPORT_PORT_KEY_PRESENT |
+                          LACP_LPORT_PORT_PRIORITY_PRESENT |
+                          LACP_LPORT_ACTIVITY_FIELD_PRESENT |
+                          LACP_LPORT_TIMEOUT_FIELD_PRESENT |
+                          LACP_LPORT_AGGREGATION_FIELD_PRESENT |
+                          LACP_LPORT_HW_COLL_STATUS_PRESENT),
+                         lag_id,
+                         1,
+                         LACP_ACTIVE_MODE,
+                         LONG_TIMEOUT,
+                         AGGREGATABLE,
+                         INTERFACE_LINK_STATE_UP,
+                         HARNESS_LINK_SPEED,
+                         0,
+                         0,
+                         NULL);
+
+    /* Keep the per-port FSM trace out of the measurements. */
+    lacp_ports[port].debug_level = 0;
+} /* harness_add_port */
+
+static bool
+fire(lacp_timer_t *timer)
+{
+    if (!lacp_timer_running(timer)) {
+        return false;
+    }
+
+    lacp_timer_stop(timer);
+    timer->t_handler(timer);
+
+    return true;
+} /* fire */
+
+bool
+harness_fire_timers(int port)
+{
+    lacp_per_port_variables_t *plpinfo = &lacp_ports[port];
+    bool fired = false;
+
+    fired |= fire(&plpinfo->wait_while_timer);
+    fired |= fire(&plpinfo->async_tx_timer);
+    if (!fired) {
+        fired = fire(&plpinfo->periodic_tx_timer);
+    }
+
+    return fired;
+} /* harness_fire_timers */
+
+int
+harness_count_mux_state(int n_ports, int mux_state)
+{
+    int count = 0;
+    int port;
+
+    for (port = 0; port < n_ports; port++) {
+        if (lacp_ports[port].in_use &&
+            lacp_ports[port].mux_fsm_state == mux_state) {
+            count++;
+        }
+    }
+
+    return count;
+} /* harness_count_mux_state */
+
+int
+harness_converge(int n_ports, int max_rounds)
+{
+    lacpdu_payload_t reply;
+    int rounds;
+    int port;
+
+    for (rounds = 0; rounds < max_rounds; rounds++) {
+        bool delivered = false;
+
+        if (harness_count_mux_state(n_ports,
+                                    MUX_FSM_COLLECTING_DISTRIBUTING_STATE)
+            == n_ports) {
+            return rounds;
+        }
+
+        for (port = 0; port < n_ports; port++) {
+            if (harness_take_reply(port, &reply)) {
+                LACP_process_input_pkt(harness_port_handle(port),
+                                       (unsigned char *)&reply,
+                                       sizeof(reply));
+                delivered = true;
+            }
+        }
+
+        /* Time only moves on once nothing is left to answer. */
+        if (!delivered) {
+            for (port = 0; port < n_ports; port++) {
+                harness_fire_timers(port);
+            }
+        }
+    }
+
+    return -1;
+} /* harness_converge */
+
+unsigned long long
+harness_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+} /* harness_now_ns */
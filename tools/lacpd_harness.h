@@ -0,0 +1,76 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef __LACPD_HARNESS_H__
+#define __LACPD_HARNESS_H__
+
+#include <stdbool.h>
+
+#include "lacp.h"
+
+/* Runs the LACP protocol sources without OVSDB or hardware.  The
+ * functions lacpd normally gets from ovsdb_if.c and mlacp_main.c are
+ * replaced by stubs: transmitted LACPDUs are kept per port instead of
+ * being sent, and an emulated partner system answers them.  Every LAG
+ * has its own partner, whose actor state is always in sync, collecting
+ * and distributing.  Nothing here is thread safe; all calls must come
+ * from the thread that runs the protocol. */
+
+/* Port numbers are 0 to LACP_MAX_PORTS - 1, LAG IDs from 1. */
+extern void harness_init(void);
+extern void harness_add_lag(int lag_id);
+extern void harness_add_port(int port, int lag_id);
+extern port_handle_t harness_port_handle(int port);
+
+/* Takes the last LACPDU the port transmitted, if it sent one since the
+ * previous call, and builds the partner's answer to it in *reply. */
+extern bool harness_take_reply(int port, lacpdu_payload_t *reply);
+
+/* Builds a LACPDU from the port's partner without waiting for the port
+ * to transmit.  Used to inject PDUs at a fixed rate. */
+extern void harness_partner_pdu(int port, lacpdu_payload_t *pdu);
+
+/* Builds the partner's answer to a LACPDU the port sent, which need not
+ * come from this process.  With a NULL frame, the answer is what the
+ * partner sends before it has heard from the port. */
+extern void harness_partner_answer(int port, const lacpdu_payload_t *frame,
+                                   lacpdu_payload_t *pdu);
+
+/* The partner of a port has system ID 02:4c:41:43:00:00 plus system_id
+ * and the given key.  harness_partner_init() sets them from the LAG ID
+ * (system_id = lag_id, key = lag_id + 1000) without setting up the port
+ * itself; harness_add_port() calls it.  Changing either makes the port
+ * select a new aggregator. */
+extern void harness_partner_init(int port, int lag_id);
+extern void harness_partner_set(int port, unsigned int system_id, int key);
+
+/* Expires the port's running wait-while and async Tx timers, or its
+ * periodic Tx timer if neither runs.  Returns true if any fired. */
+extern bool harness_fire_timers(int port);
+
+/* Delivers partner answers and expires timers until every port is
+ * Collecting_Distributing or max_rounds passed.  Returns the number
+ * of rounds, or -1 if the ports did not converge. */
+extern int harness_converge(int n_ports, int max_rounds);
+
+extern int harness_count_mux_state(int n_ports, int mux_state);
+extern unsigned long long harness_now_ns(void);
+
+extern unsigned long harness_tx_frames;
+extern unsigned long harness_hw_attach;
+extern unsigned long harness_hw_detach;
+
+#endif /* __LACPD_HARNESS_H__ */
@@ -0,0 +1,904 @@
+/*
+ * (c) Copyright 2015-2016 Hewlett Packard Enterprise Development LP
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * lacpd_replay.c
+ *
+ *   LACPDU load generator.  Emulates one partner system per LAG and
+ *   sends its LACPDUs at a configured rate, either
+ *
+ *     -T event  into the protocol thread's event queue, through
+ *               ml_send_event() as the RX thread does, with the protocol
+ *               sources running in this process against the stubs in
+ *               lacpd_harness.c, or
+ *     -T veth   onto the peer ends of veth pairs whose other ends are
+ *               LACP members of a running ops-lacpd.
+ *
+ *   The partners answer every LACPDU they receive right away; the rate
+ *   only applies to the load on top of that.  Modes:
+ *
+ *     steady    the partners repeat their last LACPDU.
+ *     flap      every interval, all links go down and come back up.
+ *     key       every interval, every partner changes its key.
+ *     sysid     every interval, every partner changes its system ID.
+ *
+ *   A line is printed every second with the PDU rate achieved, the
+ *   protocol thread's queue depth and the number of ports in
+ *   Collecting_Distributing, then a summary with the time it took all
+ *   ports to get (back) to Collecting_Distributing.  In veth mode the
+ *   queue depth is read from "ovs-appctl lacpd/dump queue".  The event
+ *   target ends with the protocol thread's convergence latency
+ *   histograms (the OVSDB stages are only in lacpd/getlacplatency),
+ *   event queue statistics and cost per event type.
+ *
+ *   Timers run on the clock here, unlike in lacpd-bench, so the times
+ *   to Collecting_Distributing include the wait-while timer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+
+#include <util.h>
+#include <dynamic-string.h>
+
+#include <mqueue.h>
+#include "lacp_cmn.h"
+#include <pm_cmn.h>
+#include <lacp_fsm.h>
+#include <mvlan_lacp.h>
+
+#include "lacp.h"
+#include "lacp_support.h"
+#include "lacp_timer.h"
+#include "mlacp_recv.h"
+#include "mlacp_fproto.h"
+#include "lacpd_harness.h"
+#include "lacp_worker.h"
+
+#define REPLAY_TAG              "lacpd-replay-v1"
+#define REPLAY_FLAP_DOWN_MS     100
+#define REPLAY_IDLE_USEC        50
+
+enum replay_target {
+    TARGET_EVENT,
+    TARGET_VETH,
+};
+
+enum replay_mode {
+    MODE_STEADY,
+    MODE_FLAP,
+    MODE_KEY,
+    MODE_SYSID,
+};
+
+static const char *const mode_names[] = { "steady", "flap", "key", "sysid" };
+
+struct replay_port {
+    lacpdu_payload_t    pdu;            /* what the partner sends next */
+
+    /* veth only */
+    char                name[IFNAMSIZ];
+    int                 fd;
+    lacpdu_payload_t    last_rx;        /* last LACPDU from ops-lacpd */
+    bool                have_rx;
+    bool                coll_dist;      /* as ops-lacpd reports it */
+};
+
+static struct replay_port rports[LACP_MAX_PORTS];
+static int n_ports;
+
+/* Options */
+static enum replay_target target = TARGET_EVENT;
+static enum replay_mode mode = MODE_STEADY;
+static int n_lags = 1;
+static int ports_per_lag = 2;
+static long rate;                       /* PDU/s, 0 = as fast as possible */
+static int duration = 10;               /* seconds */
+static int batch_size = LACPD_RX_BATCH_SIZE;
+static int interval_ms = 5000;          /* between flaps or churns */
+static const char *appctl_target = "ops-lacpd";
+
+/* Protocol state is shared with replay_protocol_thread(), which holds
+ * proto_lock while it handles an event. */
+static pthread_mutex_t proto_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool replay_done;
+
+static struct replay_stats {
+    unsigned long       sent;           /* accepted by the target */
+    unsigned long       dropped;        /* queue full or send failed */
+    unsigned long       answers;        /* partner answers, inside sent */
+    unsigned int        depth;          /* last sample */
+    unsigned int        depth_max;
+    unsigned long long  depth_total;
+    unsigned long       depth_samples;
+
+    /* Time from the start, or from a flap or churn, until every port
+     * is Collecting_Distributing again. */
+    unsigned long long  conv_start_ns;
+    bool                converging;
+    bool                conv_left;      /* some port left C_D since */
+    unsigned int        n_conv;
+    unsigned long long  conv_first_ns;
+    unsigned long long  conv_total_ns;
+    unsigned long long  conv_max_ns;
+} stats;
+
+/**********************************************************************
+ * Common
+ **********************************************************************/
+static void
+replay_sleep_usec(long usec)
+{
+    struct timespec ts;
+
+    ts.tv_sec = usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+} /* replay_sleep_usec */
+
+static void
+depth_sample(int depth)
+{
+    if (depth < 0) {
+        return;
+    }
+
+    stats.depth = depth;
+    if ((unsigned int)depth > stats.depth_max) {
+        stats.depth_max = depth;
+    }
+    stats.depth_total += depth;
+    stats.depth_samples++;
+} /* depth_sample */
+
+/* A flap or churn only counts as done once some port has left
+ * Collecting_Distributing and all of them are back. */
+static void
+converge_start(unsigned long long now, bool must_leave)
+{
+    stats.conv_start_ns = now;
+    stats.converging = true;
+    stats.conv_left = !must_leave;
+} /* converge_start */
+
+static void
+converge_check(unsigned long long now, int n_coll_dist)
+{
+    unsigned long long took;
+
+    if (!stats.converging) {
+        return;
+    }
+
+    if (n_coll_dist < n_ports) {
+        stats.conv_left = true;
+        return;
+    }
+
+    if (!stats.conv_left) {
+        return;
+    }
+
+    took = now - stats.conv_start_ns;
+    if (stats.n_conv == 0) {
+        stats.conv_first_ns = took;
+    }
+    stats.n_conv++;
+    stats.conv_total_ns += took;
+    if (took > stats.conv_max_ns) {
+        stats.conv_max_ns = took;
+    }
+    stats.converging = false;
+} /* converge_check */
+
+/* Changes the partner of every port for the key and sysid modes. */
+static void
+partner_churn(unsigned int generation)
+{
+    int port;
+
+    for (port = 0; port < n_ports; port++) {
+        int lag_id = port / ports_per_lag + 1;
+
+        if (mode == MODE_KEY) {
+            harness_partner_set(port, lag_id,
+                                lag_id + 1000 + (generation % 2) * 2000);
+        } else {
+            harness_partner_set(port,
+                                lag_id + (generation % 2) * 0x8000,
+                                lag_id + 1000);
+        }
+    }
+} /* partner_churn */
+
+static void
+report(double elapsed, int n_coll_dist)
+{
+    printf(REPLAY_TAG " t=%.1f pdus=%lu pdus_per_sec=%.0f dropped=%lu"
+           " queue_depth=%d coll_dist=%d/%d\n",
+           elapsed, stats.sent, elapsed > 0 ? stats.sent / elapsed : 0.0,
+           stats.dropped, stats.depth_samples ? (int)stats.depth : -1,
+           n_coll_dist, n_ports);
+    fflush(stdout);
+} /* report */
+
+static void
+summary(const char *target_name, double elapsed)
+{
+    printf(REPLAY_TAG " summary target=%s mode=%s lags=%d ports=%d"
+           " rate=%ld batch=%d seconds=%.1f pdus=%lu answers=%lu"
+           " dropped=%lu pdus_per_sec=%.0f",
+           target_name, mode_names[mode], n_lags, n_ports, rate,
+           batch_size, elapsed, stats.sent, stats.answers, stats.dropped,
+           elapsed > 0 ? stats.sent / elapsed : 0.0);
+
+    if (stats.depth_samples) {
+        printf(" queue_depth_avg=%llu queue_depth_max=%u",
+               stats.depth_total / stats.depth_samples, stats.depth_max);
+    }
+
+    printf(" converged=%u", stats.n_conv);
+    if (stats.n_conv) {
+        printf(" coll_dist_first_ms=%llu coll_dist_avg_ms=%llu"
+               " coll_dist_max_ms=%llu",
+               stats.conv_first_ns / 1000000,
+               stats.conv_total_ns / stats.n_conv / 1000000,
+               stats.conv_max_ns / 1000000);
+    }
+    printf("\n");
+} /* summary */
+
+/* Number of PDUs of load due by now. */
+static unsigned long
+load_due(unsigned long long elapsed_ns, unsigned long load_sent)
+{
+    if (rate == 0) {
+        return load_sent + batch_size;
+    }
+
+    return (unsigned long)(elapsed_ns / 1000 * rate / 1000000);
+} /* load_due */
+
+/**********************************************************************
+ * Event target
+ **********************************************************************/
+/* One per protocol worker, as in lacpd; arg is the worker number.  The
+ * harness sets the ports up directly, so they all stay on worker 0. */
+static void *
+replay_protocol_thread(void *arg)
+{
+    ML_event *pevent;
+    unsigned long long start_ns;
+
+    lacp_worker_start((int)(intptr_t)arg);
+
+    while (!replay_done) {
+        pevent = ml_wait_for_next_event();
+        if (!pevent) {
+            continue;
+        }
+
+        pthread_mutex_lock(&proto_lock);
+        start_ns = ml_event_clock_ns();
+
+        /* Same dispatch as lacpd_protocol_thread(). */
+        if (pevent->sender.peer == ml_lport_index) {
+            mlacp_process_vlan_msg(pevent);
+        } else if (pevent->sender.peer == ml_timer_index) {
+            mlacp_process_timer();
+        } else if (pevent->sender.peer == ml_rx_pdu_index) {
+            mlacp_process_rx_pdu(pevent);
+        }
+
+        ml_event_account(pevent, start_ns);
+        pthread_mutex_unlock(&proto_lock);
+
+        ml_event_free(pevent);
+    }
+
+    return NULL;
+} /* replay_protocol_thread */
+
+static void
+event_send_timer(int worker)
+{
+    ML_event *event;
+
+    event = ml_event_alloc(sizeof(ML_event));
+    event->sender.peer = ml_timer_index;
+    event->sender.instance = worker;
+    ml_send_event(event);
+} /* event_send_timer */
+
+static void
+event_send_link(int port, bool up)
+{
+    struct MLt_vpm_api__lport_state_change *msg;
+    ML_event *event;
+
+    /* Same as send_link_state_change_msg(). */
+    event = ml_event_alloc(sizeof(ML_event) + sizeof(*msg));
+    event->sender.peer = ml_lport_index;
+    event->msgnum = up ? MLm_vpm_api__lport_state_up :
+                         MLm_vpm_api__lport_state_down;
+
+    msg = (struct MLt_vpm_api__lport_state_change *)(event + 1);
+    msg->lport_handle = harness_port_handle(port);
+    msg->link_speed = 10000;
+
+    ml_send_event(event);
+} /* event_send_link */
+
+/* Posts count PDUs as one RX batch, as mlacp_rx_send_batch() does. */
+static void
+event_send_pdus(const int *port_list, int count, bool answers)
+{
+    struct MLt_drivers_mlacp__rxPduBatch *batch;
+    ML_event *event;
+    int ii;
+
+    event = ml_event_alloc(sizeof(ML_event) + sizeof(*batch) +
+                           count * sizeof(struct MLt_drivers_mlacp__rxPdu));
+    event->sender.peer = ml_rx_pdu_index;
+    event->msgnum = MLm_drivers_mlacp__rxPduBatch;
+
+    batch = (struct MLt_drivers_mlacp__rxPduBatch *)(event + 1);
+    batch->count = count;
+    batch->rx_usec = lacp_latency_now();
+    for (ii = 0; ii < count; ii++) {
+        batch->pdus[ii].lport_handle = harness_port_handle(port_list[ii]);
+        batch->pdus[ii].pktLen = sizeof(lacpdu_payload_t);
+        memcpy(batch->pdus[ii].data, &rports[port_list[ii]].pdu,
+               sizeof(lacpdu_payload_t));
+    }
+
+    if (ml_send_event(event)) {
+        stats.dropped += count;
+    } else {
+        stats.sent += count;
+        if (answers) {
+            stats.answers += count;
+        }
+    }
+} /* event_send_pdus */
+
+static void
+run_event(void)
+{
+    int port_list[LACP_MAX_PORTS];
+    unsigned long long start;
+    unsigned long long now;
+    unsigned long long next_report;
+    unsigned long long next_change;
+    unsigned long long link_up_at = 0;
+    unsigned long load_sent = 0;
+    unsigned int generation = 0;
+    bool links_down = false;
+    int n_coll_dist = 0;
+    int cursor = 0;
+    pthread_t tids[LACPD_PROTOCOL_WORKERS];
+    uint64_t expirations;
+    int worker;
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    int lag_id;
+    int port;
+
+    harness_init();
+    if (ml_init_event_rcvr()) {
+        exit(1);
+    }
+
+    n_ports = n_lags * ports_per_lag;
+    for (lag_id = 1; lag_id <= n_lags; lag_id++) {
+        harness_add_lag(lag_id);
+    }
+    for (port = 0; port < n_ports; port++) {
+        harness_add_port(port, port / ports_per_lag + 1);
+        harness_partner_answer(port, NULL, &rports[port].pdu);
+    }
+
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        pthread_create(&tids[worker], NULL, replay_protocol_thread,
+                       (void *)(intptr_t)worker);
+    }
+
+    start = harness_now_ns();
+    next_report = start + 1000000000ULL;
+    next_change = start + interval_ms * 1000000ULL;
+    converge_start(start, false);
+
+    for (;;) {
+        int n_answers = 0;
+        int n_load = 0;
+
+        now = harness_now_ns();
+        if (now >= start + duration * 1000000000ULL) {
+            break;
+        }
+
+        /* Stand in for the RX thread's timerfd handling. */
+        for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+            if (read(lacp_timer_fd(worker), &expirations,
+                     sizeof(expirations)) > 0) {
+                event_send_timer(worker);
+            }
+        }
+
+        if (mode != MODE_STEADY && now >= next_change) {
+            next_change = now + interval_ms * 1000000ULL;
+            generation++;
+            if (mode == MODE_FLAP) {
+                for (port = 0; port < n_ports; port++) {
+                    event_send_link(port, false);
+                }
+                links_down = true;
+                link_up_at = now + REPLAY_FLAP_DOWN_MS * 1000000ULL;
+            } else {
+                pthread_mutex_lock(&proto_lock);
+                partner_churn(generation);
+                for (port = 0; port < n_ports; port++) {
+                    harness_partner_pdu(port, &rports[port].pdu);
+                }
+                pthread_mutex_unlock(&proto_lock);
+            }
+            converge_start(now, true);
+        }
+
+        if (links_down && now >= link_up_at) {
+            for (port = 0; port < n_ports; port++) {
+                event_send_link(port, true);
+            }
+            links_down = false;
+        }
+
+        /* Pick up what the ports sent and answer it. */
+        pthread_mutex_lock(&proto_lock);
+        for (port = 0; port < n_ports; port++) {
+            if (harness_take_reply(port, &rports[port].pdu) && !links_down) {
+                port_list[n_answers++] = port;
+            }
+        }
+        n_coll_dist = harness_count_mux_state(
+                          n_ports, MUX_FSM_COLLECTING_DISTRIBUTING_STATE);
+        pthread_mutex_unlock(&proto_lock);
+
+        while (n_answers > 0) {
+            int count = (n_answers < batch_size) ? n_answers : batch_size;
+
+            event_send_pdus(&port_list[n_answers - count], count, true);
+            n_answers -= count;
+        }
+
+        converge_check(now, n_coll_dist);
+
+        if (!links_down &&
+            load_due(now - start, load_sent) > load_sent) {
+            n_load = load_due(now - start, load_sent) - load_sent;
+            if (n_load > batch_size) {
+                n_load = batch_size;
+            }
+            for (port = 0; port < n_load; port++) {
+                port_list[port] = cursor;
+                cursor = (cursor + 1) % n_ports;
+            }
+            event_send_pdus(port_list, n_load, false);
+            load_sent += n_load;
+        }
+
+        depth_sample(ml_event_queue_depth());
+
+        if (now >= next_report) {
+            next_report += 1000000000ULL;
+            report((now - start) / 1e9, n_coll_dist);
+        }
+
+        if (n_load == 0) {
+            replay_sleep_usec(REPLAY_IDLE_USEC);
+        }
+    }
+
+    /* Wake the protocol threads so they see replay_done. */
+    replay_done = true;
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        event_send_timer(worker);
+    }
+    for (worker = 0; worker < LACPD_PROTOCOL_WORKERS; worker++) {
+        pthread_join(tids[worker], NULL);
+    }
+
+    summary("event", (now - start) / 1e9);
+
+    /* The protocol side of lacpd/getlacplatency, and what lacpd/dump
+     * queue and lacpd/dump events would show. */
+    lacp_latency_dump(&ds);
+    mlacp_event_queue_dump(&ds);
+    mlacp_event_cost_dump(&ds);
+    fputs(ds_cstr(&ds), stdout);
+    ds_destroy(&ds);
+} /* run_event */
+
+/**********************************************************************
+ * veth target
+ **********************************************************************/
+static int
+veth_open(struct replay_port *rp)
+{
+    struct sockaddr_ll addr;
+    int ifindex;
+
+    ifindex = if_nametoindex(rp->name);
+    if (ifindex == 0) {
+        fprintf(stderr, "%s: no such interface\n", rp->name);
+        return -1;
+    }
+
+    rp->fd = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(ETH_P_SLOW));
+    if (rp->fd < 0) {
+        fprintf(stderr, "%s: socket: %s\n", rp->name, strerror(errno));
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_SLOW);
+    addr.sll_ifindex = ifindex;
+    if (bind(rp->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "%s: bind: %s\n", rp->name, strerror(errno));
+        return -1;
+    }
+
+    return 0;
+} /* veth_open */
+
+static void
+veth_set_up(struct replay_port *rp, bool up)
+{
+    struct ifreq ifr;
+
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", rp->name);
+
+    if (ioctl(rp->fd, SIOCGIFFLAGS, &ifr) != 0) {
+        fprintf(stderr, "%s: SIOCGIFFLAGS: %s\n", rp->name, strerror(errno));
+        return;
+    }
+
+    if (up) {
+        ifr.ifr_flags |= IFF_UP;
+    } else {
+        ifr.ifr_flags &= ~IFF_UP;
+    }
+
+    if (ioctl(rp->fd, SIOCSIFFLAGS, &ifr) != 0) {
+        fprintf(stderr, "%s: SIOCSIFFLAGS: %s\n", rp->name, strerror(errno));
+    }
+} /* veth_set_up */
+
+static void
+veth_send(struct replay_port *rp, bool answer)
+{
+    if (send(rp->fd, &rp->pdu, sizeof(rp->pdu), 0) == sizeof(rp->pdu)) {
+        stats.sent++;
+        if (answer) {
+            stats.answers++;
+        }
+    } else {
+        stats.dropped++;
+    }
+} /* veth_send */
+
+/* Reads what ops-lacpd sent on the port and answers it.  Returns true
+ * if the port got a LACPDU. */
+static bool
+veth_receive(int port)
+{
+    struct replay_port *rp = &rports[port];
+    struct sockaddr_ll from;
+    socklen_t from_len;
+    lacpdu_payload_t frame;
+    bool got = false;
+    ssize_t len;
+
+    for (;;) {
+        from_len = sizeof(from);
+        len = recvfrom(rp->fd, &frame, sizeof(frame), 0,
+                       (struct sockaddr *)&from, &from_len);
+        if (len < 0) {
+            break;
+        }
+
+        /* Our own transmits and Marker PDUs. */
+        if (from.sll_pkttype == PACKET_OUTGOING ||
+            len < (ssize_t)sizeof(frame) || frame.subtype != LACP_SUBTYPE) {
+            continue;
+        }
+
+        rp->last_rx = frame;
+        rp->have_rx = true;
+        rp->coll_dist = (frame.actor_state.collecting &&
+                         frame.actor_state.distributing);
+        got = true;
+    }
+
+    if (got) {
+        harness_partner_answer(port, &rp->last_rx, &rp->pdu);
+    }
+
+    return got;
+} /* veth_receive */
+
+/* Reads the protocol thread's queue depth from ops-lacpd.  Returns -1
+ * if it is not available. */
+static int
+veth_queue_depth(void)
+{
+    char cmd[128];
+    char line[256];
+    int depth = -1;
+    FILE *fp;
+
+    if (appctl_target[0] == '\0') {
+        return -1;
+    }
+
+    snprintf(cmd, sizeof(cmd),
+             "ovs-appctl -t %s lacpd/dump queue 2>/dev/null", appctl_target);
+    fp = popen(cmd, "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, " depth : %d", &depth) == 1) {
+            break;
+        }
+    }
+    pclose(fp);
+
+    return depth;
+} /* veth_queue_depth */
+
+static void
+run_veth(char *ifnames)
+{
+    unsigned long long start;
+    unsigned long long now;
+    unsigned long long next_report;
+    unsigned long long next_change;
+    unsigned long long link_up_at = 0;
+    unsigned long load_sent = 0;
+    unsigned int generation = 0;
+    bool links_down = false;
+    int cursor = 0;
+    char *name;
+    char *save;
+    int port;
+
+    for (name = strtok_r(ifnames, ",", &save); name;
+         name = strtok_r(NULL, ",", &save)) {
+        if (n_ports == LACP_MAX_PORTS) {
+            fprintf(stderr, "Too many interfaces\n");
+            exit(1);
+        }
+        snprintf(rports[n_ports].name, IFNAMSIZ, "%s", name);
+        if (veth_open(&rports[n_ports])) {
+            exit(1);
+        }
+        n_ports++;
+    }
+    n_lags = (n_ports + ports_per_lag - 1) / ports_per_lag;
+
+    /* Only the emulated partners are used here; the LACP actor is the
+     * ops-lacpd on the other end of every veth pair. */
+    for (port = 0; port < n_ports; port++) {
+        harness_partner_init(port, port / ports_per_lag + 1);
+        harness_partner_answer(port, NULL, &rports[port].pdu);
+        veth_send(&rports[port], true);
+    }
+
+    start = harness_now_ns();
+    next_report = start + 1000000000ULL;
+    next_change = start + interval_ms * 1000000ULL;
+    converge_start(start, false);
+
+    for (;;) {
+        int n_coll_dist = 0;
+        long n_load = 0;
+
+        now = harness_now_ns();
+        if (now >= start + duration * 1000000000ULL) {
+            break;
+        }
+
+        if (mode != MODE_STEADY && now >= next_change) {
+            next_change = now + interval_ms * 1000000ULL;
+            generation++;
+            if (mode == MODE_FLAP) {
+                for (port = 0; port < n_ports; port++) {
+                    veth_set_up(&rports[port], false);
+                    rports[port].coll_dist = false;
+                }
+                links_down = true;
+                link_up_at = now + REPLAY_FLAP_DOWN_MS * 1000000ULL;
+            } else {
+                partner_churn(generation);
+                for (port = 0; port < n_ports; port++) {
+                    struct replay_port *rp = &rports[port];
+
+                    harness_partner_answer(port,
+                                           rp->have_rx ? &rp->last_rx : NULL,
+                                           &rp->pdu);
+                    veth_send(rp, true);
+                }
+            }
+            converge_start(now, true);
+        }
+
+        if (links_down && now >= link_up_at) {
+            for (port = 0; port < n_ports; port++) {
+                veth_set_up(&rports[port], true);
+            }
+            links_down = false;
+        }
+
+        for (port = 0; port < n_ports; port++) {
+            if (veth_receive(port) && !links_down) {
+                veth_send(&rports[port], true);
+            }
+            n_coll_dist += rports[port].coll_dist;
+        }
+
+        converge_check(now, n_coll_dist);
+
+        if (!links_down) {
+            n_load = load_due(now - start, load_sent) - load_sent;
+            if (n_load > batch_size) {
+                n_load = batch_size;
+            }
+            while (n_load-- > 0) {
+                veth_send(&rports[cursor], false);
+                cursor = (cursor + 1) % n_ports;
+                load_sent++;
+            }
+        }
+
+        if (now >= next_report) {
+            next_report += 1000000000ULL;
+            depth_sample(veth_queue_depth());
+            report((now - start) / 1e9, n_coll_dist);
+        }
+
+        if (n_load <= 0) {
+            replay_sleep_usec(REPLAY_IDLE_USEC);
+        }
+    }
+
+    summary("veth", (now - start) / 1e9);
+} /* run_veth */
+
+/**********************************************************************
+ * Main
+ **********************************************************************/
+static void
+usage(const char *prog)
+{
+    printf("usage: %s [options]\n"
+           "  -T event|veth   where the LACPDUs go (default event)\n"
+           "  -M steady|flap|key|sysid\n"
+           "                  load pattern (default steady)\n"
+           "  -l lags         number of LAGs, event target (default 1)\n"
+           "  -p ports        ports per LAG (default 2)\n"
+           "  -i if1,if2,...  veth peer interfaces, veth target; every\n"
+           "                  -p consecutive ones form one LAG\n"
+           "  -r rate         PDUs per second, 0 = unlimited (default 0)\n"
+           "  -b batch        PDUs per RX event or send burst (default %d)\n"
+           "  -c msec         time between flaps or churns (default 5000)\n"
+           "  -d seconds      duration (default 10)\n"
+           "  -a target       ovs-appctl target for the queue depth,\n"
+           "                  \"\" for none (default ops-lacpd)\n",
+           prog, LACPD_RX_BATCH_SIZE);
+} /* usage */
+
+int
+main(int argc, char **argv)
+{
+    char *ifnames = NULL;
+    int opt;
+    int ii;
+
+    while ((opt = getopt(argc, argv, "T:M:l:p:i:r:b:c:d:a:h")) != -1) {
+        switch (opt) {
+        case 'T':
+            if (!strcmp(optarg, "event")) {
+                target = TARGET_EVENT;
+            } else if (!strcmp(optarg, "veth")) {
+                target = TARGET_VETH;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'M':
+            for (ii = 0; ii < (int)ARRAY_SIZE(mode_names); ii++) {
+                if (!strcmp(optarg, mode_names[ii])) {
+                    break;
+                }
+            }
+            if (ii == (int)ARRAY_SIZE(mode_names)) {
+                usage(argv[0]);
+                return 1;
+            }
+            mode = ii;
+            break;
+        case 'l':
+            n_lags = atoi(optarg);
+            break;
+        case 'p':
+            ports_per_lag = atoi(optarg);
+            break;
+        case 'i':
+            ifnames = optarg;
+            break;
+        case 'r':
+            rate = atol(optarg);
+            break;
+        case 'b':
+            batch_size = atoi(optarg);
+            break;
+        case 'c':
+            interval_ms = atoi(optarg);
+            break;
+        case 'd':
+            duration = atoi(optarg);
+            break;
+        case 'a':
+            appctl_target = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    if (n_lags <= 0 || ports_per_lag <= 0 || rate < 0 || batch_size <= 0 ||
+        batch_size > LACP_MAX_PORTS || interval_ms <= REPLAY_FLAP_DOWN_MS ||
+        duration <= 0 ||
+        (target == TARGET_EVENT && n_lags * ports_per_lag > LACP_MAX_PORTS) ||
+        (target == TARGET_VETH && ifnames == NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (target == TARGET_EVENT) {
+        run_event();
+    } else {
+        run_veth(ifnames);
+    }
+
+    return 0;
+} /* main */